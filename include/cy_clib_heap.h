@@ -0,0 +1,163 @@
+/***********************************************************************************************//**
+ * \file cy_clib_heap.h
+ *
+ * \brief
+ * Optional heap extensions for the C library allocator
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Maximum number of heap regions, including the heap defined by the linker script */
+#ifndef CY_CLIB_HEAP_REGION_MAX
+#define CY_CLIB_HEAP_REGION_MAX     (4U)
+#endif
+
+/** Usage of one heap region */
+typedef struct
+{
+    void*  base;        /**< Start address of the region */
+    size_t size;        /**< Size of the region in bytes */
+    size_t used;        /**< Bytes currently handed to the C library heap */
+    size_t high_water;  /**< Highest number of bytes ever handed to the C library heap */
+} cy_clib_heap_region_stats_t;
+
+/** Adds a memory region to the C library heap. With GCC Newlib the whole region is freed into
+ *  the allocator as one block; with the ARM C library the heap grows into it once the regions
+ *  before it are exhausted. Regions must not overlap and should be added during startup, before
+ *  other tasks allocate memory. Returns false if CY_CLIB_HEAP_REGION_MAX regions are already in
+ *  use. */
+bool cy_clib_heap_add_region(void* base, size_t size);
+
+/** Copies the usage of up to count heap regions, in the order they are used, into stats and
+ *  returns the number of entries written. */
+uint32_t cy_clib_heap_get_region_stats(cy_clib_heap_region_stats_t* stats, uint32_t count);
+
+/** Sets the region of the heap defined by the linker script. Called by the toolchain port. */
+void cy_clib_heap_set_default_region(void* base, size_t size);
+
+/** Moves the break of the heap defined by the linker script by incr bytes and returns the
+ *  previous break, or NULL if the region cannot satisfy the request. The memory added always
+ *  continues the memory of the previous call; other regions are never used. Called by the
+ *  toolchain port (_sbrk) with the C library heap lock held. */
+void* cy_clib_heap_sbrk(intptr_t incr);
+
+/** Returns size bytes from the region that served the previous call while it has room,
+ *  otherwise from the first region that does, or NULL if no region can. For allocators that
+ *  accept memory that does not continue their previous block (__rt_heap_extend). Called by the
+ *  toolchain port with the C library heap lock held. */
+void* cy_clib_heap_extend(size_t size);
+
+/** Offers a region added with cy_clib_heap_add_region to the C library allocator as a whole.
+ *  Returns true if the allocator took it, in which case the region is never used by
+ *  cy_clib_heap_extend. The default (weak) implementation returns false; the toolchain port
+ *  overrides it. */
+bool cy_clib_heap_give_region(void* base, size_t size);
+
+#if defined(CY_CLIB_HEAP_STATS)
+/** Heap usage snapshot */
+typedef struct
+{
+    size_t   heap_size;         /**< Total size of all heap regions in bytes */
+    size_t   in_use;            /**< Bytes in heap blocks allocated through malloc, realloc and
+                                     calloc (usable size, including the 4-byte tag) */
+    size_t   in_use_peak;       /**< Highest value in_use has reached */
+    size_t   free;              /**< heap_size - in_use, including allocator overhead, cached
+                                     blocks and blocks the C library allocates internally */
+    size_t   largest_free;      /**< Lower bound of the largest free block: the largest of the
+                                     free block estimate kept by the wrappers, the allocator's
+                                     top chunk with the unclaimed rest of the linker heap, and
+                                     the unclaimed space of each region */
+    uint32_t fragmentation;     /**< 1000 * (1 - largest_free / free), an upper bound: 0 when
+                                     all free memory is one block, approaching 1000 as it is
+                                     split up */
+    size_t   sbrk_in_use;       /**< Bytes currently claimed from the regions through sbrk */
+    size_t   sbrk_high_water;   /**< Highest value sbrk_in_use has reached */
+    uint32_t sbrk_calls;        /**< Number of sbrk calls */
+    uint32_t allocations;       /**< Number of successful allocations, including pool blocks */
+    uint32_t frees;             /**< Number of blocks freed, including pool blocks */
+    uint32_t failures;          /**< Number of allocations that returned NULL */
+} cy_clib_heap_stats_t;
+
+/** Takes a snapshot of the heap counters. This does not walk the heap or take the heap lock. */
+void cy_clib_heap_get_stats(cy_clib_heap_stats_t* stats);
+
+/** Returns the size of the allocator's top chunk, the free block that the next sbrk extends, or
+ *  0 if the allocator has none. Read without the heap lock. The default (weak) implementation
+ *  returns 0; the toolchain port overrides it. */
+size_t cy_clib_heap_top_free(void);
+#endif // defined(CY_CLIB_HEAP_STATS)
+
+#if defined(CY_CLIB_HEAP_CACHE)
+/** Returns all blocks held in the calling task's small-object cache to the heap. The cache is
+ *  flushed automatically when a task is deleted on RTOS configurations that provide a deletion
+ *  callback for thread local storage; otherwise a task should call this before it exits. */
+void cy_clib_heap_cache_flush(void);
+#endif // defined(CY_CLIB_HEAP_CACHE)
+
+#if defined(CY_CLIB_HEAP_POOL)
+/** Pool classes as CLASS(block size, block count) entries in ascending block size. Block sizes
+ *  must be distinct multiples of 8 bytes and each class may hold up to 65535 blocks. */
+#ifndef CY_CLIB_HEAP_POOL_CLASSES
+#define CY_CLIB_HEAP_POOL_CLASSES(CLASS) \
+    CLASS(16U, 32U)                      \
+    CLASS(32U, 32U)                      \
+    CLASS(64U, 16U)                      \
+    CLASS(128U, 8U)
+#endif
+
+/** Occupancy of one pool class */
+typedef struct
+{
+    uint32_t block_size;    /**< Size of each block in bytes */
+    uint32_t block_count;   /**< Number of blocks reserved for the class */
+    uint32_t in_use;        /**< Number of blocks currently allocated */
+    uint32_t peak;          /**< Highest number of blocks allocated at the same time */
+    uint32_t exhausted;     /**< Number of requests the class could not serve */
+} cy_clib_heap_pool_stats_t;
+
+/** Allocates a block from the smallest pool class that fits size and has a free block.
+ *  Returns NULL if there is none; the caller then falls back to the heap. */
+void* cy_clib_heap_pool_alloc(size_t size);
+
+/** Returns a block to its pool. Returns false, without doing anything, if ptr does not point
+ *  into the pool memory. */
+bool cy_clib_heap_pool_free(void* ptr);
+
+/** Returns the block size of the pool class ptr belongs to, or 0 if ptr is not a pool block. */
+size_t cy_clib_heap_pool_block_size(const void* ptr);
+
+/** Copies the occupancy of up to count pool classes, smallest first, into stats and returns
+ *  the number of entries written. */
+uint32_t cy_clib_heap_pool_get_stats(cy_clib_heap_pool_stats_t* stats, uint32_t count);
+#endif // defined(CY_CLIB_HEAP_POOL)
+
+#ifdef __cplusplus
+}
+#endif
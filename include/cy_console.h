@@ -0,0 +1,122 @@
+/***********************************************************************************************//**
+ * \file cy_console.h
+ *
+ * \brief
+ * Buffered console output shared by the toolchain stdout and stderr hooks
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(CY_CONSOLE)
+
+/** Size of the output ring buffer in bytes. Must be a power of two. */
+#ifndef CY_CONSOLE_RING_SIZE
+#define CY_CONSOLE_RING_SIZE        (2048U)
+#endif
+
+/** Number of tasks that can collect a partial line at the same time */
+#ifndef CY_CONSOLE_LINE_BUFFERS
+#define CY_CONSOLE_LINE_BUFFERS     (4U)
+#endif
+
+/** Size of each line buffer in bytes */
+#ifndef CY_CONSOLE_LINE_SIZE
+#define CY_CONSOLE_LINE_SIZE        (80U)
+#endif
+
+/** RTOS ticks (milliseconds on POSIX) after which the draining task passes a partial line that
+ *  has stopped growing, such as a prompt or the rest of a deleted task's output, to the sink */
+#ifndef CY_CONSOLE_LINE_TIMEOUT
+#define CY_CONSOLE_LINE_TIMEOUT     (50U)
+#endif
+
+/** Receives console output, in the order it was written. Called only by the task that drains
+ *  the console (see cy_console_drain). */
+/** \param context Value passed to cy_console_set_sink
+ *  \param data    Output bytes
+ *  \param size    Number of bytes */
+typedef void (*cy_console_sink_t)(void* context, const uint8_t* data, size_t size);
+
+/** Sets the function that sends console output to the device, such as a UART. Output written
+ *  before a sink is set is kept in the ring buffer until one is. */
+/** \param sink    Output function, NULL to stop draining
+ *  \param context Passed to sink */
+void cy_console_set_sink(cy_console_sink_t sink, void* context);
+
+/** Queues console output. Single-byte writes from a task are collected in a line buffer until
+ *  the end of the line, or until the line has not grown for CY_CONSOLE_LINE_TIMEOUT ticks; other
+ *  writes are queued as a unit. Never waits for the sink. If the ring buffer is full, the output
+ *  is dropped unless CY_CONSOLE_BLOCKING is defined, in which case a task waits for room. Can be
+ *  called from interrupt handlers, which never wait. */
+/** \param data Output bytes
+ *  \param size Number of bytes
+ *  \return size, also if the output was dropped */
+size_t cy_console_write(const void* data, size_t size);
+
+/** Passes all queued output to the sink. Meant to be called in a loop by a low-priority task
+ *  that owns the sink. Returns 0 without waiting if another task is draining the console. */
+/** \param wait Whether to wait for output if there is none (requires the kernel to be started)
+ *  \return Number of bytes passed to the sink */
+size_t cy_console_drain(bool wait);
+
+/** Queues the calling task's partial line and, unless another task is draining the console,
+ *  passes all queued output to the sink in the calling task. */
+void cy_console_flush(void);
+
+/** Console counters */
+typedef struct
+{
+    uint32_t written;       /**< Bytes queued */
+    uint32_t dropped;       /**< Bytes dropped because the ring buffer was full */
+    uint32_t drained;       /**< Bytes passed to the sink */
+    uint32_t high_water;    /**< Most bytes of the ring buffer in use at the same time */
+    uint32_t waits;         /**< Writes that waited for room (CY_CONSOLE_BLOCKING) */
+} cy_console_stats_t;
+
+/** Returns the console counters. */
+/** \param stats Receives the counters */
+void cy_console_get_stats(cy_console_stats_t* stats);
+
+#if defined(COMPONENT_POSIX)
+/** Sink writing to a file descriptor, given as the context. */
+void cy_console_posix_sink(void* context, const uint8_t* data, size_t size);
+#elif defined(__ARM_ARCH_PROFILE) && (__ARM_ARCH_PROFILE == 'M') && \
+    defined(__ARM_ARCH_ISA_THUMB) && (__ARM_ARCH_ISA_THUMB >= 2)
+/** Sink writing to the debugger through an ITM stimulus port, given as the context. Output is
+ *  discarded while the debugger has not enabled the port. */
+void cy_console_itm_sink(void* context, const uint8_t* data, size_t size);
+#define CY_CONSOLE_ITM_AVAILABLE
+#endif // if defined(COMPONENT_POSIX)
+
+#endif // defined(CY_CONSOLE)
+
+#ifdef __cplusplus
+}
+#endif
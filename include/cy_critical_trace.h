@@ -0,0 +1,103 @@
+/***********************************************************************************************//**
+ * \file cy_critical_trace.h
+ *
+ * \brief
+ * Duration histograms of the critical sections opened by this library
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(CY_CRITICAL_TRACE)
+
+/** Critical sections opened by the library */
+typedef enum
+{
+    CY_CRITICAL_TRACE_POOL_CREATE,      /**< Slot allocation in cy_mutex_pool_create */
+    CY_CRITICAL_TRACE_POOL_DESTROY,     /**< Slot release in cy_mutex_pool_destroy */
+    CY_CRITICAL_TRACE_PARK,             /**< Queueing a waiter in cy_mutex_pool_park */
+    CY_CRITICAL_TRACE_UNPARK,           /**< Detaching waiters in cy_mutex_pool_unpark_all */
+    CY_CRITICAL_TRACE_SUSPEND_THREADS,  /**< Scheduler suspended by cy_mutex_pool_suspend_threads */
+    CY_CRITICAL_TRACE_SITE_COUNT
+} cy_critical_trace_site_t;
+
+/** Number of histogram buckets. Bucket 0 counts sections of 0 timestamp units, bucket b sections
+ *  of 2^(b-1) to 2^b - 1 units; the last bucket also counts all longer sections. */
+#ifndef CY_CRITICAL_TRACE_BUCKETS
+#define CY_CRITICAL_TRACE_BUCKETS   (24U)
+#endif
+
+/** Durations recorded for one critical section */
+typedef struct
+{
+    uint32_t count;                                 /**< Number of times the section was entered */
+    uint32_t max;                                   /**< Longest duration */
+    void*    max_caller;                            /**< Return address of the library function
+                                                         that opened the longest section */
+    uint32_t histogram[CY_CRITICAL_TRACE_BUCKETS];  /**< log2 histogram of the durations */
+} cy_critical_trace_stats_t;
+
+/** Copies the durations recorded for a critical section into stats. */
+void cy_critical_trace_get(cy_critical_trace_site_t site, cy_critical_trace_stats_t* stats);
+
+/** Returns a printable name for a critical section. */
+const char* cy_critical_trace_site_name(cy_critical_trace_site_t site);
+
+/** Clears all recorded durations. */
+void cy_critical_trace_reset(void);
+
+/** Internal use only. Returns the current timestamp. */
+uint32_t cy_critical_trace_timestamp(void);
+
+/** Internal use only. Records a section that started at start; called before leaving it. */
+void cy_critical_trace_record(cy_critical_trace_site_t site, uint32_t start, void* caller);
+
+/** Internal use only. Mark the outermost cy_mutex_pool_suspend_threads region. */
+void cy_critical_trace_suspend_begin(void* caller);
+void cy_critical_trace_suspend_end(void);
+
+#if defined(__GNUC__)
+#define CY_CRITICAL_TRACE_CALLER()              __builtin_return_address(0)
+#else
+#define CY_CRITICAL_TRACE_CALLER()              ((void*)0)
+#endif
+
+/** Internal use only. Placed right after entering and right before leaving a critical section. */
+#define CY_CRITICAL_TRACE_BEGIN(start)          uint32_t start = cy_critical_trace_timestamp()
+#define CY_CRITICAL_TRACE_END(site, start)      \
+    cy_critical_trace_record((site), (start), CY_CRITICAL_TRACE_CALLER())
+
+#else // if defined(CY_CRITICAL_TRACE)
+
+#define CY_CRITICAL_TRACE_BEGIN(start)
+#define CY_CRITICAL_TRACE_END(site, start)
+
+#endif // if defined(CY_CRITICAL_TRACE)
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,265 @@
+/***********************************************************************************************//**
+ * \file cy_log.h
+ *
+ * \brief
+ * Binary logging: records a format string ID and the raw arguments, which a host tool formats
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(CY_LOG_ENABLED)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Size of the log ring buffer in bytes. Must be a power of two. */
+#ifndef CY_LOG_RING_SIZE
+#define CY_LOG_RING_SIZE        (1024U)
+#endif
+
+/** Most bytes of a string argument that are recorded; longer strings are cut */
+#ifndef CY_LOG_STRING_MAX
+#define CY_LOG_STRING_MAX       (32U)
+#endif
+
+/** Most arguments of a CY_LOG call */
+#define CY_LOG_ARGS_MAX         (8U)
+
+/** Section holding the format strings, which the host decoder reads from the ELF file. The code
+ *  only uses their addresses, so the section can be left out of the image (see README.md). */
+#ifndef CY_LOG_FORMAT_SECTION
+#if defined(__ICCARM__)
+#define CY_LOG_FORMAT_SECTION   _Pragma("location=\".cy_log_fmt\"")
+#elif defined(__APPLE__)
+#define CY_LOG_FORMAT_SECTION   __attribute__((section("__DATA,.cy_log_fmt")))
+#else
+#define CY_LOG_FORMAT_SECTION   __attribute__((section(".cy_log_fmt")))
+#endif
+#endif // ifndef CY_LOG_FORMAT_SECTION
+
+/** Receives encoded log records. Called only by the task that drains the log. */
+/** \param context Value passed to cy_log_set_sink
+ *  \param data    Output bytes
+ *  \param size    Number of bytes */
+typedef void (*cy_log_sink_t)(void* context, const uint8_t* data, size_t size);
+
+/** Internal use only. How an argument is recorded. */
+typedef enum
+{
+    CY_LOG_ARG_WORD,    /**< 32 bits: int and smaller, long on 32-bit targets */
+    CY_LOG_ARG_INT64,   /**< 64 bits: long long, long and pointers on 64-bit hosts */
+    CY_LOG_ARG_DOUBLE,  /**< IEEE 754 double: float and double */
+    CY_LOG_ARG_STRING   /**< Up to CY_LOG_STRING_MAX characters of a string */
+} cy_log_arg_kind_t;
+
+/** Internal use only. An argument of CY_LOG. */
+typedef struct
+{
+    uint64_t          value;    /**< Value, or the address of a string */
+    cy_log_arg_kind_t kind;     /**< How the value is recorded */
+} cy_log_arg_t;
+
+/** Sets the function that sends encoded log records to the host, such as a UART or a debugger
+ *  channel other than the one used for the console. */
+/** \param sink    Output function, NULL to stop draining
+ *  \param context Passed to sink */
+void cy_log_set_sink(cy_log_sink_t sink, void* context);
+
+/** Passes all recorded log entries to the sink. Call it periodically from a low-priority task.
+ *  Returns 0 if another task is draining the log. */
+/** \return Number of records passed to the sink */
+size_t cy_log_drain(void);
+
+/** Log counters */
+typedef struct
+{
+    uint32_t recorded;      /**< Records written to the ring buffer */
+    uint32_t dropped;       /**< Records dropped because the ring buffer was full */
+    uint32_t high_water;    /**< Most bytes of the ring buffer in use at the same time */
+} cy_log_stats_t;
+
+/** Returns the log counters. */
+/** \param stats Receives the counters */
+void cy_log_get_stats(cy_log_stats_t* stats);
+
+/** Internal use only. Records a CY_LOG call. */
+void cy_log_record(const char* format, const cy_log_arg_t* args, uint32_t count);
+
+//--------------------------------------------------------------------------------------------------
+// cy_log_arg_word
+//--------------------------------------------------------------------------------------------------
+static inline cy_log_arg_t cy_log_arg_word(uint32_t value)
+{
+    cy_log_arg_t arg = { value, CY_LOG_ARG_WORD };
+    return arg;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_log_arg_int64
+//--------------------------------------------------------------------------------------------------
+static inline cy_log_arg_t cy_log_arg_int64(uint64_t value)
+{
+    cy_log_arg_t arg = { value, CY_LOG_ARG_INT64 };
+    return arg;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_log_arg_long
+//--------------------------------------------------------------------------------------------------
+static inline cy_log_arg_t cy_log_arg_long(unsigned long value)
+{
+    return (sizeof(long) > 4U) ? cy_log_arg_int64(value) : cy_log_arg_word((uint32_t)value);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_log_arg_pointer
+//--------------------------------------------------------------------------------------------------
+static inline cy_log_arg_t cy_log_arg_pointer(const volatile void* value)
+{
+    return (sizeof(void*) > 4U) ? cy_log_arg_int64((uintptr_t)value) :
+           cy_log_arg_word((uint32_t)(uintptr_t)value);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_log_arg_double
+//--------------------------------------------------------------------------------------------------
+static inline cy_log_arg_t cy_log_arg_double(double value)
+{
+    cy_log_arg_t arg = { 0U, CY_LOG_ARG_DOUBLE };
+    (void)memcpy(&arg.value, &value, sizeof(value));
+    return arg;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_log_arg_string
+//--------------------------------------------------------------------------------------------------
+static inline cy_log_arg_t cy_log_arg_string(const char* value)
+{
+    cy_log_arg_t arg = { (uintptr_t)value, CY_LOG_ARG_STRING };
+    return arg;
+}
+
+
+#ifdef __cplusplus
+}
+
+// C++ picks the recording of each argument by overloading
+#define CY_LOG_OVERLOAD(type, record) \
+    static inline cy_log_arg_t cy_log_arg(type value) { return record; }
+CY_LOG_OVERLOAD(float, cy_log_arg_double(value))
+CY_LOG_OVERLOAD(double, cy_log_arg_double(value))
+CY_LOG_OVERLOAD(long, cy_log_arg_long((unsigned long)value))
+CY_LOG_OVERLOAD(unsigned long, cy_log_arg_long(value))
+CY_LOG_OVERLOAD(long long, cy_log_arg_int64((uint64_t)value))
+CY_LOG_OVERLOAD(unsigned long long, cy_log_arg_int64(value))
+CY_LOG_OVERLOAD(const char*, cy_log_arg_string(value))
+CY_LOG_OVERLOAD(const volatile void*, cy_log_arg_pointer(value))
+CY_LOG_OVERLOAD(bool, cy_log_arg_word(value ? 1U : 0U))
+CY_LOG_OVERLOAD(char, cy_log_arg_word((uint32_t)value))
+CY_LOG_OVERLOAD(signed char, cy_log_arg_word((uint32_t)value))
+CY_LOG_OVERLOAD(unsigned char, cy_log_arg_word(value))
+CY_LOG_OVERLOAD(short, cy_log_arg_word((uint32_t)value))
+CY_LOG_OVERLOAD(unsigned short, cy_log_arg_word(value))
+CY_LOG_OVERLOAD(int, cy_log_arg_word((uint32_t)value))
+CY_LOG_OVERLOAD(unsigned int, cy_log_arg_word(value))
+#undef CY_LOG_OVERLOAD
+#define CY_LOG_ARG(x)   cy_log_arg(x)
+#else // ifdef __cplusplus
+// C picks the recording of each argument with _Generic. Pointers other than
+// void* and char* must be cast to void* for %p.
+#define CY_LOG_ARG(x)                                 \
+    _Generic((x),                                     \
+             float: cy_log_arg_double,                \
+             double: cy_log_arg_double,               \
+             long: cy_log_arg_long,                   \
+             unsigned long: cy_log_arg_long,          \
+             long long: cy_log_arg_int64,             \
+             unsigned long long: cy_log_arg_int64,    \
+             char*: cy_log_arg_string,                \
+             const char*: cy_log_arg_string,          \
+             void*: cy_log_arg_pointer,               \
+             const void*: cy_log_arg_pointer,         \
+             volatile void*: cy_log_arg_pointer,      \
+             const volatile void*: cy_log_arg_pointer, \
+             default: cy_log_arg_word)(x)
+#endif // ifdef __cplusplus
+
+#define CY_LOG_STR_(x)          #x
+#define CY_LOG_STR(x)           CY_LOG_STR_(x)
+#define CY_LOG_CAT_(a, b)       a ## b
+#define CY_LOG_CAT(a, b)        CY_LOG_CAT_(a, b)
+#define CY_LOG_COUNT_(_1, _2, _3, _4, _5, _6, _7, _8, _9, n, ...) n
+#define CY_LOG_COUNT(...)       CY_LOG_COUNT_(__VA_ARGS__, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+
+// The format string is followed by the source location, which the decoder
+// can show; neither takes space in the image if the section is left out.
+#define CY_LOG_RECORD(format, count, ...)                                                  \
+    do {                                                                                   \
+        CY_LOG_FORMAT_SECTION static const char cy_log_format[] =                          \
+            format "\0" __FILE__ ":" CY_LOG_STR(__LINE__);                                 \
+        const cy_log_arg_t cy_log_args[] = { __VA_ARGS__ };                                \
+        cy_log_record(cy_log_format, cy_log_args, (count));                                \
+    } while (false)
+
+#define CY_LOG_1(f)     CY_LOG_RECORD(f, 0U, { 0U, CY_LOG_ARG_WORD })
+#define CY_LOG_2(f, a)  CY_LOG_RECORD(f, 1U, CY_LOG_ARG(a))
+#define CY_LOG_3(f, a, b) \
+    CY_LOG_RECORD(f, 2U, CY_LOG_ARG(a), CY_LOG_ARG(b))
+#define CY_LOG_4(f, a, b, c) \
+    CY_LOG_RECORD(f, 3U, CY_LOG_ARG(a), CY_LOG_ARG(b), CY_LOG_ARG(c))
+#define CY_LOG_5(f, a, b, c, d) \
+    CY_LOG_RECORD(f, 4U, CY_LOG_ARG(a), CY_LOG_ARG(b), CY_LOG_ARG(c), CY_LOG_ARG(d))
+#define CY_LOG_6(f, a, b, c, d, e)                                                    \
+    CY_LOG_RECORD(f, 5U, CY_LOG_ARG(a), CY_LOG_ARG(b), CY_LOG_ARG(c), CY_LOG_ARG(d), \
+                  CY_LOG_ARG(e))
+#define CY_LOG_7(f, a, b, c, d, e, g)                                                 \
+    CY_LOG_RECORD(f, 6U, CY_LOG_ARG(a), CY_LOG_ARG(b), CY_LOG_ARG(c), CY_LOG_ARG(d), \
+                  CY_LOG_ARG(e), CY_LOG_ARG(g))
+#define CY_LOG_8(f, a, b, c, d, e, g, h)                                              \
+    CY_LOG_RECORD(f, 7U, CY_LOG_ARG(a), CY_LOG_ARG(b), CY_LOG_ARG(c), CY_LOG_ARG(d), \
+                  CY_LOG_ARG(e), CY_LOG_ARG(g), CY_LOG_ARG(h))
+#define CY_LOG_9(f, a, b, c, d, e, g, h, i)                                           \
+    CY_LOG_RECORD(f, 8U, CY_LOG_ARG(a), CY_LOG_ARG(b), CY_LOG_ARG(c), CY_LOG_ARG(d), \
+                  CY_LOG_ARG(e), CY_LOG_ARG(g), CY_LOG_ARG(h), CY_LOG_ARG(i))
+
+/** Records a log entry: printf-style format string literal followed by up to CY_LOG_ARGS_MAX
+ *  arguments. Only the address of the format string, a timestamp and the raw arguments are
+ *  recorded; tools/cy_log_decode.py formats them on the host. Does not block, takes no lock and
+ *  can be called from interrupt handlers. If the ring buffer is full the entry is dropped. */
+#define CY_LOG(...)     CY_LOG_CAT(CY_LOG_, CY_LOG_COUNT(__VA_ARGS__))(__VA_ARGS__)
+
+#else // if defined(CY_LOG_ENABLED)
+
+#define CY_LOG(...)     do { } while (false)
+
+#endif // if defined(CY_LOG_ENABLED)
@@ -2,7 +2,7 @@
  * \file cy_mutex_pool.h
  *
  * \brief
- * Mutex pool implementation for FreeRTOS
+ * Mutex pool implementation for FreeRTOS, ThreadX and POSIX threads
  *
  ***************************************************************************************************
  * \copyright
@@ -26,6 +26,10 @@
 
 #pragma once
 
+#include <stdbool.h>
+#include <stdint.h>
+#include "cy_critical_trace.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -37,11 +41,32 @@ extern "C" {
 
 /** Map cy_mutex_pool_semaphore_t to FreeRTOS specific SemaphoreHandle_t */
 typedef SemaphoreHandle_t cy_mutex_pool_semaphore_t;
+
+/** Runs the destructor registered for the clib-support task-local pointer of a task that is
+ *  being deleted. Needed unless configTHREAD_LOCAL_STORAGE_DELETE_CALLBACKS is enabled; hook it
+ *  in with #define portCLEAN_UP_TCB(pxTCB) cy_mutex_pool_freertos_task_deleted(pxTCB) */
+/** \param task Handle (TCB) of the task being deleted */
+void cy_mutex_pool_freertos_task_deleted(void* task);
 #elif defined(COMPONENT_THREADX)
 #include "tx_api.h"
 
 /** Map cy_mutex_pool_semaphore_t to ThreadX specific TX_MUTEX* */
 typedef TX_MUTEX* cy_mutex_pool_semaphore_t;
+
+/** Runs the destructor registered for the clib-support task-local pointer of a thread that is
+ *  being deleted. ThreadX has no deletion callback, so the application hooks this in with
+ *  #define TX_THREAD_DELETE_EXTENSION(thread_ptr) cy_mutex_pool_threadx_thread_deleted(thread_ptr) */
+/** \param thread Thread being deleted */
+void cy_mutex_pool_threadx_thread_deleted(TX_THREAD* thread);
+#elif defined(COMPONENT_POSIX)
+#include <pthread.h>
+
+/** Map cy_mutex_pool_semaphore_t to POSIX specific pthread_mutex_t* */
+typedef pthread_mutex_t* cy_mutex_pool_semaphore_t;
+
+/** Host stand-in for vTaskStartScheduler/tx_kernel_enter. Until this is called, acquire and
+ *  release do nothing, the same as before the RTOS kernel is started on a target. */
+void cy_mutex_pool_posix_kernel_start(void);
 #else // if defined(COMPONENT_FREERTOS)
 #error "Unhandled RTOS type"
 #endif // if defined(COMPONENT_FREERTOS)
@@ -52,14 +77,61 @@ typedef TX_MUTEX* cy_mutex_pool_semaphore_t;
 /** Internal use only. Initializes the mutex pool. */
 void cy_mutex_pool_setup(void);
 
+/** C library lock that a pool mutex is created for */
+typedef enum
+{
+    CY_MUTEX_POOL_ROLE_MALLOC,  /**< Heap lock */
+    CY_MUTEX_POOL_ROLE_ENV,     /**< Environment lock (GCC Newlib) */
+    CY_MUTEX_POOL_ROLE_TIMER,   /**< cy_timer_mutex, used by time() */
+    CY_MUTEX_POOL_ROLE_FILE,    /**< Stream locks (IAR) */
+    CY_MUTEX_POOL_ROLE_SYSTEM   /**< Other C library locks, including all ARM C library locks */
+} cy_mutex_pool_role_t;
+
+/** Bit of a role in CY_MUTEX_POOL_INHERIT */
+#define CY_MUTEX_POOL_ROLE_BIT(role) (1UL << (uint32_t)(role))
+
+#ifndef CY_MUTEX_POOL_INHERIT
+/** Roles, as a mask of CY_MUTEX_POOL_ROLE_BIT, whose mutexes use priority inheritance on ThreadX
+ *  and POSIX. FreeRTOS mutexes always use priority inheritance. */
+#define CY_MUTEX_POOL_INHERIT (0UL)
+#endif
+
 /** Internal use only. Allocates a recursive mutex. */
-/** \return cy_mutex_pool_semaphore_t */
-cy_mutex_pool_semaphore_t cy_mutex_pool_create(void);
+/** \param role C library lock the mutex is used for
+ *  \return cy_mutex_pool_semaphore_t */
+cy_mutex_pool_semaphore_t cy_mutex_pool_create(cy_mutex_pool_role_t role);
 
-/** Internal use only. Acquires a recursive mutex. */
+/** Internal use only. Acquires a recursive mutex, waiting as long as it takes. */
 /** \param m cy_mutex_pool_semaphore_t */
 void cy_mutex_pool_acquire(cy_mutex_pool_semaphore_t m);
 
+/** Timeout of cy_mutex_pool_acquire_timeout that waits as long as it takes */
+#define CY_MUTEX_POOL_WAIT_FOREVER (0xFFFFFFFFUL)
+
+/** Acquires a pool mutex if no other task holds it, without blocking. Before the RTOS kernel is
+ *  started this always succeeds, the same as cy_mutex_pool_acquire. Must not be called from an
+ *  interrupt. */
+/** \param m cy_mutex_pool_semaphore_t
+ *  \return true if the mutex was acquired and must be released with cy_mutex_pool_release */
+bool cy_mutex_pool_try_acquire(cy_mutex_pool_semaphore_t m);
+
+/** Acquires a pool mutex, waiting at most timeout RTOS ticks (milliseconds on POSIX) for another
+ *  task to release it. Must not be called from an interrupt. */
+/** \param m       cy_mutex_pool_semaphore_t
+ *  \param timeout Ticks to wait, 0 to not wait or CY_MUTEX_POOL_WAIT_FOREVER
+ *  \return true if the mutex was acquired and must be released with cy_mutex_pool_release */
+bool cy_mutex_pool_acquire_timeout(cy_mutex_pool_semaphore_t m, uint32_t timeout);
+
+#if defined(CY_MUTEX_POOL_WATCHDOG_TICKS)
+/** Must be provided by the application when CY_MUTEX_POOL_WATCHDOG_TICKS is defined. Called by a
+ *  task each time it has waited another CY_MUTEX_POOL_WATCHDOG_TICKS for a pool mutex without
+ *  getting it. The task keeps waiting afterwards (up to its timeout). Must not acquire m. */
+/** \param m      Mutex being waited for
+ *  \param owner  Task holding it (as returned by cy_mutex_pool_current_task), NULL if unknown
+ *  \param waited Ticks waited so far */
+void cy_mutex_pool_watchdog(cy_mutex_pool_semaphore_t m, void* owner, uint32_t waited);
+#endif // defined(CY_MUTEX_POOL_WATCHDOG_TICKS)
+
 /** Internal use only. Releases a recursive mutex. */
 /** \param m cy_mutex_pool_semaphore_t */
 void cy_mutex_pool_release(cy_mutex_pool_semaphore_t m);
@@ -68,6 +140,122 @@ void cy_mutex_pool_release(cy_mutex_pool_semaphore_t m);
 /** \param m cy_mutex_pool_semaphore_t */
 void cy_mutex_pool_destroy(cy_mutex_pool_semaphore_t m);
 
+/** Internal use only. Checks whether the RTOS kernel has been started. */
+/** \return true once acquire/release stop being no-ops */
+bool cy_mutex_pool_kernel_started(void);
+
+/** Internal use only. Returns an identifier of the calling task. */
+/** \return Task handle (never NULL once the kernel is started) */
+void* cy_mutex_pool_current_task(void);
+
+/** Internal use only. Returns the clib-support task-local pointer of the calling task. */
+/** \return Value last set by cy_mutex_pool_set_task_local, NULL if none or if the task-local
+ *  pointer is not supported by the RTOS configuration */
+void* cy_mutex_pool_get_task_local(void);
+
+/** Internal use only. Sets the clib-support task-local pointer of the calling task. */
+/** \param value      New value
+ *  \param destructor Called with value when the task is deleted, if the RTOS supports it */
+void cy_mutex_pool_set_task_local(void* value, void (*destructor)(void* value));
+
+/** Internal use only. Blocks the calling task on the wait queue for key until
+ *  cy_mutex_pool_unpark_all is called for a key that shares its queue. validate is called with
+ *  the queue locked; if it returns false the task does not block. Callers must re-check their
+ *  condition after returning. */
+/** \param key      Address of the word being waited on
+ *  \param validate Returns whether the caller still needs to wait
+ *  \param context  Argument passed to validate */
+void cy_mutex_pool_park(const volatile void* key, bool (*validate)(const void* context),
+                        const void* context);
+
+/** Internal use only. Same as cy_mutex_pool_park, but returns after timeout RTOS ticks
+ *  (milliseconds on POSIX) if the task is not woken before. */
+/** \param key      Address of the word being waited on
+ *  \param validate Returns whether the caller still needs to wait
+ *  \param context  Argument passed to validate
+ *  \param timeout  Ticks to wait or CY_MUTEX_POOL_WAIT_FOREVER
+ *  \return false if the wait timed out */
+bool cy_mutex_pool_park_timeout(const volatile void* key, bool (*validate)(const void* context),
+                                const void* context, uint32_t timeout);
+
+/** Internal use only. Wakes all tasks parked on the wait queue for key. */
+/** \param key Address of the word that changed */
+void cy_mutex_pool_unpark_all(const volatile void* key);
+
+/** Lock occupying a single pointer-sized word. Zero is unlocked. */
+typedef uintptr_t cy_compact_lock_t;
+
+/** Internal use only. Acquires a compact recursive lock. */
+/** \param lock cy_compact_lock_t */
+void cy_compact_lock_acquire(volatile cy_compact_lock_t* lock);
+
+/** Internal use only. Releases a compact recursive lock. */
+/** \param lock cy_compact_lock_t */
+void cy_compact_lock_release(volatile cy_compact_lock_t* lock);
+
+#if defined(CY_MUTEX_POOL_STATS)
+/** Contention and hold-time statistics for one mutex pool slot. Times are in units of
+ *  CY_MUTEX_POOL_STATS_TIMESTAMP, which defaults to DWT cycle counter ticks (RTOS ticks on
+ *  ARMv6-M, nanoseconds on POSIX). */
+typedef struct
+{
+    uint32_t acquisitions;  /**< Number of acquires, including recursive ones */
+    uint32_t contended;     /**< Number of acquires that had to wait for another task */
+    uint64_t wait_total;    /**< Total time spent waiting in contended acquires */
+    uint32_t wait_max;      /**< Longest wait of a single contended acquire */
+    uint64_t hold_total;    /**< Total time held, from outermost acquire to matching release */
+    uint32_t hold_max;      /**< Longest single hold */
+    uint16_t depth_max;     /**< Deepest recursion observed */
+    void*    last_owner;    /**< Task that most recently took the mutex */
+} cy_mutex_pool_stats_t;
+
+/** Takes a snapshot of the statistics of every pool slot, in slot order. Slots are handed out
+ *  in creation order, so the first slots belong to the mutexes created by cy_toolchain_init.
+ *  The snapshot does not acquire any pool mutex.
+ *  \param stats Array receiving one entry per slot
+ *  \param count Number of entries in stats
+ *  \return Number of entries written, at most CY_STATIC_MUTEX_MAX */
+uint32_t cy_mutex_pool_get_stats(cy_mutex_pool_stats_t* stats, uint32_t count);
+#endif // defined(CY_MUTEX_POOL_STATS)
+
+#if defined(CY_MUTEX_POOL_LOCKDEP)
+/** Maximum length of a task name in cy_mutex_pool_lockdep_report_t, including the terminator */
+#ifndef CY_MUTEX_POOL_LOCKDEP_NAME_LEN
+#define CY_MUTEX_POOL_LOCKDEP_NAME_LEN  (16U)
+#endif
+
+/** Lock-order inversion found by CY_MUTEX_POOL_LOCKDEP */
+typedef struct
+{
+    uint32_t             held_slot;         /**< Pool slot of a mutex the task holds */
+    cy_mutex_pool_role_t held_role;         /**< Role of that mutex */
+    uint32_t             acquiring_slot;    /**< Pool slot of the mutex the task is acquiring */
+    cy_mutex_pool_role_t acquiring_role;    /**< Role of that mutex */
+    uint32_t             via_slot;          /**< Slot that other_task held while taking held_slot;
+                                                 equal to acquiring_slot for a direct inversion,
+                                                 otherwise reached from it through other slots */
+    char                 task[CY_MUTEX_POOL_LOCKDEP_NAME_LEN];       /**< Acquiring task */
+    char                 other_task[CY_MUTEX_POOL_LOCKDEP_NAME_LEN]; /**< Task that took via_slot
+                                                                          then held_slot; empty
+                                                                          if no longer known */
+} cy_mutex_pool_lockdep_report_t;
+
+/** Must be provided by the application when CY_MUTEX_POOL_LOCKDEP is defined. Called once for
+ *  every pair of pool mutexes the first time a task acquires them in an order that can deadlock
+ *  with an order seen earlier. Runs in the acquiring task before it waits for the mutex. */
+/** \param report Description of the inversion, only valid during the call */
+void cy_mutex_pool_lockdep_report(const cy_mutex_pool_lockdep_report_t* report);
+#endif // defined(CY_MUTEX_POOL_LOCKDEP)
+
+#elif defined(configNUMBER_OF_CORES) && (configNUMBER_OF_CORES > 1)
+
+/** Internal use only. If the mutex pool is not available, we have to suspend all threads to ensure
+ *  exclusive access to resources. On SMP this also excludes tasks running on the other cores. */
+void cy_mutex_pool_suspend_threads(void);
+
+/** Internal use only. Ends an exclusive region and allows other threads to start running again. */
+void cy_mutex_pool_resume_threads(void);
+
 #else // defined(MUTEX_POOL_AVAILABLE)
 
 /** Internal use only. If the mutex pool is not available, we have to suspend all threads to ensure
@@ -75,12 +263,18 @@ void cy_mutex_pool_destroy(cy_mutex_pool_semaphore_t m);
 static inline void cy_mutex_pool_suspend_threads(void)
 {
     vTaskSuspendAll();
+    #if defined(CY_CRITICAL_TRACE)
+    cy_critical_trace_suspend_begin(CY_CRITICAL_TRACE_CALLER());
+    #endif
 }
 
 
 /** Internal use only. Ends an exclusive region and allows other threads to start running again. */
 static inline void cy_mutex_pool_resume_threads(void)
 {
+    #if defined(CY_CRITICAL_TRACE)
+    cy_critical_trace_suspend_end();
+    #endif
     xTaskResumeAll();
 }
 
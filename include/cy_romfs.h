@@ -0,0 +1,102 @@
+/***********************************************************************************************//**
+ * \file cy_romfs.h
+ *
+ * \brief
+ * Read-only file system served from an image in flash, built by tools/cy_romfs_image.py
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(CY_ROMFS)
+
+/** Number of files that can be open at the same time */
+#ifndef CY_ROMFS_MAX_OPEN
+#define CY_ROMFS_MAX_OPEN       (8U)
+#endif
+
+/** File descriptor of the first open file. The descriptors below it are left to stdin, stdout and
+ *  stderr. */
+#ifndef CY_ROMFS_FD_BASE
+#define CY_ROMFS_FD_BASE        (3)
+#endif
+
+/** Serves the files of an image built by tools/cy_romfs_image.py through fopen and this API.
+ *  Usually the image is the array in the C file generated by the tool, and mounted at startup.
+ *  Files opened from a previous image must be closed first. */
+/** \param image Image in flash, aligned as given to the tool, or NULL to unmount
+ *  \return false if image is not a valid image, or is not aligned */
+bool cy_romfs_mount(const void* image);
+
+/** Returns the contents of a file without copying them: a pointer into the image in flash. The
+ *  contents are aligned as given to the tool (8 bytes by default), so lookup tables can be used
+ *  in place. */
+/** \param path Path of the file in the image; a leading '/' is ignored
+ *  \param data Receives the contents
+ *  \param size Receives the size of the file in bytes
+ *  \return false if there is no such file */
+bool cy_romfs_map(const char* path, const void** data, size_t* size);
+
+/** Opens a file for reading. Called by the toolchain ports for fopen. */
+/** \param path Path of the file in the image; a leading '/' is ignored
+ *  \return File descriptor, or -1 if there is no such file or CY_ROMFS_MAX_OPEN files are open */
+int cy_romfs_open(const char* path);
+
+/** Returns whether fd is a file opened with cy_romfs_open. */
+bool cy_romfs_is_open(int fd);
+
+/** Closes a file. */
+/** \return 0, or -1 if fd is not an open file */
+int cy_romfs_close(int fd);
+
+/** Copies the contents of a file from the current position and advances the position. */
+/** \return Number of bytes copied, 0 at the end of the file, or -1 if fd is not an open file */
+long cy_romfs_read(int fd, void* buffer, size_t size);
+
+/** Moves the position of a file, as lseek does for SEEK_SET, SEEK_CUR and SEEK_END. */
+/** \return New position, or -1 if fd is not an open file or the position would be negative */
+long cy_romfs_seek(int fd, long offset, int whence);
+
+/** Returns the size of a file. */
+/** \return Size in bytes, or -1 if fd is not an open file */
+long cy_romfs_size(int fd);
+
+/** Reads stdin for the GCC Newlib, ARM and IAR ports when CY_ROMFS_STDIN is defined; otherwise
+ *  stdin is left to the application's low-level read function (see README.md). The default
+ *  returns 0 (end of file); define this function to read stdin from a UART instead. */
+/** \param buffer Receives the input
+ *  \param size   Size of buffer in bytes
+ *  \return Number of bytes read, 0 at the end of the input, or -1 on error */
+long cy_romfs_stdin_read(void* buffer, size_t size);
+
+#endif // defined(CY_ROMFS)
+
+#ifdef __cplusplus
+}
+#endif
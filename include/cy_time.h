@@ -41,6 +41,11 @@
 #define _MTB_CLIB_SUPPORT_RTC_AVAILABLE
 
 #include "time.h"
+#include <stdbool.h>
+#include <stdint.h>
+#if defined(__NEWLIB__)
+#include <sys/time.h>
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -73,6 +78,61 @@ mtb_hal_rtc_t* mtb_clib_support_get_rtc(void);
 cyhal_rtc_t* mtb_clib_support_get_rtc(void);
 #endif
 
+/** Take the realtime clock from the RTC again.
+ *
+ * Call this after writing a new time to the RTC.
+ */
+void mtb_clib_support_time_resync(void);
+
+/** Get the monotonic time.
+ *
+ * The time is derived from the RTOS tick count and, if CY_TIME_SUBTICK_US() is defined, the time
+ * since the last tick. It never decreases, including when the RTC is written. This function
+ * does not block and can be called from interrupt handlers.
+ *
+ * @return  Microseconds since the RTOS kernel was started
+ */
+uint64_t mtb_clib_support_monotonic_us(void);
+
+/** Get the realtime clock.
+ *
+ * The time is interpolated from the RTOS tick count between reads of the RTC. This function can
+ * be called from interrupt handlers, which never read the RTC.
+ *
+ * @param[out] us Microseconds since the epoch
+ * @return  true on success, false if the RTC could not be read
+ */
+bool mtb_clib_support_realtime_us(int64_t* us);
+
+/** Get a timestamp for tracing and logging.
+ *
+ * Returns the realtime clock as of the last time base taken from the RTC, or the monotonic clock
+ * if there is none yet. Unlike @ref mtb_clib_support_realtime_us, it never reads the RTC, takes a
+ * lock or resyncs the time base, so it can be called from any context, including while
+ * cy_timer_mutex is held.
+ *
+ * @return  Microseconds since the epoch, or since the kernel was started
+ */
+int64_t mtb_clib_support_timestamp_us(void);
+
+#if defined(__NEWLIB__)
+// Newlib only defines these for some targets
+#if !defined(CLOCK_REALTIME)
+#define CLOCK_REALTIME  ((clockid_t)1)
+#endif
+#if !defined(CLOCK_MONOTONIC)
+#define CLOCK_MONOTONIC ((clockid_t)4)
+#endif
+
+/** Get the time of CLOCK_REALTIME or CLOCK_MONOTONIC with microsecond resolution.
+ *
+ * @param[in]  clock_id CLOCK_REALTIME or CLOCK_MONOTONIC
+ * @param[out] tp       Time of the clock
+ * @return  0 on success, -1 with errno set otherwise
+ */
+int clock_gettime(clockid_t clock_id, struct timespec* tp);
+#endif // defined(__NEWLIB__)
+
 #ifdef __cplusplus
 }
 #endif
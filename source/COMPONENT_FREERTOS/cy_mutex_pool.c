@@ -26,6 +26,14 @@
 
 #include "cy_mutex_pool.h"
 #include "cy_mutex_pool_cfg.h"
+#include "cy_clib_support_atomic.h"
+#include "cy_mutex_pool_bitmap.h"
+#include "cy_mutex_pool_park.h"
+#if defined(MUTEX_POOL_AVAILABLE)
+#include "cy_mutex_pool_stats.h"
+#include "cy_mutex_pool_wait.h"
+#include "cy_mutex_pool_lockdep.h"
+#endif
 #include <task.h>
 #include <stdbool.h>
 #include <string.h>
@@ -47,20 +55,57 @@
 
 #else
 
+// On multi-core (SMP) FreeRTOS, a task that finds a pool mutex taken polls a
+// word holding its owner for up to CY_MUTEX_POOL_SPIN_LIMIT iterations, and
+// makes one more attempt to take the mutex as soon as the word is clear. A
+// preempted or blocked owner cannot release the mutex while the task spins, so
+// the task blocks as soon as the owner is not running on one of the cores, or
+// if the owner keeps the mutex for the whole budget. The word is kept by this
+// file, and whether the owner runs is read from the kernel's running task of
+// each core, so polling never looks at the owner's TCB, which may already have
+// been deleted. Set CY_MUTEX_POOL_SPIN_LIMIT to 0 to always block immediately.
+#ifndef CY_MUTEX_POOL_SPIN_LIMIT
+#if defined(configNUMBER_OF_CORES) && (configNUMBER_OF_CORES > 1)
+#define CY_MUTEX_POOL_SPIN_LIMIT    (1000U)
+#else
+#define CY_MUTEX_POOL_SPIN_LIMIT    (0U)
+#endif
+#endif // ifndef CY_MUTEX_POOL_SPIN_LIMIT
+
+#if defined(CY_MUTEX_POOL_WATCHDOG_TICKS) && (INCLUDE_xSemaphoreGetMutexHolder == 0)
+#error INCLUDE_xSemaphoreGetMutexHolder must be set to 1 when CY_MUTEX_POOL_WATCHDOG_TICKS is defined
+#endif
+
+#if defined(MUTEX_POOL_AVAILABLE) || \
+    (defined(configNUMBER_OF_CORES) && (configNUMBER_OF_CORES > 1))
 //--------------------------------------------------------------------------------------------------
 // cy_freertos_kernel_started
 //--------------------------------------------------------------------------------------------------
 static bool cy_freertos_kernel_started(void)
 {
-    static bool rtos_started = false;
-    if (!rtos_started)
+    // Once set, the flag never changes again. The acquire/release ordering
+    // makes a core that sees it set also see the scheduler state behind it.
+    static volatile uintptr_t rtos_started = 0U;
+    bool                      started      = (0U != cy_atomic_load(&rtos_started));
+    if (!started)
     {
-        rtos_started = xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED;
+        started = xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED;
+        if (started)
+        {
+            cy_atomic_store(&rtos_started, 1U);
+        }
     }
-    return rtos_started;
+    return started;
 }
 
 
+#endif // if defined(MUTEX_POOL_AVAILABLE) ||
+//     (defined(configNUMBER_OF_CORES) && (configNUMBER_OF_CORES > 1))
+
+#if defined(MUTEX_POOL_AVAILABLE)
+// With heap_3 the pool is not used (see cy_mutex_pool.h); only the
+// replacement for cy_mutex_pool_suspend_threads below is compiled.
+
 // The mutex functions must not be used in interrupt context.
 // The create/destroy functions will not work because taskENTER_CRITICAL will
 // not work in an interrupt.
@@ -94,42 +139,71 @@ static void cy_freertos_check_in_isr(void)
 #endif
 
 static CY_ATTR_NO_INIT StaticSemaphore_t cy_mutex_pool_storage[CY_STATIC_MUTEX_MAX];
-static CY_ATTR_NO_INIT SemaphoreHandle_t cy_mutex_pool_handle[CY_STATIC_MUTEX_MAX];
+static CY_ATTR_NO_INIT cy_mutex_pool_bitmap_t cy_mutex_pool_bitmap;
+#if defined(CY_MUTEX_POOL_STATS)
+static cy_mutex_pool_stats_slot_t cy_mutex_pool_stats[CY_STATIC_MUTEX_MAX];
+#endif
+#if (CY_MUTEX_POOL_SPIN_LIMIT > 0)
+// Owner of each pool mutex for spinning waiters, and its recursion depth, which only the owner
+// touches
+typedef struct
+{
+    volatile uintptr_t holder;
+    uint32_t           depth;
+} cy_mutex_pool_holder_t;
+
+static cy_mutex_pool_holder_t cy_mutex_pool_holders[CY_STATIC_MUTEX_MAX];
+#endif
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_index
+//--------------------------------------------------------------------------------------------------
+static inline uint32_t cy_mutex_pool_index(SemaphoreHandle_t m)
+{
+    // Statically created semaphores use the supplied buffer as their handle
+    return (uint32_t)((StaticSemaphore_t*)m - cy_mutex_pool_storage);
+}
+
 
 //--------------------------------------------------------------------------------------------------
 // cy_mutex_pool_setup
 //--------------------------------------------------------------------------------------------------
 void cy_mutex_pool_setup(void)
 {
-    // Only required if the startup code does not initialize cy_mutex_pool_handle
-    memset(cy_mutex_pool_handle, 0, sizeof(cy_mutex_pool_handle));
+    // Only required if the startup code does not initialize cy_mutex_pool_bitmap
+    memset(&cy_mutex_pool_bitmap, 0, sizeof(cy_mutex_pool_bitmap));
 }
 
 
 //--------------------------------------------------------------------------------------------------
 // cy_mutex_pool_create
 //--------------------------------------------------------------------------------------------------
-SemaphoreHandle_t cy_mutex_pool_create(void)
+SemaphoreHandle_t cy_mutex_pool_create(cy_mutex_pool_role_t role)
 {
+    // FreeRTOS mutexes always use priority inheritance
+    (void)role;
     cy_freertos_check_in_isr();
     SemaphoreHandle_t handle = NULL;
-    int16_t           found  = -1;
+    int32_t           found;
     taskENTER_CRITICAL();
-    for (int16_t i = 0; i < CY_STATIC_MUTEX_MAX; i++)
-    {
-        if (NULL == cy_mutex_pool_handle[i])
-        {
-            found                       = i;
-            cy_mutex_pool_handle[found] = (SemaphoreHandle_t)1;
-            break;
-        }
-    }
+    CY_CRITICAL_TRACE_BEGIN(trace);
+    found = cy_mutex_pool_bitmap_alloc(&cy_mutex_pool_bitmap);
+    CY_CRITICAL_TRACE_END(CY_CRITICAL_TRACE_POOL_CREATE, trace);
     taskEXIT_CRITICAL();
     if (found >= 0)
     {
         handle =
             xSemaphoreCreateRecursiveMutexStatic(&cy_mutex_pool_storage[found]);
-        cy_mutex_pool_handle[found] = handle;
+        #if defined(CY_MUTEX_POOL_STATS)
+        cy_mutex_pool_stats_reset(&cy_mutex_pool_stats[found]);
+        #endif
+        #if (CY_MUTEX_POOL_SPIN_LIMIT > 0)
+        cy_mutex_pool_holders[found].holder = 0U;
+        cy_mutex_pool_holders[found].depth  = 0U;
+        #endif
+        #if defined(CY_MUTEX_POOL_LOCKDEP)
+        cy_mutex_pool_lockdep_created((uint32_t)found, role);
+        #endif
     }
     else
     {
@@ -139,20 +213,223 @@ SemaphoreHandle_t cy_mutex_pool_create(void)
 }
 
 
+#if (CY_MUTEX_POOL_SPIN_LIMIT > 0)
 //--------------------------------------------------------------------------------------------------
-// cy_mutex_pool_acquire
+// cy_freertos_owner_running
 //--------------------------------------------------------------------------------------------------
-void cy_mutex_pool_acquire(SemaphoreHandle_t m)
+// Returns whether owner is the running task of a core. The caller is running, and does not own
+// the mutex, so that core is another one.
+static inline bool cy_freertos_owner_running(uintptr_t owner)
+{
+    bool running = false;
+    #if defined(configNUMBER_OF_CORES) && (configNUMBER_OF_CORES > 1)
+    for (BaseType_t core = 0; !running && (core < (BaseType_t)configNUMBER_OF_CORES); core++)
+    {
+        running = ((uintptr_t)xTaskGetCurrentTaskHandleForCore(core) == owner);
+    }
+    #else
+    (void)owner;
+    #endif
+    return running;
+}
+
+
+#endif // if (CY_MUTEX_POOL_SPIN_LIMIT > 0)
+
+//--------------------------------------------------------------------------------------------------
+// cy_freertos_spin_acquire
+//--------------------------------------------------------------------------------------------------
+static inline bool cy_freertos_spin_acquire(SemaphoreHandle_t m)
 {
+    bool acquired = false;
+    #if (CY_MUTEX_POOL_SPIN_LIMIT > 0)
+    volatile uintptr_t* holder = &cy_mutex_pool_holders[cy_mutex_pool_index(m)].holder;
+    for (uint32_t i = 0U; i < CY_MUTEX_POOL_SPIN_LIMIT; i++)
+    {
+        uintptr_t owner = *holder;
+        if (0U == owner)
+        {
+            acquired = (xSemaphoreTakeRecursive(m, 0) == pdTRUE);
+            break;
+        }
+        if (!cy_freertos_owner_running(owner))
+        {
+            break;
+        }
+    }
+    #else
+    (void)m;
+    #endif // if (CY_MUTEX_POOL_SPIN_LIMIT > 0)
+    return acquired;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_freertos_holder_acquired
+//--------------------------------------------------------------------------------------------------
+static inline void cy_freertos_holder_acquired(SemaphoreHandle_t m)
+{
+    #if (CY_MUTEX_POOL_SPIN_LIMIT > 0)
+    cy_mutex_pool_holder_t* holder = &cy_mutex_pool_holders[cy_mutex_pool_index(m)];
+    if (0U == holder->depth)
+    {
+        cy_atomic_store(&holder->holder, (uintptr_t)xTaskGetCurrentTaskHandle());
+    }
+    holder->depth++;
+    #else
+    (void)m;
+    #endif
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_freertos_holder_releasing
+//--------------------------------------------------------------------------------------------------
+// Returns whether the calling task is about to give up the mutex entirely
+static inline bool cy_freertos_holder_releasing(SemaphoreHandle_t m)
+{
+    #if (CY_MUTEX_POOL_SPIN_LIMIT > 0)
+    cy_mutex_pool_holder_t* holder = &cy_mutex_pool_holders[cy_mutex_pool_index(m)];
+    holder->depth--;
+    return (0U == holder->depth);
+    #else
+    (void)m;
+    return false;
+    #endif
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_freertos_holder_released
+//--------------------------------------------------------------------------------------------------
+// Called after the mutex was given. A task that took it meanwhile may already
+// have stored itself, so the word is only cleared if it still holds this task.
+static inline void cy_freertos_holder_released(SemaphoreHandle_t m, bool last)
+{
+    #if (CY_MUTEX_POOL_SPIN_LIMIT > 0)
+    if (last)
+    {
+        (void)cy_atomic_compare_exchange(&cy_mutex_pool_holders[cy_mutex_pool_index(m)].holder,
+                                         (uintptr_t)xTaskGetCurrentTaskHandle(), 0U);
+    }
+    #else
+    (void)m;
+    (void)last;
+    #endif
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_freertos_take
+//--------------------------------------------------------------------------------------------------
+static bool cy_freertos_take(SemaphoreHandle_t m, uint32_t ticks)
+{
+    bool acquired;
+    if (CY_MUTEX_POOL_WAIT_FOREVER == ticks)
+    {
+        // portMAX_DELAY only blocks indefinitely with INCLUDE_vTaskSuspend
+        while (xSemaphoreTakeRecursive(m, portMAX_DELAY) != pdTRUE)
+        {
+            // Halt here until the operation succeeds
+        }
+        acquired = true;
+    }
+    else
+    {
+        // Longer waits than a TickType_t can express are cut short
+        TickType_t delay = (ticks < (uint32_t)portMAX_DELAY) ? (TickType_t)ticks :
+                           (TickType_t)(portMAX_DELAY - 1U);
+        acquired = (xSemaphoreTakeRecursive(m, delay) == pdTRUE);
+    }
+    return acquired;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_freertos_owner
+//--------------------------------------------------------------------------------------------------
+static void* cy_freertos_owner(SemaphoreHandle_t m)
+{
+    #if defined(CY_MUTEX_POOL_WATCHDOG_TICKS)
+    return xSemaphoreGetMutexHolder(m);
+    #else
+    (void)m;
+    return NULL;
+    #endif
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_freertos_acquire
+//--------------------------------------------------------------------------------------------------
+static bool cy_freertos_acquire(SemaphoreHandle_t m, uint32_t timeout)
+{
+    bool acquired = true;
     cy_freertos_check_in_isr();
     if (cy_freertos_kernel_started())
     {
-        static const int16_t CY_MUTEX_TIMEOUT_TICKS = 10000;
-        while (xSemaphoreTakeRecursive(m, CY_MUTEX_TIMEOUT_TICKS) != pdTRUE)
+        #if defined(CY_MUTEX_POOL_LOCKDEP)
+        if (0U != timeout)
+        {
+            cy_mutex_pool_lockdep_acquiring(cy_mutex_pool_index(m));
+        }
+        #endif
+        #if defined(CY_MUTEX_POOL_STATS)
+        uint32_t start = CY_MUTEX_POOL_STATS_TIMESTAMP();
+        #endif
+        acquired = (xSemaphoreTakeRecursive(m, 0) == pdTRUE);
+        bool contended = !acquired;
+        if (contended && (0U != timeout))
         {
-            // Halt here until condition is false
+            acquired = cy_freertos_spin_acquire(m) ||
+                       cy_mutex_pool_wait(m, timeout, cy_freertos_take, cy_freertos_owner);
         }
+        if (acquired)
+        {
+            cy_freertos_holder_acquired(m);
+        }
+        #if defined(CY_MUTEX_POOL_STATS)
+        if (acquired)
+        {
+            cy_mutex_pool_stats_acquired(&cy_mutex_pool_stats[cy_mutex_pool_index(m)], start,
+                                         contended, xTaskGetCurrentTaskHandle());
+        }
+        #endif
+        #if defined(CY_MUTEX_POOL_LOCKDEP)
+        if (acquired)
+        {
+            cy_mutex_pool_lockdep_acquired(cy_mutex_pool_index(m));
+        }
+        #endif
     }
+    return acquired;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_acquire
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_acquire(SemaphoreHandle_t m)
+{
+    (void)cy_freertos_acquire(m, CY_MUTEX_POOL_WAIT_FOREVER);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_try_acquire
+//--------------------------------------------------------------------------------------------------
+bool cy_mutex_pool_try_acquire(SemaphoreHandle_t m)
+{
+    return cy_freertos_acquire(m, 0U);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_acquire_timeout
+//--------------------------------------------------------------------------------------------------
+bool cy_mutex_pool_acquire_timeout(SemaphoreHandle_t m, uint32_t timeout)
+{
+    return cy_freertos_acquire(m, timeout);
 }
 
 
@@ -164,7 +441,15 @@ void cy_mutex_pool_release(SemaphoreHandle_t m)
     cy_freertos_check_in_isr();
     if (cy_freertos_kernel_started())
     {
+        #if defined(CY_MUTEX_POOL_STATS)
+        cy_mutex_pool_stats_releasing(&cy_mutex_pool_stats[cy_mutex_pool_index(m)]);
+        #endif
+        #if defined(CY_MUTEX_POOL_LOCKDEP)
+        cy_mutex_pool_lockdep_releasing(cy_mutex_pool_index(m));
+        #endif
+        bool last = cy_freertos_holder_releasing(m);
         xSemaphoreGiveRecursive(m);
+        cy_freertos_holder_released(m, last);
     }
 }
 
@@ -175,19 +460,323 @@ void cy_mutex_pool_release(SemaphoreHandle_t m)
 void cy_mutex_pool_destroy(SemaphoreHandle_t m)
 {
     cy_freertos_check_in_isr();
+    #if defined(CY_MUTEX_POOL_LOCKDEP)
+    cy_mutex_pool_lockdep_destroyed(cy_mutex_pool_index(m));
+    #endif
     vSemaphoreDelete(m);
     taskENTER_CRITICAL();
-    for (int16_t i = 0; i < CY_STATIC_MUTEX_MAX; i++)
+    CY_CRITICAL_TRACE_BEGIN(trace);
+    cy_mutex_pool_bitmap_free(&cy_mutex_pool_bitmap, cy_mutex_pool_index(m));
+    CY_CRITICAL_TRACE_END(CY_CRITICAL_TRACE_POOL_DESTROY, trace);
+    taskEXIT_CRITICAL();
+}
+
+
+#if defined(CY_MUTEX_POOL_STATS)
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_get_stats
+//--------------------------------------------------------------------------------------------------
+uint32_t cy_mutex_pool_get_stats(cy_mutex_pool_stats_t* stats, uint32_t count)
+{
+    return cy_mutex_pool_stats_snapshot(cy_mutex_pool_stats, CY_STATIC_MUTEX_MAX, stats, count);
+}
+
+
+#endif // defined(CY_MUTEX_POOL_STATS)
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_kernel_started
+//--------------------------------------------------------------------------------------------------
+bool cy_mutex_pool_kernel_started(void)
+{
+    return cy_freertos_kernel_started();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_current_task
+//--------------------------------------------------------------------------------------------------
+void* cy_mutex_pool_current_task(void)
+{
+    return xTaskGetCurrentTaskHandle();
+}
+
+
+#if defined(CY_MUTEX_POOL_LOCKDEP)
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_task_name
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_task_name(void* task, char* name, uint32_t size)
+{
+    (void)strncpy(name, pcTaskGetName((TaskHandle_t)task), size - 1U);
+    name[size - 1U] = '\0';
+}
+
+
+#endif // defined(CY_MUTEX_POOL_LOCKDEP)
+
+// The task-local pointer uses one of the FreeRTOS thread local storage
+// pointers, selected by CY_MUTEX_POOL_TLS_INDEX. The last one is used by
+// default, as applications and other middleware usually count from 0.
+// The destructor runs when a task is deleted, through the deletion callback if
+// configTHREAD_LOCAL_STORAGE_DELETE_CALLBACKS is enabled and otherwise if the
+// application hooks cy_mutex_pool_freertos_task_deleted into the kernel:
+//     #define portCLEAN_UP_TCB(pxTCB) cy_mutex_pool_freertos_task_deleted(pxTCB)
+#if defined(configNUM_THREAD_LOCAL_STORAGE_POINTERS)
+#ifndef CY_MUTEX_POOL_TLS_INDEX
+#define CY_MUTEX_POOL_TLS_INDEX (configNUM_THREAD_LOCAL_STORAGE_POINTERS - 1)
+#endif
+
+#if (CY_MUTEX_POOL_TLS_INDEX >= 0) && \
+    (configNUM_THREAD_LOCAL_STORAGE_POINTERS > CY_MUTEX_POOL_TLS_INDEX)
+#define CY_MUTEX_POOL_TLS_AVAILABLE
+#endif
+#endif // if defined(configNUM_THREAD_LOCAL_STORAGE_POINTERS)
+
+#if defined(CY_MUTEX_POOL_TLS_AVAILABLE)
+static void (*cy_mutex_pool_tls_destructor)(void* value) = NULL;
+
+#if (configTHREAD_LOCAL_STORAGE_DELETE_CALLBACKS == 1)
+//--------------------------------------------------------------------------------------------------
+// cy_freertos_tls_deleted
+//--------------------------------------------------------------------------------------------------
+static void cy_freertos_tls_deleted(int index, void* value)
+{
+    (void)index;
+    if ((NULL != value) && (NULL != cy_mutex_pool_tls_destructor))
+    {
+        cy_mutex_pool_tls_destructor(value);
+    }
+}
+
+
+#endif // if (configTHREAD_LOCAL_STORAGE_DELETE_CALLBACKS == 1)
+#endif // if defined(CY_MUTEX_POOL_TLS_AVAILABLE)
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_get_task_local
+//--------------------------------------------------------------------------------------------------
+void* cy_mutex_pool_get_task_local(void)
+{
+    void* value = NULL;
+    #if defined(CY_MUTEX_POOL_TLS_AVAILABLE)
+    if (cy_freertos_kernel_started())
+    {
+        value = pvTaskGetThreadLocalStoragePointer(NULL, CY_MUTEX_POOL_TLS_INDEX);
+    }
+    #endif
+    return value;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_set_task_local
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_set_task_local(void* value, void (*destructor)(void* value))
+{
+    #if defined(CY_MUTEX_POOL_TLS_AVAILABLE)
+    // One destructor serves all tasks; clearing the pointer keeps it
+    if (NULL != destructor)
+    {
+        cy_mutex_pool_tls_destructor = destructor;
+    }
+    #if (configTHREAD_LOCAL_STORAGE_DELETE_CALLBACKS == 1)
+    vTaskSetThreadLocalStoragePointerAndDelCallback(NULL, CY_MUTEX_POOL_TLS_INDEX, value,
+                                                    cy_freertos_tls_deleted);
+    #else
+    vTaskSetThreadLocalStoragePointer(NULL, CY_MUTEX_POOL_TLS_INDEX, value);
+    #endif
+    #else // if defined(CY_MUTEX_POOL_TLS_AVAILABLE)
+    (void)value;
+    (void)destructor;
+    #endif // if defined(CY_MUTEX_POOL_TLS_AVAILABLE)
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_freertos_task_deleted
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_freertos_task_deleted(void* task)
+{
+    #if defined(CY_MUTEX_POOL_TLS_AVAILABLE)
+    // The pointer is cleared first, so that a deletion callback that runs
+    // afterwards does not destroy the value again
+    void* value = pvTaskGetThreadLocalStoragePointer((TaskHandle_t)task, CY_MUTEX_POOL_TLS_INDEX);
+    if (NULL != value)
+    {
+        vTaskSetThreadLocalStoragePointer((TaskHandle_t)task, CY_MUTEX_POOL_TLS_INDEX, NULL);
+        if (NULL != cy_mutex_pool_tls_destructor)
+        {
+            cy_mutex_pool_tls_destructor(value);
+        }
+    }
+    #else
+    (void)task;
+    #endif
+}
+
+
+// A parked task waits on a binary semaphore that lives on its own stack for as
+// long as it is parked, so wait objects only exist while there is contention.
+typedef struct cy_mutex_pool_waiter
+{
+    struct cy_mutex_pool_waiter* next;
+    SemaphoreHandle_t            semaphore;
+    StaticSemaphore_t            storage;
+} cy_mutex_pool_waiter_t;
+
+static cy_mutex_pool_waiter_t* cy_mutex_pool_park_queue[CY_MUTEX_POOL_PARK_BUCKETS];
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_park_timeout
+//--------------------------------------------------------------------------------------------------
+bool cy_mutex_pool_park_timeout(const volatile void* key, bool (*validate)(const void* context),
+                                const void* context, uint32_t timeout)
+{
+    cy_mutex_pool_waiter_t** queue = &cy_mutex_pool_park_queue[cy_mutex_pool_park_bucket(key)];
+    cy_mutex_pool_waiter_t   waiter;
+    bool                     parked = false;
+    bool                     woken  = true;
+
+    cy_freertos_check_in_isr();
+    waiter.semaphore = xSemaphoreCreateBinaryStatic(&waiter.storage);
+    taskENTER_CRITICAL();
+    CY_CRITICAL_TRACE_BEGIN(trace);
+    if (validate(context))
+    {
+        waiter.next = *queue;
+        *queue      = &waiter;
+        parked      = true;
+    }
+    CY_CRITICAL_TRACE_END(CY_CRITICAL_TRACE_PARK, trace);
+    taskEXIT_CRITICAL();
+    if (parked && (CY_MUTEX_POOL_WAIT_FOREVER != timeout))
     {
-        if (cy_mutex_pool_handle[i] == m)
+        if (xSemaphoreTake(waiter.semaphore, (TickType_t)timeout) == pdTRUE)
         {
-            cy_mutex_pool_handle[i] = NULL;
-            break;
+            parked = false;
+        }
+        else
+        {
+            // Timed out, unless cy_mutex_pool_unpark_all has taken the waiter off the queue in
+            // the meantime and is about to give the semaphore
+            taskENTER_CRITICAL();
+            for (cy_mutex_pool_waiter_t** link = queue; NULL != *link; link = &(*link)->next)
+            {
+                if (&waiter == *link)
+                {
+                    *link  = waiter.next;
+                    parked = false;
+                    woken  = false;
+                    break;
+                }
+            }
+            taskEXIT_CRITICAL();
+        }
+    }
+    if (parked)
+    {
+        while (xSemaphoreTake(waiter.semaphore, portMAX_DELAY) != pdTRUE)
+        {
+            // Halt here until woken by cy_mutex_pool_unpark_all
         }
     }
+    vSemaphoreDelete(waiter.semaphore);
+    return woken;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_park
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_park(const volatile void* key, bool (*validate)(const void* context),
+                        const void* context)
+{
+    (void)cy_mutex_pool_park_timeout(key, validate, context, CY_MUTEX_POOL_WAIT_FOREVER);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_unpark_all
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_unpark_all(const volatile void* key)
+{
+    cy_mutex_pool_waiter_t** queue = &cy_mutex_pool_park_queue[cy_mutex_pool_park_bucket(key)];
+    cy_mutex_pool_waiter_t*  waiter;
+
+    taskENTER_CRITICAL();
+    CY_CRITICAL_TRACE_BEGIN(trace);
+    waiter = *queue;
+    *queue = NULL;
+    CY_CRITICAL_TRACE_END(CY_CRITICAL_TRACE_UNPARK, trace);
     taskEXIT_CRITICAL();
+    while (NULL != waiter)
+    {
+        // The waiter's stack frame goes away once it is woken
+        cy_mutex_pool_waiter_t* next = waiter->next;
+        (void)xSemaphoreGive(waiter->semaphore);
+        waiter = next;
+    }
+}
+
+
+#endif // defined(MUTEX_POOL_AVAILABLE)
+
+#if defined(configNUMBER_OF_CORES) && (configNUMBER_OF_CORES > 1)
+// Used in place of the mutex pool when it is not available (see
+// cy_mutex_pool.h). Suspending the scheduler stops tasks from being switched
+// in, but does not stop a task that is already running on another core, so a
+// spinlock owned by the core provides the exclusion. The owner cannot be
+// preempted while it holds the spinlock because its scheduler is suspended.
+static volatile uintptr_t cy_mutex_pool_smp_owner = 0U;
+static uint32_t           cy_mutex_pool_smp_depth = 0U;
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_suspend_threads
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_suspend_threads(void)
+{
+    vTaskSuspendAll();
+    if (cy_freertos_kernel_started())
+    {
+        uintptr_t self = (uintptr_t)portGET_CORE_ID() + 1U;
+        if (cy_atomic_load(&cy_mutex_pool_smp_owner) != self)
+        {
+            while (!cy_atomic_compare_exchange(&cy_mutex_pool_smp_owner, 0U, self))
+            {
+                // Spin until the other core leaves its exclusive region
+            }
+        }
+        cy_mutex_pool_smp_depth++;
+    }
+    #if defined(CY_CRITICAL_TRACE)
+    cy_critical_trace_suspend_begin(CY_CRITICAL_TRACE_CALLER());
+    #endif
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_resume_threads
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_resume_threads(void)
+{
+    #if defined(CY_CRITICAL_TRACE)
+    cy_critical_trace_suspend_end();
+    #endif
+    if (cy_freertos_kernel_started())
+    {
+        cy_mutex_pool_smp_depth--;
+        if (0U == cy_mutex_pool_smp_depth)
+        {
+            cy_atomic_store(&cy_mutex_pool_smp_owner, 0U);
+        }
+    }
+    (void)xTaskResumeAll();
 }
 
 
+#endif // if defined(configNUMBER_OF_CORES) && (configNUMBER_OF_CORES > 1)
+
 #endif // if configUSE_MUTEXES == 0 || configUSE_RECURSIVE_MUTEXES == 0 ||
 // configSUPPORT_STATIC_ALLOCATION == 0
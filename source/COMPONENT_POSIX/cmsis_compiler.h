@@ -0,0 +1,57 @@
+/***********************************************************************************************//**
+ * \file COMPONENT_POSIX/cmsis_compiler.h
+ *
+ * \brief
+ * Host stand-in for the CMSIS compiler intrinsics used by clib-support
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <signal.h>
+#include <stdint.h>
+
+// Host builds have no CMSIS. Provide the few intrinsics this library uses so
+// that the toolchain ports and shared sources compile unchanged.
+
+#ifndef __STATIC_INLINE
+#define __STATIC_INLINE         static inline
+#endif
+
+#ifndef __STATIC_FORCEINLINE
+#define __STATIC_FORCEINLINE    __attribute__((always_inline)) static inline
+#endif
+
+// There is no debugger to halt on a host; raise SIGTRAP instead so that an
+// attached debugger stops at the same places a target would.
+#define __BKPT(value)           ((void)(value), (void)raise(SIGTRAP))
+
+#define __DMB()                 __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+#define __CLZ(value)            (((value) == 0U) ? 32U : (uint8_t)__builtin_clz(value))
+
+#ifndef __WEAK
+#define __WEAK                  __attribute__((weak))
+#endif
+
+#ifndef __ALIGNED
+#define __ALIGNED(x)            __attribute__((aligned(x)))
+#endif
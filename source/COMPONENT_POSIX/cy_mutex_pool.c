@@ -0,0 +1,576 @@
+/***********************************************************************************************//**
+ * \file COMPONENT_POSIX/cy_mutex_pool.c
+ *
+ * \brief
+ * Mutex pool implementation for POSIX threads (host builds)
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#if defined(CY_MUTEX_POOL_LOCKDEP)
+// For pthread_getname_np
+#define _GNU_SOURCE
+#endif
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <cmsis_compiler.h>
+#include "cy_mutex_pool.h"
+#include "cy_mutex_pool_cfg.h"
+#include "cy_mutex_pool_bitmap.h"
+#include "cy_mutex_pool_park.h"
+#include "cy_mutex_pool_stats.h"
+#include "cy_mutex_pool_wait.h"
+#include "cy_mutex_pool_lockdep.h"
+
+// This backend runs the C library hooks on a POSIX host so that they can be
+// stress-tested and profiled without a target. It mirrors the FreeRTOS and
+// ThreadX backends: the mutexes come from a static pool of CY_STATIC_MUTEX_MAX
+// recursive mutexes and are never allocated on the heap.
+
+// The mutex functions may be called before cy_mutex_pool_posix_kernel_start,
+// which stands in for vTaskStartScheduler/tx_kernel_enter. In this case, the
+// acquire/release functions will do nothing.
+
+static atomic_bool cy_posix_rtos_started = false;
+
+//--------------------------------------------------------------------------------------------------
+// cy_posix_kernel_started
+//--------------------------------------------------------------------------------------------------
+static bool cy_posix_kernel_started(void)
+{
+    return atomic_load_explicit(&cy_posix_rtos_started, memory_order_acquire);
+}
+
+
+static pthread_mutex_t cy_mutex_pool_storage[CY_STATIC_MUTEX_MAX];
+static cy_mutex_pool_bitmap_t cy_mutex_pool_bitmap;
+#if defined(CY_MUTEX_POOL_STATS)
+static cy_mutex_pool_stats_slot_t cy_mutex_pool_stats[CY_STATIC_MUTEX_MAX];
+#endif
+
+// As on FreeRTOS SMP, a thread that finds a pool mutex taken polls its owner
+// for up to CY_MUTEX_POOL_SPIN_LIMIT plain loads and tries once more as soon as
+// the mutex is free, before it blocks. 0 (the default on the host) always
+// blocks immediately.
+#ifndef CY_MUTEX_POOL_SPIN_LIMIT
+#define CY_MUTEX_POOL_SPIN_LIMIT    (0U)
+#endif
+
+#if defined(CY_MUTEX_POOL_WATCHDOG_TICKS) || (CY_MUTEX_POOL_SPIN_LIMIT > 0)
+// pthread mutexes do not expose their owner, so it is tracked here for the
+// watchdog and spinning waiters. Both fields are only written by the thread
+// holding the mutex, except that the owner is cleared after the mutex is
+// unlocked unless another thread has stored itself meanwhile.
+#define CY_POSIX_OWNER_TRACKED
+static _Atomic(void*) cy_mutex_pool_owner[CY_STATIC_MUTEX_MAX];
+static uint32_t cy_mutex_pool_depth[CY_STATIC_MUTEX_MAX];
+#endif
+
+// Protects cy_mutex_pool_bitmap. This is the host equivalent of the critical
+// section the RTOS backends enter while searching for a free slot.
+static pthread_mutex_t cy_mutex_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_posix_kernel_start
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_posix_kernel_start(void)
+{
+    atomic_store_explicit(&cy_posix_rtos_started, true, memory_order_release);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_setup
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_setup(void)
+{
+    // Only required if the startup code does not initialize cy_mutex_pool_bitmap
+    memset(&cy_mutex_pool_bitmap, 0, sizeof(cy_mutex_pool_bitmap));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_create
+//--------------------------------------------------------------------------------------------------
+cy_mutex_pool_semaphore_t cy_mutex_pool_create(cy_mutex_pool_role_t role)
+{
+    cy_mutex_pool_semaphore_t handle = NULL;
+    pthread_mutexattr_t       attr;
+    int32_t                   found;
+
+    (void)pthread_mutex_lock(&cy_mutex_pool_lock);
+    CY_CRITICAL_TRACE_BEGIN(trace);
+    found = cy_mutex_pool_bitmap_alloc(&cy_mutex_pool_bitmap);
+    CY_CRITICAL_TRACE_END(CY_CRITICAL_TRACE_POOL_CREATE, trace);
+    (void)pthread_mutex_unlock(&cy_mutex_pool_lock);
+
+    if (found >= 0)
+    {
+        handle = &cy_mutex_pool_storage[found];
+        (void)pthread_mutexattr_init(&attr);
+        (void)pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+        if ((CY_MUTEX_POOL_INHERIT & CY_MUTEX_POOL_ROLE_BIT(role)) != 0UL)
+        {
+            (void)pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+        }
+        if (0 != pthread_mutex_init(handle, &attr))
+        {
+            (void)pthread_mutex_lock(&cy_mutex_pool_lock);
+            CY_CRITICAL_TRACE_BEGIN(trace_free);
+            cy_mutex_pool_bitmap_free(&cy_mutex_pool_bitmap, (uint32_t)found);
+            CY_CRITICAL_TRACE_END(CY_CRITICAL_TRACE_POOL_CREATE, trace_free);
+            (void)pthread_mutex_unlock(&cy_mutex_pool_lock);
+            handle = NULL;
+        }
+        #if defined(CY_MUTEX_POOL_STATS)
+        else
+        {
+            cy_mutex_pool_stats_reset(&cy_mutex_pool_stats[handle - cy_mutex_pool_storage]);
+        }
+        #endif
+        #if defined(CY_MUTEX_POOL_LOCKDEP)
+        if (NULL != handle)
+        {
+            cy_mutex_pool_lockdep_created((uint32_t)found, role);
+        }
+        #endif
+        (void)pthread_mutexattr_destroy(&attr);
+    }
+
+    if (NULL == handle)
+    {
+        __BKPT(0);  // Out of resources
+    }
+
+    return handle;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_posix_take
+//--------------------------------------------------------------------------------------------------
+static bool cy_posix_take(cy_mutex_pool_semaphore_t m, uint32_t ticks)
+{
+    bool acquired;
+    if (CY_MUTEX_POOL_WAIT_FOREVER == ticks)
+    {
+        while (pthread_mutex_lock(m) != 0)
+        {
+            // Halt here until the operation succeeds
+        }
+        acquired = true;
+    }
+    else
+    {
+        // Host ticks are milliseconds
+        struct timespec deadline;
+        (void)clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec  += (time_t)(ticks / 1000U);
+        deadline.tv_nsec += (long)(ticks % 1000U) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        acquired = (pthread_mutex_timedlock(m, &deadline) == 0);
+    }
+    return acquired;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_posix_owner
+//--------------------------------------------------------------------------------------------------
+static void* cy_posix_owner(cy_mutex_pool_semaphore_t m)
+{
+    #if defined(CY_POSIX_OWNER_TRACKED)
+    return atomic_load_explicit(&cy_mutex_pool_owner[m - cy_mutex_pool_storage],
+                                memory_order_relaxed);
+    #else
+    (void)m;
+    return NULL;
+    #endif
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_posix_spin_acquire
+//--------------------------------------------------------------------------------------------------
+static inline bool cy_posix_spin_acquire(cy_mutex_pool_semaphore_t m)
+{
+    bool acquired = false;
+    #if (CY_MUTEX_POOL_SPIN_LIMIT > 0)
+    _Atomic(void*)* owner = &cy_mutex_pool_owner[m - cy_mutex_pool_storage];
+    for (uint32_t i = 0U; i < CY_MUTEX_POOL_SPIN_LIMIT; i++)
+    {
+        if (NULL == atomic_load_explicit(owner, memory_order_relaxed))
+        {
+            acquired = (pthread_mutex_trylock(m) == 0);
+            break;
+        }
+    }
+    #else
+    (void)m;
+    #endif // if (CY_MUTEX_POOL_SPIN_LIMIT > 0)
+    return acquired;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_posix_acquire
+//--------------------------------------------------------------------------------------------------
+static bool cy_posix_acquire(cy_mutex_pool_semaphore_t m, uint32_t timeout)
+{
+    bool acquired = true;
+    if (cy_posix_kernel_started())
+    {
+        #if defined(CY_MUTEX_POOL_LOCKDEP)
+        if (0U != timeout)
+        {
+            cy_mutex_pool_lockdep_acquiring((uint32_t)(m - cy_mutex_pool_storage));
+        }
+        #endif
+        #if defined(CY_MUTEX_POOL_STATS)
+        uint32_t start = CY_MUTEX_POOL_STATS_TIMESTAMP();
+        #endif
+        acquired = (pthread_mutex_trylock(m) == 0);
+        bool contended = !acquired;
+        if (contended)
+        {
+            acquired = ((0U != timeout) && cy_posix_spin_acquire(m)) ||
+                       cy_mutex_pool_wait(m, timeout, cy_posix_take, cy_posix_owner);
+        }
+        #if defined(CY_POSIX_OWNER_TRACKED)
+        if (acquired && (0U == cy_mutex_pool_depth[m - cy_mutex_pool_storage]++))
+        {
+            atomic_store_explicit(&cy_mutex_pool_owner[m - cy_mutex_pool_storage],
+                                  (void*)pthread_self(), memory_order_relaxed);
+        }
+        #endif
+        #if defined(CY_MUTEX_POOL_STATS)
+        if (acquired)
+        {
+            cy_mutex_pool_stats_acquired(&cy_mutex_pool_stats[m - cy_mutex_pool_storage], start,
+                                         contended, (void*)pthread_self());
+        }
+        #endif
+        #if defined(CY_MUTEX_POOL_LOCKDEP)
+        if (acquired)
+        {
+            cy_mutex_pool_lockdep_acquired((uint32_t)(m - cy_mutex_pool_storage));
+        }
+        #endif
+    }
+    return acquired;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_acquire
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_acquire(cy_mutex_pool_semaphore_t m)
+{
+    (void)cy_posix_acquire(m, CY_MUTEX_POOL_WAIT_FOREVER);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_try_acquire
+//--------------------------------------------------------------------------------------------------
+bool cy_mutex_pool_try_acquire(cy_mutex_pool_semaphore_t m)
+{
+    return cy_posix_acquire(m, 0U);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_acquire_timeout
+//--------------------------------------------------------------------------------------------------
+bool cy_mutex_pool_acquire_timeout(cy_mutex_pool_semaphore_t m, uint32_t timeout)
+{
+    return cy_posix_acquire(m, timeout);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_release
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_release(cy_mutex_pool_semaphore_t m)
+{
+    if (cy_posix_kernel_started())
+    {
+        #if defined(CY_MUTEX_POOL_STATS)
+        cy_mutex_pool_stats_releasing(&cy_mutex_pool_stats[m - cy_mutex_pool_storage]);
+        #endif
+        #if defined(CY_MUTEX_POOL_LOCKDEP)
+        cy_mutex_pool_lockdep_releasing((uint32_t)(m - cy_mutex_pool_storage));
+        #endif
+        #if defined(CY_POSIX_OWNER_TRACKED)
+        bool last = (0U == --cy_mutex_pool_depth[m - cy_mutex_pool_storage]);
+        (void)pthread_mutex_unlock(m);
+        void* self = (void*)pthread_self();
+        if (last)
+        {
+            (void)atomic_compare_exchange_strong(&cy_mutex_pool_owner[m - cy_mutex_pool_storage],
+                                                 &self, NULL);
+        }
+        #else
+        (void)pthread_mutex_unlock(m);
+        #endif
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_destroy
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_destroy(cy_mutex_pool_semaphore_t m)
+{
+    #if defined(CY_MUTEX_POOL_LOCKDEP)
+    cy_mutex_pool_lockdep_destroyed((uint32_t)(m - cy_mutex_pool_storage));
+    #endif
+    (void)pthread_mutex_destroy(m);
+    (void)pthread_mutex_lock(&cy_mutex_pool_lock);
+    CY_CRITICAL_TRACE_BEGIN(trace);
+    cy_mutex_pool_bitmap_free(&cy_mutex_pool_bitmap, (uint32_t)(m - cy_mutex_pool_storage));
+    CY_CRITICAL_TRACE_END(CY_CRITICAL_TRACE_POOL_DESTROY, trace);
+    (void)pthread_mutex_unlock(&cy_mutex_pool_lock);
+}
+
+
+#if defined(CY_MUTEX_POOL_STATS)
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_get_stats
+//--------------------------------------------------------------------------------------------------
+uint32_t cy_mutex_pool_get_stats(cy_mutex_pool_stats_t* stats, uint32_t count)
+{
+    return cy_mutex_pool_stats_snapshot(cy_mutex_pool_stats, CY_STATIC_MUTEX_MAX, stats, count);
+}
+
+
+#endif // defined(CY_MUTEX_POOL_STATS)
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_kernel_started
+//--------------------------------------------------------------------------------------------------
+bool cy_mutex_pool_kernel_started(void)
+{
+    return cy_posix_kernel_started();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_current_task
+//--------------------------------------------------------------------------------------------------
+void* cy_mutex_pool_current_task(void)
+{
+    return (void*)pthread_self();
+}
+
+
+#if defined(CY_MUTEX_POOL_LOCKDEP)
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_task_name
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_task_name(void* task, char* name, uint32_t size)
+{
+    if (0 != pthread_getname_np((pthread_t)task, name, size))
+    {
+        name[0] = '\0';
+    }
+}
+
+
+#endif // defined(CY_MUTEX_POOL_LOCKDEP)
+
+static pthread_key_t  cy_mutex_pool_tls_key;
+static pthread_once_t cy_mutex_pool_tls_once = PTHREAD_ONCE_INIT;
+static void           (*cy_mutex_pool_tls_destructor)(void* value) = NULL;
+
+//--------------------------------------------------------------------------------------------------
+// cy_posix_tls_deleted
+//--------------------------------------------------------------------------------------------------
+static void cy_posix_tls_deleted(void* value)
+{
+    if (NULL != cy_mutex_pool_tls_destructor)
+    {
+        cy_mutex_pool_tls_destructor(value);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_posix_tls_init
+//--------------------------------------------------------------------------------------------------
+static void cy_posix_tls_init(void)
+{
+    (void)pthread_key_create(&cy_mutex_pool_tls_key, cy_posix_tls_deleted);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_get_task_local
+//--------------------------------------------------------------------------------------------------
+void* cy_mutex_pool_get_task_local(void)
+{
+    (void)pthread_once(&cy_mutex_pool_tls_once, cy_posix_tls_init);
+    return pthread_getspecific(cy_mutex_pool_tls_key);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_set_task_local
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_set_task_local(void* value, void (*destructor)(void* value))
+{
+    (void)pthread_once(&cy_mutex_pool_tls_once, cy_posix_tls_init);
+    cy_mutex_pool_tls_destructor = destructor;
+    (void)pthread_setspecific(cy_mutex_pool_tls_key, value);
+}
+
+
+// A parked thread waits on its queue's condition variable until its own
+// woken flag is set, which filters out wake-ups meant for other waiters.
+typedef struct cy_mutex_pool_waiter
+{
+    struct cy_mutex_pool_waiter* next;
+    bool                         woken;
+} cy_mutex_pool_waiter_t;
+
+typedef struct
+{
+    pthread_mutex_t         lock;
+    pthread_cond_t          wake;
+    cy_mutex_pool_waiter_t* head;
+} cy_mutex_pool_park_queue_t;
+
+static cy_mutex_pool_park_queue_t cy_mutex_pool_park_queue[CY_MUTEX_POOL_PARK_BUCKETS];
+static pthread_once_t             cy_mutex_pool_park_once = PTHREAD_ONCE_INIT;
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_park_init
+//--------------------------------------------------------------------------------------------------
+static void cy_mutex_pool_park_init(void)
+{
+    for (uint32_t i = 0U; i < CY_MUTEX_POOL_PARK_BUCKETS; i++)
+    {
+        (void)pthread_mutex_init(&cy_mutex_pool_park_queue[i].lock, NULL);
+        (void)pthread_cond_init(&cy_mutex_pool_park_queue[i].wake, NULL);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_park_timeout
+//--------------------------------------------------------------------------------------------------
+bool cy_mutex_pool_park_timeout(const volatile void* key, bool (*validate)(const void* context),
+                                const void* context, uint32_t timeout)
+{
+    cy_mutex_pool_park_queue_t* queue = &cy_mutex_pool_park_queue[cy_mutex_pool_park_bucket(key)];
+    cy_mutex_pool_waiter_t      waiter = { NULL, false };
+    bool                        woken  = true;
+    struct timespec             deadline;
+
+    if (CY_MUTEX_POOL_WAIT_FOREVER != timeout)
+    {
+        // Host ticks are milliseconds
+        (void)clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec  += (time_t)(timeout / 1000U);
+        deadline.tv_nsec += (long)(timeout % 1000U) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+    (void)pthread_once(&cy_mutex_pool_park_once, cy_mutex_pool_park_init);
+    (void)pthread_mutex_lock(&queue->lock);
+    CY_CRITICAL_TRACE_BEGIN(trace);
+    if (!validate(context))
+    {
+        CY_CRITICAL_TRACE_END(CY_CRITICAL_TRACE_PARK, trace);
+    }
+    else
+    {
+        waiter.next = queue->head;
+        queue->head = &waiter;
+        CY_CRITICAL_TRACE_END(CY_CRITICAL_TRACE_PARK, trace);
+        while (!waiter.woken && woken)
+        {
+            if (CY_MUTEX_POOL_WAIT_FOREVER == timeout)
+            {
+                (void)pthread_cond_wait(&queue->wake, &queue->lock);
+            }
+            else if (ETIMEDOUT == pthread_cond_timedwait(&queue->wake, &queue->lock, &deadline))
+            {
+                woken = waiter.woken;
+            }
+        }
+        if (!woken)
+        {
+            // Still queued, as cy_mutex_pool_unpark_all sets woken under the lock
+            cy_mutex_pool_waiter_t** link = &queue->head;
+            while (*link != &waiter)
+            {
+                link = &(*link)->next;
+            }
+            *link = waiter.next;
+        }
+    }
+    (void)pthread_mutex_unlock(&queue->lock);
+    return woken;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_park
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_park(const volatile void* key, bool (*validate)(const void* context),
+                        const void* context)
+{
+    (void)cy_mutex_pool_park_timeout(key, validate, context, CY_MUTEX_POOL_WAIT_FOREVER);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_unpark_all
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_unpark_all(const volatile void* key)
+{
+    cy_mutex_pool_park_queue_t* queue = &cy_mutex_pool_park_queue[cy_mutex_pool_park_bucket(key)];
+
+    (void)pthread_once(&cy_mutex_pool_park_once, cy_mutex_pool_park_init);
+    (void)pthread_mutex_lock(&queue->lock);
+    CY_CRITICAL_TRACE_BEGIN(trace);
+    for (cy_mutex_pool_waiter_t* waiter = queue->head; NULL != waiter; waiter = waiter->next)
+    {
+        waiter->woken = true;
+    }
+    queue->head = NULL;
+    CY_CRITICAL_TRACE_END(CY_CRITICAL_TRACE_UNPARK, trace);
+    (void)pthread_cond_broadcast(&queue->wake);
+    (void)pthread_mutex_unlock(&queue->lock);
+}
@@ -36,6 +36,11 @@
 
 #include "cy_mutex_pool.h"
 #include "cy_mutex_pool_cfg.h"
+#include "cy_mutex_pool_bitmap.h"
+#include "cy_mutex_pool_park.h"
+#include "cy_mutex_pool_stats.h"
+#include "cy_mutex_pool_wait.h"
+#include "cy_mutex_pool_lockdep.h"
 #include "tx_api.h"
 #include "tx_thread.h"
 #include "tx_mutex.h"
@@ -85,6 +90,57 @@ static void cy_threadx_check_in_isr(void)
 }
 
 
+// The free-slot bitmap is only used by threads (and before the kernel is
+// started), so instead of masking interrupts it is protected by raising the
+// calling thread's preemption threshold, which keeps other threads from
+// running while interrupts stay enabled. If preemption-threshold is disabled
+// in the ThreadX build, interrupts are masked for the few instructions of the
+// constant-time bitmap update instead.
+typedef UINT cy_threadx_pool_lock_t;
+
+//--------------------------------------------------------------------------------------------------
+// cy_threadx_pool_lock
+//--------------------------------------------------------------------------------------------------
+static cy_threadx_pool_lock_t cy_threadx_pool_lock(void)
+{
+    cy_threadx_pool_lock_t previous = 0U;
+    #if defined(TX_DISABLE_PREEMPTION_THRESHOLD)
+    previous = tx_interrupt_control(TX_INT_DISABLE);
+    #else
+    if (cy_threadx_kernel_started())
+    {
+        TX_THREAD* thread = tx_thread_identify();
+        if (TX_NULL != thread)
+        {
+            (void)tx_thread_preemption_change(thread, 0U, &previous);
+        }
+    }
+    #endif // if defined(TX_DISABLE_PREEMPTION_THRESHOLD)
+    return previous;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_threadx_pool_unlock
+//--------------------------------------------------------------------------------------------------
+static void cy_threadx_pool_unlock(cy_threadx_pool_lock_t previous)
+{
+    #if defined(TX_DISABLE_PREEMPTION_THRESHOLD)
+    (void)tx_interrupt_control(previous);
+    #else
+    if (cy_threadx_kernel_started())
+    {
+        TX_THREAD* thread = tx_thread_identify();
+        if (TX_NULL != thread)
+        {
+            UINT threshold;
+            (void)tx_thread_preemption_change(thread, previous, &threshold);
+        }
+    }
+    #endif // if defined(TX_DISABLE_PREEMPTION_THRESHOLD)
+}
+
+
 #ifdef __ICCARM__
 // For IAR, the mutexes are allocated by __iar_Initlocks before static
 // data initialization. Use the __no_init attribute so the mutex data
@@ -97,6 +153,10 @@ static void cy_threadx_check_in_isr(void)
 #endif
 
 static CY_ATTR_NO_INIT TX_MUTEX cy_mutex_pool_storage[CY_STATIC_MUTEX_MAX];
+static CY_ATTR_NO_INIT cy_mutex_pool_bitmap_t cy_mutex_pool_bitmap;
+#if defined(CY_MUTEX_POOL_STATS)
+static cy_mutex_pool_stats_slot_t cy_mutex_pool_stats[CY_STATIC_MUTEX_MAX];
+#endif
 
 //--------------------------------------------------------------------------------------------------
 // cy_mutex_pool_setup
@@ -105,40 +165,57 @@ void cy_mutex_pool_setup(void)
 {
     // Only required if the startup code does not initialize cy_mutex_pool_storage
     memset(cy_mutex_pool_storage, 0, sizeof(cy_mutex_pool_storage));
+    memset(&cy_mutex_pool_bitmap, 0, sizeof(cy_mutex_pool_bitmap));
 }
 
 
 //--------------------------------------------------------------------------------------------------
 // cy_mutex_pool_create
 //--------------------------------------------------------------------------------------------------
-cy_mutex_pool_semaphore_t cy_mutex_pool_create(void)
+cy_mutex_pool_semaphore_t cy_mutex_pool_create(cy_mutex_pool_role_t role)
 {
-    UINT old_posture;
+    cy_threadx_pool_lock_t lock;
+    int32_t found;
     cy_mutex_pool_semaphore_t handle = NULL;
+    UINT inherit = ((CY_MUTEX_POOL_INHERIT & CY_MUTEX_POOL_ROLE_BIT(role)) != 0UL) ?
+                   TX_INHERIT : TX_NO_INHERIT;
 
     cy_threadx_check_in_isr();
 
     /*
-     * Find a mutex that hasn't been initialized yet.
+     * Claim a mutex that hasn't been initialized yet.
      */
 
-    old_posture = tx_interrupt_control(TX_INT_DISABLE);
-    for (uint16_t i = 0; i < CY_STATIC_MUTEX_MAX; i++)
-    {
-        if (TX_MUTEX_ID != cy_mutex_pool_storage[i].tx_mutex_id)
-        {
-            handle = &cy_mutex_pool_storage[i];
-            break;
-        }
-    }
-    tx_interrupt_control(old_posture);
+    lock  = cy_threadx_pool_lock();
+    CY_CRITICAL_TRACE_BEGIN(trace);
+    found = cy_mutex_pool_bitmap_alloc(&cy_mutex_pool_bitmap);
+    CY_CRITICAL_TRACE_END(CY_CRITICAL_TRACE_POOL_CREATE, trace);
+    cy_threadx_pool_unlock(lock);
 
-    if (NULL != handle)
+    if (found >= 0)
     {
-        if (tx_mutex_create(handle, TX_NULL, TX_NO_INHERIT) != TX_SUCCESS)
+        handle = &cy_mutex_pool_storage[found];
+        if (tx_mutex_create(handle, TX_NULL, inherit) != TX_SUCCESS)
         {
+            lock = cy_threadx_pool_lock();
+            CY_CRITICAL_TRACE_BEGIN(trace_free);
+            cy_mutex_pool_bitmap_free(&cy_mutex_pool_bitmap, (uint32_t)found);
+            CY_CRITICAL_TRACE_END(CY_CRITICAL_TRACE_POOL_CREATE, trace_free);
+            cy_threadx_pool_unlock(lock);
             handle = NULL;
         }
+        #if defined(CY_MUTEX_POOL_STATS)
+        else
+        {
+            cy_mutex_pool_stats_reset(&cy_mutex_pool_stats[handle - cy_mutex_pool_storage]);
+        }
+        #endif
+        #if defined(CY_MUTEX_POOL_LOCKDEP)
+        if (NULL != handle)
+        {
+            cy_mutex_pool_lockdep_created((uint32_t)found, role);
+        }
+        #endif
     }
 
     if (NULL == handle)
@@ -151,20 +228,103 @@ cy_mutex_pool_semaphore_t cy_mutex_pool_create(void)
 
 
 //--------------------------------------------------------------------------------------------------
-// cy_mutex_pool_acquire
+// cy_threadx_take
 //--------------------------------------------------------------------------------------------------
-void cy_mutex_pool_acquire(cy_mutex_pool_semaphore_t m)
+static bool cy_threadx_take(cy_mutex_pool_semaphore_t m, uint32_t ticks)
 {
+    bool acquired;
+    if (CY_MUTEX_POOL_WAIT_FOREVER == ticks)
+    {
+        // An infinite wait still ends early if another thread aborts it
+        while (tx_mutex_get(m, TX_WAIT_FOREVER) != TX_SUCCESS)
+        {
+            // Halt here until the operation succeeds
+        }
+        acquired = true;
+    }
+    else
+    {
+        acquired = (tx_mutex_get(m, (ULONG)ticks) == TX_SUCCESS);
+    }
+    return acquired;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_threadx_owner
+//--------------------------------------------------------------------------------------------------
+static void* cy_threadx_owner(cy_mutex_pool_semaphore_t m)
+{
+    return m->tx_mutex_owner;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_threadx_acquire
+//--------------------------------------------------------------------------------------------------
+static bool cy_threadx_acquire(cy_mutex_pool_semaphore_t m, uint32_t timeout)
+{
+    bool acquired = true;
     cy_threadx_check_in_isr();
     if (cy_threadx_kernel_started())
     {
-        static const uint32_t CY_MUTEX_TIMEOUT_TICKS = 10000;
-
-        while (tx_mutex_get(m, CY_MUTEX_TIMEOUT_TICKS) != TX_SUCCESS)
+        #if defined(CY_MUTEX_POOL_LOCKDEP)
+        if (0U != timeout)
         {
-            // Halt here until condition the operation succeeds
+            cy_mutex_pool_lockdep_acquiring((uint32_t)(m - cy_mutex_pool_storage));
         }
+        #endif
+        #if defined(CY_MUTEX_POOL_STATS)
+        uint32_t start = CY_MUTEX_POOL_STATS_TIMESTAMP();
+        #endif
+        acquired = (tx_mutex_get(m, TX_NO_WAIT) == TX_SUCCESS);
+        bool contended = !acquired;
+        if (contended)
+        {
+            acquired = cy_mutex_pool_wait(m, timeout, cy_threadx_take, cy_threadx_owner);
+        }
+        #if defined(CY_MUTEX_POOL_STATS)
+        if (acquired)
+        {
+            cy_mutex_pool_stats_acquired(&cy_mutex_pool_stats[m - cy_mutex_pool_storage], start,
+                                         contended, tx_thread_identify());
+        }
+        #endif
+        #if defined(CY_MUTEX_POOL_LOCKDEP)
+        if (acquired)
+        {
+            cy_mutex_pool_lockdep_acquired((uint32_t)(m - cy_mutex_pool_storage));
+        }
+        #endif
     }
+    return acquired;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_acquire
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_acquire(cy_mutex_pool_semaphore_t m)
+{
+    (void)cy_threadx_acquire(m, CY_MUTEX_POOL_WAIT_FOREVER);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_try_acquire
+//--------------------------------------------------------------------------------------------------
+bool cy_mutex_pool_try_acquire(cy_mutex_pool_semaphore_t m)
+{
+    return cy_threadx_acquire(m, 0U);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_acquire_timeout
+//--------------------------------------------------------------------------------------------------
+bool cy_mutex_pool_acquire_timeout(cy_mutex_pool_semaphore_t m, uint32_t timeout)
+{
+    return cy_threadx_acquire(m, timeout);
 }
 
 
@@ -176,6 +336,12 @@ void cy_mutex_pool_release(cy_mutex_pool_semaphore_t m)
     cy_threadx_check_in_isr();
     if (cy_threadx_kernel_started())
     {
+        #if defined(CY_MUTEX_POOL_STATS)
+        cy_mutex_pool_stats_releasing(&cy_mutex_pool_stats[m - cy_mutex_pool_storage]);
+        #endif
+        #if defined(CY_MUTEX_POOL_LOCKDEP)
+        cy_mutex_pool_lockdep_releasing((uint32_t)(m - cy_mutex_pool_storage));
+        #endif
         tx_mutex_put(m);
     }
 }
@@ -186,11 +352,276 @@ void cy_mutex_pool_release(cy_mutex_pool_semaphore_t m)
 //--------------------------------------------------------------------------------------------------
 void cy_mutex_pool_destroy(cy_mutex_pool_semaphore_t m)
 {
-    UINT old_posture;
+    cy_threadx_pool_lock_t lock;
+
+    cy_threadx_check_in_isr();
+
+    #if defined(CY_MUTEX_POOL_LOCKDEP)
+    cy_mutex_pool_lockdep_destroyed((uint32_t)(m - cy_mutex_pool_storage));
+    #endif
+    // The slot only becomes available again once the mutex is deleted, so
+    // the deletion itself needs no protection.
+    (void)tx_mutex_delete(m);
+    lock = cy_threadx_pool_lock();
+    CY_CRITICAL_TRACE_BEGIN(trace);
+    cy_mutex_pool_bitmap_free(&cy_mutex_pool_bitmap, (uint32_t)(m - cy_mutex_pool_storage));
+    CY_CRITICAL_TRACE_END(CY_CRITICAL_TRACE_POOL_DESTROY, trace);
+    cy_threadx_pool_unlock(lock);
+}
+
+
+#if defined(CY_MUTEX_POOL_STATS)
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_get_stats
+//--------------------------------------------------------------------------------------------------
+uint32_t cy_mutex_pool_get_stats(cy_mutex_pool_stats_t* stats, uint32_t count)
+{
+    return cy_mutex_pool_stats_snapshot(cy_mutex_pool_stats, CY_STATIC_MUTEX_MAX, stats, count);
+}
+
+
+#endif // defined(CY_MUTEX_POOL_STATS)
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_kernel_started
+//--------------------------------------------------------------------------------------------------
+bool cy_mutex_pool_kernel_started(void)
+{
+    return cy_threadx_kernel_started();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_current_task
+//--------------------------------------------------------------------------------------------------
+void* cy_mutex_pool_current_task(void)
+{
+    return tx_thread_identify();
+}
+
+
+#if defined(CY_MUTEX_POOL_LOCKDEP)
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_task_name
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_task_name(void* task, char* name, uint32_t size)
+{
+    const CHAR* thread_name = ((TX_THREAD*)task)->tx_thread_name;
+    (void)strncpy(name, (NULL != thread_name) ? thread_name : "", size - 1U);
+    name[size - 1U] = '\0';
+}
+
+
+#endif // defined(CY_MUTEX_POOL_LOCKDEP)
+
+// ThreadX has no generic thread local storage. The task-local pointer is
+// available when the application defines CY_MUTEX_POOL_THREADX_TASK_LOCAL and
+// adds a cy_task_local member to TX_THREAD:
+//     #define TX_THREAD_USER_EXTENSION VOID* cy_task_local;
+// TX_THREAD_USER_EXTENSION alone is not enough, as applications and other
+// middleware use it for their own members, and cannot be checked here either:
+// tx_port.h defines it as empty when the application does not. Defining
+// CY_MUTEX_POOL_THREADX_TASK_LOCAL states that the member exists; without it
+// the build fails where cy_task_local is used.
+// ThreadX has no deletion callback either; the destructor is only called if
+// the application also hooks cy_mutex_pool_threadx_thread_deleted into
+// thread deletion:
+//     #define TX_THREAD_DELETE_EXTENSION(p) cy_mutex_pool_threadx_thread_deleted(p)
+
+#if defined(CY_MUTEX_POOL_THREADX_TASK_LOCAL)
+static void (*cy_mutex_pool_tls_destructor)(void* value) = NULL;
+#endif
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_get_task_local
+//--------------------------------------------------------------------------------------------------
+void* cy_mutex_pool_get_task_local(void)
+{
+    void* value = NULL;
+    #if defined(CY_MUTEX_POOL_THREADX_TASK_LOCAL)
+    TX_THREAD* thread = tx_thread_identify();
+    if (NULL != thread)
+    {
+        value = thread->cy_task_local;
+    }
+    #endif
+    return value;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_set_task_local
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_set_task_local(void* value, void (*destructor)(void* value))
+{
+    #if defined(CY_MUTEX_POOL_THREADX_TASK_LOCAL)
+    TX_THREAD* thread = tx_thread_identify();
+    if (NULL != thread)
+    {
+        // One destructor serves all threads; clearing the pointer keeps it
+        if (NULL != destructor)
+        {
+            cy_mutex_pool_tls_destructor = destructor;
+        }
+        thread->cy_task_local = value;
+    }
+    #else
+    (void)value;
+    (void)destructor;
+    #endif
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_threadx_thread_deleted
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_threadx_thread_deleted(TX_THREAD* thread)
+{
+    #if defined(CY_MUTEX_POOL_THREADX_TASK_LOCAL)
+    void* value = thread->cy_task_local;
+    thread->cy_task_local = NULL;
+    if ((NULL != value) && (NULL != cy_mutex_pool_tls_destructor))
+    {
+        cy_mutex_pool_tls_destructor(value);
+    }
+    #else
+    (void)thread;
+    #endif
+}
+
+
+// A parked thread waits on a semaphore that lives on its own stack for as
+// long as it is parked, so wait objects only exist while there is contention.
+// cy_mutex_pool_unpark_all may run in an interrupt handler (the console drains
+// from one), so the queues are protected by masking interrupts. Each waiter
+// also points to the link that points to it, so every operation under the
+// mask takes constant time: queueing, a waiter that timed out taking itself
+// off, and taking one waiter at a time off a queue to wake it.
+typedef struct cy_mutex_pool_waiter
+{
+    struct cy_mutex_pool_waiter*  next;
+    struct cy_mutex_pool_waiter** link;     // NULL once taken off to be woken
+    TX_SEMAPHORE                  semaphore;
+} cy_mutex_pool_waiter_t;
+
+static cy_mutex_pool_waiter_t* cy_mutex_pool_park_queue[CY_MUTEX_POOL_PARK_BUCKETS];
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_park_timeout
+//--------------------------------------------------------------------------------------------------
+bool cy_mutex_pool_park_timeout(const volatile void* key, bool (*validate)(const void* context),
+                                const void* context, uint32_t timeout)
+{
+    cy_mutex_pool_waiter_t** queue = &cy_mutex_pool_park_queue[cy_mutex_pool_park_bucket(key)];
+    cy_mutex_pool_waiter_t   waiter;
+    bool                     parked = false;
+    bool                     woken  = true;
+    UINT                     old_posture;
 
     cy_threadx_check_in_isr();
+    (void)tx_semaphore_create(&waiter.semaphore, TX_NULL, 0);
+    old_posture = tx_interrupt_control(TX_INT_DISABLE);
+    CY_CRITICAL_TRACE_BEGIN(trace);
+    if (validate(context))
+    {
+        waiter.next = *queue;
+        waiter.link = queue;
+        if (NULL != waiter.next)
+        {
+            waiter.next->link = &waiter.next;
+        }
+        *queue = &waiter;
+        parked = true;
+    }
+    CY_CRITICAL_TRACE_END(CY_CRITICAL_TRACE_PARK, trace);
+    tx_interrupt_control(old_posture);
+    if (parked && (CY_MUTEX_POOL_WAIT_FOREVER != timeout))
+    {
+        if (tx_semaphore_get(&waiter.semaphore, (ULONG)timeout) == TX_SUCCESS)
+        {
+            parked = false;
+        }
+        else
+        {
+            // Timed out, unless cy_mutex_pool_unpark_all has taken the waiter off the queue in
+            // the meantime and is about to put the semaphore
+            old_posture = tx_interrupt_control(TX_INT_DISABLE);
+            if (NULL != waiter.link)
+            {
+                *waiter.link = waiter.next;
+                if (NULL != waiter.next)
+                {
+                    waiter.next->link = waiter.link;
+                }
+                parked = false;
+                woken  = false;
+            }
+            tx_interrupt_control(old_posture);
+        }
+    }
+    if (parked)
+    {
+        while (tx_semaphore_get(&waiter.semaphore, TX_WAIT_FOREVER) != TX_SUCCESS)
+        {
+            // Halt here until woken by cy_mutex_pool_unpark_all
+        }
+    }
+    (void)tx_semaphore_delete(&waiter.semaphore);
+    return woken;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_park
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_park(const volatile void* key, bool (*validate)(const void* context),
+                        const void* context)
+{
+    (void)cy_mutex_pool_park_timeout(key, validate, context, CY_MUTEX_POOL_WAIT_FOREVER);
+}
+
 
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_unpark_all
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_unpark_all(const volatile void* key)
+{
+    cy_mutex_pool_waiter_t** queue = &cy_mutex_pool_park_queue[cy_mutex_pool_park_bucket(key)];
+    cy_mutex_pool_waiter_t*  waiters;
+    cy_mutex_pool_waiter_t*  waiter;
+    UINT                     old_posture;
+
+    // The queue moves to a list of this call, on which waiters that time out can still take
+    // themselves off, and is then woken one waiter at a time
     old_posture = tx_interrupt_control(TX_INT_DISABLE);
-    tx_mutex_delete(m);
+    CY_CRITICAL_TRACE_BEGIN(trace);
+    waiters = *queue;
+    *queue  = NULL;
+    if (NULL != waiters)
+    {
+        waiters->link = &waiters;
+    }
+    CY_CRITICAL_TRACE_END(CY_CRITICAL_TRACE_UNPARK, trace);
     tx_interrupt_control(old_posture);
+    do
+    {
+        old_posture = tx_interrupt_control(TX_INT_DISABLE);
+        waiter      = waiters;
+        if (NULL != waiter)
+        {
+            waiters = waiter->next;
+            if (NULL != waiters)
+            {
+                waiters->link = &waiters;
+            }
+            waiter->link = NULL;
+        }
+        tx_interrupt_control(old_posture);
+        if (NULL != waiter)
+        {
+            // The waiter's stack frame goes away once it is woken
+            (void)tx_semaphore_put(&waiter->semaphore);
+        }
+    } while (NULL != waiter);
 }
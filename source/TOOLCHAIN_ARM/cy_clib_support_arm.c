@@ -27,13 +27,18 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <cmsis_compiler.h>
 #include "reent.h"
+#include "cy_clib_heap.h"
+#include "cy_clib_support_atomic.h"
+#include "cy_console.h"
 #include "cy_mutex_pool.h"
+#include "cy_romfs_port.h"
 #include "rt_misc.h"
-#if defined(COMPONENT_THREADX)
-#include "cy_pdl.h"
-#endif // defined(COMPONENT_THREADX)
+#if defined(CY_CONSOLE) || defined(CY_ROMFS)
+#include <rt_sys.h>
+#endif
 
 #if defined(COMPONENT_FREERTOS) && (configUSE_MUTEXES == 0 || configUSE_RECURSIVE_MUTEXES == 0 || \
                                     configSUPPORT_STATIC_ALLOCATION == 0)
@@ -49,7 +54,6 @@ __asm(".global __use_no_semihosting\n\t");
 __asm(".global __use_two_region_memory\n\t");
 #endif // defined(COMPONENT_CAT5)
 #if defined(MUTEX_POOL_AVAILABLE)
-cy_mutex_pool_semaphore_t cy_ctor_mutex;
 cy_mutex_pool_semaphore_t cy_timer_mutex;
 #endif // defined(MUTEX_POOL_AVAILABLE)
 
@@ -59,10 +63,6 @@ extern char Image$$HEAP$$ZI$$Base[];
 extern int Image$$HEAP$$ZI$$Limit;
 #endif // defined(COMPONENT_CAT5)
 
-#if defined(COMPONENT_THREADX)
-static uint16_t _scheduler_suspend_count = 0;
-static uint32_t _interrupt_primask = 0;
-#endif // defined(COMPONENT_THREADX)
 //--------------------------------------------------------------------------------------------------
 // _platform_post_stackheap_init
 //--------------------------------------------------------------------------------------------------
@@ -72,8 +72,7 @@ void _platform_post_stackheap_init(void)
     __rt_lib_init((unsigned)&Image$$HEAP$$ZI$$Base[0], (unsigned)&Image$$HEAP$$ZI$$Limit);
     #endif // defined(COMPONENT_CAT5)
     #if defined(MUTEX_POOL_AVAILABLE)
-    cy_ctor_mutex = cy_mutex_pool_create();
-    cy_timer_mutex = cy_mutex_pool_create();
+    cy_timer_mutex = cy_mutex_pool_create(CY_MUTEX_POOL_ROLE_TIMER);
     #endif // defined(MUTEX_POOL_AVAILABLE)
 }
 
@@ -84,40 +83,242 @@ void _platform_post_stackheap_init(void)
 //--------------------------------------------------------------------------------------------------
 size_t __rt_heap_extend(size_t incr, void** block)
 {
-    static uint8_t* heap_base = (uint8_t*)Image$$HEAP$$ZI$$Base;
-    static uint8_t* heap_limit = (uint8_t*)&Image$$HEAP$$ZI$$Limit;
-    static uint8_t* heapBrk = (uint8_t*)Image$$HEAP$$ZI$$Base;
-    if ((incr > (int32_t)(heap_limit - heapBrk)) ||
-        (((int32_t)heapBrk + incr) < (int32_t)heap_base))
+    cy_clib_heap_set_default_region(Image$$HEAP$$ZI$$Base,
+                                    (size_t)((uint8_t*)&Image$$HEAP$$ZI$$Limit -
+                                             (uint8_t*)Image$$HEAP$$ZI$$Base));
+    void* start = cy_clib_heap_extend(incr);
+    if (NULL == start)
     {
         return 0;
     }
-    *block = (void*)heapBrk;
-    heapBrk += incr;
+    *block = start;
     return incr;
 }
 
 
 #endif // defined(COMPONENT_CAT5)
 
+#if defined(CY_CLIB_HEAP_POOL)
+// ARM heap front end
+
+// Requests that fit a pool class are served from the lock-free block pools;
+// everything else, and anything the pools cannot serve, goes to the library
+// heap through the original functions.
+
+extern void* $Super$$malloc(size_t size);
+extern void  $Super$$free(void* ptr);
+extern void* $Super$$realloc(void* ptr, size_t size);
+extern void* $Super$$calloc(size_t count, size_t size);
+
+//--------------------------------------------------------------------------------------------------
+// $Sub$$malloc
+//--------------------------------------------------------------------------------------------------
+void* $Sub$$malloc(size_t size)
+{
+    void* ptr = cy_clib_heap_pool_alloc(size);
+    if (NULL == ptr)
+    {
+        ptr = $Super$$malloc(size);
+    }
+    return ptr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// $Sub$$free
+//--------------------------------------------------------------------------------------------------
+void $Sub$$free(void* ptr)
+{
+    if ((NULL != ptr) && !cy_clib_heap_pool_free(ptr))
+    {
+        $Super$$free(ptr);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// $Sub$$realloc
+//--------------------------------------------------------------------------------------------------
+void* $Sub$$realloc(void* ptr, size_t size)
+{
+    void*  result;
+    size_t block_size = cy_clib_heap_pool_block_size(ptr);
+    if (0U == block_size)
+    {
+        result = $Super$$realloc(ptr, size);
+    }
+    else if (size <= block_size)
+    {
+        result = ptr;
+    }
+    else
+    {
+        result = $Super$$malloc(size);
+        if (NULL != result)
+        {
+            memcpy(result, ptr, block_size);
+            (void)cy_clib_heap_pool_free(ptr);
+        }
+    }
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// $Sub$$calloc
+//--------------------------------------------------------------------------------------------------
+void* $Sub$$calloc(size_t count, size_t size)
+{
+    void* ptr = NULL;
+    if ((0U == size) || (count <= (SIZE_MAX / size)))
+    {
+        ptr = cy_clib_heap_pool_alloc(count * size);
+    }
+    if (NULL != ptr)
+    {
+        memset(ptr, 0, count * size);
+    }
+    else
+    {
+        ptr = $Super$$calloc(count, size);
+    }
+    return ptr;
+}
+
+
+#endif // defined(CY_CLIB_HEAP_POOL)
+
 // ARM thread-local state
 
 static struct _reent cy_armlib_global_impure;
 struct _reent*       _impure_ptr = &cy_armlib_global_impure;
 
+#if defined(CY_ARMLIB_LIBSPACE_POOL) && defined(MUTEX_POOL_AVAILABLE)
+// Each task gets its own libspace (errno, strtok and rand state and the other
+// per-thread library data) from a static pool of CY_ARMLIB_LIBSPACE_POOL
+// blocks. A block is taken and zeroed the first time the task calls into the
+// library after the kernel is started, and is found again through the task's
+// task-local pointer (see cy_mutex_pool_get_task_local). It goes back to the
+// pool when the task is deleted, if the RTOS runs the task-local destructor
+// (see cy_mutex_pool_set_task_local), or when the task calls
+// cy_armlib_libspace_release before it exits. The pool is a bitmask updated
+// with compare-and-swap, so taking and returning blocks needs no lock. Interrupt
+// handlers, tasks that find the pool empty and RTOS configurations without a
+// task-local pointer keep using the shared libspace at _impure_ptr.
+
+#if (CY_ARMLIB_LIBSPACE_POOL > 32U)
+#error CY_ARMLIB_LIBSPACE_POOL must not exceed 32
+#endif
+
+static struct _reent cy_armlib_libspace_pool[CY_ARMLIB_LIBSPACE_POOL];
+// Bit (31 - i) is set while block i is in use
+static volatile uintptr_t cy_armlib_libspace_used = 0U;
+// Set once it turns out that the RTOS configuration has no task-local pointer
+static volatile uintptr_t cy_armlib_libspace_unsupported = 0U;
+
+//--------------------------------------------------------------------------------------------------
+// cy_armlib_libspace_free
+//--------------------------------------------------------------------------------------------------
+static void cy_armlib_libspace_free(void* value)
+{
+    uintptr_t bit  = 0x80000000U >> ((struct _reent*)value - cy_armlib_libspace_pool);
+    uintptr_t used = cy_atomic_load(&cy_armlib_libspace_used);
+    while (!cy_atomic_compare_exchange(&cy_armlib_libspace_used, used, used & ~bit))
+    {
+        used = cy_atomic_load(&cy_armlib_libspace_used);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_armlib_libspace_attach
+//--------------------------------------------------------------------------------------------------
+static struct _reent* cy_armlib_libspace_attach(void)
+{
+    struct _reent* space = _impure_ptr;
+    uintptr_t      used  = cy_atomic_load(&cy_armlib_libspace_used);
+    uint32_t       index = __CLZ(~(uint32_t)used);
+    while ((index < CY_ARMLIB_LIBSPACE_POOL) &&
+           !cy_atomic_compare_exchange(&cy_armlib_libspace_used, used,
+                                       used | (0x80000000U >> index)))
+    {
+        used  = cy_atomic_load(&cy_armlib_libspace_used);
+        index = __CLZ(~(uint32_t)used);
+    }
+    if (index < CY_ARMLIB_LIBSPACE_POOL)
+    {
+        memset(&cy_armlib_libspace_pool[index], 0, sizeof(cy_armlib_libspace_pool[index]));
+        cy_mutex_pool_set_task_local(&cy_armlib_libspace_pool[index], cy_armlib_libspace_free);
+        if (cy_mutex_pool_get_task_local() == &cy_armlib_libspace_pool[index])
+        {
+            space = &cy_armlib_libspace_pool[index];
+        }
+        else
+        {
+            cy_armlib_libspace_free(&cy_armlib_libspace_pool[index]);
+            cy_atomic_store(&cy_armlib_libspace_unsupported, 1U);
+        }
+    }
+    return space;
+}
+
+
+#endif // defined(CY_ARMLIB_LIBSPACE_POOL) && defined(MUTEX_POOL_AVAILABLE)
+
+//--------------------------------------------------------------------------------------------------
+// cy_armlib_libspace_release
+//--------------------------------------------------------------------------------------------------
+void cy_armlib_libspace_release(void)
+{
+    #if defined(CY_ARMLIB_LIBSPACE_POOL) && defined(MUTEX_POOL_AVAILABLE)
+    if ((0U == __get_IPSR()) && cy_mutex_pool_kernel_started())
+    {
+        void* own = cy_mutex_pool_get_task_local();
+        if (NULL != own)
+        {
+            // Cleared first, so that the destructor does not run again on deletion
+            cy_mutex_pool_set_task_local(NULL, NULL);
+            cy_armlib_libspace_free(own);
+        }
+    }
+    #endif // defined(CY_ARMLIB_LIBSPACE_POOL) && defined(MUTEX_POOL_AVAILABLE)
+}
+
+
 //--------------------------------------------------------------------------------------------------
 // __user_perthread_libspace
 //--------------------------------------------------------------------------------------------------
 __attribute__((used))
 struct _reent* __user_perthread_libspace(void)
 {
+    #if defined(CY_ARMLIB_LIBSPACE_POOL) && defined(MUTEX_POOL_AVAILABLE)
+    struct _reent* space = _impure_ptr;
+    if ((0U == __get_IPSR()) && cy_mutex_pool_kernel_started())
+    {
+        struct _reent* own = (struct _reent*)cy_mutex_pool_get_task_local();
+        if (NULL != own)
+        {
+            space = own;
+        }
+        else if (0U == cy_atomic_load(&cy_armlib_libspace_unsupported))
+        {
+            space = cy_armlib_libspace_attach();
+        }
+    }
+    return space;
+    #else
     return _impure_ptr;
+    #endif // defined(CY_ARMLIB_LIBSPACE_POOL) && defined(MUTEX_POOL_AVAILABLE)
 }
 
 
 // ARM library locking
 
-// The ARM library allocates 4 bytes for each mutex.
+// The ARM library allocates 4 bytes for each mutex. By default each of them
+// holds a handle to a mutex from the pool. With CY_ARMLIB_COMPACT_LOCKS
+// defined, the 4 bytes are used as a cy_compact_lock_t instead, so the
+// library's locks (one per FILE, among others) need no kernel object and no
+// pool slot, and only call into the kernel when they are contended.
 
 //--------------------------------------------------------------------------------------------------
 // _mutex_initialize
@@ -125,8 +326,10 @@ struct _reent* __user_perthread_libspace(void)
 __attribute__((used))
 int _mutex_initialize(cy_mutex_pool_semaphore_t* m)
 {
-    #if defined(MUTEX_POOL_AVAILABLE)
-    *m = cy_mutex_pool_create();
+    #if defined(MUTEX_POOL_AVAILABLE) && defined(CY_ARMLIB_COMPACT_LOCKS)
+    *(volatile cy_compact_lock_t*)m = 0U;
+    #elif defined(MUTEX_POOL_AVAILABLE)
+    *m = cy_mutex_pool_create(CY_MUTEX_POOL_ROLE_SYSTEM);
     #else
     (void)m;
     #endif // defined(MUTEX_POOL_AVAILABLE)
@@ -140,20 +343,14 @@ int _mutex_initialize(cy_mutex_pool_semaphore_t* m)
 __attribute__((used))
 void _mutex_acquire(cy_mutex_pool_semaphore_t* m)
 {
-    #if defined(MUTEX_POOL_AVAILABLE)
+    #if defined(MUTEX_POOL_AVAILABLE) && defined(CY_ARMLIB_COMPACT_LOCKS)
+    cy_compact_lock_acquire((volatile cy_compact_lock_t*)m);
+    #elif defined(MUTEX_POOL_AVAILABLE)
     cy_mutex_pool_acquire(*m);
     #else
-    #if defined(COMPONENT_FREERTOS)
+    // The mutex pool is only unavailable with FreeRTOS heap_3
     (void)m;
     cy_mutex_pool_suspend_threads();
-    #elif defined(COMPONENT_THREADX)
-    ++_scheduler_suspend_count;
-    /* ThreadX scheduler suspend for other threads to do not interfere */
-    if (_scheduler_suspend_count == 1)
-    {
-        _interrupt_primask = Cy_SysLib_EnterCriticalSection();
-    }
-    #endif // defined(COMPONENT_FREERTOS)
     #endif // defined(MUTEX_POOL_AVAILABLE)
 }
 
@@ -164,23 +361,13 @@ void _mutex_acquire(cy_mutex_pool_semaphore_t* m)
 __attribute__((used))
 void _mutex_release(cy_mutex_pool_semaphore_t* m)
 {
-    #if defined(MUTEX_POOL_AVAILABLE)
+    #if defined(MUTEX_POOL_AVAILABLE) && defined(CY_ARMLIB_COMPACT_LOCKS)
+    cy_compact_lock_release((volatile cy_compact_lock_t*)m);
+    #elif defined(MUTEX_POOL_AVAILABLE)
     cy_mutex_pool_release(*m);
     #else
-    #if defined(COMPONENT_FREERTOS)
     (void)m;
     cy_mutex_pool_resume_threads();
-    #elif defined(COMPONENT_THREADX)
-    /* ThreadX scheduler resume , allows other threads to run */
-    if (_scheduler_suspend_count > 0)
-    {
-        if (_scheduler_suspend_count == 1)
-        {
-            Cy_SysLib_ExitCriticalSection(_interrupt_primask);
-        }
-        --_scheduler_suspend_count;
-    }
-    #endif // defined(COMPONENT_FREERTOS)
     #endif // defined(MUTEX_POOL_AVAILABLE)
 }
 
@@ -191,204 +378,176 @@ void _mutex_release(cy_mutex_pool_semaphore_t* m)
 __attribute__((used))
 void _mutex_free(cy_mutex_pool_semaphore_t* m)
 {
-    #if defined(MUTEX_POOL_AVAILABLE)
+    #if defined(MUTEX_POOL_AVAILABLE) && !defined(CY_ARMLIB_COMPACT_LOCKS)
     cy_mutex_pool_destroy(*m);
     #endif //defined(MUTEX_POOL_AVAILABLE)
     *m = NULL;
 }
 
 
-// The __cxa_guard_acquire, __cxa_guard_release, and __cxa_guard_abort
-// functions ensure that constructors for static local variables are
-// executed exactly once. For more information, see:
-// https://itanium-cxx-abi.github.io/cxx-abi/abi.html#obj-ctor
-
-typedef struct
-{
-    uint8_t initialized;
-    uint8_t acquired;
-} cy_cxa_guard_object_t;
+// Replace functions that depend on semihosting
 
-// Use custom routines for atomic load/store as the ARM Compiler
-// doesn't provide the required builtins for ARMv6-M architecture.
-__STATIC_INLINE uint8_t cy_atomic_load_1(uint8_t* address)
+//--------------------------------------------------------------------------------------------------
+// _sys_exit
+//--------------------------------------------------------------------------------------------------
+__attribute__((used))
+void _sys_exit(int unused __attribute__((unused)))
 {
-    __DMB();
-    uint8_t result = *address;
-    __DMB();
-    return result;
+    __disable_irq();
+    while (1)
+    {
+        __WFI();
+    }
 }
 
 
 //--------------------------------------------------------------------------------------------------
-// cy_atomic_store_1
+// _ttywrch
 //--------------------------------------------------------------------------------------------------
-__STATIC_INLINE void cy_atomic_store_1(uint8_t* address, uint8_t value)
+__attribute__((used))
+void _ttywrch(int ch)
 {
-    __DMB();
-    *address = value;
-    __DMB();
+    #if defined(CY_CONSOLE)
+    // Bypass the stdout lock; the console collects the line per task
+    unsigned char byte = (unsigned char)ch;
+    (void)cy_console_write(&byte, 1U);
+    #else
+    fputc(ch, stdout);
+    #endif
 }
 
 
+#if defined(CY_CONSOLE)
 //--------------------------------------------------------------------------------------------------
-// __cxa_guard_acquire
+// _sys_write
 //--------------------------------------------------------------------------------------------------
-int __cxa_guard_acquire(cy_cxa_guard_object_t* guard_object)
+__attribute__((used))
+int _sys_write(FILEHANDLE fh, const unsigned char* buf, unsigned len,
+               int mode __attribute__((unused)))
 {
-    int acquired = 0;
-    if (0 == cy_atomic_load_1(&guard_object->initialized))
+    int result = -1;
+    if ((1 == fh) || (2 == fh)) // STDOUT_FILENO, STDERR_FILENO
     {
-        #if defined(MUTEX_POOL_AVAILABLE)
-        cy_mutex_pool_acquire(cy_ctor_mutex);
-        #if defined(COMPONENT_THREADX)
-        ++_scheduler_suspend_count;
-        /* ThreadX scheduler suspend for other threads to do not interfere */
-        if (_scheduler_suspend_count == 1)
-        {
-            _interrupt_primask = Cy_SysLib_EnterCriticalSection();
-        }
-        #endif // defined(COMPONENT_THREADX)
-        #else
-        #if defined(COMPONENT_FREERTOS)
-        cy_mutex_pool_suspend_threads();
-        #endif // defined(COMPONENT_FREERTOS)
-        #endif // defined(MUTEX_POOL_AVAILABLE)
-        if (0 == cy_atomic_load_1(&guard_object->initialized))
-        {
-            acquired = 1;
-            #ifndef NDEBUG
-            if (guard_object->acquired)
-            {
-                __BKPT(0);  // acquire called again without release/abort
-            }
-            #endif
-            guard_object->acquired = 1;
-        }
-        else
-        {
-            #if defined(MUTEX_POOL_AVAILABLE)
-            cy_mutex_pool_release(cy_ctor_mutex);
-            #if defined(COMPONENT_THREADX)
-            /* ThreadX scheduler resume , allows other threads to run */
-            if (_scheduler_suspend_count > 0)
-            {
-                if (_scheduler_suspend_count == 1)
-                {
-                    Cy_SysLib_ExitCriticalSection(_interrupt_primask);
-                }
-                --_scheduler_suspend_count;
-            }
-            #endif // defined(COMPONENT_THREADX)
-            #else // if defined(MUTEX_POOL_AVAILABLE)
-            #if defined(COMPONENT_FREERTOS)
-            cy_mutex_pool_resume_threads();
-            #endif // defined(COMPONENT_FREERTOS)
-            #endif // defined(MUTEX_POOL_AVAILABLE)
-        }
+        (void)cy_console_write(buf, len);
+        result = 0;
     }
-    return acquired;
+    return result;
 }
 
 
+#endif // defined(CY_CONSOLE)
+
+
+extern int $Super$$_sys_open(const char*, int);
+
 //--------------------------------------------------------------------------------------------------
-// __cxa_guard_abort
+// _sys_open
 //--------------------------------------------------------------------------------------------------
-void __cxa_guard_abort(cy_cxa_guard_object_t* guard_object)
+__attribute__((used))
+int $Sub$$_sys_open(const char* name, int openmode __attribute__((unused)))
 {
-    if (guard_object->acquired)
+    extern const char __stdin_name, __stdout_name, __stderr_name;
+    int               fd = -1;
+    if (0 == strcmp(name, &__stdin_name))
     {
-        guard_object->acquired = 0;
-        #if defined(MUTEX_POOL_AVAILABLE)
-        cy_mutex_pool_release(cy_ctor_mutex);
-        #if defined(COMPONENT_THREADX)
-        /* ThreadX scheduler resume , allows other threads to run */
-        if (_scheduler_suspend_count > 0)
-        {
-            if (_scheduler_suspend_count == 1)
-            {
-                Cy_SysLib_ExitCriticalSection(_interrupt_primask);
-            }
-            --_scheduler_suspend_count;
-        }
-        #endif // defined(COMPONENT_THREADX)
-        #else // if defined(MUTEX_POOL_AVAILABLE)
-        #if defined(COMPONENT_FREERTOS)
-        cy_mutex_pool_resume_threads();
-        #endif // defined(COMPONENT_FREERTOS)
-        #endif // defined(MUTEX_POOL_AVAILABLE)
+        fd = 0; // STDIN_FILENO
     }
-    #ifndef NDEBUG
-    else
+    else if (0 == strcmp(name, &__stdout_name))
+    {
+        fd = 1; // STDOUT_FILENO
+    }
+    else if (0 == strcmp(name, &__stderr_name))
+    {
+        fd = 2; // STDERR_FILENO
+    }
+    #if defined(CY_ROMFS)
+    else if (0 == (openmode & ~OPEN_B)) // Read-only
     {
-        __BKPT(0);  // __cxa_guard_abort called when not acquired
+        fd = cy_romfs_open(name);
     }
     #endif
+    return fd;
 }
 
 
+#if defined(CY_ROMFS)
 //--------------------------------------------------------------------------------------------------
-// __cxa_guard_release
+// _sys_close
 //--------------------------------------------------------------------------------------------------
-void __cxa_guard_release(cy_cxa_guard_object_t* guard_object)
+__attribute__((used))
+int _sys_close(FILEHANDLE fh)
 {
-    cy_atomic_store_1(&guard_object->initialized, 1);
-    __cxa_guard_abort(guard_object);    // Release mutex
+    return (fh <= 2) ? 0 : cy_romfs_close(fh);
 }
 
 
-// Replace functions that depend on semihosting
-
 //--------------------------------------------------------------------------------------------------
-// _sys_exit
+// _sys_read
 //--------------------------------------------------------------------------------------------------
+// Returns the number of bytes not read, with the top bit set if the end of the
+// file was reached before any were read, or -1 on error. stdin is read through
+// cy_romfs_stdin_read with CY_ROMFS_STDIN, and is otherwise left to the
+// application's fgetc (for example retarget-io).
 __attribute__((used))
-void _sys_exit(int unused __attribute__((unused)))
+int _sys_read(FILEHANDLE fh, unsigned char* buf, unsigned len, int mode __attribute__((unused)))
 {
-    __disable_irq();
-    while (1)
+    long result;
+    #if defined(CY_ROMFS_STDIN)
+    if (0 == fh) // STDIN_FILENO
     {
-        __WFI();
+        result = cy_romfs_stdin_read(buf, len);
+    }
+    else
+    #endif
+    {
+        result = cy_romfs_read(fh, buf, len);
     }
+    return cy_romfs_sys_read_result(result, len);
 }
 
 
 //--------------------------------------------------------------------------------------------------
-// _ttywrch
+// _sys_seek
 //--------------------------------------------------------------------------------------------------
 __attribute__((used))
-void _ttywrch(int ch)
+int _sys_seek(FILEHANDLE fh, long pos)
 {
-    fputc(ch, stdout);
+    return (cy_romfs_seek(fh, pos, SEEK_SET) < 0) ? -1 : 0;
 }
 
 
-extern int $Super$$_sys_open(const char*, int);
+//--------------------------------------------------------------------------------------------------
+// _sys_flen
+//--------------------------------------------------------------------------------------------------
+__attribute__((used))
+long _sys_flen(FILEHANDLE fh)
+{
+    return cy_romfs_size(fh);
+}
+
 
 //--------------------------------------------------------------------------------------------------
-// _sys_open
+// _sys_istty
 //--------------------------------------------------------------------------------------------------
 __attribute__((used))
-int $Sub$$_sys_open(const char* name, int openmode __attribute__((unused)))
+int _sys_istty(FILEHANDLE fh)
 {
-    extern const char __stdin_name, __stdout_name, __stderr_name;
-    int               fd = -1;
-    if (0 == strcmp(name, &__stdin_name))
+    int result = -1;
+    if (fh <= 2) // stdin, stdout, stderr
     {
-        fd = 0; // STDIN_FILENO
+        result = 1;
     }
-    else if (0 == strcmp(name, &__stdout_name))
+    else if (cy_romfs_is_open(fh))
     {
-        fd = 1; // STDOUT_FILENO
+        result = 0;
     }
-    else if (0 == strcmp(name, &__stderr_name))
-    {
-        fd = 2; // STDERR_FILENO
-    }
-    return fd;
+    return result;
 }
 
 
+#endif // defined(CY_ROMFS)
+
+
 //--------------------------------------------------------------------------------------------------
 // _sys_command_string
 //--------------------------------------------------------------------------------------------------
@@ -28,4 +28,10 @@
 
 #include <stdio.h>
 
+#if defined(CY_ARMLIB_COMPACT_LOCKS)
+// Only cy_timer_mutex comes from the pool, the ARM library locks are compact
+// locks
+#define CY_STATIC_MUTEX_MAX (1)
+#else
 #define CY_STATIC_MUTEX_MAX (6 + (FOPEN_MAX))
+#endif
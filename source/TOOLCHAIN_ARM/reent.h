@@ -44,6 +44,12 @@ struct _reent
 
 extern struct _reent* _impure_ptr;          /**< Pointer to struct _reent for current thread */
 
+/** Returns the calling task's libspace block to the CY_ARMLIB_LIBSPACE_POOL pool. A task calls
+ *  this just before deleting itself when neither configTHREAD_LOCAL_STORAGE_DELETE_CALLBACKS nor
+ *  the portCLEAN_UP_TCB hook (cy_mutex_pool_freertos_task_deleted) returns the block on deletion;
+ *  otherwise the block is lost. Does nothing without CY_ARMLIB_LIBSPACE_POOL. */
+void cy_armlib_libspace_release(void);
+
 /** Initializes the struct _reent by pointer x */
 #define _REENT_INIT_PTR(x) memset((x), 0, sizeof(struct _reent))
 
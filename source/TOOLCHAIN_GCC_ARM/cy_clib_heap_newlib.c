@@ -0,0 +1,565 @@
+/***********************************************************************************************//**
+ * \file TOOLCHAIN_GCC_ARM/cy_clib_heap_newlib.c
+ *
+ * \brief
+ * Newlib allocator front end for the optional heap extensions
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <malloc.h>
+#if !defined(COMPONENT_POSIX)
+#include <reent.h>
+#endif
+#include "cy_clib_heap.h"
+#include "cy_clib_heap_stats.h"
+#include "cy_mutex_pool.h"
+
+#if defined(CY_CLIB_HEAP_CACHE) || defined(CY_CLIB_HEAP_POOL) || defined(CY_CLIB_HEAP_STATS)
+
+// malloc, free, realloc and calloc are replaced so that allocations can be
+// served without going through the newlib allocator (and its __malloc_lock),
+// first from the fixed-size block pools and then from the calling task's
+// cache. Cached blocks are ordinary newlib heap blocks, so anything that calls
+// the reentrant _malloc_r/_free_r family directly keeps working with them.
+// Pool blocks are not: they must only be released through free or realloc.
+// With CY_CLIB_HEAP_STATS defined every call also updates the heap counters.
+//
+// Host builds (COMPONENT_POSIX) sit in front of the glibc allocator instead,
+// taking __malloc_lock around each call as newlib's _malloc_r family does, so
+// that host benchmarks see the same locked heap path as a target.
+
+struct _reent;
+extern void __malloc_lock(struct _reent* reent);
+extern void __malloc_unlock(struct _reent* reent);
+
+#if defined(COMPONENT_POSIX)
+extern void* __libc_malloc(size_t size);
+extern void  __libc_free(void* ptr);
+extern void* __libc_realloc(void* ptr, size_t size);
+#define CY_HEAP_MALLOC(size)            cy_clib_heap_posix_malloc(size)
+#define CY_HEAP_FREE(ptr)               cy_clib_heap_posix_free(ptr)
+#define CY_HEAP_REALLOC(ptr, size)      cy_clib_heap_posix_realloc((ptr), (size))
+#define CY_HEAP_USABLE_SIZE(ptr)        malloc_usable_size(ptr)
+#define CY_HEAP_REENT                   NULL
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_posix_malloc
+//--------------------------------------------------------------------------------------------------
+static inline void* cy_clib_heap_posix_malloc(size_t size)
+{
+    __malloc_lock(NULL);
+    void* ptr = __libc_malloc(size);
+    __malloc_unlock(NULL);
+    return ptr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_posix_free
+//--------------------------------------------------------------------------------------------------
+static inline void cy_clib_heap_posix_free(void* ptr)
+{
+    __malloc_lock(NULL);
+    __libc_free(ptr);
+    __malloc_unlock(NULL);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_posix_realloc
+//--------------------------------------------------------------------------------------------------
+static inline void* cy_clib_heap_posix_realloc(void* ptr, size_t size)
+{
+    __malloc_lock(NULL);
+    void* result = __libc_realloc(ptr, size);
+    __malloc_unlock(NULL);
+    return result;
+}
+
+
+#else
+#define CY_HEAP_MALLOC(size)            _malloc_r(_REENT, (size))
+#define CY_HEAP_FREE(ptr)               _free_r(_REENT, (ptr))
+#define CY_HEAP_REALLOC(ptr, size)      _realloc_r(_REENT, (ptr), (size))
+#define CY_HEAP_USABLE_SIZE(ptr)        _malloc_usable_size_r(_REENT, (ptr))
+#define CY_HEAP_REENT                   _REENT
+#endif // if defined(COMPONENT_POSIX)
+
+#if defined(CY_CLIB_HEAP_CACHE)
+
+// Each task keeps CY_CLIB_HEAP_CACHE_CLASSES free lists of small blocks. Class
+// c holds blocks with at least (c + 1) * CY_CLIB_HEAP_CACHE_GRANULE usable
+// bytes; with the defaults these are the 16, 32, 48 and 64 byte classes.
+// Empty lists are refilled, and full lists half flushed, in batches of
+// CY_CLIB_HEAP_CACHE_BATCH blocks under a single hold of the malloc lock.
+
+#ifndef CY_CLIB_HEAP_CACHE_GRANULE
+#define CY_CLIB_HEAP_CACHE_GRANULE      (16U)
+#endif
+
+#ifndef CY_CLIB_HEAP_CACHE_CLASSES
+#define CY_CLIB_HEAP_CACHE_CLASSES      (4U)
+#endif
+
+// Maximum number of blocks a task caches per class
+#ifndef CY_CLIB_HEAP_CACHE_CAPACITY
+#define CY_CLIB_HEAP_CACHE_CAPACITY     (8U)
+#endif
+
+#ifndef CY_CLIB_HEAP_CACHE_BATCH
+#define CY_CLIB_HEAP_CACHE_BATCH        (4U)
+#endif
+
+#if (CY_CLIB_HEAP_CACHE_BATCH > CY_CLIB_HEAP_CACHE_CAPACITY)
+#error "CY_CLIB_HEAP_CACHE_BATCH must not exceed CY_CLIB_HEAP_CACHE_CAPACITY"
+#endif
+
+#define CY_CLIB_HEAP_CACHE_MAX_SIZE     ((CY_CLIB_HEAP_CACHE_CLASSES) * (CY_CLIB_HEAP_CACHE_GRANULE))
+
+typedef struct cy_clib_heap_cache_block
+{
+    struct cy_clib_heap_cache_block* next;
+} cy_clib_heap_cache_block_t;
+
+typedef struct
+{
+    cy_clib_heap_cache_block_t* head[CY_CLIB_HEAP_CACHE_CLASSES];
+    uint16_t                    count[CY_CLIB_HEAP_CACHE_CLASSES];
+} cy_clib_heap_cache_t;
+
+// Set when the RTOS configuration provides no task-local pointer
+static bool cy_clib_heap_cache_unavailable = false;
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_cache_release
+//--------------------------------------------------------------------------------------------------
+// Returns up to count blocks of a class to the heap
+static void cy_clib_heap_cache_release(cy_clib_heap_cache_t* cache, uint32_t index, uint32_t count)
+{
+    __malloc_lock(CY_HEAP_REENT);
+    while ((count > 0U) && (NULL != cache->head[index]))
+    {
+        cy_clib_heap_cache_block_t* block = cache->head[index];
+        cache->head[index] = block->next;
+        cache->count[index]--;
+        count--;
+        cy_clib_heap_stats_released(CY_HEAP_USABLE_SIZE(block));
+        CY_HEAP_FREE(block);
+    }
+    __malloc_unlock(CY_HEAP_REENT);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_cache_destroy
+//--------------------------------------------------------------------------------------------------
+static void cy_clib_heap_cache_destroy(void* value)
+{
+    cy_clib_heap_cache_t* cache = (cy_clib_heap_cache_t*)value;
+    for (uint32_t i = 0U; i < CY_CLIB_HEAP_CACHE_CLASSES; i++)
+    {
+        cy_clib_heap_cache_release(cache, i, CY_CLIB_HEAP_CACHE_CAPACITY);
+    }
+    CY_HEAP_FREE(cache);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_cache_get
+//--------------------------------------------------------------------------------------------------
+static cy_clib_heap_cache_t* cy_clib_heap_cache_get(bool create)
+{
+    cy_clib_heap_cache_t* cache = (cy_clib_heap_cache_t*)cy_mutex_pool_get_task_local();
+    if ((NULL == cache) && create && !cy_clib_heap_cache_unavailable &&
+        cy_mutex_pool_kernel_started())
+    {
+        cache = (cy_clib_heap_cache_t*)CY_HEAP_MALLOC(sizeof(cy_clib_heap_cache_t));
+        if (NULL != cache)
+        {
+            memset(cache, 0, sizeof(cy_clib_heap_cache_t));
+            cy_mutex_pool_set_task_local(cache, cy_clib_heap_cache_destroy);
+            if (cy_mutex_pool_get_task_local() != cache)
+            {
+                cy_clib_heap_cache_unavailable = true;
+                CY_HEAP_FREE(cache);
+                cache = NULL;
+            }
+        }
+    }
+    return cache;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_cache_refill
+//--------------------------------------------------------------------------------------------------
+static void cy_clib_heap_cache_refill(cy_clib_heap_cache_t* cache, uint32_t index)
+{
+    size_t size = (index + 1U) * CY_CLIB_HEAP_CACHE_GRANULE;
+    __malloc_lock(CY_HEAP_REENT);
+    for (uint32_t i = 0U; i < CY_CLIB_HEAP_CACHE_BATCH; i++)
+    {
+        cy_clib_heap_cache_block_t* block = (cy_clib_heap_cache_block_t*)CY_HEAP_MALLOC(size);
+        if (NULL == block)
+        {
+            break;
+        }
+        cy_clib_heap_stats_carved(CY_HEAP_USABLE_SIZE(block));
+        block->next        = cache->head[index];
+        cache->head[index] = block;
+        cache->count[index]++;
+    }
+    __malloc_unlock(CY_HEAP_REENT);
+}
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_cache_take
+//--------------------------------------------------------------------------------------------------
+static void* cy_clib_heap_cache_take(size_t size)
+{
+    void*                 ptr   = NULL;
+    cy_clib_heap_cache_t* cache = cy_clib_heap_cache_get(true);
+    if (NULL != cache)
+    {
+        uint32_t index = (size == 0U) ? 0U : (uint32_t)((size - 1U) / CY_CLIB_HEAP_CACHE_GRANULE);
+        if (NULL == cache->head[index])
+        {
+            cy_clib_heap_cache_refill(cache, index);
+        }
+        if (NULL != cache->head[index])
+        {
+            cy_clib_heap_cache_block_t* block = cache->head[index];
+            cache->head[index] = block->next;
+            cache->count[index]--;
+            ptr = block;
+        }
+    }
+    return ptr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_cache_put
+//--------------------------------------------------------------------------------------------------
+static bool cy_clib_heap_cache_put(void* ptr)
+{
+    bool                  cached = false;
+    cy_clib_heap_cache_t* cache  = cy_clib_heap_cache_get(false);
+    if (NULL != cache)
+    {
+        size_t usable = CY_HEAP_USABLE_SIZE(ptr);
+        if ((usable >= CY_CLIB_HEAP_CACHE_GRANULE) &&
+            (usable < (CY_CLIB_HEAP_CACHE_MAX_SIZE + CY_CLIB_HEAP_CACHE_GRANULE)))
+        {
+            uint32_t index = (uint32_t)(usable / CY_CLIB_HEAP_CACHE_GRANULE) - 1U;
+            if (cache->count[index] >= CY_CLIB_HEAP_CACHE_CAPACITY)
+            {
+                cy_clib_heap_cache_release(cache, index, CY_CLIB_HEAP_CACHE_BATCH);
+            }
+            ((cy_clib_heap_cache_block_t*)ptr)->next = cache->head[index];
+            cache->head[index] = (cy_clib_heap_cache_block_t*)ptr;
+            cache->count[index]++;
+            cached = true;
+        }
+    }
+    return cached;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_cache_flush
+//--------------------------------------------------------------------------------------------------
+void cy_clib_heap_cache_flush(void)
+{
+    cy_clib_heap_cache_t* cache = cy_clib_heap_cache_get(false);
+    if (NULL != cache)
+    {
+        cy_mutex_pool_set_task_local(NULL, NULL);
+        cy_clib_heap_cache_destroy(cache);
+    }
+}
+
+
+#endif // defined(CY_CLIB_HEAP_CACHE)
+
+#if defined(CY_CLIB_HEAP_STATS)
+// Heap blocks allocated through the wrappers carry a tag, their address XOR
+// CY_CLIB_HEAP_TAG, in the last word of their usable size. A block is only
+// subtracted from the bytes in use when it is freed with its tag in place, so
+// blocks the C library allocates with _malloc_r (strdup, stdio buffers) and
+// the application releases with free are not counted out without having been
+// counted in. The tag is cleared when the block is freed.
+#define CY_CLIB_HEAP_TAG_SIZE           (sizeof(uintptr_t))
+#define CY_CLIB_HEAP_TAG                ((uintptr_t)0xC11BA55EU)
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_tag_write
+//--------------------------------------------------------------------------------------------------
+static void cy_clib_heap_tag_write(void* ptr, size_t usable, uintptr_t tag)
+{
+    if (usable >= CY_CLIB_HEAP_TAG_SIZE)
+    {
+        (void)memcpy((uint8_t*)ptr + usable - CY_CLIB_HEAP_TAG_SIZE, &tag, sizeof(tag));
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_tag
+//--------------------------------------------------------------------------------------------------
+// Tags a block just allocated from the heap and counts it
+static void cy_clib_heap_tag(void* ptr)
+{
+    size_t usable = CY_HEAP_USABLE_SIZE(ptr);
+    cy_clib_heap_tag_write(ptr, usable, (uintptr_t)ptr ^ CY_CLIB_HEAP_TAG);
+    cy_clib_heap_stats_allocated(usable);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_untag
+//--------------------------------------------------------------------------------------------------
+// Clears the tag of a heap block about to be freed and returns its usable size, or 0 if the
+// block was not allocated through the wrappers
+static size_t cy_clib_heap_untag(void* ptr)
+{
+    size_t    usable = CY_HEAP_USABLE_SIZE(ptr);
+    uintptr_t tag    = 0U;
+    if (usable >= CY_CLIB_HEAP_TAG_SIZE)
+    {
+        (void)memcpy(&tag, (uint8_t*)ptr + usable - CY_CLIB_HEAP_TAG_SIZE, sizeof(tag));
+    }
+    if (((uintptr_t)ptr ^ CY_CLIB_HEAP_TAG) == tag)
+    {
+        cy_clib_heap_tag_write(ptr, usable, 0U);
+    }
+    else
+    {
+        usable = 0U;
+    }
+    return usable;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_request
+//--------------------------------------------------------------------------------------------------
+// The size to ask the heap for to fit size bytes and the tag
+static size_t cy_clib_heap_request(size_t size)
+{
+    return (size <= (SIZE_MAX - CY_CLIB_HEAP_TAG_SIZE)) ?
+           (size + CY_CLIB_HEAP_TAG_SIZE) : SIZE_MAX;
+}
+
+
+#else // if defined(CY_CLIB_HEAP_STATS)
+#define cy_clib_heap_tag(ptr)           ((void)0)
+#define cy_clib_heap_request(size)      (size)
+#endif // if defined(CY_CLIB_HEAP_STATS)
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_alloc
+//--------------------------------------------------------------------------------------------------
+// Kept separate from malloc so that the compiler cannot fold the malloc and
+// memset in calloc back into a (recursive) call to calloc.
+static void* cy_clib_heap_alloc(size_t size)
+{
+    void*  ptr     = NULL;
+    size_t request = cy_clib_heap_request(size);
+    #if defined(CY_CLIB_HEAP_POOL)
+    ptr = cy_clib_heap_pool_alloc(size);
+    if (NULL != ptr)
+    {
+        // Pool blocks count as allocations, but not as heap bytes
+        cy_clib_heap_stats_allocated(0U);
+    }
+    else
+    #endif
+    {
+        #if defined(CY_CLIB_HEAP_CACHE)
+        if (request <= CY_CLIB_HEAP_CACHE_MAX_SIZE)
+        {
+            ptr = cy_clib_heap_cache_take(request);
+        }
+        #endif
+        if (NULL == ptr)
+        {
+            ptr = CY_HEAP_MALLOC(request);
+            if (NULL != ptr)
+            {
+                cy_clib_heap_stats_carved(CY_HEAP_USABLE_SIZE(ptr));
+            }
+        }
+
+        if (NULL == ptr)
+        {
+            cy_clib_heap_stats_failed();
+        }
+        else
+        {
+            cy_clib_heap_tag(ptr);
+        }
+    }
+    return ptr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// malloc
+//--------------------------------------------------------------------------------------------------
+void* malloc(size_t size)
+{
+    return cy_clib_heap_alloc(size);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// free
+//--------------------------------------------------------------------------------------------------
+void free(void* ptr)
+{
+    if (NULL != ptr)
+    {
+        bool done = false;
+        #if defined(CY_CLIB_HEAP_POOL)
+        done = cy_clib_heap_pool_free(ptr);
+        if (done)
+        {
+            cy_clib_heap_stats_freed(0U);
+        }
+        #endif
+        #if defined(CY_CLIB_HEAP_STATS)
+        if (!done)
+        {
+            size_t usable = cy_clib_heap_untag(ptr);
+            if (0U != usable)
+            {
+                cy_clib_heap_stats_freed(usable);
+            }
+        }
+        #endif
+        #if defined(CY_CLIB_HEAP_CACHE)
+        done = done || cy_clib_heap_cache_put(ptr);
+        #endif
+        if (!done)
+        {
+            cy_clib_heap_stats_released(CY_HEAP_USABLE_SIZE(ptr));
+            CY_HEAP_FREE(ptr);
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// realloc
+//--------------------------------------------------------------------------------------------------
+void* realloc(void* ptr, size_t size)
+{
+    void* result;
+    #if defined(CY_CLIB_HEAP_POOL)
+    size_t block_size = cy_clib_heap_pool_block_size(ptr);
+    if (0U != block_size)
+    {
+        if (size <= block_size)
+        {
+            result = ptr;
+        }
+        else
+        {
+            result = cy_clib_heap_alloc(size);
+            if (NULL != result)
+            {
+                memcpy(result, ptr, block_size);
+                (void)cy_clib_heap_pool_free(ptr);
+                cy_clib_heap_stats_freed(0U);
+            }
+        }
+    }
+    else
+    #endif // defined(CY_CLIB_HEAP_POOL)
+    {
+        // Cached blocks are ordinary heap blocks, so the heap can resize them
+        #if defined(CY_CLIB_HEAP_STATS)
+        size_t old_size   = (NULL == ptr) ? 0U : cy_clib_heap_untag(ptr);
+        size_t old_usable = (NULL == ptr) ? 0U : CY_HEAP_USABLE_SIZE(ptr);
+        // realloc(ptr, 0) frees ptr and returns NULL, the same as without the tag
+        result = CY_HEAP_REALLOC(ptr, (0U == size) ? 0U : cy_clib_heap_request(size));
+        if ((0U != old_size) && ((NULL != result) || (0U == size)))
+        {
+            cy_clib_heap_stats_freed(old_size);
+        }
+        if (NULL != result)
+        {
+            // Resized in place or moved, the block may come out of any free block
+            cy_clib_heap_stats_carved(CY_HEAP_USABLE_SIZE(result));
+            cy_clib_heap_tag(result);
+            if (result != ptr)
+            {
+                cy_clib_heap_stats_released(old_usable);
+            }
+        }
+        else if (0U == size)
+        {
+            cy_clib_heap_stats_released(old_usable);
+        }
+        else
+        {
+            if (0U != old_size)
+            {
+                // ptr is unchanged and still counted
+                cy_clib_heap_tag_write(ptr, old_size, (uintptr_t)ptr ^ CY_CLIB_HEAP_TAG);
+            }
+            cy_clib_heap_stats_failed();
+        }
+        #else // if defined(CY_CLIB_HEAP_STATS)
+        result = CY_HEAP_REALLOC(ptr, size);
+        #endif // if defined(CY_CLIB_HEAP_STATS)
+    }
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// calloc
+//--------------------------------------------------------------------------------------------------
+void* calloc(size_t count, size_t size)
+{
+    void* ptr = NULL;
+    if ((0U == size) || (count <= (SIZE_MAX / size)))
+    {
+        ptr = cy_clib_heap_alloc(count * size);
+        if (NULL != ptr)
+        {
+            memset(ptr, 0, count * size);
+        }
+    }
+    else
+    {
+        cy_clib_heap_stats_failed();
+    }
+    return ptr;
+}
+
+
+#endif // defined(CY_CLIB_HEAP_CACHE) || defined(CY_CLIB_HEAP_POOL) || defined(CY_CLIB_HEAP_STATS)
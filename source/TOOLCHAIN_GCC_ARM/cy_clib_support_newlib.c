@@ -25,12 +25,25 @@
  **************************************************************************************************/
 
 #include <malloc.h>
-#include <stdatomic.h>
 #include <stdint.h>
+#if defined(COMPONENT_POSIX)
+// Host build against glibc, which does not provide the newlib specific headers
+#include <errno.h>
+#include <sys/types.h>
+#include <unistd.h>
+struct _reent;
+#else
 #include <sys/errno.h>
 #include <sys/types.h>
 #include <sys/unistd.h>
 #include <envlock.h>
+#include <reent.h>
+#if defined(CY_ROMFS)
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#endif
+#endif // defined(COMPONENT_POSIX)
 #if !defined (COMPONENT_CAT5)
 #include <cmsis_compiler.h>
 #elif defined(COMPONENT_MTB_HAL)
@@ -38,7 +51,12 @@
 #elif defined(CY_USING_HAL)
 #include "cyhal_system.h"
 #endif
+#include "cy_clib_heap.h"
+#include "cy_clib_heap_stats.h"
+#include "cy_console.h"
 #include "cy_mutex_pool.h"
+#include "cy_romfs_port.h"
+#include "cy_time.h"
 #include "cy_utils.h"
 
 #if defined(COMPONENT_FREERTOS) && ((configUSE_MUTEXES == 0) || \
@@ -49,7 +67,7 @@
 #else
 
 #if defined(MUTEX_POOL_AVAILABLE)
-static cy_mutex_pool_semaphore_t cy_malloc_mutex = NULL, cy_env_mutex = NULL, cy_ctor_mutex = NULL;
+static cy_mutex_pool_semaphore_t cy_malloc_mutex = NULL, cy_env_mutex = NULL;
 cy_mutex_pool_semaphore_t cy_timer_mutex;
 #endif
 
@@ -60,10 +78,9 @@ cy_mutex_pool_semaphore_t cy_timer_mutex;
 void cy_toolchain_init(void)
 {
     #if defined(MUTEX_POOL_AVAILABLE)
-    cy_malloc_mutex = cy_mutex_pool_create();
-    cy_env_mutex    = cy_mutex_pool_create();
-    cy_ctor_mutex   = cy_mutex_pool_create();
-    cy_timer_mutex  = cy_mutex_pool_create();
+    cy_malloc_mutex = cy_mutex_pool_create(CY_MUTEX_POOL_ROLE_MALLOC);
+    cy_env_mutex    = cy_mutex_pool_create(CY_MUTEX_POOL_ROLE_ENV);
+    cy_timer_mutex  = cy_mutex_pool_create(CY_MUTEX_POOL_ROLE_TIMER);
     #endif
 }
 
@@ -75,22 +92,271 @@ void cy_toolchain_init(void)
 //--------------------------------------------------------------------------------------------------
 caddr_t _sbrk(int32_t incr)
 {
-    extern uint8_t  __HeapBase, __HeapLimit;
-    static uint8_t* heapBrk = &__HeapBase;
-    uint8_t*        prevBrk = heapBrk;
-    if ((incr > (int32_t)(&__HeapLimit - heapBrk)) ||
-        (((int32_t)heapBrk + incr) < (int32_t)(&__HeapBase)))
+    extern uint8_t __HeapBase, __HeapLimit;
+    cy_clib_heap_set_default_region(&__HeapBase, (size_t)(&__HeapLimit - &__HeapBase));
+    void* prevBrk = cy_clib_heap_sbrk(incr);
+    if (NULL == prevBrk)
     {
         errno = ENOMEM;
         return (caddr_t)-1;
     }
-    heapBrk += incr;
     return (caddr_t)prevBrk;
 }
 
 
 #endif // if !defined(COMPONENT_CAT3)
 
+// Regions added with cy_clib_heap_add_region are freed into the allocator as
+// one block each, laid out the way the allocator lays out its own chunks. nano
+// malloc and the full allocator each define their free list under their own
+// name, so the one that is linked is found through weak references. If
+// neither is linked, the region is not used.
+extern uint8_t __malloc_free_list __WEAK;   // nano
+extern size_t* __malloc_av_[] __WEAK;       // Full allocator
+extern void _free_r(struct _reent* reent, void* ptr) __WEAK;
+
+#if defined(COMPONENT_POSIX)
+#define CY_NEWLIB_REENT             NULL
+#else
+#define CY_NEWLIB_REENT             _REENT
+#endif
+
+#define CY_NEWLIB_CHUNK_ALIGN       (8U)
+#define CY_NEWLIB_CHUNK_MIN         (8U * sizeof(size_t))
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_give_region
+//--------------------------------------------------------------------------------------------------
+bool cy_clib_heap_give_region(void* base, size_t size)
+{
+    uintptr_t start = ((uintptr_t)base + (CY_NEWLIB_CHUNK_ALIGN - 1U)) &
+                      ~(uintptr_t)(CY_NEWLIB_CHUNK_ALIGN - 1U);
+    uintptr_t end   = (uintptr_t)base + size;
+    size_t    avail = (end > start) ? (size_t)(end - start) : 0U;
+    uint8_t*  chunk = (uint8_t*)start;
+    void*     ptr   = NULL;
+    size_t    freed = 0U;
+
+    if ((NULL == _free_r) || (avail < (CY_NEWLIB_CHUNK_MIN + (3U * sizeof(size_t)))))
+    {
+        // Nothing to give it to, or too small to be worth it
+    }
+    else if (NULL != &__malloc_free_list)
+    {
+        // nano: the size of the whole chunk, then the memory handed out
+        size_t chunk_size = avail & ~(size_t)(CY_NEWLIB_CHUNK_ALIGN - 1U);
+        *(long*)chunk = (long)chunk_size;
+        ptr           = &chunk[sizeof(long)];
+        freed         = chunk_size - sizeof(long);
+    }
+    else if (NULL != &__malloc_av_)
+    {
+        // Full allocator: the previous size and the size with PREV_INUSE (bit 0) set, then the
+        // memory handed out. Two in-use fence posts after the chunk keep free from merging it
+        // with what follows the region, as malloc_extend_top does for a foreign sbrk.
+        size_t chunk_size = (avail - (3U * sizeof(size_t))) &
+                            ~(size_t)(CY_NEWLIB_CHUNK_ALIGN - 1U);
+        ((size_t*)chunk)[1] = chunk_size | 1U;
+        *(size_t*)&chunk[chunk_size + sizeof(size_t)]        = sizeof(size_t) | 1U;
+        *(size_t*)&chunk[chunk_size + (2U * sizeof(size_t))] = sizeof(size_t) | 1U;
+        ptr   = &chunk[2U * sizeof(size_t)];
+        freed = chunk_size - sizeof(size_t);
+    }
+    else
+    {
+        // Another allocator; leave the region to cy_clib_heap_extend
+    }
+
+    if (NULL != ptr)
+    {
+        // A free block of at least this size for the heap statistics
+        cy_clib_heap_stats_released(freed);
+        (void)freed;
+        _free_r(CY_NEWLIB_REENT, ptr);
+    }
+    return (NULL != ptr);
+}
+
+
+#if defined(CY_CLIB_HEAP_STATS)
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_top_free
+//--------------------------------------------------------------------------------------------------
+// The full allocator keeps its top chunk in av_[2] (mallocr.c) with the size, PREV_INUSE in bit 0,
+// in its second word. nano malloc has no top chunk; it extends its last free chunk in place.
+size_t cy_clib_heap_top_free(void)
+{
+    size_t top_free = 0U;
+    if (NULL != &__malloc_av_)
+    {
+        top_free = __malloc_av_[2][1] & ~(size_t)3U;
+    }
+    return top_free;
+}
+
+
+#endif // if defined(CY_CLIB_HEAP_STATS)
+
+
+
+#if defined(CY_CONSOLE) && !defined(COMPONENT_POSIX)
+//--------------------------------------------------------------------------------------------------
+// _write
+//--------------------------------------------------------------------------------------------------
+// stdout and stderr go to the buffered console (cy_console.h) instead of the
+// application's _write, which must not be linked in as well
+int _write(int fd, const char* ptr, int len)
+{
+    int result = -1;
+    if ((STDOUT_FILENO == fd) || (STDERR_FILENO == fd))
+    {
+        result = (int)cy_console_write(ptr, (size_t)len);
+    }
+    else
+    {
+        errno = EBADF;
+    }
+    return result;
+}
+
+
+#endif // defined(CY_CONSOLE) && !defined(COMPONENT_POSIX)
+
+#if defined(CY_ROMFS) && !defined(COMPONENT_POSIX)
+//--------------------------------------------------------------------------------------------------
+// _open
+//--------------------------------------------------------------------------------------------------
+// Files are served from the ROM file system (cy_romfs.h), read-only
+int _open(const char* path, int flags, int mode)
+{
+    int fd = -1;
+    (void)mode;
+    if (O_RDONLY != (flags & O_ACCMODE))
+    {
+        errno = EROFS;
+    }
+    else
+    {
+        fd = cy_romfs_open(path);
+        if (fd < 0)
+        {
+            errno = cy_romfs_open_error(path);
+        }
+    }
+    return fd;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// _close
+//--------------------------------------------------------------------------------------------------
+int _close(int fd)
+{
+    int result = 0;
+    if (fd > STDERR_FILENO)
+    {
+        result = cy_romfs_close(fd);
+        if (result < 0)
+        {
+            errno = EBADF;
+        }
+    }
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// _read_r
+//--------------------------------------------------------------------------------------------------
+// Replaces the one of the C library, through which stdio reads. Files are read
+// here, so that other descriptors, such as stdin, are left to _read, which the
+// application (for example retarget-io) provides.
+extern int _read(int fd, char* ptr, int len);
+_ssize_t _read_r(struct _reent* ptr, int fd, void* buf, size_t cnt)
+{
+    _ssize_t result;
+    if (cy_romfs_is_open(fd))
+    {
+        result = (_ssize_t)cy_romfs_read(fd, buf, cnt);
+    }
+    else
+    {
+        errno  = 0;
+        result = (_ssize_t)_read(fd, buf, (int)cnt);
+        if ((result < 0) && (0 != errno))
+        {
+            ptr->_errno = errno;
+        }
+    }
+    return result;
+}
+
+
+#if defined(CY_ROMFS_STDIN)
+//--------------------------------------------------------------------------------------------------
+// _read
+//--------------------------------------------------------------------------------------------------
+// The application's _read, which must not be linked in as well, is replaced by
+// cy_romfs_stdin_read for stdin
+int _read(int fd, char* ptr, int len)
+{
+    long result = -1;
+    if (STDIN_FILENO == fd)
+    {
+        result = cy_romfs_stdin_read(ptr, (size_t)len);
+    }
+    if (result < 0)
+    {
+        errno = EBADF;
+    }
+    return (int)result;
+}
+
+
+#endif // defined(CY_ROMFS_STDIN)
+
+
+//--------------------------------------------------------------------------------------------------
+// _lseek
+//--------------------------------------------------------------------------------------------------
+off_t _lseek(int fd, off_t offset, int whence)
+{
+    off_t result = (off_t)cy_romfs_seek(fd, (long)offset, whence);
+    if (result < 0)
+    {
+        errno = cy_romfs_is_open(fd) ? EINVAL : ESPIPE;
+    }
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// _fstat
+//--------------------------------------------------------------------------------------------------
+int _fstat(int fd, struct stat* st)
+{
+    int result = 0;
+    (void)memset(st, 0, sizeof(*st));
+    if (cy_romfs_is_open(fd))
+    {
+        st->st_mode = S_IFREG | S_IRUSR | S_IRGRP | S_IROTH;
+        st->st_size = (off_t)cy_romfs_size(fd);
+    }
+    else if ((fd >= STDIN_FILENO) && (fd <= STDERR_FILENO))
+    {
+        st->st_mode = S_IFCHR;
+    }
+    else
+    {
+        errno  = EBADF;
+        result = -1;
+    }
+    return result;
+}
+
+
+#endif // defined(CY_ROMFS) && !defined(COMPONENT_POSIX)
+
 
 //--------------------------------------------------------------------------------------------------
 // __malloc_lock
@@ -148,91 +414,85 @@ void __env_unlock(struct _reent* reent)
 }
 
 
-// The __cxa_guard_acquire, __cxa_guard_release, and __cxa_guard_abort
-// functions ensure that constructors for static local variables are
-// executed exactly once. For more information, see:
-// https://itanium-cxx-abi.github.io/cxx-abi/abi.html#obj-ctor
-
-typedef struct
+#if defined(_MTB_CLIB_SUPPORT_RTC_AVAILABLE) && defined(__NEWLIB__)
+//--------------------------------------------------------------------------------------------------
+// cy_time_split_us
+//--------------------------------------------------------------------------------------------------
+static time_t cy_time_split_us(int64_t us, long* fraction_us)
 {
-    atomic_uchar initialized;
-    uint8_t      acquired;
-} cy_cxa_guard_object_t;
+    time_t seconds = (time_t)(us / 1000000);
+    *fraction_us = (long)(us % 1000000);
+    if (*fraction_us < 0)
+    {
+        *fraction_us += 1000000;
+        seconds--;
+    }
+    return seconds;
+}
+
 
 //--------------------------------------------------------------------------------------------------
-// __cxa_guard_acquire
+// _gettimeofday
 //--------------------------------------------------------------------------------------------------
-int16_t __cxa_guard_acquire(cy_cxa_guard_object_t* guard_object)
+int _gettimeofday(struct timeval* tv, void* tz)
 {
-    int16_t acquired = 0;
-    CY_MISRA_DEVIATE_BLOCK_START('MISRA C-2012 Directive 4.6', 2,
-                                 'Standard macro atomic_load generates code using char type.');
-    if (0 == atomic_load(&guard_object->initialized))
+    (void)tz;
+    int     result = 0;
+    int64_t now;
+    if (tv != NULL)
     {
-        #if defined(MUTEX_POOL_AVAILABLE)
-        cy_mutex_pool_acquire(cy_ctor_mutex);
-        #else
-        cy_mutex_pool_suspend_threads();
-        #endif
-        if (0 == atomic_load(&guard_object->initialized))
+        if (mtb_clib_support_realtime_us(&now))
         {
-            acquired = 1;
-            #ifndef NDEBUG
-            if (guard_object->acquired)
-            {
-                __BKPT(0);  // acquire called again without release/abort
-            }
-            #endif
-            guard_object->acquired = 1;
+            long fraction_us;
+            tv->tv_sec  = cy_time_split_us(now, &fraction_us);
+            tv->tv_usec = (suseconds_t)fraction_us;
         }
         else
         {
-            #if defined(MUTEX_POOL_AVAILABLE)
-            cy_mutex_pool_release(cy_ctor_mutex);
-            #else
-            cy_mutex_pool_resume_threads();
-            #endif
+            errno  = EIO;
+            result = -1;
         }
     }
-    CY_MISRA_BLOCK_END('MISRA C-2012 Directive 4.6');
-    return acquired;
+    return result;
 }
 
 
 //--------------------------------------------------------------------------------------------------
-// __cxa_guard_abort
+// clock_gettime
 //--------------------------------------------------------------------------------------------------
-void __cxa_guard_abort(cy_cxa_guard_object_t* guard_object)
+int clock_gettime(clockid_t clock_id, struct timespec* tp)
 {
-    if (guard_object->acquired)
+    int     result = 0;
+    int64_t now;
+    if (clock_id == CLOCK_MONOTONIC)
     {
-        guard_object->acquired = 0;
-        #if defined(MUTEX_POOL_AVAILABLE)
-        cy_mutex_pool_release(cy_ctor_mutex);
-        #else
-        cy_mutex_pool_resume_threads();
-        #endif
+        now = (int64_t)mtb_clib_support_monotonic_us();
+    }
+    else if (clock_id == CLOCK_REALTIME)
+    {
+        if (!mtb_clib_support_realtime_us(&now))
+        {
+            errno  = EIO;
+            result = -1;
+        }
     }
-    #ifndef NDEBUG
     else
     {
-        __BKPT(0);  // __cxa_guard_abort called when not acquired
+        errno  = EINVAL;
+        result = -1;
     }
-    #endif
+
+    if (result == 0)
+    {
+        long fraction_us;
+        tp->tv_sec  = cy_time_split_us(now, &fraction_us);
+        tp->tv_nsec = fraction_us * 1000L;
+    }
+    return result;
 }
 
 
-//--------------------------------------------------------------------------------------------------
-// __cxa_guard_release
-//--------------------------------------------------------------------------------------------------
-void __cxa_guard_release(cy_cxa_guard_object_t* guard_object)
-{
-    CY_MISRA_DEVIATE_BLOCK_START('MISRA C-2012 Directive 4.6', 1,
-                                 'Standard macro atomic_load generates code using char type.');
-    atomic_store(&guard_object->initialized, 1);
-    CY_MISRA_BLOCK_END('MISRA C-2012 Directive 4.6');
-    __cxa_guard_abort(guard_object);    // Release mutex
-}
+#endif // defined(_MTB_CLIB_SUPPORT_RTC_AVAILABLE) && defined(__NEWLIB__)
 
 
 #endif \
@@ -28,10 +28,15 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <DLib_Threads.h>
 #include "reent.h"
 #include <cmsis_compiler.h>
+#include "cy_clib_heap.h"
+#include "cy_clib_support_atomic.h"
+#include "cy_console.h"
 #include "cy_mutex_pool.h"
+#include "cy_romfs.h"
 
 #if defined(COMPONENT_FREERTOS) && (configUSE_MUTEXES == 0 || configUSE_RECURSIVE_MUTEXES == 0 || \
                                     configSUPPORT_STATIC_ALLOCATION == 0)
@@ -58,18 +63,135 @@ cy_mutex_pool_semaphore_t cy_timer_mutex;
 cy_mutex_pool_semaphore_t cy_malloc_mutex;
 #endif // if defined(COMPONENT_THREADX)
 
+#if defined(COMPONENT_FREERTOS)
+// A task's thread-local storage block is only set up the first time the task
+// accesses thread-local data (through __aeabi_read_tp), so tasks that never do
+// cost nothing. Blocks come from a static pool of CY_IAR_TLS_POOL_BLOCKS blocks
+// of CY_IAR_TLS_BLOCK_SIZE bytes when the TLS size fits, and from the FreeRTOS
+// heap otherwise; _reclaim_reent gives them back to where they came from. The
+// pool is a bitmask updated with compare-and-swap, so it needs no lock. An
+// interrupt handler never sets up a block: before the interrupted task has one,
+// thread-local accesses from the handler use the static (main) block.
+
+#ifndef CY_IAR_TLS_POOL_BLOCKS
+#define CY_IAR_TLS_POOL_BLOCKS  (0U)
+#endif
+
+#ifndef CY_IAR_TLS_BLOCK_SIZE
+#define CY_IAR_TLS_BLOCK_SIZE   (128U)
+#endif
+
+#if (CY_IAR_TLS_POOL_BLOCKS > 32U)
+#error CY_IAR_TLS_POOL_BLOCKS must not exceed 32
+#endif
+
+#if (CY_IAR_TLS_POOL_BLOCKS > 0U)
+static uint64_t cy_iar_tls_pool[CY_IAR_TLS_POOL_BLOCKS][(CY_IAR_TLS_BLOCK_SIZE + 7U) / 8U];
+// Bit (31 - i) is set while block i is in use
+static volatile uintptr_t cy_iar_tls_pool_used = 0U;
+#endif
+
 //--------------------------------------------------------------------------------------------------
-// __aeabi_read_tp
+// cy_iar_tls_alloc
 //--------------------------------------------------------------------------------------------------
-#if !defined(COMPONENT_THREADX)
-// __aeabi_read_tp functions is defined in the tx_iar.c port provided by ThreadX
-void* __aeabi_read_tp(void)
+static void* cy_iar_tls_alloc(size_t size)
 {
-    return _impure_ptr->ptr;
+    void* block = NULL;
+    #if (CY_IAR_TLS_POOL_BLOCKS > 0U)
+    if (size <= CY_IAR_TLS_BLOCK_SIZE)
+    {
+        uintptr_t used  = cy_atomic_load(&cy_iar_tls_pool_used);
+        uint32_t  index = __CLZ(~(uint32_t)used);
+        while ((index < CY_IAR_TLS_POOL_BLOCKS) &&
+               !cy_atomic_compare_exchange(&cy_iar_tls_pool_used, used,
+                                           used | (0x80000000U >> index)))
+        {
+            used  = cy_atomic_load(&cy_iar_tls_pool_used);
+            index = __CLZ(~(uint32_t)used);
+        }
+        if (index < CY_IAR_TLS_POOL_BLOCKS)
+        {
+            block = cy_iar_tls_pool[index];
+        }
+    }
+    #endif // if (CY_IAR_TLS_POOL_BLOCKS > 0U)
+    if (NULL == block)
+    {
+        block = pvPortMalloc(size);
+    }
+    return block;
 }
 
 
-#endif
+//--------------------------------------------------------------------------------------------------
+// cy_iar_tls_free
+//--------------------------------------------------------------------------------------------------
+static void cy_iar_tls_free(void* block)
+{
+    #if (CY_IAR_TLS_POOL_BLOCKS > 0U)
+    uintptr_t offset = (uintptr_t)block - (uintptr_t)cy_iar_tls_pool;
+    if (offset < sizeof(cy_iar_tls_pool))
+    {
+        uintptr_t bit  = 0x80000000U >> (offset / sizeof(cy_iar_tls_pool[0]));
+        uintptr_t used = cy_atomic_load(&cy_iar_tls_pool_used);
+        while (!cy_atomic_compare_exchange(&cy_iar_tls_pool_used, used, used & ~bit))
+        {
+            used = cy_atomic_load(&cy_iar_tls_pool_used);
+        }
+    }
+    else
+    #endif // if (CY_IAR_TLS_POOL_BLOCKS > 0U)
+    {
+        vPortFree(block);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_iar_tls_attach_current
+//--------------------------------------------------------------------------------------------------
+// Called from __aeabi_read_tp the first time the current task accesses
+// thread-local data. Not static because it is only called from assembly.
+void* cy_iar_tls_attach_current(void)
+{
+    struct _reent* r   = _impure_ptr;
+    void*          tls = cy_iar_global_impure.ptr;
+    if (0U == __get_IPSR())
+    {
+        size_t tls_size = __iar_tls_size();
+        if (0U == tls_size)
+        {
+            tls_size = sizeof(void*);
+        }
+        tls = cy_iar_tls_alloc(tls_size);
+        if (NULL == tls)
+        {
+            __BKPT(0);  // Failed to allocate memory for TLS
+        }
+        __iar_tls_init(tls);
+        r->ptr = tls;
+    }
+    return tls;
+}
+
+
+#else // if defined(COMPONENT_FREERTOS)
+
+//--------------------------------------------------------------------------------------------------
+// cy_iar_tls_attach_current
+//--------------------------------------------------------------------------------------------------
+// Without FreeRTOS there is only the static (main) block. Not static because
+// it is only called from assembly.
+void* cy_iar_tls_attach_current(void)
+{
+    return cy_iar_global_impure.ptr;
+}
+
+
+#endif // if defined(COMPONENT_FREERTOS)
+
+// __aeabi_read_tp is written in assembly (cy_iar_read_tp.s), as it may only change r0, r12, lr
+// and the flags. Its slow path calls cy_iar_tls_attach_current.
 
 //--------------------------------------------------------------------------------------------------
 // cy_iar_init_reent
@@ -77,17 +199,21 @@ void* __aeabi_read_tp(void)
 #if defined(COMPONENT_FREERTOS)
 void cy_iar_init_reent(struct _reent* r)
 {
-    size_t tls_size = __iar_tls_size();
-    if (0 == tls_size)
-    {
-        tls_size = sizeof(void*);
-    }
-    r->ptr = pvPortMalloc(tls_size);
-    if (NULL == r->ptr)
+    // The block is set up by __aeabi_read_tp when the task first needs it
+    r->ptr = NULL;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_iar_thread_exit
+//--------------------------------------------------------------------------------------------------
+void cy_iar_thread_exit(void)
+{
+    // A task that never accessed thread-local data has no destructors registered
+    if (NULL != _impure_ptr->ptr)
     {
-        __BKPT(0);  // Failed to allocate memory for TLS
+        __call_thread_dtors();
     }
-    __iar_tls_init(r->ptr);
 }
 
 
@@ -99,15 +225,13 @@ void cy_iar_init_reent(struct _reent* r)
 //--------------------------------------------------------------------------------------------------
 void _reclaim_reent(struct _reent* r)
 {
-    // __call_thread_dtors must be called from the thread that is being destroyed. This will not
-    // work with FreeRTOS.
-    // The effect of omitting it is that destructors for thread-local C++ objects will not be
-    // executed.
-    //__call_thread_dtors();
-    if (r != &cy_iar_global_impure)
+    // __call_thread_dtors must be called from the thread that is being destroyed, which is not
+    // the case here with FreeRTOS. Tasks that own thread-local C++ objects run their destructors
+    // by calling cy_iar_thread_exit before deleting themselves.
+    if ((r != &cy_iar_global_impure) && (NULL != r->ptr))
     {
         #if defined(COMPONENT_FREERTOS)
-        vPortFree(r->ptr);
+        cy_iar_tls_free(r->ptr);
         #elif defined(COMPONENT_THREADX)
         cy_mutex_pool_acquire(cy_malloc_mutex);
         free(r->ptr);
@@ -118,6 +242,104 @@ void _reclaim_reent(struct _reent* r)
 }
 
 
+#if defined(CY_CLIB_HEAP_POOL)
+// IAR heap front end
+
+// malloc, free, realloc and calloc are replaced so that requests that fit a
+// pool class are served from the lock-free block pools. Everything else goes
+// to the heap selected at link time; the defaults are the advanced heap entry
+// points, define the macros below to use the basic heap (__basic_malloc etc.).
+
+#ifndef CY_CLIB_HEAP_IAR_MALLOC
+#define CY_CLIB_HEAP_IAR_MALLOC     __iar_dlmalloc
+#define CY_CLIB_HEAP_IAR_FREE       __iar_dlfree
+#define CY_CLIB_HEAP_IAR_REALLOC    __iar_dlrealloc
+#define CY_CLIB_HEAP_IAR_CALLOC     __iar_dlcalloc
+#endif
+
+extern void* CY_CLIB_HEAP_IAR_MALLOC(size_t size);
+extern void  CY_CLIB_HEAP_IAR_FREE(void* ptr);
+extern void* CY_CLIB_HEAP_IAR_REALLOC(void* ptr, size_t size);
+extern void* CY_CLIB_HEAP_IAR_CALLOC(size_t count, size_t size);
+
+//--------------------------------------------------------------------------------------------------
+// malloc
+//--------------------------------------------------------------------------------------------------
+void* malloc(size_t size)
+{
+    void* ptr = cy_clib_heap_pool_alloc(size);
+    if (NULL == ptr)
+    {
+        ptr = CY_CLIB_HEAP_IAR_MALLOC(size);
+    }
+    return ptr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// free
+//--------------------------------------------------------------------------------------------------
+void free(void* ptr)
+{
+    if ((NULL != ptr) && !cy_clib_heap_pool_free(ptr))
+    {
+        CY_CLIB_HEAP_IAR_FREE(ptr);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// realloc
+//--------------------------------------------------------------------------------------------------
+void* realloc(void* ptr, size_t size)
+{
+    void*  result;
+    size_t block_size = cy_clib_heap_pool_block_size(ptr);
+    if (0U == block_size)
+    {
+        result = CY_CLIB_HEAP_IAR_REALLOC(ptr, size);
+    }
+    else if (size <= block_size)
+    {
+        result = ptr;
+    }
+    else
+    {
+        result = CY_CLIB_HEAP_IAR_MALLOC(size);
+        if (NULL != result)
+        {
+            memcpy(result, ptr, block_size);
+            (void)cy_clib_heap_pool_free(ptr);
+        }
+    }
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// calloc
+//--------------------------------------------------------------------------------------------------
+void* calloc(size_t count, size_t size)
+{
+    void* ptr = NULL;
+    if ((0U == size) || (count <= (SIZE_MAX / size)))
+    {
+        ptr = cy_clib_heap_pool_alloc(count * size);
+    }
+    if (NULL != ptr)
+    {
+        memset(ptr, 0, count * size);
+    }
+    else
+    {
+        ptr = CY_CLIB_HEAP_IAR_CALLOC(count, size);
+    }
+    return ptr;
+}
+
+
+#endif // defined(CY_CLIB_HEAP_POOL)
+
 // IAR library locking
 
 void cy_toolchain_init(void)
@@ -127,10 +349,10 @@ void cy_toolchain_init(void)
     #endif
     #if defined(MUTEX_POOL_AVAILABLE)
     cy_mutex_pool_setup();
-    cy_timer_mutex   = cy_mutex_pool_create();
+    cy_timer_mutex   = cy_mutex_pool_create(CY_MUTEX_POOL_ROLE_TIMER);
     #endif
     #if defined(COMPONENT_THREADX)
-    cy_malloc_mutex = cy_mutex_pool_create();
+    cy_malloc_mutex = cy_mutex_pool_create(CY_MUTEX_POOL_ROLE_MALLOC);
     #endif
     // __iar_Initlocks is called in ThreadX during setup; calling it here would lead
     // to (invalid) double initialization of the mutexes
@@ -149,7 +371,7 @@ void cy_toolchain_init(void)
 void __iar_system_Mtxinit(__iar_Rmtx* arg)
 {
     #if defined(MUTEX_POOL_AVAILABLE)
-    *(cy_mutex_pool_semaphore_t*)arg = cy_mutex_pool_create();
+    *(cy_mutex_pool_semaphore_t*)arg = cy_mutex_pool_create(CY_MUTEX_POOL_ROLE_SYSTEM);
     #else
     (void)arg;
     #endif
@@ -208,7 +430,11 @@ void __iar_system_Mtxdst(__iar_Rmtx* arg)
 //--------------------------------------------------------------------------------------------------
 void __iar_file_Mtxinit(__iar_Rmtx* m)
 {
+    #if defined(MUTEX_POOL_AVAILABLE) && !defined(COMPONENT_THREADX)
+    *(cy_mutex_pool_semaphore_t*)m = cy_mutex_pool_create(CY_MUTEX_POOL_ROLE_FILE);
+    #else
     __iar_system_Mtxinit(m);
+    #endif
 }
 
 
@@ -296,12 +522,81 @@ void __iar_Dstdynamiclock(__iar_Rmtx* m)
 
 #endif // if configSUPPORT_DYNAMIC_ALLOCATION
 
+#if defined(CY_CONSOLE)
+//--------------------------------------------------------------------------------------------------
+// __write
+//--------------------------------------------------------------------------------------------------
+size_t __write(int handle, const unsigned char* buffer, size_t size)
+{
+    size_t result = (size_t)-1; // _LLIO_ERROR
+    if (NULL == buffer)
+    {
+        // Flush request
+        cy_console_flush();
+        result = 0U;
+    }
+    else if ((1 == handle) || (2 == handle)) // _LLIO_STDOUT, _LLIO_STDERR
+    {
+        result = cy_console_write(buffer, size);
+    }
+    return result;
+}
+
+
+#endif // defined(CY_CONSOLE)
+
+#if defined(CY_ROMFS)
+//--------------------------------------------------------------------------------------------------
+// __open
+//--------------------------------------------------------------------------------------------------
+// Files are served from the ROM file system (cy_romfs.h), read-only
+int __open(const char* filename, int mode)
+{
+    int handle = -1;
+    if (0 == (mode & 0x0003)) // _LLIO_RDONLY within _LLIO_RDWRMASK
+    {
+        handle = cy_romfs_open(filename);
+    }
+    return handle;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// __read
+//--------------------------------------------------------------------------------------------------
+// DLib has no other read function to hook, so this one is weak: an application
+// __read (for example retarget-io) takes precedence and must pass the handles
+// above 2 to cy_romfs_read. With CY_ROMFS_STDIN, stdin is read here through
+// cy_romfs_stdin_read instead, and the application must not provide __read.
+__weak size_t __read(int handle, unsigned char* buffer, size_t size)
+{
+    long result;
+    #if defined(CY_ROMFS_STDIN)
+    if (0 == handle) // _LLIO_STDIN
+    {
+        result = cy_romfs_stdin_read(buffer, size);
+    }
+    else
+    #endif
+    {
+        result = cy_romfs_read(handle, buffer, size);
+    }
+    return (result < 0) ? (size_t)-1 : (size_t)result; // _LLIO_ERROR
+}
+
+
+#endif // defined(CY_ROMFS)
+
 //--------------------------------------------------------------------------------------------------
 // __close
 //--------------------------------------------------------------------------------------------------
 __weak int __close(int fd)
 {
+    #if defined(CY_ROMFS)
+    return (fd > 2) ? cy_romfs_close(fd) : 0;
+    #else
     return 0;
+    #endif
 }
 
 
@@ -310,7 +605,11 @@ __weak int __close(int fd)
 //--------------------------------------------------------------------------------------------------
 __weak long __lseek(int fd, long offset, int whence)
 {
+    #if defined(CY_ROMFS)
+    return cy_romfs_seek(fd, offset, whence);
+    #else
     return -1;
+    #endif
 }
 
 
@@ -319,7 +618,13 @@ __weak long __lseek(int fd, long offset, int whence)
 //--------------------------------------------------------------------------------------------------
 __weak int remove(const char* path)
 {
+    #if defined(CY_ROMFS)
+    // Files of the ROM file system cannot be removed, and there are no others
+    (void)path;
+    return -1;
+    #else
     return 0;
+    #endif
 }
 
 
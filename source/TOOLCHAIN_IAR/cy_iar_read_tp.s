@@ -0,0 +1,86 @@
+/***********************************************************************************************//**
+ * \file cy_iar_read_tp.s
+ *
+ * \brief
+ * IAR thread pointer lookup for RTOS
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+        MODULE  cy_iar_read_tp
+
+        // Weak, so that the definition in the ThreadX port (tx_iar.c) takes precedence
+        PUBWEAK __aeabi_read_tp
+        EXTERN  _impure_ptr
+        EXTERN  cy_iar_tls_attach_current
+
+        SECTION .text:CODE:NOROOT(2)
+        THUMB
+
+//--------------------------------------------------------------------------------------------------
+// __aeabi_read_tp
+//--------------------------------------------------------------------------------------------------
+// Returns the thread-local storage block of the current task, the ptr member (at offset 0) of the
+// struct _reent at _impure_ptr. The run-time ABI only lets __aeabi_read_tp change r0, r12, lr and
+// the flags, which a C function cannot promise, so the whole routine is written here. The first
+// access by a task sets its block up in cy_iar_tls_attach_current, with every other caller-saved
+// register saved around the call and the stack kept 8-byte aligned. ARMv6-M has neither CBZ nor
+// high registers in PUSH and POP, so r12 goes through r1 there, and r0 pads the stack.
+__aeabi_read_tp:
+        LDR     R0, =_impure_ptr
+        LDR     R0, [R0]
+        LDR     R0, [R0, #0]
+#if defined(__ARM_ARCH_6M__) || \
+    (defined(__ARM_ARCH) && (__ARM_ARCH == 6) && defined(__ARM_ARCH_PROFILE) && \
+    (__ARM_ARCH_PROFILE == 'M')) || \
+    (defined(__CORE__) && defined(__ARM6M__) && (__CORE__ == __ARM6M__))
+        CMP     R0, #0
+        BEQ     attach
+        BX      LR
+
+attach:
+        PUSH    {R1-R3, LR}
+        MOV     R1, R12
+        PUSH    {R0, R1}
+        BL      cy_iar_tls_attach_current
+        POP     {R1, R2}
+        MOV     R12, R1
+        POP     {R1-R3, PC}
+#else
+        CBZ     R0, attach
+        BX      LR
+
+attach:
+        // r4 keeps the stack 8-byte aligned and holds FPSCR
+        PUSH    {R1-R4, R12, LR}
+#ifdef __ARMVFP__
+        VMRS    R4, FPSCR
+        VPUSH   {S0-S15}
+#endif
+        BL      cy_iar_tls_attach_current
+#ifdef __ARMVFP__
+        VPOP    {S0-S15}
+        VMSR    FPSCR, R4
+#endif
+        POP     {R1-R4, R12, PC}
+#endif
+
+        LTORG
+        END
@@ -47,6 +47,10 @@ extern struct _reent* _impure_ptr;          /**< Pointer to struct _reent for cu
 /** Initializes a struct _reent */
 /** \param r struct _reent */
 void cy_iar_init_reent(struct _reent* r);
+
+/** Runs the destructors of the calling task's thread-local C++ objects. A task that owns such
+ *  objects calls this just before deleting itself; otherwise their destructors are not run. */
+void cy_iar_thread_exit(void);
 #endif
 
 /** Initializes the struct _reent by pointer x */
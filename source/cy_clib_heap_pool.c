@@ -0,0 +1,256 @@
+/***********************************************************************************************//**
+ * \file cy_clib_heap_pool.c
+ *
+ * \brief
+ * Lock-free fixed-size block pools in front of the C library heap
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "cy_clib_heap.h"
+#include "cy_clib_support_atomic.h"
+#include "cy_utils.h"
+
+#if defined(CY_CLIB_HEAP_POOL)
+
+// The pool memory is reserved statically, one array of equally sized blocks
+// per class, and never returned to the heap. Blocks that have never been
+// handed out are taken from the end of the class array (a bump index); freed
+// blocks are kept on a per-class LIFO free list whose link is stored in the
+// first word of the block. Both are updated with a single compare-and-swap,
+// so allocation and free never take a lock and complete in a bounded number
+// of steps unless they are repeatedly preempted by another pool operation.
+//
+// The free list head holds the index of the first free block (plus one, so
+// that zero means empty) in its low 16 bits and a modification count in the
+// remaining bits. The count changes on every push and pop, which makes a pop
+// that raced with other pops and pushes of the same block fail its
+// compare-and-swap instead of installing a stale link.
+
+#define CY_CLIB_HEAP_POOL_INDEX_MASK    ((uintptr_t)0xFFFFU)
+#define CY_CLIB_HEAP_POOL_TAG_ONE       ((uintptr_t)0x10000U)
+
+#if defined(__ICCARM__)
+#   define CY_ATTR_NO_INIT __no_init
+#elif defined(CY_CLIB_HEAP_POOL_SECTION)
+#   define CY_ATTR_NO_INIT __attribute__((section(CY_CLIB_HEAP_POOL_SECTION)))
+#else
+#   define CY_ATTR_NO_INIT
+#endif
+
+#define CY_CLIB_HEAP_POOL_MEMBER(size, count)   uint8_t class_##size[(size) * (count)];
+#define CY_CLIB_HEAP_POOL_ENTRY(size, count)    \
+    { cy_clib_heap_pool_memory.classes.class_##size, (size), (count), 0U, 0U, 0U, 0U, 0U },
+
+// Block sizes are multiples of 8 bytes, so the class arrays stay 8 byte
+// aligned one after the other.
+typedef union
+{
+    uint64_t align;
+    struct
+    {
+        CY_CLIB_HEAP_POOL_CLASSES(CY_CLIB_HEAP_POOL_MEMBER)
+    } classes;
+} cy_clib_heap_pool_memory_t;
+
+typedef struct
+{
+    uint8_t*           base;
+    uint32_t           size;
+    uint32_t           count;
+    volatile uintptr_t head;
+    volatile uintptr_t unused;
+    volatile uintptr_t in_use;
+    volatile uintptr_t peak;
+    volatile uintptr_t exhausted;
+} cy_clib_heap_pool_class_t;
+
+static CY_ATTR_NO_INIT cy_clib_heap_pool_memory_t cy_clib_heap_pool_memory;
+
+static cy_clib_heap_pool_class_t cy_clib_heap_pool_class[] =
+{
+    CY_CLIB_HEAP_POOL_CLASSES(CY_CLIB_HEAP_POOL_ENTRY)
+};
+
+#define CY_CLIB_HEAP_POOL_CLASS_COUNT \
+    (sizeof(cy_clib_heap_pool_class) / sizeof(cy_clib_heap_pool_class[0]))
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_pool_take
+//--------------------------------------------------------------------------------------------------
+static void* cy_clib_heap_pool_take(cy_clib_heap_pool_class_t* pool)
+{
+    uint8_t*  block = NULL;
+    uintptr_t head;
+    uintptr_t next;
+
+    do
+    {
+        head = cy_atomic_load(&pool->head);
+        if (0U == (head & CY_CLIB_HEAP_POOL_INDEX_MASK))
+        {
+            break;
+        }
+        block = pool->base + (((head & CY_CLIB_HEAP_POOL_INDEX_MASK) - 1U) * pool->size);
+        // If another task took this block meanwhile, the link may already be
+        // overwritten, but then the head has changed and the exchange fails.
+        next = (*(volatile uintptr_t*)(void*)block & CY_CLIB_HEAP_POOL_INDEX_MASK) |
+               ((head + CY_CLIB_HEAP_POOL_TAG_ONE) & ~CY_CLIB_HEAP_POOL_INDEX_MASK);
+    } while (!cy_atomic_compare_exchange(&pool->head, head, next));
+
+    if (0U == (head & CY_CLIB_HEAP_POOL_INDEX_MASK))
+    {
+        uintptr_t index;
+        block = NULL;
+        do
+        {
+            index = cy_atomic_load(&pool->unused);
+            if (index >= pool->count)
+            {
+                break;
+            }
+        } while (!cy_atomic_compare_exchange(&pool->unused, index, index + 1U));
+
+        if (index < pool->count)
+        {
+            block = pool->base + (index * pool->size);
+        }
+    }
+    return block;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_pool_alloc
+//--------------------------------------------------------------------------------------------------
+void* cy_clib_heap_pool_alloc(size_t size)
+{
+    void* block = NULL;
+
+    // A class that has run out hands the request to the next larger one
+    for (uint32_t i = 0U; (i < CY_CLIB_HEAP_POOL_CLASS_COUNT) && (NULL == block); i++)
+    {
+        cy_clib_heap_pool_class_t* pool = &cy_clib_heap_pool_class[i];
+        if (size <= pool->size)
+        {
+            block = cy_clib_heap_pool_take(pool);
+            if (NULL == block)
+            {
+                (void)cy_atomic_add(&pool->exhausted, 1U);
+            }
+            else
+            {
+                uintptr_t in_use = cy_atomic_add(&pool->in_use, 1U);
+                uintptr_t peak   = cy_atomic_load(&pool->peak);
+                while ((in_use > peak) &&
+                       !cy_atomic_compare_exchange(&pool->peak, peak, in_use))
+                {
+                    peak = cy_atomic_load(&pool->peak);
+                }
+            }
+        }
+    }
+    return block;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_pool_block_size
+//--------------------------------------------------------------------------------------------------
+size_t cy_clib_heap_pool_block_size(const void* ptr)
+{
+    size_t         size    = 0U;
+    const uint8_t* address = (const uint8_t*)ptr;
+
+    if ((address >= (const uint8_t*)&cy_clib_heap_pool_memory) &&
+        (address < ((const uint8_t*)&cy_clib_heap_pool_memory + sizeof(cy_clib_heap_pool_memory))))
+    {
+        for (uint32_t i = 0U; i < CY_CLIB_HEAP_POOL_CLASS_COUNT; i++)
+        {
+            const cy_clib_heap_pool_class_t* pool = &cy_clib_heap_pool_class[i];
+            if ((address >= pool->base) && (address < (pool->base + (pool->size * pool->count))))
+            {
+                size = pool->size;
+                break;
+            }
+        }
+    }
+    return size;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_pool_free
+//--------------------------------------------------------------------------------------------------
+bool cy_clib_heap_pool_free(void* ptr)
+{
+    bool     found   = false;
+    uint8_t* address = (uint8_t*)ptr;
+
+    if ((address >= (uint8_t*)&cy_clib_heap_pool_memory) &&
+        (address < ((uint8_t*)&cy_clib_heap_pool_memory + sizeof(cy_clib_heap_pool_memory))))
+    {
+        for (uint32_t i = 0U; (i < CY_CLIB_HEAP_POOL_CLASS_COUNT) && !found; i++)
+        {
+            cy_clib_heap_pool_class_t* pool = &cy_clib_heap_pool_class[i];
+            if ((address >= pool->base) && (address < (pool->base + (pool->size * pool->count))))
+            {
+                uintptr_t index = (uintptr_t)(address - pool->base) / pool->size;
+                uintptr_t head;
+                CY_ASSERT(address == (pool->base + (index * pool->size)));
+                do
+                {
+                    head = cy_atomic_load(&pool->head);
+                    *(volatile uintptr_t*)ptr = head & CY_CLIB_HEAP_POOL_INDEX_MASK;
+                } while (!cy_atomic_compare_exchange(&pool->head, head,
+                                                     (index + 1U) |
+                                                     ((head + CY_CLIB_HEAP_POOL_TAG_ONE) &
+                                                      ~CY_CLIB_HEAP_POOL_INDEX_MASK)));
+                (void)cy_atomic_add(&pool->in_use, (uintptr_t)0U - 1U);
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_pool_get_stats
+//--------------------------------------------------------------------------------------------------
+uint32_t cy_clib_heap_pool_get_stats(cy_clib_heap_pool_stats_t* stats, uint32_t count)
+{
+    uint32_t filled = 0U;
+    for (; (filled < count) && (filled < CY_CLIB_HEAP_POOL_CLASS_COUNT); filled++)
+    {
+        cy_clib_heap_pool_class_t* pool = &cy_clib_heap_pool_class[filled];
+        stats[filled].block_size  = pool->size;
+        stats[filled].block_count = pool->count;
+        stats[filled].in_use      = (uint32_t)cy_atomic_load(&pool->in_use);
+        stats[filled].peak        = (uint32_t)cy_atomic_load(&pool->peak);
+        stats[filled].exhausted   = (uint32_t)cy_atomic_load(&pool->exhausted);
+    }
+    return filled;
+}
+
+
+#endif // defined(CY_CLIB_HEAP_POOL)
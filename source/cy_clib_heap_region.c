@@ -0,0 +1,284 @@
+/***********************************************************************************************//**
+ * \file cy_clib_heap_region.c
+ *
+ * \brief
+ * Table of discontiguous memory regions used to grow the C library heap
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#include <stdbool.h>
+#include <stdint.h>
+#if !defined (COMPONENT_CAT5)
+#include <cmsis_compiler.h>
+#endif
+#include "cy_clib_heap.h"
+#include "cy_clib_support_atomic.h"
+#include "cy_clib_heap_stats.h"
+
+// The heap defined by the linker script (region 0) grows through _sbrk (GCC)
+// like a classic break. Newlib's allocators rely on each _sbrk call continuing
+// the memory of the previous one: nano malloc grows its last free chunk in
+// place and the full allocator merges new memory into its top chunk. So
+// cy_clib_heap_sbrk only ever moves the break of region 0 and fails once it is
+// full.
+//
+// The regions added with cy_clib_heap_add_region are offered to the toolchain
+// port as a whole (cy_clib_heap_give_region); the newlib port frees each of
+// them into the allocator as one large free block. Regions the port does not
+// take are served by cy_clib_heap_extend for allocators that accept memory
+// that does not continue their previous block (__rt_heap_extend of the ARM C
+// library): each request comes from the region that served the previous one
+// while it has room, otherwise from the first region in the table that does.
+// Any space left at the end of a region that could not hold a request stays
+// available for later, smaller ones.
+//
+// Slot 0 is reserved for the heap defined by the linker script, which the
+// toolchain port sets before the first request; cy_clib_heap_add_region fills
+// the remaining slots.
+
+typedef struct
+{
+    uint8_t* base;
+    uint8_t* limit;
+    uint8_t* brk;
+    uint8_t* peak;
+} cy_clib_heap_region_t;
+
+static cy_clib_heap_region_t cy_clib_heap_region[CY_CLIB_HEAP_REGION_MAX];
+static volatile uintptr_t    cy_clib_heap_region_count   = 1U;
+static uint32_t              cy_clib_heap_region_current = 0U;
+
+// Updated by cy_clib_heap_sbrk and cy_clib_heap_extend, which run with the heap lock held
+static uint32_t cy_clib_heap_sbrk_calls      = 0U;
+static size_t   cy_clib_heap_sbrk_total      = 0U;
+static size_t   cy_clib_heap_sbrk_high_water = 0U;
+
+#if defined(CY_CLIB_HEAP_STATS)
+cy_clib_heap_counters_t cy_clib_heap_counters;
+#endif
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_region_init
+//--------------------------------------------------------------------------------------------------
+static void cy_clib_heap_region_init(cy_clib_heap_region_t* region, void* base, size_t size)
+{
+    region->base  = (uint8_t*)base;
+    region->limit = (uint8_t*)base + size;
+    region->brk   = (uint8_t*)base;
+    region->peak  = (uint8_t*)base;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_set_default_region
+//--------------------------------------------------------------------------------------------------
+void cy_clib_heap_set_default_region(void* base, size_t size)
+{
+    if (NULL == cy_clib_heap_region[0].base)
+    {
+        cy_clib_heap_region_init(&cy_clib_heap_region[0], base, size);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_give_region
+//--------------------------------------------------------------------------------------------------
+__WEAK bool cy_clib_heap_give_region(void* base, size_t size)
+{
+    (void)base;
+    (void)size;
+    return false;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_add_region
+//--------------------------------------------------------------------------------------------------
+bool cy_clib_heap_add_region(void* base, size_t size)
+{
+    bool      added = false;
+    uintptr_t count = cy_atomic_load(&cy_clib_heap_region_count);
+    if ((NULL != base) && (0U != size) && (count < CY_CLIB_HEAP_REGION_MAX))
+    {
+        cy_clib_heap_region_t* region = &cy_clib_heap_region[count];
+        cy_clib_heap_region_init(region, base, size);
+        if (cy_clib_heap_give_region(base, size))
+        {
+            // The allocator owns all of it now
+            region->brk  = region->limit;
+            region->peak = region->limit;
+        }
+        // Publish the entry only once it is complete
+        cy_atomic_store(&cy_clib_heap_region_count, count + 1U);
+        added = true;
+    }
+    return added;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_claim
+//--------------------------------------------------------------------------------------------------
+static void* cy_clib_heap_claim(cy_clib_heap_region_t* region, intptr_t incr)
+{
+    void* block = NULL;
+    if ((NULL != region->base) &&
+        (incr <= (region->limit - region->brk)) && (incr >= (region->base - region->brk)))
+    {
+        block        = region->brk;
+        region->brk += incr;
+        if (region->brk > region->peak)
+        {
+            region->peak = region->brk;
+        }
+        cy_clib_heap_sbrk_total += (size_t)incr;
+        if (cy_clib_heap_sbrk_total > cy_clib_heap_sbrk_high_water)
+        {
+            cy_clib_heap_sbrk_high_water = cy_clib_heap_sbrk_total;
+        }
+    }
+    cy_clib_heap_sbrk_calls++;
+    return block;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_sbrk
+//--------------------------------------------------------------------------------------------------
+void* cy_clib_heap_sbrk(intptr_t incr)
+{
+    return cy_clib_heap_claim(&cy_clib_heap_region[0], incr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_extend
+//--------------------------------------------------------------------------------------------------
+void* cy_clib_heap_extend(size_t size)
+{
+    uint32_t               count   = (uint32_t)cy_atomic_load(&cy_clib_heap_region_count);
+    cy_clib_heap_region_t* current = &cy_clib_heap_region[cy_clib_heap_region_current];
+    void*                  block   = NULL;
+
+    if ((NULL == current->base) || (size > (size_t)(current->limit - current->brk)))
+    {
+        // The current region cannot grow, move to the first one that can
+        for (uint32_t i = 0U; i < count; i++)
+        {
+            cy_clib_heap_region_t* region = &cy_clib_heap_region[i];
+            if ((NULL != region->base) && (size <= (size_t)(region->limit - region->brk)))
+            {
+                cy_clib_heap_region_current = i;
+                current                     = region;
+                break;
+            }
+        }
+    }
+    if (size <= (size_t)INTPTR_MAX)
+    {
+        block = cy_clib_heap_claim(current, (intptr_t)size);
+    }
+    return block;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_get_region_stats
+//--------------------------------------------------------------------------------------------------
+uint32_t cy_clib_heap_get_region_stats(cy_clib_heap_region_stats_t* stats, uint32_t count)
+{
+    uint32_t filled  = 0U;
+    uint32_t regions = (uint32_t)cy_atomic_load(&cy_clib_heap_region_count);
+    for (uint32_t i = 0U; (i < regions) && (filled < count); i++)
+    {
+        const cy_clib_heap_region_t* region = &cy_clib_heap_region[i];
+        if (NULL != region->base)
+        {
+            stats[filled].base       = region->base;
+            stats[filled].size       = (size_t)(region->limit - region->base);
+            stats[filled].used       = (size_t)(region->brk - region->base);
+            stats[filled].high_water = (size_t)(region->peak - region->base);
+            filled++;
+        }
+    }
+    return filled;
+}
+
+
+#if defined(CY_CLIB_HEAP_STATS)
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_top_free
+//--------------------------------------------------------------------------------------------------
+__WEAK size_t cy_clib_heap_top_free(void)
+{
+    return 0U;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_get_stats
+//--------------------------------------------------------------------------------------------------
+void cy_clib_heap_get_stats(cy_clib_heap_stats_t* stats)
+{
+    uint32_t regions      = (uint32_t)cy_atomic_load(&cy_clib_heap_region_count);
+    size_t   heap_size    = 0U;
+    size_t   largest_free = (size_t)cy_atomic_load(&cy_clib_heap_counters.largest_free);
+
+    // Every value is read without the heap lock, so a snapshot taken while
+    // other tasks allocate may mix values from before and after a call.
+    for (uint32_t i = 0U; i < regions; i++)
+    {
+        const cy_clib_heap_region_t* region = &cy_clib_heap_region[i];
+        if (NULL != region->base)
+        {
+            heap_size += (size_t)(region->limit - region->base);
+            // Unclaimed space is free; at the end of the linker heap it continues the top chunk
+            size_t unclaimed = (size_t)(region->limit - region->brk);
+            if (0U == i)
+            {
+                unclaimed += cy_clib_heap_top_free();
+            }
+            if (unclaimed > largest_free)
+            {
+                largest_free = unclaimed;
+            }
+        }
+    }
+
+    stats->heap_size       = heap_size;
+    stats->in_use          = (size_t)cy_atomic_load(&cy_clib_heap_counters.in_use);
+    stats->in_use_peak     = (size_t)cy_atomic_load(&cy_clib_heap_counters.in_use_peak);
+    stats->free            = (heap_size > stats->in_use) ? (heap_size - stats->in_use) : 0U;
+    stats->largest_free    = (largest_free < stats->free) ? largest_free : stats->free;
+    stats->fragmentation   = (0U == stats->free) ? 0U :
+                             (uint32_t)(1000U - (((uint64_t)stats->largest_free * 1000U) /
+                                                 stats->free));
+    stats->sbrk_in_use     = cy_clib_heap_sbrk_total;
+    stats->sbrk_high_water = cy_clib_heap_sbrk_high_water;
+    stats->sbrk_calls      = cy_clib_heap_sbrk_calls;
+    stats->allocations     = (uint32_t)cy_atomic_load(&cy_clib_heap_counters.allocations);
+    stats->frees           = (uint32_t)cy_atomic_load(&cy_clib_heap_counters.frees);
+    stats->failures        = (uint32_t)cy_atomic_load(&cy_clib_heap_counters.failures);
+}
+
+
+#endif // defined(CY_CLIB_HEAP_STATS)
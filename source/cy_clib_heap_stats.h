@@ -0,0 +1,149 @@
+/***********************************************************************************************//**
+ * \file cy_clib_heap_stats.h
+ *
+ * \brief
+ * Internal allocation counters behind cy_clib_heap_get_stats
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cy_clib_support_atomic.h"
+
+// Counters updated by the allocator front end on every call, outside the heap
+// lock for requests served by the pools or the task caches, so they use
+// atomic operations. Byte counts cover heap blocks only (by their usable
+// size); pool blocks are counted by cy_clib_heap_pool_get_stats instead. Only
+// blocks allocated through the front end are counted when they are freed.
+//
+// largest_free is kept as a lower bound of the largest free block in the
+// allocator's free list without walking it: a block freed into the heap leaves
+// a free block at least its size behind (coalescing only makes it larger), and
+// a block carved from the heap shrinks no free block by more than its size.
+
+#if defined(CY_CLIB_HEAP_STATS)
+
+typedef struct
+{
+    volatile uintptr_t allocations;
+    volatile uintptr_t frees;
+    volatile uintptr_t failures;
+    volatile uintptr_t in_use;
+    volatile uintptr_t in_use_peak;
+    volatile uintptr_t largest_free;
+} cy_clib_heap_counters_t;
+
+extern cy_clib_heap_counters_t cy_clib_heap_counters;
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_stats_raise
+//--------------------------------------------------------------------------------------------------
+static inline void cy_clib_heap_stats_raise(volatile uintptr_t* counter, uintptr_t value)
+{
+    uintptr_t current = cy_atomic_load(counter);
+    while ((value > current) && !cy_atomic_compare_exchange(counter, current, value))
+    {
+        current = cy_atomic_load(counter);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_stats_lower
+//--------------------------------------------------------------------------------------------------
+// Subtracts value, stopping at zero
+static inline void cy_clib_heap_stats_lower(volatile uintptr_t* counter, uintptr_t value)
+{
+    uintptr_t current = cy_atomic_load(counter);
+    while (!cy_atomic_compare_exchange(counter, current,
+                                       (current > value) ? (current - value) : 0U))
+    {
+        current = cy_atomic_load(counter);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_stats_allocated
+//--------------------------------------------------------------------------------------------------
+static inline void cy_clib_heap_stats_allocated(size_t size)
+{
+    (void)cy_atomic_add(&cy_clib_heap_counters.allocations, 1U);
+    if (0U != size)
+    {
+        uintptr_t in_use = cy_atomic_add(&cy_clib_heap_counters.in_use, size);
+        cy_clib_heap_stats_raise(&cy_clib_heap_counters.in_use_peak, in_use);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_stats_freed
+//--------------------------------------------------------------------------------------------------
+static inline void cy_clib_heap_stats_freed(size_t size)
+{
+    (void)cy_atomic_add(&cy_clib_heap_counters.frees, 1U);
+    // Never below zero, even if a block is freed that was counted with a smaller size
+    cy_clib_heap_stats_lower(&cy_clib_heap_counters.in_use, size);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_stats_carved
+//--------------------------------------------------------------------------------------------------
+// A block of size usable bytes was taken from the heap, whether it goes to the caller or to a
+// task cache
+static inline void cy_clib_heap_stats_carved(size_t size)
+{
+    cy_clib_heap_stats_lower(&cy_clib_heap_counters.largest_free, size);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_stats_released
+//--------------------------------------------------------------------------------------------------
+// A block of size usable bytes is about to be returned to the heap
+static inline void cy_clib_heap_stats_released(size_t size)
+{
+    cy_clib_heap_stats_raise(&cy_clib_heap_counters.largest_free, size);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_clib_heap_stats_failed
+//--------------------------------------------------------------------------------------------------
+static inline void cy_clib_heap_stats_failed(void)
+{
+    (void)cy_atomic_add(&cy_clib_heap_counters.failures, 1U);
+}
+
+
+#else // if defined(CY_CLIB_HEAP_STATS)
+
+#define cy_clib_heap_stats_allocated(size)  ((void)0)
+#define cy_clib_heap_stats_freed(size)      ((void)0)
+#define cy_clib_heap_stats_failed()         ((void)0)
+#define cy_clib_heap_stats_carved(size)     ((void)0)
+#define cy_clib_heap_stats_released(size)   ((void)0)
+
+#endif // if defined(CY_CLIB_HEAP_STATS)
@@ -0,0 +1,201 @@
+/***********************************************************************************************//**
+ * \file cy_clib_support_atomic.h
+ *
+ * \brief
+ * Internal atomic operations for the lock-free paths of clib-support
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#if !defined (COMPONENT_CAT5)
+#include <cmsis_compiler.h>
+#endif
+
+// Word-sized atomic operations used by the lock-free paths of this library.
+// They are written against CMSIS exclusive access intrinsics rather than
+// compiler builtins because the ARM and IAR compilers do not provide the C11
+// builtins for all targets. ARMv6-M has no exclusive access instructions, so
+// on those devices the operations briefly mask interrupts instead. Host builds
+// (COMPONENT_POSIX) use the GCC builtins.
+
+#if defined(COMPONENT_POSIX)
+
+//--------------------------------------------------------------------------------------------------
+// cy_atomic_load
+//--------------------------------------------------------------------------------------------------
+static inline uintptr_t cy_atomic_load(volatile uintptr_t* address)
+{
+    return __atomic_load_n(address, __ATOMIC_ACQUIRE);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_atomic_store
+//--------------------------------------------------------------------------------------------------
+static inline void cy_atomic_store(volatile uintptr_t* address, uintptr_t value)
+{
+    __atomic_store_n(address, value, __ATOMIC_RELEASE);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_atomic_compare_exchange
+//--------------------------------------------------------------------------------------------------
+static inline bool cy_atomic_compare_exchange(volatile uintptr_t* address, uintptr_t expected,
+                                              uintptr_t desired)
+{
+    return __atomic_compare_exchange_n(address, &expected, desired, false, __ATOMIC_ACQ_REL,
+                                       __ATOMIC_ACQUIRE);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_atomic_exchange
+//--------------------------------------------------------------------------------------------------
+static inline uintptr_t cy_atomic_exchange(volatile uintptr_t* address, uintptr_t value)
+{
+    return __atomic_exchange_n(address, value, __ATOMIC_ACQ_REL);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_atomic_fence
+//--------------------------------------------------------------------------------------------------
+static inline void cy_atomic_fence(void)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+
+#else // if defined(COMPONENT_POSIX)
+
+#if defined(__ARM_ARCH_6M__) || \
+    (defined(__ARM_ARCH) && (__ARM_ARCH == 6) && defined(__ARM_ARCH_PROFILE) && \
+    (__ARM_ARCH_PROFILE == 'M'))
+#define CY_ATOMIC_USE_CRITICAL_SECTION
+#endif
+
+//--------------------------------------------------------------------------------------------------
+// cy_atomic_load
+//--------------------------------------------------------------------------------------------------
+__STATIC_FORCEINLINE uintptr_t cy_atomic_load(volatile uintptr_t* address)
+{
+    uintptr_t result = *address;
+    __DMB();
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_atomic_store
+//--------------------------------------------------------------------------------------------------
+__STATIC_FORCEINLINE void cy_atomic_store(volatile uintptr_t* address, uintptr_t value)
+{
+    __DMB();
+    *address = value;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_atomic_compare_exchange
+//--------------------------------------------------------------------------------------------------
+__STATIC_FORCEINLINE bool cy_atomic_compare_exchange(volatile uintptr_t* address,
+                                                     uintptr_t expected, uintptr_t desired)
+{
+    bool success = false;
+    __DMB();
+    #if defined(CY_ATOMIC_USE_CRITICAL_SECTION)
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (*address == expected)
+    {
+        *address = desired;
+        success  = true;
+    }
+    __set_PRIMASK(primask);
+    #else
+    do
+    {
+        if (__LDREXW((volatile uint32_t*)address) != expected)
+        {
+            __CLREX();
+            break;
+        }
+        success = (0U == __STREXW(desired, (volatile uint32_t*)address));
+    } while (!success);
+    #endif // if defined(CY_ATOMIC_USE_CRITICAL_SECTION)
+    __DMB();
+    return success;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_atomic_exchange
+//--------------------------------------------------------------------------------------------------
+__STATIC_FORCEINLINE uintptr_t cy_atomic_exchange(volatile uintptr_t* address, uintptr_t value)
+{
+    uintptr_t previous;
+    __DMB();
+    #if defined(CY_ATOMIC_USE_CRITICAL_SECTION)
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    previous = *address;
+    *address = value;
+    __set_PRIMASK(primask);
+    #else
+    do
+    {
+        previous = __LDREXW((volatile uint32_t*)address);
+    } while (0U != __STREXW(value, (volatile uint32_t*)address));
+    #endif // if defined(CY_ATOMIC_USE_CRITICAL_SECTION)
+    __DMB();
+    return previous;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_atomic_fence
+//--------------------------------------------------------------------------------------------------
+__STATIC_FORCEINLINE void cy_atomic_fence(void)
+{
+    __DMB();
+}
+
+
+#endif // if defined(COMPONENT_POSIX)
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_atomic_add
+//--------------------------------------------------------------------------------------------------
+// Adds delta (which may wrap, to subtract) to a counter and returns the new value
+static inline uintptr_t cy_atomic_add(volatile uintptr_t* address, uintptr_t delta)
+{
+    uintptr_t value;
+    do
+    {
+        value = cy_atomic_load(address);
+    } while (!cy_atomic_compare_exchange(address, value, value + delta));
+    return value + delta;
+}
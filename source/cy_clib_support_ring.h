@@ -0,0 +1,197 @@
+/***********************************************************************************************//**
+ * \file cy_clib_support_ring.h
+ *
+ * \brief
+ * Lock-free multi-producer, single-consumer ring buffer of variable-size records
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "cy_clib_support_atomic.h"
+
+// Records are a header word holding the payload length and a committed flag,
+// followed by the payload, padded to a whole word. Producers reserve a record
+// by advancing the head with a compare-and-swap, copy their payload and then
+// set the header, so producers never wait for each other. The consumer takes
+// committed records in order, stopping at the first record that is still
+// being filled, and clears each record before advancing the tail so that
+// stale payload bytes are never taken for a header.
+//
+// Head and tail are free-running byte counters; the index into the storage is
+// the counter modulo the size, which must be a power of two. Only one task at
+// a time may consume.
+
+#define CY_RING_WORD        ((uintptr_t)sizeof(uintptr_t))
+#define CY_RING_COMMITTED   ((uintptr_t)1U << 31U)
+
+typedef struct
+{
+    uintptr_t*         storage;     // size bytes, zero-initialized
+    uintptr_t          size;
+    volatile uintptr_t head;
+    volatile uintptr_t tail;
+    volatile uintptr_t high_water;  // Most bytes in use at the same time
+} cy_ring_t;
+
+//--------------------------------------------------------------------------------------------------
+// cy_ring_header
+//--------------------------------------------------------------------------------------------------
+static inline volatile uintptr_t* cy_ring_header(cy_ring_t* ring, uintptr_t position)
+{
+    return &ring->storage[(position & (ring->size - 1U)) / CY_RING_WORD];
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_ring_record_size
+//--------------------------------------------------------------------------------------------------
+// Bytes taken by a record with a payload of length bytes
+static inline uintptr_t cy_ring_record_size(size_t length)
+{
+    uintptr_t padded = ((uintptr_t)length + CY_RING_WORD - 1U) & ~(CY_RING_WORD - 1U);
+    return CY_RING_WORD + padded;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_ring_has_room
+//--------------------------------------------------------------------------------------------------
+static inline bool cy_ring_has_room(cy_ring_t* ring, size_t length)
+{
+    // The tail is read first so that it can never be ahead of the head
+    uintptr_t tail = cy_atomic_load(&ring->tail);
+    uintptr_t head = cy_atomic_load(&ring->head);
+    return ((head + cy_ring_record_size(length) - tail) <= ring->size);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_ring_reserve
+//--------------------------------------------------------------------------------------------------
+// Reserves a record for a payload of length bytes. Returns false if the ring
+// is full; otherwise the record must be filled and committed at *position.
+static inline bool cy_ring_reserve(cy_ring_t* ring, size_t length, uintptr_t* position)
+{
+    uintptr_t need     = cy_ring_record_size(length);
+    bool      reserved = false;
+    bool      full     = false;
+    while (!reserved && !full)
+    {
+        uintptr_t tail = cy_atomic_load(&ring->tail);
+        uintptr_t head = cy_atomic_load(&ring->head);
+        full = ((head + need - tail) > ring->size);
+        if (!full)
+        {
+            reserved = cy_atomic_compare_exchange(&ring->head, head, head + need);
+            if (reserved)
+            {
+                uintptr_t used = head + need - tail;
+                uintptr_t peak = cy_atomic_load(&ring->high_water);
+                while ((used > peak) && !cy_atomic_compare_exchange(&ring->high_water, peak, used))
+                {
+                    peak = cy_atomic_load(&ring->high_water);
+                }
+                *position = head;
+            }
+        }
+    }
+    return reserved;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_ring_write
+//--------------------------------------------------------------------------------------------------
+// Copies size bytes to offset bytes into the payload of the record at position
+static inline void cy_ring_write(cy_ring_t* ring, uintptr_t position, size_t offset,
+                                 const void* data, size_t size)
+{
+    if (0U != size)
+    {
+        uint8_t* bytes = (uint8_t*)ring->storage;
+        size_t   index = (size_t)((position + CY_RING_WORD + offset) & (ring->size - 1U));
+        size_t   first = (size_t)ring->size - index;
+        if (first > size)
+        {
+            first = size;
+        }
+        (void)memcpy(&bytes[index], data, first);
+        (void)memcpy(bytes, &((const uint8_t*)data)[first], size - first);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_ring_commit
+//--------------------------------------------------------------------------------------------------
+// Hands the filled record at position to the consumer
+static inline void cy_ring_commit(cy_ring_t* ring, uintptr_t position, size_t length)
+{
+    cy_atomic_store(cy_ring_header(ring, position), CY_RING_COMMITTED | (uintptr_t)length);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_ring_front
+//--------------------------------------------------------------------------------------------------
+// Returns whether the oldest record is committed, and its payload. The
+// payload may wrap around the end of the storage: it is the first bytes at
+// *first followed by the rest at the start of the storage.
+static inline bool cy_ring_front(cy_ring_t* ring, const uint8_t** first, size_t* first_size,
+                                 size_t* length)
+{
+    uintptr_t tail   = cy_atomic_load(&ring->tail);
+    uintptr_t header = cy_atomic_load(cy_ring_header(ring, tail));
+    bool      ready  = (0U != (header & CY_RING_COMMITTED));
+    if (ready)
+    {
+        size_t index = (size_t)((tail + CY_RING_WORD) & (ring->size - 1U));
+        *length     = (size_t)(header & ~CY_RING_COMMITTED);
+        *first      = &((const uint8_t*)ring->storage)[index];
+        *first_size = (size_t)ring->size - index;
+        if (*first_size > *length)
+        {
+            *first_size = *length;
+        }
+    }
+    return ready;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_ring_pop
+//--------------------------------------------------------------------------------------------------
+// Frees the oldest record, which has a payload of length bytes
+static inline void cy_ring_pop(cy_ring_t* ring, size_t length)
+{
+    uintptr_t tail = cy_atomic_load(&ring->tail);
+    uintptr_t need = cy_ring_record_size(length);
+    for (uintptr_t word = 0U; word < need; word += CY_RING_WORD)
+    {
+        *cy_ring_header(ring, tail + word) = 0U;
+    }
+    cy_atomic_store(&ring->tail, tail + need);
+}
@@ -0,0 +1,240 @@
+/***********************************************************************************************//**
+ * \file cy_compact_lock.c
+ *
+ * \brief
+ * Recursive locks that fit in a single word, parking waiters only on contention
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <cmsis_compiler.h>
+#include "cy_mutex_pool.h"
+#include "cy_clib_support_atomic.h"
+
+#if defined(MUTEX_POOL_AVAILABLE)
+
+// A compact lock is a single word holding the owning task handle. Task handles
+// are at least 4-byte aligned, which leaves the two low bits for flags:
+// CY_COMPACT_LOCK_CONTENDED tells the owner that tasks may be parked on the
+// word and must be woken on release, and CY_COMPACT_LOCK_RECURSED tells it
+// that the lock has been re-entered. Uncontended acquire and release are a
+// single compare-and-swap each and never call into the kernel.
+//
+// Recursion is rare, so the depth of re-entered locks is kept in a small table
+// rather than in the word. Only the owner of a lock ever reads or writes its
+// table entry.
+
+#define CY_COMPACT_LOCK_CONTENDED   ((uintptr_t)1U)
+#define CY_COMPACT_LOCK_RECURSED    ((uintptr_t)2U)
+#define CY_COMPACT_LOCK_FLAGS       (CY_COMPACT_LOCK_CONTENDED | CY_COMPACT_LOCK_RECURSED)
+
+// Maximum number of compact locks that can be re-entered at the same time
+#ifndef CY_COMPACT_LOCK_RECURSION_MAX
+#define CY_COMPACT_LOCK_RECURSION_MAX   (8U)
+#endif
+
+typedef struct
+{
+    volatile uintptr_t lock;    // Address of the re-entered lock, 0 if the entry is free
+    uint32_t           depth;
+} cy_compact_lock_depth_t;
+
+static cy_compact_lock_depth_t cy_compact_lock_depth[CY_COMPACT_LOCK_RECURSION_MAX];
+
+//--------------------------------------------------------------------------------------------------
+// cy_compact_lock_find_depth
+//--------------------------------------------------------------------------------------------------
+static cy_compact_lock_depth_t* cy_compact_lock_find_depth(volatile cy_compact_lock_t* lock)
+{
+    cy_compact_lock_depth_t* entry = NULL;
+    for (uint32_t i = 0U; i < CY_COMPACT_LOCK_RECURSION_MAX; i++)
+    {
+        if (cy_atomic_load(&cy_compact_lock_depth[i].lock) == (uintptr_t)lock)
+        {
+            entry = &cy_compact_lock_depth[i];
+            break;
+        }
+    }
+    return entry;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_compact_lock_claim_depth
+//--------------------------------------------------------------------------------------------------
+static cy_compact_lock_depth_t* cy_compact_lock_claim_depth(volatile cy_compact_lock_t* lock)
+{
+    cy_compact_lock_depth_t* entry = NULL;
+    for (uint32_t i = 0U; i < CY_COMPACT_LOCK_RECURSION_MAX; i++)
+    {
+        if (cy_atomic_compare_exchange(&cy_compact_lock_depth[i].lock, 0U, (uintptr_t)lock))
+        {
+            entry = &cy_compact_lock_depth[i];
+            break;
+        }
+    }
+    return entry;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_compact_lock_update_flags
+//--------------------------------------------------------------------------------------------------
+// Sets and clears flag bits while the word is held, without losing
+// CY_COMPACT_LOCK_CONTENDED being set concurrently by a waiter.
+static void cy_compact_lock_update_flags(volatile cy_compact_lock_t* lock, uintptr_t set,
+                                         uintptr_t clear)
+{
+    uintptr_t current;
+    do
+    {
+        current = cy_atomic_load(lock);
+    } while (!cy_atomic_compare_exchange(lock, current, (current & ~clear) | set));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_compact_lock_must_wait
+//--------------------------------------------------------------------------------------------------
+static bool cy_compact_lock_must_wait(const void* context)
+{
+    // The owner will only wake parked tasks if it sees the contended flag
+    uintptr_t current = cy_atomic_load((volatile cy_compact_lock_t*)context);
+    return (0U != (current & CY_COMPACT_LOCK_CONTENDED));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_compact_lock_check_in_isr
+//--------------------------------------------------------------------------------------------------
+// Like the pool mutexes, compact locks must not be used in interrupt context:
+// the interrupted task may own the lock, and a contended acquire parks the
+// caller, which an interrupt handler cannot do.
+static void cy_compact_lock_check_in_isr(void)
+{
+    #if defined(COMPONENT_POSIX)
+    // Host builds have no interrupt handlers
+    #elif defined(COMPONENT_CR4) // Can work for any Cortex-A & Cortex-R
+    uint32_t mode = __get_mode();
+    if ((mode == 0x11U /*FIQ*/) || (mode == 0x12U /*IRQ*/))
+    {
+        __BKPT(0);
+    }
+    #else // Cortex-M
+    if (0U != __get_IPSR())
+    {
+        __BKPT(0);
+    }
+    #endif
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_compact_lock_acquire
+//--------------------------------------------------------------------------------------------------
+void cy_compact_lock_acquire(volatile cy_compact_lock_t* lock)
+{
+    if (cy_mutex_pool_kernel_started())
+    {
+        cy_compact_lock_check_in_isr();
+        uintptr_t self = (uintptr_t)cy_mutex_pool_current_task();
+        if (!cy_atomic_compare_exchange(lock, 0U, self))
+        {
+            uintptr_t current = cy_atomic_load(lock);
+            if ((current & ~CY_COMPACT_LOCK_FLAGS) == self)
+            {
+                if (0U == (current & CY_COMPACT_LOCK_RECURSED))
+                {
+                    cy_compact_lock_depth_t* entry = cy_compact_lock_claim_depth(lock);
+                    if (NULL == entry)
+                    {
+                        __BKPT(0);  // Out of resources, increase CY_COMPACT_LOCK_RECURSION_MAX
+                    }
+                    else
+                    {
+                        entry->depth = 2U;
+                        cy_compact_lock_update_flags(lock, CY_COMPACT_LOCK_RECURSED, 0U);
+                    }
+                }
+                else
+                {
+                    cy_compact_lock_find_depth(lock)->depth++;
+                }
+            }
+            else
+            {
+                // Contended. A task that acquires the lock after having waited
+                // cannot know whether others are still parked, so it keeps the
+                // contended flag set and its release wakes the queue.
+                while (!cy_atomic_compare_exchange(lock, 0U, self | CY_COMPACT_LOCK_CONTENDED))
+                {
+                    current = cy_atomic_load(lock);
+                    if ((0U != current) && (0U == (current & CY_COMPACT_LOCK_CONTENDED)))
+                    {
+                        if (!cy_atomic_compare_exchange(lock, current,
+                                                        current | CY_COMPACT_LOCK_CONTENDED))
+                        {
+                            continue;
+                        }
+                    }
+                    if (0U != current)
+                    {
+                        cy_mutex_pool_park(lock, cy_compact_lock_must_wait, (const void*)lock);
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_compact_lock_release
+//--------------------------------------------------------------------------------------------------
+void cy_compact_lock_release(volatile cy_compact_lock_t* lock)
+{
+    if (cy_mutex_pool_kernel_started())
+    {
+        if (0U != (cy_atomic_load(lock) & CY_COMPACT_LOCK_RECURSED))
+        {
+            cy_compact_lock_depth_t* entry = cy_compact_lock_find_depth(lock);
+            entry->depth--;
+            if (1U == entry->depth)
+            {
+                cy_compact_lock_update_flags(lock, 0U, CY_COMPACT_LOCK_RECURSED);
+                cy_atomic_store(&entry->lock, 0U);
+            }
+        }
+        else if (0U != (cy_atomic_exchange(lock, 0U) & CY_COMPACT_LOCK_CONTENDED))
+        {
+            cy_mutex_pool_unpark_all(lock);
+        }
+        else
+        {
+            // Uncontended release
+        }
+    }
+}
+
+
+#endif // defined(MUTEX_POOL_AVAILABLE)
@@ -0,0 +1,649 @@
+/***********************************************************************************************//**
+ * \file cy_console.c
+ *
+ * \brief
+ * Buffered console output: per-task line buffers in front of a multi-producer
+ * ring buffer that a low-priority task drains into a pluggable sink
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#if defined(COMPONENT_POSIX)
+#include <time.h>
+#include <unistd.h>
+#endif
+#if !defined (COMPONENT_CAT5)
+#include <cmsis_compiler.h>
+#endif
+#include "cy_console.h"
+#include "cy_mutex_pool.h"
+#include "cy_clib_support_atomic.h"
+#include "cy_clib_support_ring.h"
+
+#if defined(CY_CONSOLE)
+
+// Output is queued as records in a lock-free ring buffer (see
+// cy_clib_support_ring.h), so writers never wait for each other. A writer
+// that finds the ring full drops its record, or with CY_CONSOLE_BLOCKING
+// waits for the drain to make room. Records are limited to a quarter of the
+// ring so that one large write cannot hold up the others for long; larger
+// writes are split.
+//
+// Each task collects single-byte writes, as made by unbuffered stdio and the
+// ARM _ttywrch hook, in a line buffer so that lines printed a character at a
+// time by different tasks do not interleave. A task only holds a line buffer
+// while it has a partial line, so a few buffers serve any number of tasks.
+// The draining task passes a partial line that has not grown for
+// CY_CONSOLE_LINE_TIMEOUT ticks to the sink itself and frees its buffer, so
+// that a prompt is shown and a deleted task does not keep its buffer.
+
+#if ((CY_CONSOLE_RING_SIZE & (CY_CONSOLE_RING_SIZE - 1U)) != 0U)
+#error CY_CONSOLE_RING_SIZE must be a power of two
+#endif
+
+#define CY_CONSOLE_RECORD_MAX   ((size_t)CY_CONSOLE_RING_SIZE / 4U)
+
+#if (CY_CONSOLE_LINE_SIZE > (CY_CONSOLE_RING_SIZE / 4U))
+#error CY_CONSOLE_LINE_SIZE must not exceed a quarter of CY_CONSOLE_RING_SIZE
+#endif
+
+static uintptr_t cy_console_storage[CY_CONSOLE_RING_SIZE / sizeof(uintptr_t)];
+static cy_ring_t cy_console_ring = { cy_console_storage, CY_CONSOLE_RING_SIZE, 0U, 0U, 0U };
+
+// Set while a task passes records to the sink
+static volatile uintptr_t cy_console_draining = 0U;
+// Dropped bytes not yet reported through the sink
+static volatile uintptr_t cy_console_unreported = 0U;
+
+static cy_console_sink_t cy_console_sink         = NULL;
+static void*             cy_console_sink_context = NULL;
+
+static volatile uintptr_t cy_console_written = 0U;
+static volatile uintptr_t cy_console_dropped = 0U;
+static volatile uintptr_t cy_console_drained = 0U;
+static volatile uintptr_t cy_console_waits   = 0U;
+
+#if defined(MUTEX_POOL_AVAILABLE)
+// Set by the draining task before it parks on the tail, and by writers
+// waiting for room before they park on the head
+static volatile uintptr_t cy_console_sink_waiting  = 0U;
+static volatile uintptr_t cy_console_space_waiting = 0U;
+
+// How often the draining task looks at partial lines, so that they are passed
+// on between CY_CONSOLE_LINE_TIMEOUT and 1.25 times that after the last write
+#define CY_CONSOLE_LINE_CHECK \
+    (((CY_CONSOLE_LINE_TIMEOUT / 4U) > 0U) ? (CY_CONSOLE_LINE_TIMEOUT / 4U) : 1U)
+
+// Set in the owner of a line buffer while the task adds to it
+#define CY_CONSOLE_LINE_BUSY    ((uintptr_t)1U)
+// Owner of a line buffer that the draining task passes to the sink: busy, but
+// without a task
+#define CY_CONSOLE_LINE_TAKEN   ((uintptr_t)1U)
+
+typedef struct
+{
+    volatile uintptr_t owner;   // Task collecting a partial line, 0 if the buffer is free
+    volatile uintptr_t length;
+    uint8_t            data[CY_CONSOLE_LINE_SIZE];
+    // Only used by the draining task, to find lines that stopped growing
+    uintptr_t          seen_owner;
+    uintptr_t          seen_length;
+    uint32_t           seen_at;
+} cy_console_line_t;
+
+static cy_console_line_t cy_console_lines[CY_CONSOLE_LINE_BUFFERS];
+// Set by the draining task while a line buffer is in use
+static volatile uintptr_t cy_console_lines_pending = 0U;
+#endif // defined(MUTEX_POOL_AVAILABLE)
+
+//--------------------------------------------------------------------------------------------------
+// cy_console_in_task
+//--------------------------------------------------------------------------------------------------
+// Whether the caller is a task that may block, as opposed to an interrupt
+// handler or code running before the kernel is started
+static bool cy_console_in_task(void)
+{
+    #if !defined(MUTEX_POOL_AVAILABLE)
+    return false;
+    #elif defined(COMPONENT_POSIX)
+    return cy_mutex_pool_kernel_started();
+    #elif defined(COMPONENT_CR4) // Can work for any Cortex-A & Cortex-R
+    uint32_t mode = __get_mode();
+    return (mode != 0x11U /*FIQ*/) && (mode != 0x12U /*IRQ*/) && cy_mutex_pool_kernel_started();
+    #else // Cortex-M
+    return (0U == __get_IPSR()) && cy_mutex_pool_kernel_started();
+    #endif
+}
+
+
+#if defined(MUTEX_POOL_AVAILABLE)
+//--------------------------------------------------------------------------------------------------
+// cy_console_ticks
+//--------------------------------------------------------------------------------------------------
+static uint32_t cy_console_ticks(void)
+{
+    #if defined(COMPONENT_POSIX)
+    struct timespec now;
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)(((uint64_t)now.tv_sec * 1000U) + ((uint64_t)now.tv_nsec / 1000000U));
+    #elif defined(COMPONENT_FREERTOS)
+    return (uint32_t)xTaskGetTickCount();
+    #else
+    return (uint32_t)tx_time_get();
+    #endif
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_console_sink_must_wait
+//--------------------------------------------------------------------------------------------------
+// context points to the timeout of the wait
+static bool cy_console_sink_must_wait(const void* context)
+{
+    const uint8_t* first;
+    size_t         first_size;
+    size_t         length;
+    bool           must_wait = (NULL == cy_console_sink) ||
+                               !cy_ring_front(&cy_console_ring, &first, &first_size, &length);
+    // Without a timeout, a line buffer claimed since the last drain must be aged
+    if (must_wait && (NULL != cy_console_sink) &&
+        (CY_MUTEX_POOL_WAIT_FOREVER == *(const uint32_t*)context))
+    {
+        for (uint32_t i = 0U; i < CY_CONSOLE_LINE_BUFFERS; i++)
+        {
+            must_wait = must_wait && (0U == cy_atomic_load(&cy_console_lines[i].owner));
+        }
+    }
+    return must_wait;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_console_wake_drain
+//--------------------------------------------------------------------------------------------------
+// Wakes the draining task if it is parked; only tasks can wake it
+static void cy_console_wake_drain(void)
+{
+    cy_atomic_fence();
+    if ((0U != cy_atomic_load(&cy_console_sink_waiting)) &&
+        (0U != cy_atomic_exchange(&cy_console_sink_waiting, 0U)))
+    {
+        cy_mutex_pool_unpark_all(&cy_console_ring.tail);
+    }
+}
+
+
+#if defined(CY_CONSOLE_BLOCKING)
+//--------------------------------------------------------------------------------------------------
+// cy_console_writer_must_wait
+//--------------------------------------------------------------------------------------------------
+static bool cy_console_writer_must_wait(const void* context)
+{
+    return !cy_ring_has_room(&cy_console_ring, *(const size_t*)context);
+}
+
+
+#endif // defined(CY_CONSOLE_BLOCKING)
+#endif // defined(MUTEX_POOL_AVAILABLE)
+
+//--------------------------------------------------------------------------------------------------
+// cy_console_commit
+//--------------------------------------------------------------------------------------------------
+// Queues prefix followed by data as one record of at most CY_CONSOLE_RECORD_MAX bytes
+static void cy_console_commit(const uint8_t* prefix, size_t prefix_size, const uint8_t* data,
+                              size_t size)
+{
+    size_t    length   = prefix_size + size;
+    uintptr_t position = 0U;
+    bool      reserved = cy_ring_reserve(&cy_console_ring, length, &position);
+
+    #if defined(CY_CONSOLE_BLOCKING) && defined(MUTEX_POOL_AVAILABLE)
+    while (!reserved && cy_console_in_task() && (NULL != cy_console_sink))
+    {
+        (void)cy_atomic_add(&cy_console_waits, 1U);
+        (void)cy_atomic_exchange(&cy_console_space_waiting, 1U);
+        cy_mutex_pool_park(&cy_console_ring.head, cy_console_writer_must_wait, &length);
+        reserved = cy_ring_reserve(&cy_console_ring, length, &position);
+    }
+    #endif
+
+    if (reserved)
+    {
+        cy_ring_write(&cy_console_ring, position, 0U, prefix, prefix_size);
+        cy_ring_write(&cy_console_ring, position, prefix_size, data, size);
+        cy_ring_commit(&cy_console_ring, position, length);
+        (void)cy_atomic_add(&cy_console_written, (uintptr_t)length);
+        #if defined(MUTEX_POOL_AVAILABLE)
+        // Interrupt handlers cannot wake the draining task; it picks up their
+        // output with the next record queued by a task
+        if (cy_console_in_task())
+        {
+            cy_console_wake_drain();
+        }
+        #endif
+    }
+    else
+    {
+        (void)cy_atomic_add(&cy_console_dropped, (uintptr_t)length);
+        (void)cy_atomic_add(&cy_console_unreported, (uintptr_t)length);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_console_queue
+//--------------------------------------------------------------------------------------------------
+// Queues prefix followed by data, split into records as needed
+static void cy_console_queue(const uint8_t* prefix, size_t prefix_size, const uint8_t* data,
+                             size_t size)
+{
+    while ((prefix_size + size) > 0U)
+    {
+        size_t chunk = CY_CONSOLE_RECORD_MAX - prefix_size;
+        if (chunk > size)
+        {
+            chunk = size;
+        }
+        cy_console_commit(prefix, prefix_size, data, chunk);
+        prefix_size = 0U;
+        data        = &data[chunk];
+        size       -= chunk;
+    }
+}
+
+
+#if defined(MUTEX_POOL_AVAILABLE)
+//--------------------------------------------------------------------------------------------------
+// cy_console_find_line
+//--------------------------------------------------------------------------------------------------
+// Returns the line buffer of the calling task marked busy, NULL if it has none
+static cy_console_line_t* cy_console_find_line(uintptr_t self)
+{
+    cy_console_line_t* line = NULL;
+    for (uint32_t i = 0U; i < CY_CONSOLE_LINE_BUFFERS; i++)
+    {
+        // Fails if the draining task has just taken the line
+        if ((cy_atomic_load(&cy_console_lines[i].owner) == self) &&
+            cy_atomic_compare_exchange(&cy_console_lines[i].owner, self,
+                                       self | CY_CONSOLE_LINE_BUSY))
+        {
+            line = &cy_console_lines[i];
+            break;
+        }
+    }
+    return line;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_console_claim_line
+//--------------------------------------------------------------------------------------------------
+// Returns a free line buffer marked busy, NULL if there is none
+static cy_console_line_t* cy_console_claim_line(uintptr_t self)
+{
+    cy_console_line_t* line = NULL;
+    for (uint32_t i = 0U; i < CY_CONSOLE_LINE_BUFFERS; i++)
+    {
+        if (cy_atomic_compare_exchange(&cy_console_lines[i].owner, 0U,
+                                       self | CY_CONSOLE_LINE_BUSY))
+        {
+            line = &cy_console_lines[i];
+            cy_atomic_store(&line->length, 0U);
+            // The draining task ages the line from now on
+            cy_console_wake_drain();
+            break;
+        }
+    }
+    return line;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_console_finish_line
+//--------------------------------------------------------------------------------------------------
+// Queues the partial line followed by data and frees the line buffer
+static void cy_console_finish_line(cy_console_line_t* line, const uint8_t* data, size_t size)
+{
+    cy_console_queue(line->data, (size_t)line->length, data, size);
+    cy_atomic_store(&line->owner, 0U);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_console_age_lines
+//--------------------------------------------------------------------------------------------------
+// Passes partial lines that have not grown for CY_CONSOLE_LINE_TIMEOUT ticks
+// to the sink and frees their buffers; the caller has claimed the drain. A
+// line is only taken while its task is not adding to it. Returns the number of
+// bytes passed.
+static size_t cy_console_age_lines(cy_console_sink_t sink, void* context)
+{
+    size_t   drained = 0U;
+    bool     pending = false;
+    uint32_t now     = cy_console_ticks();
+
+    for (uint32_t i = 0U; i < CY_CONSOLE_LINE_BUFFERS; i++)
+    {
+        cy_console_line_t* line   = &cy_console_lines[i];
+        uintptr_t          owner  = cy_atomic_load(&line->owner);
+        uintptr_t          length = cy_atomic_load(&line->length);
+        if (0U == owner)
+        {
+            line->seen_owner = 0U;
+        }
+        else if ((owner != line->seen_owner) || (length != line->seen_length))
+        {
+            line->seen_owner  = owner;
+            line->seen_length = length;
+            line->seen_at     = now;
+            pending           = true;
+        }
+        else if (((now - line->seen_at) >= CY_CONSOLE_LINE_TIMEOUT) &&
+                 (0U == (owner & CY_CONSOLE_LINE_BUSY)) &&
+                 cy_atomic_compare_exchange(&line->owner, owner, CY_CONSOLE_LINE_TAKEN))
+        {
+            // The task may have added to the line after it was read above
+            length = cy_atomic_load(&line->length);
+            sink(context, line->data, (size_t)length);
+            drained         += (size_t)length;
+            line->seen_owner = 0U;
+            cy_atomic_store(&line->owner, 0U);
+        }
+        else
+        {
+            pending = true;
+        }
+    }
+    cy_atomic_store(&cy_console_lines_pending, pending ? 1U : 0U);
+    return drained;
+}
+
+
+#endif // defined(MUTEX_POOL_AVAILABLE)
+
+//--------------------------------------------------------------------------------------------------
+// cy_console_report_drops
+//--------------------------------------------------------------------------------------------------
+static void cy_console_report_drops(cy_console_sink_t sink, void* context, uintptr_t dropped)
+{
+    static const char prefix[] = "\n[console: ";
+    static const char suffix[] = " bytes dropped]\n";
+    char              digits[20];
+    size_t            start = sizeof(digits);
+    do
+    {
+        start--;
+        digits[start] = (char)('0' + (dropped % 10U));
+        dropped      /= 10U;
+    } while (0U != dropped);
+    sink(context, (const uint8_t*)prefix, sizeof(prefix) - 1U);
+    sink(context, (const uint8_t*)&digits[start], sizeof(digits) - start);
+    sink(context, (const uint8_t*)suffix, sizeof(suffix) - 1U);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_console_drain_ring
+//--------------------------------------------------------------------------------------------------
+// Passes the committed records to the sink; the caller has claimed the drain
+static size_t cy_console_drain_ring(void)
+{
+    size_t            drained = 0U;
+    cy_console_sink_t sink    = cy_console_sink;
+    void*             context = cy_console_sink_context;
+
+    if (NULL != sink)
+    {
+        const uint8_t* first;
+        size_t         first_size;
+        size_t         length;
+        uintptr_t      dropped = cy_atomic_exchange(&cy_console_unreported, 0U);
+        if (0U != dropped)
+        {
+            cy_console_report_drops(sink, context, dropped);
+        }
+        while (cy_ring_front(&cy_console_ring, &first, &first_size, &length))
+        {
+            sink(context, first, first_size);
+            if (first_size < length)
+            {
+                sink(context, (const uint8_t*)cy_console_storage, length - first_size);
+            }
+            cy_ring_pop(&cy_console_ring, length);
+            drained += length;
+            #if defined(MUTEX_POOL_AVAILABLE) && defined(CY_CONSOLE_BLOCKING)
+            cy_atomic_fence();
+            if ((0U != cy_atomic_load(&cy_console_space_waiting)) &&
+                (0U != cy_atomic_exchange(&cy_console_space_waiting, 0U)))
+            {
+                cy_mutex_pool_unpark_all(&cy_console_ring.head);
+            }
+            #endif
+        }
+        #if defined(MUTEX_POOL_AVAILABLE)
+        drained += cy_console_age_lines(sink, context);
+        #endif
+        (void)cy_atomic_add(&cy_console_drained, (uintptr_t)drained);
+    }
+    return drained;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_console_try_drain
+//--------------------------------------------------------------------------------------------------
+static size_t cy_console_try_drain(void)
+{
+    size_t drained = 0U;
+    if (cy_atomic_compare_exchange(&cy_console_draining, 0U, 1U))
+    {
+        drained = cy_console_drain_ring();
+        cy_atomic_store(&cy_console_draining, 0U);
+    }
+    return drained;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_console_set_sink
+//--------------------------------------------------------------------------------------------------
+void cy_console_set_sink(cy_console_sink_t sink, void* context)
+{
+    cy_console_sink_context = context;
+    cy_console_sink         = sink;
+    #if defined(MUTEX_POOL_AVAILABLE)
+    if (cy_console_in_task())
+    {
+        (void)cy_atomic_exchange(&cy_console_sink_waiting, 0U);
+        cy_mutex_pool_unpark_all(&cy_console_ring.tail);
+    }
+    else
+    #endif
+    {
+        (void)cy_console_try_drain();
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_console_write
+//--------------------------------------------------------------------------------------------------
+size_t cy_console_write(const void* data, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    #if defined(MUTEX_POOL_AVAILABLE)
+    if (cy_console_in_task())
+    {
+        uintptr_t          self = (uintptr_t)cy_mutex_pool_current_task();
+        cy_console_line_t* line = cy_console_find_line(self);
+        bool               byte = (1U == size) && ('\n' != bytes[0]);
+        if ((NULL == line) && byte)
+        {
+            line = cy_console_claim_line(self);
+        }
+        if (NULL == line)
+        {
+            cy_console_queue(NULL, 0U, bytes, size);
+        }
+        else if (byte)
+        {
+            uintptr_t length = line->length;
+            line->data[length] = bytes[0];
+            cy_atomic_store(&line->length, length + 1U);
+            if (CY_CONSOLE_LINE_SIZE == (length + 1U))
+            {
+                cy_console_finish_line(line, NULL, 0U);
+            }
+            else
+            {
+                cy_atomic_store(&line->owner, self);
+            }
+        }
+        else
+        {
+            cy_console_finish_line(line, bytes, size);
+        }
+    }
+    else
+    {
+        cy_console_queue(NULL, 0U, bytes, size);
+        if (!cy_mutex_pool_kernel_started())
+        {
+            // Nothing drains the console before the kernel starts
+            (void)cy_console_try_drain();
+        }
+    }
+    #else // if defined(MUTEX_POOL_AVAILABLE)
+    cy_console_queue(NULL, 0U, bytes, size);
+    #endif // if defined(MUTEX_POOL_AVAILABLE)
+    return size;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_console_drain
+//--------------------------------------------------------------------------------------------------
+size_t cy_console_drain(bool wait)
+{
+    size_t drained = cy_console_try_drain();
+    #if defined(MUTEX_POOL_AVAILABLE)
+    // The drain is not held while parked, so that cy_console_flush can run.
+    // While tasks have partial lines, it wakes up to age them.
+    while (wait && (0U == drained) && cy_console_in_task())
+    {
+        uint32_t timeout = (0U != cy_atomic_load(&cy_console_lines_pending))
+            ? CY_CONSOLE_LINE_CHECK
+            : CY_MUTEX_POOL_WAIT_FOREVER;
+        (void)cy_atomic_exchange(&cy_console_sink_waiting, 1U);
+        (void)cy_mutex_pool_park_timeout(&cy_console_ring.tail, cy_console_sink_must_wait,
+                                         &timeout, timeout);
+        drained = cy_console_try_drain();
+    }
+    #else
+    (void)wait;
+    #endif
+    return drained;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_console_flush
+//--------------------------------------------------------------------------------------------------
+void cy_console_flush(void)
+{
+    #if defined(MUTEX_POOL_AVAILABLE)
+    if (cy_console_in_task())
+    {
+        cy_console_line_t* line =
+            cy_console_find_line((uintptr_t)cy_mutex_pool_current_task());
+        if (NULL != line)
+        {
+            cy_console_finish_line(line, NULL, 0U);
+        }
+    }
+    #endif
+    (void)cy_console_try_drain();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_console_get_stats
+//--------------------------------------------------------------------------------------------------
+void cy_console_get_stats(cy_console_stats_t* stats)
+{
+    stats->written    = (uint32_t)cy_atomic_load(&cy_console_written);
+    stats->dropped    = (uint32_t)cy_atomic_load(&cy_console_dropped);
+    stats->drained    = (uint32_t)cy_atomic_load(&cy_console_drained);
+    stats->high_water = (uint32_t)cy_atomic_load(&cy_console_ring.high_water);
+    stats->waits      = (uint32_t)cy_atomic_load(&cy_console_waits);
+}
+
+
+#if defined(COMPONENT_POSIX)
+//--------------------------------------------------------------------------------------------------
+// cy_console_posix_sink
+//--------------------------------------------------------------------------------------------------
+void cy_console_posix_sink(void* context, const uint8_t* data, size_t size)
+{
+    int fd = (int)(intptr_t)context;
+    while (size > 0U)
+    {
+        ssize_t written = write(fd, data, size);
+        if (written <= 0)
+        {
+            break;
+        }
+        data  = &data[written];
+        size -= (size_t)written;
+    }
+}
+
+
+#elif defined(CY_CONSOLE_ITM_AVAILABLE)
+#define CY_CONSOLE_ITM_PORT(port)   (*(volatile uint32_t*)(0xE0000000UL + (4UL * (port))))
+#define CY_CONSOLE_ITM_TER          (*(volatile uint32_t*)0xE0000E00UL)
+#define CY_CONSOLE_ITM_TCR          (*(volatile uint32_t*)0xE0000E80UL)
+
+//--------------------------------------------------------------------------------------------------
+// cy_console_itm_sink
+//--------------------------------------------------------------------------------------------------
+void cy_console_itm_sink(void* context, const uint8_t* data, size_t size)
+{
+    uint32_t port = (uint32_t)(uintptr_t)context;
+    if ((0U != (CY_CONSOLE_ITM_TCR & 1U)) && (0U != (CY_CONSOLE_ITM_TER & (1UL << port))))
+    {
+        for (size_t i = 0U; i < size; i++)
+        {
+            while (0U == CY_CONSOLE_ITM_PORT(port))
+            {
+                // Wait until the stimulus port can take another byte
+            }
+            *(volatile uint8_t*)&CY_CONSOLE_ITM_PORT(port) = data[i];
+        }
+    }
+}
+
+
+#endif // if defined(COMPONENT_POSIX)
+
+#endif // defined(CY_CONSOLE)
@@ -0,0 +1,200 @@
+/***********************************************************************************************//**
+ * \file cy_critical_trace.c
+ *
+ * \brief
+ * Duration histograms of the critical sections opened by this library
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#if !defined (COMPONENT_CAT5)
+#include <cmsis_compiler.h>
+#endif
+#include "cy_critical_trace.h"
+#include "cy_clib_support_atomic.h"
+
+#if defined(CY_CRITICAL_TRACE)
+
+// Durations are measured from just after a section is entered to just before
+// it is left, so they are the time the library itself keeps interrupts masked
+// or the scheduler suspended. Recording happens inside the section and adds
+// its own (constant) cost to it. Sections on different cores, or on the host,
+// can finish at the same time, so the counters are updated atomically.
+//
+// The timestamp defaults to the DWT cycle counter on targets, which the
+// application must enable (DEMCR.TRCENA and DWT_CTRL.CYCCNTENA), and to
+// nanoseconds of CLOCK_MONOTONIC on hosts. ARMv6-M has no cycle counter, so
+// CY_CRITICAL_TRACE_TIMESTAMP() must be defined there.
+
+#ifndef CY_CRITICAL_TRACE_TIMESTAMP
+#if defined(COMPONENT_POSIX)
+#include <time.h>
+static inline uint32_t cy_critical_trace_clock(void)
+{
+    struct timespec now;
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)(((uint64_t)now.tv_sec * 1000000000U) + (uint64_t)now.tv_nsec);
+}
+
+
+#define CY_CRITICAL_TRACE_TIMESTAMP()   cy_critical_trace_clock()
+#elif defined(__ARM_ARCH_6M__) || \
+    (defined(__ARM_ARCH) && (__ARM_ARCH == 6) && defined(__ARM_ARCH_PROFILE) && \
+    (__ARM_ARCH_PROFILE == 'M'))
+#error "Define CY_CRITICAL_TRACE_TIMESTAMP() to a free-running counter on ARMv6-M"
+#else
+#define CY_CRITICAL_TRACE_TIMESTAMP()   (*(volatile uint32_t*)0xE0001004UL)  // DWT_CYCCNT
+#endif // if defined(COMPONENT_POSIX)
+#endif // ifndef CY_CRITICAL_TRACE_TIMESTAMP
+
+typedef struct
+{
+    volatile uintptr_t count;
+    volatile uintptr_t max;
+    void* volatile     max_caller;
+    volatile uintptr_t histogram[CY_CRITICAL_TRACE_BUCKETS];
+} cy_critical_trace_slot_t;
+
+static cy_critical_trace_slot_t cy_critical_trace_slot[CY_CRITICAL_TRACE_SITE_COUNT];
+
+static const char* const cy_critical_trace_names[CY_CRITICAL_TRACE_SITE_COUNT] =
+{
+    "pool create",
+    "pool destroy",
+    "park",
+    "unpark",
+    "suspend threads",
+};
+
+// cy_mutex_pool_suspend_threads nests; only the outermost region is recorded.
+// No other task runs while the scheduler is suspended, so these need no lock.
+static uint32_t cy_critical_trace_suspend_depth = 0U;
+static uint32_t cy_critical_trace_suspend_start = 0U;
+static void*    cy_critical_trace_suspend_caller = NULL;
+
+//--------------------------------------------------------------------------------------------------
+// cy_critical_trace_timestamp
+//--------------------------------------------------------------------------------------------------
+uint32_t cy_critical_trace_timestamp(void)
+{
+    return CY_CRITICAL_TRACE_TIMESTAMP();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_critical_trace_record
+//--------------------------------------------------------------------------------------------------
+void cy_critical_trace_record(cy_critical_trace_site_t site, uint32_t start, void* caller)
+{
+    cy_critical_trace_slot_t* slot     = &cy_critical_trace_slot[site];
+    uint32_t                  duration = CY_CRITICAL_TRACE_TIMESTAMP() - start;
+    uint32_t                  bucket   = 32U - __CLZ(duration);
+    uintptr_t                 max;
+
+    if (bucket >= CY_CRITICAL_TRACE_BUCKETS)
+    {
+        bucket = CY_CRITICAL_TRACE_BUCKETS - 1U;
+    }
+    (void)cy_atomic_add(&slot->count, 1U);
+    (void)cy_atomic_add(&slot->histogram[bucket], 1U);
+
+    max = cy_atomic_load(&slot->max);
+    while (duration > max)
+    {
+        if (cy_atomic_compare_exchange(&slot->max, max, duration))
+        {
+            slot->max_caller = caller;
+            break;
+        }
+        max = cy_atomic_load(&slot->max);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_critical_trace_suspend_begin
+//--------------------------------------------------------------------------------------------------
+void cy_critical_trace_suspend_begin(void* caller)
+{
+    if (0U == cy_critical_trace_suspend_depth)
+    {
+        cy_critical_trace_suspend_caller = caller;
+        cy_critical_trace_suspend_start  = CY_CRITICAL_TRACE_TIMESTAMP();
+    }
+    cy_critical_trace_suspend_depth++;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_critical_trace_suspend_end
+//--------------------------------------------------------------------------------------------------
+void cy_critical_trace_suspend_end(void)
+{
+    if (cy_critical_trace_suspend_depth > 0U)
+    {
+        cy_critical_trace_suspend_depth--;
+        if (0U == cy_critical_trace_suspend_depth)
+        {
+            cy_critical_trace_record(CY_CRITICAL_TRACE_SUSPEND_THREADS,
+                                     cy_critical_trace_suspend_start,
+                                     cy_critical_trace_suspend_caller);
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_critical_trace_get
+//--------------------------------------------------------------------------------------------------
+void cy_critical_trace_get(cy_critical_trace_site_t site, cy_critical_trace_stats_t* stats)
+{
+    cy_critical_trace_slot_t* slot = &cy_critical_trace_slot[site];
+    stats->count      = (uint32_t)cy_atomic_load(&slot->count);
+    stats->max        = (uint32_t)cy_atomic_load(&slot->max);
+    stats->max_caller = slot->max_caller;
+    for (uint32_t i = 0U; i < CY_CRITICAL_TRACE_BUCKETS; i++)
+    {
+        stats->histogram[i] = (uint32_t)cy_atomic_load(&slot->histogram[i]);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_critical_trace_site_name
+//--------------------------------------------------------------------------------------------------
+const char* cy_critical_trace_site_name(cy_critical_trace_site_t site)
+{
+    return (site < CY_CRITICAL_TRACE_SITE_COUNT) ? cy_critical_trace_names[site] : "unknown";
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_critical_trace_reset
+//--------------------------------------------------------------------------------------------------
+void cy_critical_trace_reset(void)
+{
+    memset((void*)cy_critical_trace_slot, 0, sizeof(cy_critical_trace_slot));
+}
+
+
+#endif // defined(CY_CRITICAL_TRACE)
@@ -0,0 +1,199 @@
+/***********************************************************************************************//**
+ * \file cy_cxa_guard.c
+ *
+ * \brief
+ * Thread safe guards for the initialization of function-local statics
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#include <stdbool.h>
+#include <stdint.h>
+#if !defined (COMPONENT_CAT5)
+#include <cmsis_compiler.h>
+#endif
+#include "cy_clib_support_atomic.h"
+#include "cy_mutex_pool.h"
+
+// The IAR library provides its own guards
+#if !defined(__ICCARM__)
+
+#if defined(COMPONENT_FREERTOS) && ((configUSE_MUTEXES == 0) || \
+    (configUSE_RECURSIVE_MUTEXES == 0) || (configSUPPORT_STATIC_ALLOCATION == 0))
+// The toolchain port reports the unsupported configuration
+#else
+
+// The __cxa_guard_acquire, __cxa_guard_release, and __cxa_guard_abort
+// functions ensure that constructors for static local variables are
+// executed exactly once. For more information, see:
+// https://itanium-cxx-abi.github.io/cxx-abi/abi.html#obj-ctor
+//
+// Each guard keeps its own state in the guard word, so statics that are
+// initialized at the same time by different tasks do not wait for each other.
+// The first byte is the "initialized" flag tested by compiler generated code
+// (bit 0 for the ARM EABI); the second byte records that a constructor is
+// running and whether other tasks are waiting for it. Waiting tasks park on
+// the guard address and are woken when the constructor finishes or throws.
+// Once the flag is set, acquire costs a single load with acquire ordering.
+
+#define CY_CXA_GUARD_INITIALIZED    ((uintptr_t)0x001U)
+#define CY_CXA_GUARD_PENDING        ((uintptr_t)0x100U)
+#define CY_CXA_GUARD_WAITERS        ((uintptr_t)0x200U)
+
+#if defined(MUTEX_POOL_AVAILABLE)
+//--------------------------------------------------------------------------------------------------
+// cy_cxa_guard_must_wait
+//--------------------------------------------------------------------------------------------------
+static bool cy_cxa_guard_must_wait(const void* context)
+{
+    uintptr_t value = cy_atomic_load((volatile uintptr_t*)context);
+    return ((0U == (value & CY_CXA_GUARD_INITIALIZED)) && (0U != (value & CY_CXA_GUARD_WAITERS)));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// __cxa_guard_acquire
+//--------------------------------------------------------------------------------------------------
+int __cxa_guard_acquire(volatile uintptr_t* guard_object)
+{
+    int       acquired = 0;
+    uintptr_t value    = cy_atomic_load(guard_object);
+
+    while ((0 == acquired) && (0U == (value & CY_CXA_GUARD_INITIALIZED)))
+    {
+        if (0U == (value & CY_CXA_GUARD_PENDING))
+        {
+            if (cy_atomic_compare_exchange(guard_object, value, value | CY_CXA_GUARD_PENDING))
+            {
+                acquired = 1;
+            }
+        }
+        else if ((0U != (value & CY_CXA_GUARD_WAITERS)) ||
+                 cy_atomic_compare_exchange(guard_object, value, value | CY_CXA_GUARD_WAITERS))
+        {
+            // A task initializing the same static again would wait for itself
+            cy_mutex_pool_park(guard_object, cy_cxa_guard_must_wait, (const void*)guard_object);
+        }
+        else
+        {
+            // The guard changed meanwhile, look at it again
+        }
+        value = cy_atomic_load(guard_object);
+    }
+    return acquired;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_cxa_guard_finish
+//--------------------------------------------------------------------------------------------------
+static void cy_cxa_guard_finish(volatile uintptr_t* guard_object, uintptr_t value)
+{
+    uintptr_t previous = cy_atomic_exchange(guard_object, value);
+    #ifndef NDEBUG
+    if (0U == (previous & CY_CXA_GUARD_PENDING))
+    {
+        __BKPT(0);  // __cxa_guard_release/abort called when not acquired
+    }
+    #endif
+    if (0U != (previous & CY_CXA_GUARD_WAITERS))
+    {
+        cy_mutex_pool_unpark_all(guard_object);
+    }
+}
+
+
+#else // if defined(MUTEX_POOL_AVAILABLE)
+
+// Without the mutex pool, other tasks are kept from running while a
+// constructor runs.
+
+//--------------------------------------------------------------------------------------------------
+// __cxa_guard_acquire
+//--------------------------------------------------------------------------------------------------
+int __cxa_guard_acquire(volatile uintptr_t* guard_object)
+{
+    int acquired = 0;
+    if (0U == (cy_atomic_load(guard_object) & CY_CXA_GUARD_INITIALIZED))
+    {
+        cy_mutex_pool_suspend_threads();
+        if (0U == (cy_atomic_load(guard_object) & CY_CXA_GUARD_INITIALIZED))
+        {
+            acquired = 1;
+            #ifndef NDEBUG
+            if (0U != (*guard_object & CY_CXA_GUARD_PENDING))
+            {
+                __BKPT(0);  // acquire called again without release/abort
+            }
+            #endif
+            *guard_object |= CY_CXA_GUARD_PENDING;
+        }
+        else
+        {
+            cy_mutex_pool_resume_threads();
+        }
+    }
+    return acquired;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_cxa_guard_finish
+//--------------------------------------------------------------------------------------------------
+static void cy_cxa_guard_finish(volatile uintptr_t* guard_object, uintptr_t value)
+{
+    if (0U != (*guard_object & CY_CXA_GUARD_PENDING))
+    {
+        cy_atomic_store(guard_object, value);
+        cy_mutex_pool_resume_threads();
+    }
+    #ifndef NDEBUG
+    else
+    {
+        __BKPT(0);  // __cxa_guard_release/abort called when not acquired
+    }
+    #endif
+}
+
+
+#endif // if defined(MUTEX_POOL_AVAILABLE)
+
+//--------------------------------------------------------------------------------------------------
+// __cxa_guard_abort
+//--------------------------------------------------------------------------------------------------
+void __cxa_guard_abort(volatile uintptr_t* guard_object)
+{
+    cy_cxa_guard_finish(guard_object, 0U);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// __cxa_guard_release
+//--------------------------------------------------------------------------------------------------
+void __cxa_guard_release(volatile uintptr_t* guard_object)
+{
+    cy_cxa_guard_finish(guard_object, CY_CXA_GUARD_INITIALIZED);
+}
+
+
+#endif \
+    // defined(COMPONENT_FREERTOS) && (configUSE_MUTEXES == 0 ||
+    //     configUSE_RECURSIVE_MUTEXES == 0 || configSUPPORT_STATIC_ALLOCATION == 0)
+#endif // !defined(__ICCARM__)
@@ -0,0 +1,319 @@
+/***********************************************************************************************//**
+ * \file cy_log.c
+ *
+ * \brief
+ * Binary logging: log records are queued in a lock-free ring buffer and sent
+ * to a sink, framed for tools/cy_log_decode.py, by a low-priority task
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "cy_log.h"
+#include "cy_time.h"
+#include "cy_clib_support_atomic.h"
+#include "cy_clib_support_ring.h"
+
+#if defined(CY_LOG_ENABLED)
+
+// A log record is packed, little-endian on the usual targets, as:
+//     format string address   (pointer size of the target)
+//     timestamp               (int64, microseconds)
+//     argument kinds          (uint32: count in bits 0-3, then 2 bits per argument)
+//     arguments               (4 bytes for CY_LOG_ARG_WORD, 8 bytes for
+//                              CY_LOG_ARG_INT64 and CY_LOG_ARG_DOUBLE, a
+//                              length byte and the characters for strings)
+// Recording packs the arguments and copies them into the ring buffer; no
+// formatting is done on the device. The drain sends each record COBS-encoded
+// and followed by a zero byte, so that the decoder can find the start of the
+// next record after lost bytes. A record with a NULL format address and one
+// CY_LOG_ARG_WORD argument reports the number of records dropped before it.
+// The layout is shared with tools/cy_log_decode.py.
+
+#if ((CY_LOG_RING_SIZE & (CY_LOG_RING_SIZE - 1U)) != 0U)
+#error CY_LOG_RING_SIZE must be a power of two
+#endif
+
+#if (CY_LOG_STRING_MAX > 255U)
+#error CY_LOG_STRING_MAX must not exceed 255
+#endif
+
+#define CY_LOG_HEADER_SIZE  (sizeof(uintptr_t) + sizeof(int64_t) + sizeof(uint32_t))
+#define CY_LOG_RECORD_MAX \
+    (CY_LOG_HEADER_SIZE + (CY_LOG_ARGS_MAX * (1U + CY_LOG_STRING_MAX + sizeof(uint64_t))))
+
+// Timestamp of a record in microseconds. Defaults to the realtime clock of the
+// RTC time support as of its last resync, or the monotonic clock before the
+// first one. Recording never reads the RTC or waits for cy_timer_mutex.
+#ifndef CY_LOG_TIMESTAMP
+#if defined(_MTB_CLIB_SUPPORT_RTC_AVAILABLE)
+static inline int64_t cy_log_clock(void)
+{
+    return mtb_clib_support_timestamp_us();
+}
+
+
+#define CY_LOG_TIMESTAMP()  cy_log_clock()
+#elif defined(COMPONENT_POSIX)
+#include <time.h>
+static inline int64_t cy_log_clock(void)
+{
+    struct timespec now;
+    (void)clock_gettime(CLOCK_REALTIME, &now);
+    return ((int64_t)now.tv_sec * 1000000) + ((int64_t)now.tv_nsec / 1000);
+}
+
+
+#define CY_LOG_TIMESTAMP()  cy_log_clock()
+#else
+#define CY_LOG_TIMESTAMP()  (0)
+#endif // if defined(_MTB_CLIB_SUPPORT_RTC_AVAILABLE)
+#endif // ifndef CY_LOG_TIMESTAMP
+
+static uintptr_t cy_log_storage[CY_LOG_RING_SIZE / sizeof(uintptr_t)];
+static cy_ring_t cy_log_ring = { cy_log_storage, CY_LOG_RING_SIZE, 0U, 0U, 0U };
+
+// Set while a task passes records to the sink
+static volatile uintptr_t cy_log_draining = 0U;
+// Dropped records not yet reported through the sink
+static volatile uintptr_t cy_log_unreported = 0U;
+
+static cy_log_sink_t cy_log_sink         = NULL;
+static void*         cy_log_sink_context = NULL;
+
+static volatile uintptr_t cy_log_recorded = 0U;
+static volatile uintptr_t cy_log_dropped  = 0U;
+
+//--------------------------------------------------------------------------------------------------
+// cy_log_string_size
+//--------------------------------------------------------------------------------------------------
+static size_t cy_log_string_size(const char* string)
+{
+    size_t size = 0U;
+    if (NULL != string)
+    {
+        while ((size < CY_LOG_STRING_MAX) && ('\0' != string[size]))
+        {
+            size++;
+        }
+    }
+    return size;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_log_put
+//--------------------------------------------------------------------------------------------------
+// Copies size bytes to *offset bytes into a record, which is at direct if it does not wrap around
+// the end of the ring buffer, and otherwise at position in the ring buffer
+static inline void cy_log_put(uint8_t* direct, uintptr_t position, size_t* offset,
+                              const void* data, size_t size)
+{
+    if (NULL != direct)
+    {
+        (void)memcpy(&direct[*offset], data, size);
+    }
+    else
+    {
+        cy_ring_write(&cy_log_ring, position, *offset, data, size);
+    }
+    *offset += size;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_log_pack
+//--------------------------------------------------------------------------------------------------
+static void cy_log_pack(uint8_t* direct, uintptr_t position, const char* format,
+                        int64_t timestamp, uint32_t kinds, const cy_log_arg_t* args,
+                        uint32_t count)
+{
+    uintptr_t address = (uintptr_t)format;
+    size_t    offset  = 0U;
+
+    cy_log_put(direct, position, &offset, &address, sizeof(address));
+    cy_log_put(direct, position, &offset, &timestamp, sizeof(timestamp));
+    cy_log_put(direct, position, &offset, &kinds, sizeof(kinds));
+    for (uint32_t i = 0U; i < count; i++)
+    {
+        if (CY_LOG_ARG_WORD == args[i].kind)
+        {
+            uint32_t word = (uint32_t)args[i].value;
+            cy_log_put(direct, position, &offset, &word, sizeof(word));
+        }
+        else if (CY_LOG_ARG_STRING == args[i].kind)
+        {
+            const char* string = (const char*)(uintptr_t)args[i].value;
+            uint8_t     size   = (uint8_t)cy_log_string_size(string);
+            cy_log_put(direct, position, &offset, &size, sizeof(size));
+            cy_log_put(direct, position, &offset, string, size);
+        }
+        else
+        {
+            cy_log_put(direct, position, &offset, &args[i].value, sizeof(args[i].value));
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_log_record
+//--------------------------------------------------------------------------------------------------
+void cy_log_record(const char* format, const cy_log_arg_t* args, uint32_t count)
+{
+    int64_t   timestamp = CY_LOG_TIMESTAMP();
+    uint32_t  kinds     = count;
+    size_t    length    = CY_LOG_HEADER_SIZE;
+    uintptr_t position;
+
+    for (uint32_t i = 0U; i < count; i++)
+    {
+        kinds |= (uint32_t)args[i].kind << (4U + (2U * i));
+        if (CY_LOG_ARG_WORD == args[i].kind)
+        {
+            length += sizeof(uint32_t);
+        }
+        else if (CY_LOG_ARG_STRING == args[i].kind)
+        {
+            length += 1U + cy_log_string_size((const char*)(uintptr_t)args[i].value);
+        }
+        else
+        {
+            length += sizeof(uint64_t);
+        }
+    }
+
+    // The record is written straight into the ring buffer, so that callers,
+    // including interrupt handlers, need no stack for a copy of it
+    if (cy_ring_reserve(&cy_log_ring, length, &position))
+    {
+        size_t   index  = (size_t)((position + CY_RING_WORD) & (CY_LOG_RING_SIZE - 1U));
+        uint8_t* direct = NULL;
+        if ((index + length) <= CY_LOG_RING_SIZE)
+        {
+            direct = &((uint8_t*)cy_log_storage)[index];
+        }
+        cy_log_pack(direct, position, format, timestamp, kinds, args, count);
+        cy_ring_commit(&cy_log_ring, position, length);
+        (void)cy_atomic_add(&cy_log_recorded, 1U);
+    }
+    else
+    {
+        (void)cy_atomic_add(&cy_log_dropped, 1U);
+        (void)cy_atomic_add(&cy_log_unreported, 1U);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_log_send
+//--------------------------------------------------------------------------------------------------
+// Sends a record COBS-encoded and followed by a zero byte
+static void cy_log_send(cy_log_sink_t sink, void* context, const uint8_t* record, size_t length)
+{
+    static uint8_t frame[CY_LOG_RECORD_MAX + (CY_LOG_RECORD_MAX / 254U) + 2U];
+    size_t         code_index = 0U;
+    size_t         size       = 1U;
+    uint8_t        code       = 1U;
+
+    for (size_t i = 0U; i < length; i++)
+    {
+        if (0U != record[i])
+        {
+            frame[size] = record[i];
+            size++;
+            code++;
+        }
+        if ((0U == record[i]) || (0xFFU == code))
+        {
+            frame[code_index] = code;
+            code_index        = size;
+            size++;
+            code = 1U;
+        }
+    }
+    frame[code_index] = code;
+    frame[size]       = 0U;
+    sink(context, frame, size + 1U);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_log_set_sink
+//--------------------------------------------------------------------------------------------------
+void cy_log_set_sink(cy_log_sink_t sink, void* context)
+{
+    cy_log_sink_context = context;
+    cy_log_sink         = sink;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_log_drain
+//--------------------------------------------------------------------------------------------------
+size_t cy_log_drain(void)
+{
+    size_t        drained = 0U;
+    cy_log_sink_t sink    = cy_log_sink;
+    void*         context = cy_log_sink_context;
+
+    if ((NULL != sink) && cy_atomic_compare_exchange(&cy_log_draining, 0U, 1U))
+    {
+        static uint8_t record[CY_LOG_RECORD_MAX];
+        const uint8_t* first;
+        size_t         first_size;
+        size_t         length;
+        uintptr_t      dropped = cy_atomic_exchange(&cy_log_unreported, 0U);
+        if (0U != dropped)
+        {
+            cy_log_arg_t arg   = cy_log_arg_word((uint32_t)dropped);
+            uint32_t     kinds = 1U | ((uint32_t)CY_LOG_ARG_WORD << 4U);
+            cy_log_pack(record, 0U, NULL, CY_LOG_TIMESTAMP(), kinds, &arg, 1U);
+            cy_log_send(sink, context, record, CY_LOG_HEADER_SIZE + sizeof(uint32_t));
+        }
+        while (cy_ring_front(&cy_log_ring, &first, &first_size, &length))
+        {
+            (void)memcpy(record, first, first_size);
+            (void)memcpy(&record[first_size], cy_log_storage, length - first_size);
+            cy_ring_pop(&cy_log_ring, length);
+            cy_log_send(sink, context, record, length);
+            drained++;
+        }
+        cy_atomic_store(&cy_log_draining, 0U);
+    }
+    return drained;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_log_get_stats
+//--------------------------------------------------------------------------------------------------
+void cy_log_get_stats(cy_log_stats_t* stats)
+{
+    stats->recorded   = (uint32_t)cy_atomic_load(&cy_log_recorded);
+    stats->dropped    = (uint32_t)cy_atomic_load(&cy_log_dropped);
+    stats->high_water = (uint32_t)cy_atomic_load(&cy_log_ring.high_water);
+}
+
+
+#endif // defined(CY_LOG_ENABLED)
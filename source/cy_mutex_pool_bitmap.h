@@ -0,0 +1,93 @@
+/***********************************************************************************************//**
+ * \file cy_mutex_pool_bitmap.h
+ *
+ * \brief
+ * Internal free-slot bitmap shared by the mutex pool backends
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#if !defined (COMPONENT_CAT5)
+#include <cmsis_compiler.h>
+#endif
+#include "cy_mutex_pool_cfg.h"
+
+// Tracks which pool slots are in use so that create and destroy run in
+// constant time, whatever CY_STATIC_MUTEX_MAX is. Slot i is bit (31 - i % 32)
+// of used[i / 32], so count-leading-zeros of the inverted word yields the
+// lowest free slot. Bit (31 - w) of full is set while used[w] has no free slot,
+// so finding a word with a free slot is a single count-leading-zeros as well.
+// An all-zero bitmap is an empty pool, so zero-initialized static storage
+// needs no further setup.
+
+#define CY_MUTEX_POOL_BITMAP_WORDS  (((CY_STATIC_MUTEX_MAX) + 31U) / 32U)
+
+#if (CY_MUTEX_POOL_BITMAP_WORDS > 32U)
+#error "CY_STATIC_MUTEX_MAX must not exceed 1024"
+#endif
+
+#define CY_MUTEX_POOL_CLZ(value)    ((uint32_t)__CLZ(value))
+
+typedef struct
+{
+    uint32_t full;
+    uint32_t used[CY_MUTEX_POOL_BITMAP_WORDS];
+} cy_mutex_pool_bitmap_t;
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_bitmap_alloc
+//--------------------------------------------------------------------------------------------------
+// Marks the lowest free slot as used and returns its index, or -1 if the pool
+// is exhausted. The caller must provide mutual exclusion.
+static inline int32_t cy_mutex_pool_bitmap_alloc(cy_mutex_pool_bitmap_t* bitmap)
+{
+    int32_t  index = -1;
+    uint32_t word  = CY_MUTEX_POOL_CLZ(~bitmap->full);
+    if (word < CY_MUTEX_POOL_BITMAP_WORDS)
+    {
+        uint32_t bit  = CY_MUTEX_POOL_CLZ(~bitmap->used[word]);
+        uint32_t slot = (word * 32U) + bit;
+        if (slot < (uint32_t)(CY_STATIC_MUTEX_MAX))
+        {
+            bitmap->used[word] |= (0x80000000U >> bit);
+            if (0xFFFFFFFFU == bitmap->used[word])
+            {
+                bitmap->full |= (0x80000000U >> word);
+            }
+            index = (int32_t)slot;
+        }
+    }
+    return index;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_bitmap_free
+//--------------------------------------------------------------------------------------------------
+// Marks a slot as free again. The caller must provide mutual exclusion.
+static inline void cy_mutex_pool_bitmap_free(cy_mutex_pool_bitmap_t* bitmap, uint32_t index)
+{
+    uint32_t word = index / 32U;
+    bitmap->used[word] &= ~(0x80000000U >> (index % 32U));
+    bitmap->full       &= ~(0x80000000U >> word);
+}
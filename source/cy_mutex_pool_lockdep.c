@@ -0,0 +1,378 @@
+/***********************************************************************************************//**
+ * \file cy_mutex_pool_lockdep.c
+ *
+ * \brief
+ * Runtime lock-order checker for the mutex pool
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "cy_mutex_pool.h"
+#include "cy_mutex_pool_cfg.h"
+#include "cy_mutex_pool_lockdep.h"
+#include "cy_clib_support_atomic.h"
+
+#if defined(MUTEX_POOL_AVAILABLE) && defined(CY_MUTEX_POOL_LOCKDEP)
+
+// Every time a task waits for a pool mutex while holding others, the order
+// "held before acquired" is added to a global graph over the pool slots. A new
+// order a -> b that closes a cycle (b already reaches a, directly or through
+// other slots) means two tasks can each hold a mutex the other waits for, so it
+// is reported before the task blocks. Known orders cost one bit test each, so
+// only the first acquisition of a pair in a given order does any real work.
+//
+// The graph is updated with atomic operations and needs no lock of its own.
+// The mutexes held by a task live in a small table that is only touched by
+// that task, and an entry is given up as soon as the task holds nothing, so
+// the table only needs room for the tasks holding pool mutexes at once.
+// Acquires that do not wait (cy_mutex_pool_try_acquire) cannot deadlock and do
+// not add orders, but the mutexes they take still count as held.
+
+#ifndef CY_MUTEX_POOL_LOCKDEP_TASKS
+#define CY_MUTEX_POOL_LOCKDEP_TASKS     (8U)
+#endif
+
+#ifndef CY_MUTEX_POOL_LOCKDEP_DEPTH
+#define CY_MUTEX_POOL_LOCKDEP_DEPTH     (8U)
+#endif
+
+// Number of orders remembered together with the task that first took them,
+// which is only used to name the other task in reports.
+#ifndef CY_MUTEX_POOL_LOCKDEP_EDGES
+#define CY_MUTEX_POOL_LOCKDEP_EDGES     (32U)
+#endif
+
+#define CY_LOCKDEP_WORD_BITS    ((uint32_t)(8U * sizeof(uintptr_t)))
+#define CY_LOCKDEP_WORDS        \
+    (((uint32_t)(CY_STATIC_MUTEX_MAX) + CY_LOCKDEP_WORD_BITS - 1U) / CY_LOCKDEP_WORD_BITS)
+#define CY_LOCKDEP_WORD(slot)   ((slot) / CY_LOCKDEP_WORD_BITS)
+#define CY_LOCKDEP_MASK(slot)   ((uintptr_t)1U << ((slot) % CY_LOCKDEP_WORD_BITS))
+
+typedef struct
+{
+    volatile uintptr_t task;    // Owning task, 0 if the entry is free
+    uint32_t           depth;   // Number of mutexes held, including recursive acquires
+    uint16_t           held[CY_MUTEX_POOL_LOCKDEP_DEPTH];
+} cy_lockdep_task_t;
+
+typedef struct
+{
+    volatile uintptr_t valid;
+    uint16_t           from;
+    uint16_t           to;
+    char               task[CY_MUTEX_POOL_LOCKDEP_NAME_LEN];
+} cy_lockdep_edge_t;
+
+// Bit b of cy_lockdep_order[a] is set once a task waited for slot b while
+// holding slot a.
+static volatile uintptr_t   cy_lockdep_order[CY_STATIC_MUTEX_MAX][CY_LOCKDEP_WORDS];
+static cy_mutex_pool_role_t cy_lockdep_role[CY_STATIC_MUTEX_MAX];
+static cy_lockdep_task_t    cy_lockdep_tasks[CY_MUTEX_POOL_LOCKDEP_TASKS];
+static cy_lockdep_edge_t    cy_lockdep_edges[CY_MUTEX_POOL_LOCKDEP_EDGES];
+static volatile uintptr_t   cy_lockdep_edge_count = 0U;
+
+//--------------------------------------------------------------------------------------------------
+// cy_lockdep_find_task
+//--------------------------------------------------------------------------------------------------
+// Returns the entry of the calling task, claiming a free one if claim is set.
+// NULL if the task has no entry (or the table is full).
+static cy_lockdep_task_t* cy_lockdep_find_task(bool claim)
+{
+    uintptr_t          self  = (uintptr_t)cy_mutex_pool_current_task();
+    cy_lockdep_task_t* entry = NULL;
+    for (uint32_t i = 0U; (i < CY_MUTEX_POOL_LOCKDEP_TASKS) && (NULL == entry); i++)
+    {
+        if (cy_atomic_load(&cy_lockdep_tasks[i].task) == self)
+        {
+            entry = &cy_lockdep_tasks[i];
+        }
+    }
+    for (uint32_t i = 0U; claim && (i < CY_MUTEX_POOL_LOCKDEP_TASKS) && (NULL == entry); i++)
+    {
+        if (cy_atomic_compare_exchange(&cy_lockdep_tasks[i].task, 0U, self))
+        {
+            entry        = &cy_lockdep_tasks[i];
+            entry->depth = 0U;
+        }
+    }
+    return entry;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_lockdep_holds
+//--------------------------------------------------------------------------------------------------
+static bool cy_lockdep_holds(const cy_lockdep_task_t* entry, uint32_t slot)
+{
+    bool     holds = false;
+    uint32_t count = (entry->depth < CY_MUTEX_POOL_LOCKDEP_DEPTH) ?
+                     entry->depth : CY_MUTEX_POOL_LOCKDEP_DEPTH;
+    for (uint32_t i = 0U; (i < count) && !holds; i++)
+    {
+        holds = (entry->held[i] == slot);
+    }
+    return holds;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_lockdep_add_order
+//--------------------------------------------------------------------------------------------------
+// Records from -> to and returns true if it was not known yet.
+static bool cy_lockdep_add_order(uint32_t from, uint32_t to)
+{
+    volatile uintptr_t* word  = &cy_lockdep_order[from][CY_LOCKDEP_WORD(to)];
+    uintptr_t           mask  = CY_LOCKDEP_MASK(to);
+    uintptr_t           value = cy_atomic_load(word);
+    bool                added = false;
+    while (!added && (0U == (value & mask)))
+    {
+        added = cy_atomic_compare_exchange(word, value, value | mask);
+        value = cy_atomic_load(word);
+    }
+    return added;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_lockdep_find_path
+//--------------------------------------------------------------------------------------------------
+// Breadth-first search for a path from -> ... -> to. On success *via is the
+// last slot on the path before to.
+static bool cy_lockdep_find_path(uint32_t from, uint32_t to, uint32_t* via)
+{
+    uintptr_t visited[CY_LOCKDEP_WORDS];
+    uintptr_t frontier[CY_LOCKDEP_WORDS];
+    uintptr_t next[CY_LOCKDEP_WORDS];
+    bool      found = false;
+    bool      more  = true;
+
+    (void)memset(visited, 0, sizeof(visited));
+    (void)memset(frontier, 0, sizeof(frontier));
+    visited[CY_LOCKDEP_WORD(from)]  = CY_LOCKDEP_MASK(from);
+    frontier[CY_LOCKDEP_WORD(from)] = CY_LOCKDEP_MASK(from);
+    while (more && !found)
+    {
+        (void)memset(next, 0, sizeof(next));
+        for (uint32_t slot = 0U; (slot < (uint32_t)(CY_STATIC_MUTEX_MAX)) && !found; slot++)
+        {
+            if (0U != (frontier[CY_LOCKDEP_WORD(slot)] & CY_LOCKDEP_MASK(slot)))
+            {
+                if (0U != (cy_atomic_load(&cy_lockdep_order[slot][CY_LOCKDEP_WORD(to)]) &
+                           CY_LOCKDEP_MASK(to)))
+                {
+                    *via  = slot;
+                    found = true;
+                }
+                for (uint32_t w = 0U; w < CY_LOCKDEP_WORDS; w++)
+                {
+                    next[w] |= cy_atomic_load(&cy_lockdep_order[slot][w]) & ~visited[w];
+                }
+            }
+        }
+        more = false;
+        for (uint32_t w = 0U; w < CY_LOCKDEP_WORDS; w++)
+        {
+            visited[w] |= next[w];
+            frontier[w] = next[w];
+            more        = more || (0U != next[w]);
+        }
+    }
+    return found;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_lockdep_remember
+//--------------------------------------------------------------------------------------------------
+static void cy_lockdep_remember(uint32_t from, uint32_t to)
+{
+    uintptr_t index = cy_atomic_add(&cy_lockdep_edge_count, 1U) - 1U;
+    if (index < CY_MUTEX_POOL_LOCKDEP_EDGES)
+    {
+        cy_lockdep_edge_t* edge = &cy_lockdep_edges[index];
+        edge->from = (uint16_t)from;
+        edge->to   = (uint16_t)to;
+        cy_mutex_pool_task_name(cy_mutex_pool_current_task(), edge->task, sizeof(edge->task));
+        cy_atomic_store(&edge->valid, 1U);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_lockdep_report
+//--------------------------------------------------------------------------------------------------
+static void cy_lockdep_report(uint32_t held, uint32_t acquiring, uint32_t via)
+{
+    cy_mutex_pool_lockdep_report_t report;
+
+    (void)memset(&report, 0, sizeof(report));
+    report.held_slot      = held;
+    report.held_role      = cy_lockdep_role[held];
+    report.acquiring_slot = acquiring;
+    report.acquiring_role = cy_lockdep_role[acquiring];
+    report.via_slot       = via;
+    cy_mutex_pool_task_name(cy_mutex_pool_current_task(), report.task, sizeof(report.task));
+    for (uint32_t i = 0U; i < CY_MUTEX_POOL_LOCKDEP_EDGES; i++)
+    {
+        cy_lockdep_edge_t* edge = &cy_lockdep_edges[i];
+        if ((0U != cy_atomic_load(&edge->valid)) && (edge->from == via) && (edge->to == held))
+        {
+            (void)memcpy(report.other_task, edge->task, sizeof(report.other_task));
+            break;
+        }
+    }
+    cy_mutex_pool_lockdep_report(&report);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_lockdep_created
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_lockdep_created(uint32_t slot, cy_mutex_pool_role_t role)
+{
+    cy_lockdep_role[slot] = role;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_lockdep_destroyed
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_lockdep_destroyed(uint32_t slot)
+{
+    // Forget every order involving the slot so that its next user starts clean
+    for (uint32_t w = 0U; w < CY_LOCKDEP_WORDS; w++)
+    {
+        cy_atomic_store(&cy_lockdep_order[slot][w], 0U);
+    }
+    for (uint32_t from = 0U; from < (uint32_t)(CY_STATIC_MUTEX_MAX); from++)
+    {
+        volatile uintptr_t* word  = &cy_lockdep_order[from][CY_LOCKDEP_WORD(slot)];
+        uintptr_t           value = cy_atomic_load(word);
+        while ((0U != (value & CY_LOCKDEP_MASK(slot))) &&
+               !cy_atomic_compare_exchange(word, value, value & ~CY_LOCKDEP_MASK(slot)))
+        {
+            value = cy_atomic_load(word);
+        }
+    }
+    for (uint32_t i = 0U; i < CY_MUTEX_POOL_LOCKDEP_EDGES; i++)
+    {
+        if ((cy_lockdep_edges[i].from == slot) || (cy_lockdep_edges[i].to == slot))
+        {
+            cy_atomic_store(&cy_lockdep_edges[i].valid, 0U);
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_lockdep_acquiring
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_lockdep_acquiring(uint32_t slot)
+{
+    const cy_lockdep_task_t* entry = cy_lockdep_find_task(false);
+    // A recursive acquire never waits
+    if ((NULL != entry) && !cy_lockdep_holds(entry, slot))
+    {
+        uint32_t count = (entry->depth < CY_MUTEX_POOL_LOCKDEP_DEPTH) ?
+                         entry->depth : CY_MUTEX_POOL_LOCKDEP_DEPTH;
+        for (uint32_t i = 0U; i < count; i++)
+        {
+            uint32_t held = entry->held[i];
+            uint32_t via  = slot;
+            bool     seen = false;
+            // The same slot can be on the held list more than once
+            for (uint32_t j = 0U; (j < i) && !seen; j++)
+            {
+                seen = (entry->held[j] == held);
+            }
+            if (!seen && cy_lockdep_add_order(held, slot))
+            {
+                cy_lockdep_remember(held, slot);
+                if (cy_lockdep_find_path(slot, held, &via))
+                {
+                    cy_lockdep_report(held, slot, via);
+                }
+            }
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_lockdep_acquired
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_lockdep_acquired(uint32_t slot)
+{
+    cy_lockdep_task_t* entry = cy_lockdep_find_task(true);
+    // Tasks that do not fit in the table are not checked
+    if (NULL != entry)
+    {
+        if (entry->depth < CY_MUTEX_POOL_LOCKDEP_DEPTH)
+        {
+            entry->held[entry->depth] = (uint16_t)slot;
+        }
+        entry->depth++;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_lockdep_releasing
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_lockdep_releasing(uint32_t slot)
+{
+    cy_lockdep_task_t* entry = cy_lockdep_find_task(false);
+    if (NULL != entry)
+    {
+        // Beyond CY_MUTEX_POOL_LOCKDEP_DEPTH the innermost acquires are only counted
+        bool found = (entry->depth > CY_MUTEX_POOL_LOCKDEP_DEPTH);
+        if (!found)
+        {
+            // Mutexes may be released in any order; drop the latest acquire of this one
+            uint32_t i = entry->depth;
+            while ((i > 0U) && (entry->held[i - 1U] != slot))
+            {
+                i--;
+            }
+            if (i > 0U)
+            {
+                (void)memmove(&entry->held[i - 1U], &entry->held[i],
+                              (entry->depth - i) * sizeof(entry->held[0]));
+                found = true;
+            }
+        }
+        // Not found if the task acquired the mutex while the table was full
+        if (found)
+        {
+            entry->depth--;
+            if (0U == entry->depth)
+            {
+                cy_atomic_store(&entry->task, 0U);
+            }
+        }
+    }
+}
+
+
+#endif // defined(MUTEX_POOL_AVAILABLE) && defined(CY_MUTEX_POOL_LOCKDEP)
@@ -0,0 +1,58 @@
+/***********************************************************************************************//**
+ * \file cy_mutex_pool_lockdep.h
+ *
+ * \brief
+ * Internal interface between the mutex pool backends and the lock-order checker
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "cy_mutex_pool.h"
+
+#if defined(MUTEX_POOL_AVAILABLE) && defined(CY_MUTEX_POOL_LOCKDEP)
+
+// The backends call these with the pool slot of the mutex, from task context
+// and only once the kernel is started (except for created/destroyed).
+
+// A slot was handed out by cy_mutex_pool_create for role.
+void cy_mutex_pool_lockdep_created(uint32_t slot, cy_mutex_pool_role_t role);
+
+// A slot is being returned by cy_mutex_pool_destroy.
+void cy_mutex_pool_lockdep_destroyed(uint32_t slot);
+
+// The calling task is about to wait for slot. Checks the new order against
+// the mutexes the task holds, before the wait can deadlock.
+void cy_mutex_pool_lockdep_acquiring(uint32_t slot);
+
+// The calling task now holds slot.
+void cy_mutex_pool_lockdep_acquired(uint32_t slot);
+
+// The calling task is about to release slot.
+void cy_mutex_pool_lockdep_releasing(uint32_t slot);
+
+// Implemented by each backend: copies the name of task into name, which has
+// room for size characters including the terminator.
+void cy_mutex_pool_task_name(void* task, char* name, uint32_t size);
+
+#endif // defined(MUTEX_POOL_AVAILABLE) && defined(CY_MUTEX_POOL_LOCKDEP)
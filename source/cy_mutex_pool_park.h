@@ -0,0 +1,48 @@
+/***********************************************************************************************//**
+ * \file cy_mutex_pool_park.h
+ *
+ * \brief
+ * Internal wait-queue hashing shared by the mutex pool backends
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+// Tasks that have to wait for a lock word (see cy_mutex_pool_park) queue up on
+// one of a small number of shared wait queues, selected by hashing the address
+// of the word. Queues are only touched on contention, so a handful is enough;
+// tasks waiting on different words that hash to the same queue are all woken
+// and re-check their own word.
+
+#ifndef CY_MUTEX_POOL_PARK_BUCKETS
+#define CY_MUTEX_POOL_PARK_BUCKETS  (8U)
+#endif
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_park_bucket
+//--------------------------------------------------------------------------------------------------
+static inline uint32_t cy_mutex_pool_park_bucket(const volatile void* key)
+{
+    // Fibonacci hashing; lock words are at least 4-byte aligned
+    return (uint32_t)((((uintptr_t)key >> 2) * 0x9E3779B1U) >> 16) % CY_MUTEX_POOL_PARK_BUCKETS;
+}
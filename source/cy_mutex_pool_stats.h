@@ -0,0 +1,209 @@
+/***********************************************************************************************//**
+ * \file cy_mutex_pool_stats.h
+ *
+ * \brief
+ * Internal contention and hold-time statistics shared by the mutex pool backends
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#if !defined (COMPONENT_CAT5)
+#include <cmsis_compiler.h>
+#endif
+#include "cy_mutex_pool.h"
+
+#if defined(CY_MUTEX_POOL_STATS)
+
+#define CY_MUTEX_POOL_STATS_BARRIER()   __DMB()
+
+// The timestamp defaults to the DWT cycle counter on ARMv7-M and later, as in
+// cy_critical_trace.c, which the application must enable (DEMCR.TRCENA and
+// DWT_CTRL.CYCCNTENA): most holds of C library locks are far shorter than an
+// RTOS tick. ARMv6-M has no cycle counter and falls back to RTOS ticks; hosts
+// use nanoseconds of CLOCK_MONOTONIC.
+
+#ifndef CY_MUTEX_POOL_STATS_TIMESTAMP
+#if defined(COMPONENT_POSIX)
+#include <time.h>
+#define CY_MUTEX_POOL_STATS_TIMESTAMP() cy_mutex_pool_stats_posix_timestamp()
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_stats_posix_timestamp
+//--------------------------------------------------------------------------------------------------
+static inline uint32_t cy_mutex_pool_stats_posix_timestamp(void)
+{
+    struct timespec now;
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)((uint64_t)now.tv_sec * 1000000000U + (uint64_t)now.tv_nsec);
+}
+
+
+#elif !(defined(__ARM_ARCH_6M__) || \
+    (defined(__ARM_ARCH) && (__ARM_ARCH == 6) && defined(__ARM_ARCH_PROFILE) && \
+    (__ARM_ARCH_PROFILE == 'M')))
+#define CY_MUTEX_POOL_STATS_TIMESTAMP() (*(volatile uint32_t*)0xE0001004UL)  // DWT_CYCCNT
+#elif defined(COMPONENT_FREERTOS)
+#define CY_MUTEX_POOL_STATS_TIMESTAMP() ((uint32_t)xTaskGetTickCount())
+#elif defined(COMPONENT_THREADX)
+#define CY_MUTEX_POOL_STATS_TIMESTAMP() ((uint32_t)tx_time_get())
+#endif // if defined(COMPONENT_POSIX)
+#endif // ifndef CY_MUTEX_POOL_STATS_TIMESTAMP
+
+// Number of times a snapshot retries a slot that is being updated by its owner
+// before it settles for the last copy that was read.
+#ifndef CY_MUTEX_POOL_STATS_SNAPSHOT_RETRIES
+#define CY_MUTEX_POOL_STATS_SNAPSHOT_RETRIES    (8U)
+#endif
+
+// Statistics for one pool slot. All fields other than sequence are only ever
+// written by the task that currently owns the mutex (or by create, when nobody
+// does), so no lock is needed to update them. The sequence counter is odd while
+// an update is in progress, which lets cy_mutex_pool_get_stats take a
+// consistent copy without acquiring the mutex being measured.
+typedef struct
+{
+    volatile uint32_t     sequence;
+    uint32_t              hold_start;
+    uint16_t              depth;
+    cy_mutex_pool_stats_t stats;
+} cy_mutex_pool_stats_slot_t;
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_stats_begin_update
+//--------------------------------------------------------------------------------------------------
+static inline void cy_mutex_pool_stats_begin_update(cy_mutex_pool_stats_slot_t* slot)
+{
+    slot->sequence++;
+    CY_MUTEX_POOL_STATS_BARRIER();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_stats_end_update
+//--------------------------------------------------------------------------------------------------
+static inline void cy_mutex_pool_stats_end_update(cy_mutex_pool_stats_slot_t* slot)
+{
+    CY_MUTEX_POOL_STATS_BARRIER();
+    slot->sequence++;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_stats_reset
+//--------------------------------------------------------------------------------------------------
+static inline void cy_mutex_pool_stats_reset(cy_mutex_pool_stats_slot_t* slot)
+{
+    cy_mutex_pool_stats_begin_update(slot);
+    slot->hold_start = 0U;
+    slot->depth      = 0U;
+    memset(&slot->stats, 0, sizeof(slot->stats));
+    cy_mutex_pool_stats_end_update(slot);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_stats_acquired
+//--------------------------------------------------------------------------------------------------
+static inline void cy_mutex_pool_stats_acquired(cy_mutex_pool_stats_slot_t* slot, uint32_t start,
+                                                bool contended, void* owner)
+{
+    uint32_t now = CY_MUTEX_POOL_STATS_TIMESTAMP();
+    uint32_t wait = now - start;
+
+    cy_mutex_pool_stats_begin_update(slot);
+    slot->stats.acquisitions++;
+    if (contended)
+    {
+        slot->stats.contended++;
+        slot->stats.wait_total += wait;
+        if (wait > slot->stats.wait_max)
+        {
+            slot->stats.wait_max = wait;
+        }
+    }
+    if (0U == slot->depth)
+    {
+        slot->hold_start       = now;
+        slot->stats.last_owner = owner;
+    }
+    slot->depth++;
+    if (slot->depth > slot->stats.depth_max)
+    {
+        slot->stats.depth_max = slot->depth;
+    }
+    cy_mutex_pool_stats_end_update(slot);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_stats_releasing
+//--------------------------------------------------------------------------------------------------
+static inline void cy_mutex_pool_stats_releasing(cy_mutex_pool_stats_slot_t* slot)
+{
+    if (0U != slot->depth)
+    {
+        cy_mutex_pool_stats_begin_update(slot);
+        slot->depth--;
+        if (0U == slot->depth)
+        {
+            uint32_t hold = CY_MUTEX_POOL_STATS_TIMESTAMP() - slot->hold_start;
+            slot->stats.hold_total += hold;
+            if (hold > slot->stats.hold_max)
+            {
+                slot->stats.hold_max = hold;
+            }
+        }
+        cy_mutex_pool_stats_end_update(slot);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_stats_snapshot
+//--------------------------------------------------------------------------------------------------
+static inline uint32_t cy_mutex_pool_stats_snapshot(const cy_mutex_pool_stats_slot_t* slots,
+                                                    uint32_t num_slots,
+                                                    cy_mutex_pool_stats_t* stats, uint32_t count)
+{
+    uint32_t num = (count < num_slots) ? count : num_slots;
+    for (uint32_t i = 0U; i < num; i++)
+    {
+        for (uint32_t retry = 0U; retry < CY_MUTEX_POOL_STATS_SNAPSHOT_RETRIES; retry++)
+        {
+            uint32_t sequence = slots[i].sequence;
+            CY_MUTEX_POOL_STATS_BARRIER();
+            stats[i] = slots[i].stats;
+            CY_MUTEX_POOL_STATS_BARRIER();
+            if ((0U == (sequence & 1U)) && (sequence == slots[i].sequence))
+            {
+                break;
+            }
+        }
+    }
+    return num;
+}
+
+
+#endif // defined(CY_MUTEX_POOL_STATS)
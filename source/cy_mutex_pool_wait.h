@@ -0,0 +1,80 @@
+/***********************************************************************************************//**
+ * \file cy_mutex_pool_wait.h
+ *
+ * \brief
+ * Internal blocking wait with optional watchdog shared by the mutex pool backends
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "cy_mutex_pool.h"
+
+// A backend blocks on a pool mutex through cy_mutex_pool_wait, passing its own
+// functions to take the mutex with a timeout in ticks (which must treat
+// CY_MUTEX_POOL_WAIT_FOREVER as an infinite wait) and to look up its owner.
+// Without CY_MUTEX_POOL_WATCHDOG_TICKS this is a single call to take. With it,
+// the wait is split into slices of CY_MUTEX_POOL_WATCHDOG_TICKS and the
+// application's cy_mutex_pool_watchdog is called after every full slice that
+// ends without the mutex.
+
+#if defined(CY_MUTEX_POOL_WATCHDOG_TICKS) && (CY_MUTEX_POOL_WATCHDOG_TICKS == 0)
+#error CY_MUTEX_POOL_WATCHDOG_TICKS must not be 0
+#endif
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_wait
+//--------------------------------------------------------------------------------------------------
+static inline bool cy_mutex_pool_wait(cy_mutex_pool_semaphore_t m, uint32_t timeout,
+                                      bool (*take)(cy_mutex_pool_semaphore_t m, uint32_t ticks),
+                                      void* (*owner)(cy_mutex_pool_semaphore_t m))
+{
+    #if defined(CY_MUTEX_POOL_WATCHDOG_TICKS)
+    const uint32_t slice_max = (uint32_t)(CY_MUTEX_POOL_WATCHDOG_TICKS);
+    uint32_t       remaining = timeout;
+    uint32_t       waited    = 0U;
+    bool           acquired  = false;
+
+    while (!acquired && (0U != remaining))
+    {
+        uint32_t slice = (remaining < slice_max) ? remaining : slice_max;
+        acquired = take(m, slice);
+        if (!acquired)
+        {
+            if (CY_MUTEX_POOL_WAIT_FOREVER != timeout)
+            {
+                remaining -= slice;
+            }
+            waited = (waited > (UINT32_MAX - slice)) ? UINT32_MAX : (waited + slice);
+            if (slice == slice_max)
+            {
+                cy_mutex_pool_watchdog(m, owner(m), waited);
+            }
+        }
+    }
+    return acquired;
+    #else // if defined(CY_MUTEX_POOL_WATCHDOG_TICKS)
+    (void)owner;
+    return (0U != timeout) && take(m, timeout);
+    #endif // if defined(CY_MUTEX_POOL_WATCHDOG_TICKS)
+}
@@ -0,0 +1,291 @@
+/***********************************************************************************************//**
+ * \file cy_romfs.c
+ *
+ * \brief
+ * Read-only file system served from an image in flash, built by tools/cy_romfs_image.py
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#if !defined (COMPONENT_CAT5)
+#include <cmsis_compiler.h>
+#endif
+#include "cy_romfs.h"
+#include "cy_clib_support_atomic.h"
+
+#if defined(CY_ROMFS)
+
+// The image, little-endian, is a header, a table of the files sorted by path,
+// the paths, and the contents of the files, each aligned to the alignment in
+// the header. Offsets are from the start of the image. The layout is shared
+// with tools/cy_romfs_image.py.
+
+#define CY_ROMFS_MAGIC      (0x46525943UL)  // "CYRF"
+#define CY_ROMFS_VERSION    (1U)
+
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t alignment;     // Of the image and of the contents of each file, a power of two >= 4
+    uint32_t count;         // Number of files
+    uint32_t size;          // Of the whole image in bytes
+} cy_romfs_header_t;
+
+typedef struct
+{
+    uint32_t path;          // Offset of the path, without a leading '/' and NUL-terminated
+    uint32_t data;          // Offset of the contents
+    uint32_t size;          // Of the contents in bytes
+} cy_romfs_entry_t;
+
+static const cy_romfs_header_t* volatile cy_romfs_mounted = NULL;
+
+// The file of each descriptor, NULL while it is free. A descriptor is claimed
+// with a compare-and-swap, so opening takes no lock. The position is only used
+// by the owner of the descriptor, under the lock of its stream.
+static volatile uintptr_t cy_romfs_files[CY_ROMFS_MAX_OPEN];
+static size_t             cy_romfs_positions[CY_ROMFS_MAX_OPEN];
+
+//--------------------------------------------------------------------------------------------------
+// cy_romfs_find
+//--------------------------------------------------------------------------------------------------
+static const cy_romfs_entry_t* cy_romfs_find(const char* path)
+{
+    const cy_romfs_header_t* image = cy_romfs_mounted;
+    const cy_romfs_entry_t*  found = NULL;
+
+    if ((NULL != image) && (NULL != path))
+    {
+        const cy_romfs_entry_t* entries = (const cy_romfs_entry_t*)&image[1];
+        uint32_t                low     = 0U;
+        uint32_t                high    = image->count;
+        while ('/' == *path)
+        {
+            path++;
+        }
+        // Binary search of the table, which the tool sorts the way strcmp compares
+        while ((NULL == found) && (low < high))
+        {
+            uint32_t middle = low + ((high - low) / 2U);
+            int      order  = strcmp(path, &((const char*)image)[entries[middle].path]);
+            if (0 == order)
+            {
+                found = &entries[middle];
+            }
+            else if (order < 0)
+            {
+                high = middle;
+            }
+            else
+            {
+                low = middle + 1U;
+            }
+        }
+    }
+    return found;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_romfs_file
+//--------------------------------------------------------------------------------------------------
+static const cy_romfs_entry_t* cy_romfs_file(int fd)
+{
+    const cy_romfs_entry_t* file = NULL;
+    if ((fd >= CY_ROMFS_FD_BASE) && ((fd - CY_ROMFS_FD_BASE) < (int)CY_ROMFS_MAX_OPEN))
+    {
+        file = (const cy_romfs_entry_t*)cy_atomic_load(&cy_romfs_files[fd - CY_ROMFS_FD_BASE]);
+    }
+    return file;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_romfs_mount
+//--------------------------------------------------------------------------------------------------
+bool cy_romfs_mount(const void* image)
+{
+    const cy_romfs_header_t* header = (const cy_romfs_header_t*)image;
+    bool                     valid  = (NULL == header);
+
+    if (!valid)
+    {
+        uint32_t alignment = header->alignment;
+        valid = (CY_ROMFS_MAGIC == header->magic) && (CY_ROMFS_VERSION == header->version) &&
+                (alignment >= 4U) && (0U == (alignment & (alignment - 1U))) &&
+                (0U == ((uintptr_t)image & (alignment - 1U)));
+    }
+    if (valid)
+    {
+        cy_romfs_mounted = header;
+    }
+    return valid;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_romfs_map
+//--------------------------------------------------------------------------------------------------
+bool cy_romfs_map(const char* path, const void** data, size_t* size)
+{
+    const cy_romfs_entry_t* file = cy_romfs_find(path);
+    if (NULL != file)
+    {
+        *data = &((const uint8_t*)cy_romfs_mounted)[file->data];
+        *size = file->size;
+    }
+    return (NULL != file);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_romfs_open
+//--------------------------------------------------------------------------------------------------
+int cy_romfs_open(const char* path)
+{
+    int                     fd   = -1;
+    const cy_romfs_entry_t* file = cy_romfs_find(path);
+    for (uint32_t i = 0U; (NULL != file) && (fd < 0) && (i < CY_ROMFS_MAX_OPEN); i++)
+    {
+        if (cy_atomic_compare_exchange(&cy_romfs_files[i], 0U, (uintptr_t)file))
+        {
+            cy_romfs_positions[i] = 0U;
+            fd                    = CY_ROMFS_FD_BASE + (int)i;
+        }
+    }
+    return fd;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_romfs_is_open
+//--------------------------------------------------------------------------------------------------
+bool cy_romfs_is_open(int fd)
+{
+    return (NULL != cy_romfs_file(fd));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_romfs_close
+//--------------------------------------------------------------------------------------------------
+int cy_romfs_close(int fd)
+{
+    int result = -1;
+    if (NULL != cy_romfs_file(fd))
+    {
+        cy_atomic_store(&cy_romfs_files[fd - CY_ROMFS_FD_BASE], 0U);
+        result = 0;
+    }
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_romfs_read
+//--------------------------------------------------------------------------------------------------
+long cy_romfs_read(int fd, void* buffer, size_t size)
+{
+    long                    result = -1;
+    const cy_romfs_entry_t* file   = cy_romfs_file(fd);
+    if (NULL != file)
+    {
+        size_t* position = &cy_romfs_positions[fd - CY_ROMFS_FD_BASE];
+        size_t  left     = (*position < file->size) ? (file->size - *position) : 0U;
+        if (size > left)
+        {
+            size = left;
+        }
+        if (0U != size)
+        {
+            (void)memcpy(buffer, &((const uint8_t*)cy_romfs_mounted)[file->data + *position],
+                         size);
+            *position += size;
+        }
+        result = (long)size;
+    }
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_romfs_seek
+//--------------------------------------------------------------------------------------------------
+long cy_romfs_seek(int fd, long offset, int whence)
+{
+    long                    result = -1;
+    const cy_romfs_entry_t* file   = cy_romfs_file(fd);
+    if (NULL != file)
+    {
+        size_t* position = &cy_romfs_positions[fd - CY_ROMFS_FD_BASE];
+        long    base     = -1;
+        if (SEEK_SET == whence)
+        {
+            base = 0;
+        }
+        else if (SEEK_CUR == whence)
+        {
+            base = (long)*position;
+        }
+        else if (SEEK_END == whence)
+        {
+            base = (long)file->size;
+        }
+        // Seeking past the end is allowed, as for other files; reads there return 0. base is not
+        // negative, so neither -base nor LONG_MAX - base overflows, unlike -offset for LONG_MIN.
+        if ((base >= 0) && (offset >= -base) && (offset <= (LONG_MAX - base)))
+        {
+            *position = (size_t)base + (size_t)offset;
+            result    = (long)*position;
+        }
+    }
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_romfs_size
+//--------------------------------------------------------------------------------------------------
+long cy_romfs_size(int fd)
+{
+    const cy_romfs_entry_t* file = cy_romfs_file(fd);
+    return (NULL != file) ? (long)file->size : -1;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_romfs_stdin_read
+//--------------------------------------------------------------------------------------------------
+__WEAK long cy_romfs_stdin_read(void* buffer, size_t size)
+{
+    (void)buffer;
+    (void)size;
+    return 0;
+}
+
+
+#endif // defined(CY_ROMFS)
@@ -0,0 +1,77 @@
+/***********************************************************************************************//**
+ * \file cy_romfs_port.h
+ *
+ * \brief
+ * Internal helpers shared by the toolchain ports of the ROM file system
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <errno.h>
+#include <stddef.h>
+#include "cy_romfs.h"
+
+// The parts of the low-level file functions that do more than pass a call on
+// to cy_romfs.c. They are kept here, apart from the toolchain headers the
+// ports need, so that the host tests check the same code.
+
+#if defined(CY_ROMFS)
+
+// The errno.h of the ARM C library defines neither
+#if defined(EMFILE) && defined(ENOENT)
+//--------------------------------------------------------------------------------------------------
+// cy_romfs_open_error
+//--------------------------------------------------------------------------------------------------
+// Returns the errno of a failed cy_romfs_open: EMFILE if the file exists but CY_ROMFS_MAX_OPEN
+// files are open, ENOENT otherwise
+static inline int cy_romfs_open_error(const char* path)
+{
+    const void* data;
+    size_t      size;
+    return cy_romfs_map(path, &data, &size) ? EMFILE : ENOENT;
+}
+
+
+#endif // defined(EMFILE) && defined(ENOENT)
+
+//--------------------------------------------------------------------------------------------------
+// cy_romfs_sys_read_result
+//--------------------------------------------------------------------------------------------------
+// Converts the result of a read of len bytes (bytes read, 0 at the end of the file, or -1) to that
+// of the ARM C library's _sys_read: the number of bytes not read, with the top bit set if the end
+// of the file was reached before any were read, or -1 on error
+static inline int cy_romfs_sys_read_result(long result, unsigned len)
+{
+    if (result >= 0)
+    {
+        unsigned not_read = len - (unsigned)result;
+        if ((0 == result) && (0U != len))
+        {
+            not_read |= 0x80000000U; // EOF
+        }
+        result = (long)(int)not_read;
+    }
+    return (int)result;
+}
+
+
+#endif // defined(CY_ROMFS)
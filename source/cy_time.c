@@ -30,6 +30,7 @@
 // Make sure the RTC is available on this device.
 #if defined(_MTB_CLIB_SUPPORT_RTC_AVAILABLE)
 #include "cy_mutex_pool.h"
+#include "cy_clib_support_atomic.h"
 
 #if defined(__cplusplus)
 extern "C"
@@ -51,6 +52,91 @@ static cyhal_rtc_t         cy_time_rtc_inst;
 extern cy_mutex_pool_semaphore_t cy_timer_mutex;
 #endif
 
+#if defined(COMPONENT_CAT5)
+/* For CAT5, default time is set as January 1, 2011 12:00:00 AM.
+   Epoch timestamp: 1293840000 */
+#define CY_TIME_DEFAULT_SECONDS     (1293840000)
+#else
+#define CY_TIME_DEFAULT_SECONDS     (0)
+#endif
+
+// The monotonic clock is the RTOS tick count, extended to 64 bits and converted to microseconds,
+// plus the time since the last tick if CY_TIME_SUBTICK_US() is defined. The realtime clock is the
+// monotonic clock plus an offset taken from the RTC. The RTC is read again when the resync
+// interval has passed. The interval is halved, down to CY_TIME_RESYNC_MIN seconds, each time a
+// resync finds that the tick count and the RTC have drifted apart, and doubled again, up to
+// CY_TIME_RESYNC_MAX seconds, while they agree.
+#ifndef CY_TIME_RESYNC_MIN
+#define CY_TIME_RESYNC_MIN          (1U)
+#endif
+
+#ifndef CY_TIME_RESYNC_MAX
+#define CY_TIME_RESYNC_MAX          (64U)
+#endif
+
+#ifndef CY_TIME_TICKS
+#if defined(COMPONENT_FREERTOS)
+#define CY_TIME_TICKS()             \
+    ((uint32_t)(cy_time_in_isr() ? xTaskGetTickCountFromISR() : xTaskGetTickCount()))
+#define CY_TIME_TICK_HZ             ((uint32_t)configTICK_RATE_HZ)
+#elif defined(COMPONENT_THREADX)
+#define CY_TIME_TICKS()             ((uint32_t)tx_time_get())
+#if defined(TX_TIMER_TICKS_PER_SECOND)
+#define CY_TIME_TICK_HZ             ((uint32_t)TX_TIMER_TICKS_PER_SECOND)
+#else
+#error "Define CY_TIME_TICKS() and CY_TIME_TICK_HZ to the ThreadX timer tick count and rate"
+#endif
+#elif defined(COMPONENT_POSIX)
+#define CY_TIME_TICKS()             cy_time_posix_ticks()
+#define CY_TIME_TICK_HZ             (1000U)
+
+//--------------------------------------------------------------------------------------------------
+// cy_time_posix_ticks
+//--------------------------------------------------------------------------------------------------
+static inline uint32_t cy_time_posix_ticks(void)
+{
+    struct timespec now;
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)((uint64_t)now.tv_sec * 1000U + (uint64_t)now.tv_nsec / 1000000U);
+}
+
+
+#endif // if defined(COMPONENT_FREERTOS)
+#endif // ifndef CY_TIME_TICKS
+
+// The tick count does not advance before the kernel is started
+#if defined(MUTEX_POOL_AVAILABLE)
+#define CY_TIME_TICKS_RUNNING()     cy_mutex_pool_kernel_started()
+#else
+#define CY_TIME_TICKS_RUNNING()     (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED)
+#endif
+
+#define CY_TIME_US_PER_SECOND       (1000000U)
+
+// The time base is published through two copies. The writer updates the copy that readers are
+// not directed to and then advances the sequence number, which directs new readers to it. A
+// reader retries if the sequence number changed while it copied the time base, so readers never
+// wait for the writer and an interrupt handler can read it while a task is updating it. Writers
+// are serialized by cy_timer_mutex.
+typedef struct
+{
+    uint32_t ticks;         // Tick count at which the time base was published
+    uint32_t interval;      // Resync interval, seconds
+    uint64_t tick_count;    // ticks, extended to 64 bits
+    int64_t  offset;        // Realtime minus monotonic clock, microseconds
+    uint64_t synced;        // Monotonic clock at the last RTC read
+    bool     valid;         // offset has been taken from the RTC
+    bool     resync;        // offset was taken before the kernel was started
+} cy_time_base_t;
+
+static cy_time_base_t     cy_time_bases[2] =
+{
+    { .interval = CY_TIME_RESYNC_MAX },
+    { .interval = CY_TIME_RESYNC_MAX }
+};
+static volatile uintptr_t cy_time_base_seq  = 0U;
+static volatile uintptr_t cy_time_base_busy = 0U;    // A reader is resyncing the time base
+
 //--------------------------------------------------------------------------------------------------
 // Acquire a lock to ensure exclusive access
 //--------------------------------------------------------------------------------------------------
@@ -77,24 +163,78 @@ static void mutex_release(void)
 }
 
 
+#if !defined(CY_TIME_RTC_LOCALTIME)
 //--------------------------------------------------------------------------------------------------
-// Get the current time
+// Convert a UTC calendar time to seconds since the epoch without consulting the timezone. Months
+// outside 0-11 are carried into the year and the other fields are added as they are, so values
+// that mktime would normalize give the same result. The tm fields are not modified.
 //--------------------------------------------------------------------------------------------------
-time_t time(time_t* _timer)
+static time_t cy_time_from_utc(const struct tm* utc)
+{
+    // Days from civil: counting from March 1 puts the leap day at the end of the year, so the
+    // day of the year follows from the month by a linear formula and the 400-year eras repeat.
+    int64_t year  = (int64_t)utc->tm_year + 1900 + (utc->tm_mon / 12);
+    int64_t month = utc->tm_mon % 12;
+    if (month < 0)
+    {
+        month += 12;
+        year  -= 1;
+    }
+    if (month < 2)
+    {
+        year -= 1;
+    }
+
+    int64_t era         = ((year >= 0) ? year : (year - 399)) / 400;
+    int64_t year_of_era = year - (era * 400);
+    int64_t day_of_year = (((153 * ((month < 2) ? (month + 10) : (month - 2))) + 2) / 5) +
+                          utc->tm_mday - 1;
+    int64_t day_of_era  = (year_of_era * 365) + (year_of_era / 4) - (year_of_era / 100) +
+                          day_of_year;
+    int64_t days        = (era * 146097) + day_of_era - 719468;
+
+    return (time_t)((days * 86400) + ((int64_t)utc->tm_hour * 3600) +
+                    ((int64_t)utc->tm_min * 60) + utc->tm_sec);
+}
+
+
+#endif // !defined(CY_TIME_RTC_LOCALTIME)
+
+//--------------------------------------------------------------------------------------------------
+// Read the RTC and convert it to seconds since the epoch
+//--------------------------------------------------------------------------------------------------
+static cy_rslt_t cy_time_read_rtc(time_t* seconds)
 {
-    cy_rslt_t result = CY_RSLT_SUCCESS;
     struct tm rtc_time;
-    #if defined(COMPONENT_CAT5)
-    /* For CAT5, default time is set as January 1, 2011 12:00:00 AM.
-       Epoch timestamp: 1293840000 */
-    time_t seconds = 1293840000;
+
+    #if defined(MTB_HAL_API_VERSION) && ((MTB_HAL_API_VERSION) >= 3)
+    cy_rslt_t result = mtb_hal_rtc_read(cy_time, &rtc_time);
     #else
-    time_t seconds = 0;
+    cy_rslt_t result = cyhal_rtc_read(cy_time, &rtc_time);
     #endif
 
+    if (result == CY_RSLT_SUCCESS)
+    {
+        /* Convert tm format to time_t */
+        #if defined(CY_TIME_RTC_LOCALTIME)
+        *seconds = mktime(&rtc_time);
+        #else
+        *seconds = cy_time_from_utc(&rtc_time);
+        #endif
+    }
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// Make sure the CLIB support RTC is set
+//--------------------------------------------------------------------------------------------------
+static bool cy_time_rtc_ready(void)
+{
     /* If CLIB support RTC is not init using mtb_clib_support_init() API at first */
     #if defined(MTB_HAL_DISABLE_ERR_CHECK)
-    CY_ASSERT_AND_RETURN(cy_time != NULL, seconds);
+    CY_ASSERT_AND_RETURN(cy_time != NULL, false);
     #else
     if (cy_time == NULL)
     {
@@ -104,38 +244,317 @@ time_t time(time_t* _timer)
          * function being called */
         #if defined(MTB_HAL_API_VERSION) && ((MTB_HAL_API_VERSION) >= 3)
         CY_ASSERT(false);
-        return seconds;
         #else /* Older HAL versions define CYHAL_API_VERSION */
-        result = cyhal_rtc_init(&cy_time_rtc_inst);
+        cy_rslt_t result = cyhal_rtc_init(&cy_time_rtc_inst);
         CY_ASSERT(CY_RSLT_SUCCESS == result);
         if (CY_RSLT_SUCCESS == result)
         {
+            time_t seconds = CY_TIME_DEFAULT_SECONDS;
             cy_time = &cy_time_rtc_inst;
 
             /* Write default time to RTC */
-            result = cyhal_rtc_write(cy_time, localtime(&seconds));
+            #if defined(CY_TIME_RTC_LOCALTIME)
+            (void)cyhal_rtc_write(cy_time, localtime(&seconds));
+            #else
+            (void)cyhal_rtc_write(cy_time, gmtime(&seconds));
+            #endif
         }
         #endif // if defined(MTB_HAL_API_VERSION) && ((MTB_HAL_API_VERSION) >= 3)
     }
     #endif // defined(MTB_HAL_DISABLE_ERR_CHECK)
 
-    mutex_acquire();
+    return (cy_time != NULL);
+}
 
-    /* Read current time from RTC */
-    #if defined(MTB_HAL_API_VERSION) && ((MTB_HAL_API_VERSION) >= 3)
-    result = mtb_hal_rtc_read(cy_time, &rtc_time);
+
+//--------------------------------------------------------------------------------------------------
+// Convert a tick count to microseconds
+//--------------------------------------------------------------------------------------------------
+static uint64_t cy_time_ticks_to_us(uint64_t ticks)
+{
+    uint64_t us;
+
+    // Constant folded; the division is avoided for the usual tick rates
+    if ((CY_TIME_US_PER_SECOND % CY_TIME_TICK_HZ) == 0U)
+    {
+        us = ticks * (CY_TIME_US_PER_SECOND / CY_TIME_TICK_HZ);
+    }
+    else
+    {
+        us = ((ticks / CY_TIME_TICK_HZ) * CY_TIME_US_PER_SECOND) +
+             (((ticks % CY_TIME_TICK_HZ) * CY_TIME_US_PER_SECOND) / CY_TIME_TICK_HZ);
+    }
+
+    return us;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// Check whether the caller is an interrupt handler
+//--------------------------------------------------------------------------------------------------
+static bool cy_time_in_isr(void)
+{
+    #if defined(COMPONENT_POSIX)
+    return false;
+    #elif defined(COMPONENT_CR4) // Can work for any Cortex-A & Cortex-R
+    uint32_t mode = __get_mode();
+    return (mode == 0x11U /*FIQ*/) || (mode == 0x12U /*IRQ*/);
+    #else // Cortex-M
+    return (0U != __get_IPSR());
+    #endif
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// Read the monotonic clock and move base to the current tick count
+//--------------------------------------------------------------------------------------------------
+static uint64_t cy_time_monotonic_now(cy_time_base_t* base)
+{
+    uint32_t ticks;
+    uint32_t subtick = 0U;
+
+    #if defined(CY_TIME_SUBTICK_US)
+    // Retry if a tick interrupt came between the two reads
+    do
+    {
+        ticks   = CY_TIME_TICKS();
+        subtick = (uint32_t)CY_TIME_SUBTICK_US();
+    } while (ticks != CY_TIME_TICKS());
     #else
-    result = cyhal_rtc_read(cy_time, &rtc_time);
+    ticks = CY_TIME_TICKS();
     #endif
 
-    if (result == CY_RSLT_SUCCESS)
+    // Correct as long as the time base is republished at least once per period of the tick count
+    base->tick_count += (uint32_t)(ticks - base->ticks);
+    base->ticks       = ticks;
+
+    return cy_time_ticks_to_us(base->tick_count) + subtick;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// Copy the published time base and read the monotonic clock against it
+//--------------------------------------------------------------------------------------------------
+static uint64_t cy_time_base_snapshot(cy_time_base_t* base, uint32_t* age)
+{
+    uintptr_t seq;
+    uint64_t  now;
+
+    do
     {
-        /* Convert tm format to time_t */
-        seconds = mktime(&rtc_time);
+        seq   = cy_atomic_load(&cy_time_base_seq);
+        *base = cy_time_bases[seq & 1U];
+        *age  = base->ticks;
+        now   = cy_time_monotonic_now(base);
+        cy_atomic_fence();
+    } while (seq != cy_atomic_load(&cy_time_base_seq));
+
+    *age = base->ticks - *age;
+    return now;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// Make base the published time base. The caller must hold the lock.
+//--------------------------------------------------------------------------------------------------
+static void cy_time_base_publish(const cy_time_base_t* base)
+{
+    uintptr_t seq = cy_time_base_seq + 1U;
+    cy_time_bases[seq & 1U] = *base;
+    cy_atomic_store(&cy_time_base_seq, seq);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// Align the realtime clock of base with seconds read from the RTC at monotonic time now
+//--------------------------------------------------------------------------------------------------
+static void cy_time_base_sync(cy_time_base_t* base, time_t seconds, uint64_t now)
+{
+    // The RTC value says that the time is within [low, low + 1s). The offset only moves as far
+    // as needed to bring the realtime clock into that second, so repeated reads narrow down the
+    // point within the second at which the RTC advances.
+    int64_t low = (int64_t)seconds * (int64_t)CY_TIME_US_PER_SECOND;
+
+    if (!base->valid)
+    {
+        base->offset = low - (int64_t)now;
+        base->valid  = true;
+    }
+    else
+    {
+        int64_t estimate = (int64_t)now + base->offset;
+        int64_t shift    = 0;
+        if (estimate < low)
+        {
+            shift = low - estimate;
+        }
+        else if (estimate >= (low + (int64_t)CY_TIME_US_PER_SECOND))
+        {
+            shift = (low + (int64_t)CY_TIME_US_PER_SECOND - 1) - estimate;
+        }
+        base->offset += shift;
+
+        if ((shift < 0) || (shift > (int64_t)CY_TIME_US_PER_SECOND))
+        {
+            base->interval /= 2U;
+            if (base->interval < CY_TIME_RESYNC_MIN)
+            {
+                base->interval = CY_TIME_RESYNC_MIN;
+            }
+        }
+        else if (shift == 0)
+        {
+            base->interval *= 2U;
+            if (base->interval > CY_TIME_RESYNC_MAX)
+            {
+                base->interval = CY_TIME_RESYNC_MAX;
+            }
+        }
     }
 
-    mutex_release();
-    if (result != CY_RSLT_SUCCESS)
+    base->synced = now;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// Publish a time base at the current tick count, synchronized with the RTC if one is set. The
+// caller must hold the lock.
+//--------------------------------------------------------------------------------------------------
+static cy_rslt_t cy_time_base_update(bool anchor, time_t* seconds)
+{
+    cy_rslt_t      result = CY_RSLT_SUCCESS;
+    cy_time_base_t base   = cy_time_bases[cy_time_base_seq & 1U];
+    uint64_t       now    = cy_time_monotonic_now(&base);
+
+    if (anchor)
+    {
+        base.valid = false;
+    }
+
+    if (cy_time != NULL)
+    {
+        result = cy_time_read_rtc(seconds);
+        if (result == CY_RSLT_SUCCESS)
+        {
+            cy_time_base_sync(&base, *seconds, now);
+            // The tick count stands still until the kernel is started
+            base.resync = !CY_TIME_TICKS_RUNNING();
+        }
+    }
+
+    cy_time_base_publish(&base);
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// Read the time base and the monotonic clock. Outside of interrupt handlers, a time base that is
+// due for a resync is updated first, unless another task is already doing so.
+//--------------------------------------------------------------------------------------------------
+static uint64_t cy_time_base_read(cy_time_base_t* base)
+{
+    uint32_t age;
+    uint64_t now = cy_time_base_snapshot(base, &age);
+
+    bool due = (age >= 0x80000000U);
+    if (cy_time != NULL)
+    {
+        due = due || !base->valid || base->resync ||
+              ((now - base->synced) >= ((uint64_t)base->interval * CY_TIME_US_PER_SECOND));
+    }
+
+    if (due && CY_TIME_TICKS_RUNNING() && !cy_time_in_isr() &&
+        cy_atomic_compare_exchange(&cy_time_base_busy, 0U, 1U))
+    {
+        time_t seconds;
+
+        mutex_acquire();
+        (void)cy_time_base_update(false, &seconds);
+        mutex_release();
+
+        cy_atomic_store(&cy_time_base_busy, 0U);
+        now = cy_time_base_snapshot(base, &age);
+    }
+
+    return now;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// Read the realtime clock in microseconds since the epoch
+//--------------------------------------------------------------------------------------------------
+static bool cy_time_realtime_read(int64_t* us)
+{
+    bool success;
+
+    if (!CY_TIME_TICKS_RUNNING())
+    {
+        // No other task can run yet, and the tick count stands still
+        time_t seconds;
+        success = (cy_time_read_rtc(&seconds) == CY_RSLT_SUCCESS);
+        if (success)
+        {
+            *us = (int64_t)seconds * (int64_t)CY_TIME_US_PER_SECOND;
+        }
+    }
+    else
+    {
+        cy_time_base_t base;
+        uint64_t       now = cy_time_base_read(&base);
+        success = base.valid;
+        if (success)
+        {
+            *us = (int64_t)now + base.offset;
+        }
+    }
+
+    return success;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// Get the current time
+//--------------------------------------------------------------------------------------------------
+time_t time(time_t* _timer)
+{
+    bool   success;
+    time_t seconds = CY_TIME_DEFAULT_SECONDS;
+
+    if (!cy_time_rtc_ready())
+    {
+        return seconds;
+    }
+
+    #if defined(CY_TIME_CACHE)
+    bool cached = true;
+    #else
+    // Interrupt handlers cannot take the lock to read the RTC
+    bool cached = cy_time_in_isr();
+    #endif
+
+    if (cached)
+    {
+        int64_t us;
+        success = cy_time_realtime_read(&us);
+        if (success)
+        {
+            seconds = (time_t)(us / (int64_t)CY_TIME_US_PER_SECOND);
+            if ((us % (int64_t)CY_TIME_US_PER_SECOND) < 0)
+            {
+                seconds--;
+            }
+        }
+    }
+    else
+    {
+        /* Read current time from RTC */
+        mutex_acquire();
+        success = (cy_time_base_update(false, &seconds) == CY_RSLT_SUCCESS);
+        mutex_release();
+    }
+
+    if (!success)
     {
         if (_timer != NULL)
         {
@@ -165,14 +584,63 @@ void mtb_clib_support_init(mtb_hal_rtc_t* rtc)
 void mtb_clib_support_init(cyhal_rtc_t* rtc)
 #endif
 {
+    time_t seconds;
+
     mutex_acquire();
 
     cy_time = rtc;
+    (void)cy_time_base_update(true, &seconds);
 
     mutex_release();
 }
 
 
+//--------------------------------------------------------------------------------------------------
+// Take the realtime clock from the RTC again
+//--------------------------------------------------------------------------------------------------
+void mtb_clib_support_time_resync(void)
+{
+    time_t seconds;
+
+    mutex_acquire();
+
+    (void)cy_time_base_update(true, &seconds);
+
+    mutex_release();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// Get the time since the kernel was started in microseconds
+//--------------------------------------------------------------------------------------------------
+uint64_t mtb_clib_support_monotonic_us(void)
+{
+    cy_time_base_t base;
+    return cy_time_base_read(&base);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// Get the time since the epoch in microseconds
+//--------------------------------------------------------------------------------------------------
+bool mtb_clib_support_realtime_us(int64_t* us)
+{
+    return cy_time_rtc_ready() && cy_time_realtime_read(us);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// Get a timestamp from the last published time base without reading the RTC
+//--------------------------------------------------------------------------------------------------
+int64_t mtb_clib_support_timestamp_us(void)
+{
+    cy_time_base_t base;
+    uint32_t       age;
+    int64_t        now = (int64_t)cy_time_base_snapshot(&base, &age);
+    return base.valid ? (now + base.offset) : now;
+}
+
+
 //--------------------------------------------------------------------------------------------------
 // Get the CLIB support RTC (HAL API >= 3.0)
 //--------------------------------------------------------------------------------------------------
@@ -0,0 +1,279 @@
+/***********************************************************************************************//**
+ * \file bench_guard.c
+ *
+ * \brief
+ * Benchmark of the C++ static initialization guards on the POSIX host backend
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include "cy_test.h"
+#include "cy_clib_support_atomic.h"
+#include "cy_mutex_pool.h"
+
+// Two cases, each printed as one JSON object per line (or a table row with
+// --text):
+//
+// - "initialized": every thread calls __cxa_guard_acquire on the same guard
+//   whose static is already constructed, the path taken by every later use of
+//   a function-local static. Reports the CPU time per call of the slowest
+//   thread and the calls per second of all threads together.
+// - "first_use": every thread walks --guards statics, each starting at its
+//   own share of them, so that several constructors are due at the same time.
+//   Each constructor sleeps --ctor-us microseconds, standing in for one that
+//   waits for a peripheral or flash. Reported are the time until all statics
+//   are constructed and the longest time a thread took. The same run is
+//   repeated with every acquire to release wrapped in one global pool mutex,
+//   the way the guards worked before they kept per-guard state. The
+//   benchmark fails if a constructor runs more than once or a thread sees a
+//   static that is not constructed.
+//
+// Options: --threads N (runs 1, 2, 4, ... N threads, default 8), --calls C
+// (per thread in "initialized", default 10000000), --guards G (default 16),
+// --ctor-us U (default 1000), --text, --quick.
+
+#define CY_BENCH_THREADS    (64U)
+#define CY_BENCH_GUARDS     (256U)
+
+extern int  __cxa_guard_acquire(volatile uintptr_t* guard_object);
+extern void __cxa_guard_release(volatile uintptr_t* guard_object);
+extern void cy_toolchain_init(void);
+
+typedef struct
+{
+    pthread_t thread;
+    uint32_t  index;
+    uint64_t  ns;
+    uint64_t  cpu_ns;
+} cy_bench_thread_t;
+
+static volatile uintptr_t        cy_bench_guards[CY_BENCH_GUARDS];
+static atomic_uint               cy_bench_constructed[CY_BENCH_GUARDS];
+static cy_bench_thread_t         cy_bench_threads[CY_BENCH_THREADS];
+static cy_mutex_pool_semaphore_t cy_bench_global_mutex;
+static pthread_barrier_t         cy_bench_barrier;
+static bool                      cy_bench_global;
+static uint32_t                  cy_bench_guard_count;
+static uint32_t                  cy_bench_thread_count;
+static uint32_t                  cy_bench_ctor_us;
+static long                      cy_bench_calls;
+
+//--------------------------------------------------------------------------------------------------
+// cy_bench_cpu_ns
+//--------------------------------------------------------------------------------------------------
+// CPU time of the calling thread, which excludes the time other threads ran on its CPU
+static uint64_t cy_bench_cpu_ns(void)
+{
+    struct timespec now;
+    (void)clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return ((uint64_t)now.tv_sec * 1000000000U) + (uint64_t)now.tv_nsec;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_bench_initialized
+//--------------------------------------------------------------------------------------------------
+static void* cy_bench_initialized(void* arg)
+{
+    cy_bench_thread_t* thread = (cy_bench_thread_t*)arg;
+    int                again  = 0;
+    (void)pthread_barrier_wait(&cy_bench_barrier);
+    uint64_t start = cy_test_now_ns();
+    uint64_t cpu   = cy_bench_cpu_ns();
+    for (long i = 0; i < cy_bench_calls; i++)
+    {
+        again |= __cxa_guard_acquire(&cy_bench_guards[0]);
+    }
+    thread->cpu_ns = cy_bench_cpu_ns() - cpu;
+    thread->ns     = cy_test_now_ns() - start;
+    CY_TEST_CHECK(0 == again);
+    return NULL;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_bench_first_use
+//--------------------------------------------------------------------------------------------------
+static void* cy_bench_first_use(void* arg)
+{
+    cy_bench_thread_t* thread = (cy_bench_thread_t*)arg;
+    uint32_t           first  = (thread->index * cy_bench_guard_count) / cy_bench_thread_count;
+    (void)pthread_barrier_wait(&cy_bench_barrier);
+    uint64_t start = cy_test_now_ns();
+    for (uint32_t i = 0U; i < cy_bench_guard_count; i++)
+    {
+        uint32_t            index = (first + i) % cy_bench_guard_count;
+        volatile uintptr_t* guard = &cy_bench_guards[index];
+        // What the compiler emits around a function-local static
+        if (0U == (cy_atomic_load(guard) & 1U))
+        {
+            if (cy_bench_global)
+            {
+                cy_mutex_pool_acquire(cy_bench_global_mutex);
+            }
+            if (0 != __cxa_guard_acquire(guard))
+            {
+                (void)usleep(cy_bench_ctor_us);
+                (void)atomic_fetch_add(&cy_bench_constructed[index], 1U);
+                __cxa_guard_release(guard);
+            }
+            if (cy_bench_global)
+            {
+                cy_mutex_pool_release(cy_bench_global_mutex);
+            }
+        }
+        CY_TEST_CHECK(1U == atomic_load(&cy_bench_constructed[index]));
+    }
+    thread->ns = cy_test_now_ns() - start;
+    return NULL;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_bench_run
+//--------------------------------------------------------------------------------------------------
+// Runs body in threads threads and returns the wall time
+static uint64_t cy_bench_run(void* (*body)(void*), uint32_t threads)
+{
+    cy_bench_thread_count = threads;
+    CY_TEST_CHECK(0 == pthread_barrier_init(&cy_bench_barrier, NULL, threads + 1U));
+    for (uint32_t i = 0U; i < threads; i++)
+    {
+        cy_bench_threads[i].index = i;
+        cy_bench_threads[i].ns    = 0U;
+        CY_TEST_CHECK(0 == pthread_create(&cy_bench_threads[i].thread, NULL, body,
+                                          &cy_bench_threads[i]));
+    }
+    // The threads cannot start before this thread reaches the barrier, but may run to the end
+    // before it leaves it
+    uint64_t start = cy_test_now_ns();
+    (void)pthread_barrier_wait(&cy_bench_barrier);
+    for (uint32_t i = 0U; i < threads; i++)
+    {
+        (void)pthread_join(cy_bench_threads[i].thread, NULL);
+    }
+    uint64_t wall = cy_test_now_ns() - start;
+    (void)pthread_barrier_destroy(&cy_bench_barrier);
+    return wall;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_bench_slowest
+//--------------------------------------------------------------------------------------------------
+static uint64_t cy_bench_slowest(uint32_t threads)
+{
+    uint64_t slowest = 0U;
+    for (uint32_t i = 0U; i < threads; i++)
+    {
+        slowest = (cy_bench_threads[i].ns > slowest) ? cy_bench_threads[i].ns : slowest;
+    }
+    return slowest;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// main
+//--------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    bool quick   = cy_test_option(argc, argv, "--quick");
+    bool text    = cy_test_option(argc, argv, "--text");
+    long threads = cy_test_value(argc, argv, "--threads", quick ? 2 : 8);
+    long guards  = cy_test_value(argc, argv, "--guards", quick ? 4 : 16);
+    long ctor_us = cy_test_value(argc, argv, "--ctor-us", quick ? 100 : 1000);
+    cy_bench_calls = cy_test_value(argc, argv, "--calls", quick ? 100000 : 10000000);
+    CY_TEST_CHECK((threads >= 1) && (threads <= (long)CY_BENCH_THREADS));
+    CY_TEST_CHECK((guards >= 1) && (guards <= (long)CY_BENCH_GUARDS) && (ctor_us >= 0));
+    CY_TEST_CHECK(cy_bench_calls > 0);
+    cy_bench_guard_count = (uint32_t)guards;
+    cy_bench_ctor_us     = (uint32_t)ctor_us;
+
+    cy_mutex_pool_setup();
+    cy_toolchain_init();
+    cy_bench_global_mutex = cy_mutex_pool_create(CY_MUTEX_POOL_ROLE_SYSTEM);
+    cy_mutex_pool_posix_kernel_start();
+
+    if (text)
+    {
+        printf("%-12s %-13s %3s %14s %14s\n", "case", "guards", "thr", "ns/call|wall us",
+               "slowest us");
+    }
+
+    // The initialized fast path
+    cy_bench_guards[0] = 0U;
+    CY_TEST_CHECK(1 == __cxa_guard_acquire(&cy_bench_guards[0]));
+    __cxa_guard_release(&cy_bench_guards[0]);
+    for (long n = 1; n <= threads; n = ((n < threads) && ((n * 2) > threads)) ? threads : (n * 2))
+    {
+        uint64_t wall = cy_bench_run(cy_bench_initialized, (uint32_t)n);
+        uint64_t cpu  = 0U;
+        for (long i = 0; i < n; i++)
+        {
+            cpu = (cy_bench_threads[i].cpu_ns > cpu) ? cy_bench_threads[i].cpu_ns : cpu;
+        }
+        double ns   = (double)cpu / (double)cy_bench_calls;
+        double rate = ((double)cy_bench_calls * (double)n * 1e9) / (double)wall;
+        if (text)
+        {
+            printf("%-12s %-13s %3ld %14.2f %14s\n", "initialized", "per_guard", n, ns, "-");
+        }
+        else
+        {
+            printf("{\"benchmark\": \"guard\", \"case\": \"initialized\", \"threads\": %ld, "
+                   "\"calls\": %ld, \"ns_per_call\": %.2f, \"calls_per_s\": %.0f}\n", n,
+                   cy_bench_calls, ns, rate);
+        }
+    }
+
+    // Concurrent first use, with per-guard state and with one global mutex
+    for (long n = 1; n <= threads; n = ((n < threads) && ((n * 2) > threads)) ? threads : (n * 2))
+    {
+        for (int global = 0; global < 2; global++)
+        {
+            cy_bench_global = (0 != global);
+            for (uint32_t i = 0U; i < cy_bench_guard_count; i++)
+            {
+                cy_bench_guards[i] = 0U;
+                atomic_store(&cy_bench_constructed[i], 0U);
+            }
+            uint64_t    wall    = cy_bench_run(cy_bench_first_use, (uint32_t)n);
+            uint64_t    slowest = cy_bench_slowest((uint32_t)n);
+            const char* mode    = cy_bench_global ? "global_mutex" : "per_guard";
+            if (text)
+            {
+                printf("%-12s %-13s %3ld %14.0f %14.0f\n", "first_use", mode, n,
+                       (double)wall / 1e3, (double)slowest / 1e3);
+            }
+            else
+            {
+                printf("{\"benchmark\": \"guard\", \"case\": \"first_use\", \"mode\": \"%s\", "
+                       "\"threads\": %ld, \"guards\": %u, \"ctor_us\": %u, \"wall_us\": %.0f, "
+                       "\"slowest_thread_us\": %.0f}\n", mode, n, cy_bench_guard_count,
+                       cy_bench_ctor_us, (double)wall / 1e3, (double)slowest / 1e3);
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,215 @@
+/***********************************************************************************************//**
+ * \file bench_heap.c
+ *
+ * \brief
+ * Host benchmark of small allocations through the block pools against the locked heap
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#include <pthread.h>
+#include "cy_test.h"
+#include "cy_clib_heap.h"
+#include "cy_mutex_pool.h"
+
+// Built twice: bench_heap with CY_CLIB_HEAP_POOL and bench_heap_locked
+// without. Each thread keeps --live blocks and replaces a random one with a
+// new block of 0 to --max-size - 1 bytes on every step, a malloc and a free
+// per step. Every run prints one JSON object per line (or a table row with
+// --text):
+//
+//     {"benchmark": "heap", "heap": "pool", "threads": 4, "steps": ..., "wall_ms": ...,
+//      "ns_per_step": ..., "pool_share": ...}
+//
+// ns_per_step is the wall time divided by the steps of all threads.
+// pool_share is the fraction of allocations the pools served.
+//
+// On a target, newlib's _malloc_r and _free_r take __malloc_lock themselves.
+// The host front end takes it around glibc in the same way (see
+// cy_clib_heap_newlib.c). Without CY_CLIB_HEAP_POOL there is no front end on
+// the host, so the benchmark takes __malloc_lock around malloc and free
+// itself.
+//
+// Options: --threads N (runs 1, 2, 4, ... N threads, default 4), --steps S
+// (per thread, default 2000000), --live L (default 8), --max-size M (default
+// 150), --text, --quick (2 threads, 20000 steps).
+
+#define CY_BENCH_THREADS    (64U)
+#define CY_BENCH_LIVE       (1024U)
+
+struct _reent;
+extern void __malloc_lock(struct _reent* reent);
+extern void __malloc_unlock(struct _reent* reent);
+extern void cy_toolchain_init(void);
+
+typedef struct
+{
+    pthread_t thread;
+    uint32_t  seed;
+    uint64_t  pooled;                   // Allocations served by the pools
+    void*     live[CY_BENCH_LIVE];
+} cy_bench_thread_t;
+
+static cy_bench_thread_t cy_bench_threads[CY_BENCH_THREADS];
+static pthread_barrier_t cy_bench_barrier;
+static long              cy_bench_steps;
+static uint32_t          cy_bench_live;
+static uint32_t          cy_bench_max_size;
+
+//--------------------------------------------------------------------------------------------------
+// cy_bench_random
+//--------------------------------------------------------------------------------------------------
+static uint32_t cy_bench_random(uint32_t* state)
+{
+    uint32_t x = *state;
+    x     ^= x << 13;
+    x     ^= x >> 17;
+    x     ^= x << 5;
+    *state = x;
+    return x;
+}
+
+
+#if defined(CY_CLIB_HEAP_POOL)
+#define cy_bench_malloc(size)   malloc(size)
+#define cy_bench_free(ptr)      free(ptr)
+#else
+//--------------------------------------------------------------------------------------------------
+// cy_bench_malloc
+//--------------------------------------------------------------------------------------------------
+static void* cy_bench_malloc(size_t size)
+{
+    __malloc_lock(NULL);
+    void* ptr = malloc(size);
+    __malloc_unlock(NULL);
+    return ptr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_bench_free
+//--------------------------------------------------------------------------------------------------
+static void cy_bench_free(void* ptr)
+{
+    __malloc_lock(NULL);
+    free(ptr);
+    __malloc_unlock(NULL);
+}
+
+
+#endif // if defined(CY_CLIB_HEAP_POOL)
+
+//--------------------------------------------------------------------------------------------------
+// cy_bench_worker
+//--------------------------------------------------------------------------------------------------
+static void* cy_bench_worker(void* arg)
+{
+    cy_bench_thread_t* thread = (cy_bench_thread_t*)arg;
+    (void)pthread_barrier_wait(&cy_bench_barrier);
+    for (long i = 0; i < cy_bench_steps; i++)
+    {
+        uint32_t random = cy_bench_random(&thread->seed);
+        uint32_t index  = random % cy_bench_live;
+        cy_bench_free(thread->live[index]);
+        thread->live[index] = cy_bench_malloc((random >> 16) % cy_bench_max_size);
+        CY_TEST_CHECK(NULL != thread->live[index]);
+        #if defined(CY_CLIB_HEAP_POOL)
+        thread->pooled += (0U != cy_clib_heap_pool_block_size(thread->live[index])) ? 1U : 0U;
+        #endif
+    }
+    (void)pthread_barrier_wait(&cy_bench_barrier);
+    for (uint32_t i = 0U; i < cy_bench_live; i++)
+    {
+        cy_bench_free(thread->live[i]);
+        thread->live[i] = NULL;
+    }
+    return NULL;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// main
+//--------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    bool quick   = cy_test_option(argc, argv, "--quick");
+    bool text    = cy_test_option(argc, argv, "--text");
+    long threads = cy_test_value(argc, argv, "--threads", quick ? 2 : 4);
+    long live    = cy_test_value(argc, argv, "--live", 8);
+    long max     = cy_test_value(argc, argv, "--max-size", 150);
+    cy_bench_steps = cy_test_value(argc, argv, "--steps", quick ? 20000 : 2000000);
+    CY_TEST_CHECK((threads > 0) && (threads <= (long)CY_BENCH_THREADS));
+    CY_TEST_CHECK((live > 0) && (live <= (long)CY_BENCH_LIVE) && (max > 0));
+    cy_bench_live     = (uint32_t)live;
+    cy_bench_max_size = (uint32_t)max;
+
+    #if defined(CY_CLIB_HEAP_POOL)
+    const char* heap = "pool";
+    #else
+    const char* heap = "locked";
+    #endif
+
+    cy_mutex_pool_setup();
+    cy_toolchain_init();
+    cy_mutex_pool_posix_kernel_start();
+
+    if (text)
+    {
+        printf("%-7s %3s %12s %12s %10s\n", "heap", "thr", "wall ms", "ns/step", "pool");
+    }
+    for (long n = 1; n <= threads; n *= 2)
+    {
+        (void)pthread_barrier_init(&cy_bench_barrier, NULL, (unsigned)n + 1U);
+        for (long t = 0; t < n; t++)
+        {
+            cy_bench_threads[t].seed   = 0x9E3779B9U * (uint32_t)(t + 1);
+            cy_bench_threads[t].pooled = 0U;
+            CY_TEST_CHECK(0 == pthread_create(&cy_bench_threads[t].thread, NULL,
+                                              cy_bench_worker, &cy_bench_threads[t]));
+        }
+        (void)pthread_barrier_wait(&cy_bench_barrier);
+        uint64_t start = cy_test_now_ns();
+        (void)pthread_barrier_wait(&cy_bench_barrier);
+        uint64_t ns     = cy_test_now_ns() - start;
+        uint64_t pooled = 0U;
+        for (long t = 0; t < n; t++)
+        {
+            (void)pthread_join(cy_bench_threads[t].thread, NULL);
+            pooled += cy_bench_threads[t].pooled;
+        }
+        (void)pthread_barrier_destroy(&cy_bench_barrier);
+
+        uint64_t steps   = (uint64_t)cy_bench_steps * (uint64_t)n;
+        double   share   = (double)pooled / (double)steps;
+        double   step_ns = (double)ns / (double)steps;
+        if (text)
+        {
+            printf("%-7s %3ld %12.1f %12.1f %10.3f\n", heap, n, (double)ns / 1e6, step_ns, share);
+        }
+        else
+        {
+            printf("{\"benchmark\": \"heap\", \"heap\": \"%s\", \"threads\": %ld, "
+                   "\"steps\": %llu, \"wall_ms\": %.1f, \"ns_per_step\": %.1f, "
+                   "\"pool_share\": %.3f}\n", heap, n, (unsigned long long)steps,
+                   (double)ns / 1e6, step_ns, share);
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,243 @@
+/***********************************************************************************************//**
+ * \file bench_inversion.c
+ *
+ * \brief
+ * Host benchmark of priority inversion on the malloc lock, with and without priority inheritance
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+// For CPU_SET and pthread_setaffinity_np
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include "cy_test.h"
+#include "cy_mutex_pool.h"
+
+// Built twice: bench_inversion with the default CY_MUTEX_POOL_INHERIT (0) and
+// bench_inversion_inherit with the malloc role in it. All threads run on one
+// CPU under SCHED_FIFO. In each run a low-priority thread takes __malloc_lock
+// and holds it for --hold-ms of CPU time. A high-priority thread then blocks
+// on the lock while a medium-priority thread burns --burn-ms of CPU time.
+// Without inheritance the medium thread keeps the holder from running, so the
+// high thread waits for about hold + burn; with inheritance the holder runs at
+// the high priority and the wait stays at about hold. Prints one JSON object
+// (or a table row with --text):
+//
+//     {"benchmark": "inversion", "inherit": true, "sched_fifo": true, "runs": 20,
+//      "hold_ms": 2, "burn_ms": 20, "wait_ms": {"p50": ..., "max": ...}}
+//
+// SCHED_FIFO needs the privilege to use it. Without it the threads run at the
+// default priority, sched_fifo is false and the waits show nothing about
+// inheritance; the benchmark still runs so that ctest checks that it works.
+//
+// Options: --runs R (default 20), --hold-ms H (default 2), --burn-ms B
+// (default 20), --text, --quick (3 runs).
+
+#define CY_BENCH_RUNS       (1000U)
+
+enum
+{
+    CY_BENCH_LOW = 1,
+    CY_BENCH_MEDIUM,
+    CY_BENCH_HIGH,
+    CY_BENCH_MAIN
+};
+
+struct _reent;
+extern void __malloc_lock(struct _reent* reent);
+extern void __malloc_unlock(struct _reent* reent);
+extern void cy_toolchain_init(void);
+
+static bool        cy_bench_fifo;
+static uint64_t    cy_bench_hold_ns;
+static uint64_t    cy_bench_burn_ns;
+static atomic_bool cy_bench_held;
+static uint64_t    cy_bench_wait_ns;
+
+//--------------------------------------------------------------------------------------------------
+// cy_bench_cpu_ns
+//--------------------------------------------------------------------------------------------------
+static uint64_t cy_bench_cpu_ns(void)
+{
+    struct timespec now;
+    (void)clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return ((uint64_t)now.tv_sec * 1000000000U) + (uint64_t)now.tv_nsec;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_bench_burn
+//--------------------------------------------------------------------------------------------------
+// Runs for ns of CPU time of the calling thread, however long it is preempted
+static void cy_bench_burn(uint64_t ns)
+{
+    uint64_t start = cy_bench_cpu_ns();
+    while ((cy_bench_cpu_ns() - start) < ns)
+    {
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_bench_low
+//--------------------------------------------------------------------------------------------------
+static void* cy_bench_low(void* arg)
+{
+    (void)arg;
+    __malloc_lock(NULL);
+    atomic_store(&cy_bench_held, true);
+    cy_bench_burn(cy_bench_hold_ns);
+    __malloc_unlock(NULL);
+    return NULL;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_bench_medium
+//--------------------------------------------------------------------------------------------------
+static void* cy_bench_medium(void* arg)
+{
+    (void)arg;
+    cy_bench_burn(cy_bench_burn_ns);
+    return NULL;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_bench_high
+//--------------------------------------------------------------------------------------------------
+static void* cy_bench_high(void* arg)
+{
+    (void)arg;
+    uint64_t start = cy_test_now_ns();
+    __malloc_lock(NULL);
+    cy_bench_wait_ns = cy_test_now_ns() - start;
+    __malloc_unlock(NULL);
+    return NULL;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_bench_start
+//--------------------------------------------------------------------------------------------------
+static pthread_t cy_bench_start(void* (*worker)(void*), int level)
+{
+    pthread_t      thread;
+    pthread_attr_t attr;
+    (void)pthread_attr_init(&attr);
+    if (cy_bench_fifo)
+    {
+        struct sched_param param;
+        param.sched_priority = sched_get_priority_min(SCHED_FIFO) + level;
+        (void)pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        (void)pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        (void)pthread_attr_setschedparam(&attr, &param);
+    }
+    CY_TEST_CHECK(0 == pthread_create(&thread, &attr, worker, NULL));
+    (void)pthread_attr_destroy(&attr);
+    return thread;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_bench_run
+//--------------------------------------------------------------------------------------------------
+// Returns the time the high-priority thread waited for the lock
+static uint64_t cy_bench_run(void)
+{
+    atomic_store(&cy_bench_held, false);
+    pthread_t low = cy_bench_start(cy_bench_low, CY_BENCH_LOW);
+    while (!atomic_load(&cy_bench_held))
+    {
+        // Lets the low thread run, as main runs above it
+        struct timespec pause = { 0, 100000L };
+        (void)nanosleep(&pause, NULL);
+    }
+
+    // Neither runs before main blocks in pthread_join, and then high blocks on the lock first
+    pthread_t high   = cy_bench_start(cy_bench_high, CY_BENCH_HIGH);
+    pthread_t medium = cy_bench_start(cy_bench_medium, CY_BENCH_MEDIUM);
+    (void)pthread_join(high, NULL);
+    (void)pthread_join(medium, NULL);
+    (void)pthread_join(low, NULL);
+    return cy_bench_wait_ns;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// main
+//--------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    static uint64_t waits[CY_BENCH_RUNS];
+    bool            quick   = cy_test_option(argc, argv, "--quick");
+    bool            text    = cy_test_option(argc, argv, "--text");
+    long            runs    = cy_test_value(argc, argv, "--runs", quick ? 3 : 20);
+    long            hold_ms = cy_test_value(argc, argv, "--hold-ms", 2);
+    long            burn_ms = cy_test_value(argc, argv, "--burn-ms", 20);
+    CY_TEST_CHECK((runs > 0) && (runs <= (long)CY_BENCH_RUNS) && (hold_ms > 0) && (burn_ms > 0));
+    cy_bench_hold_ns = (uint64_t)hold_ms * 1000000U;
+    cy_bench_burn_ns = (uint64_t)burn_ms * 1000000U;
+
+    bool inherit = ((CY_MUTEX_POOL_INHERIT & CY_MUTEX_POOL_ROLE_BIT(CY_MUTEX_POOL_ROLE_MALLOC)) !=
+                    0UL);
+
+    // One CPU for all threads, which inherit the affinity of main
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(sched_getcpu(), &cpus);
+    (void)pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    struct sched_param param;
+    param.sched_priority = sched_get_priority_min(SCHED_FIFO) + CY_BENCH_MAIN;
+    cy_bench_fifo = (0 == pthread_setschedparam(pthread_self(), SCHED_FIFO, &param));
+
+    cy_mutex_pool_setup();
+    cy_toolchain_init();
+    cy_mutex_pool_posix_kernel_start();
+
+    for (long i = 0; i < runs; i++)
+    {
+        waits[i] = cy_bench_run();
+    }
+    qsort(waits, (size_t)runs, sizeof(uint64_t), cy_test_compare_u64);
+    double p50 = (double)cy_test_percentile(waits, (size_t)runs, 500U) / 1e6;
+    double max = (double)waits[runs - 1] / 1e6;
+
+    if (text)
+    {
+        printf("%-7s %-5s %4s %7s %7s %10s %10s\n", "inherit", "fifo", "runs", "hold ms",
+               "burn ms", "p50 ms", "max ms");
+        printf("%-7s %-5s %4ld %7ld %7ld %10.2f %10.2f\n", inherit ? "yes" : "no",
+               cy_bench_fifo ? "yes" : "no", runs, hold_ms, burn_ms, p50, max);
+    }
+    else
+    {
+        printf("{\"benchmark\": \"inversion\", \"inherit\": %s, \"sched_fifo\": %s, "
+               "\"runs\": %ld, \"hold_ms\": %ld, \"burn_ms\": %ld, "
+               "\"wait_ms\": {\"p50\": %.2f, \"max\": %.2f}}\n", inherit ? "true" : "false",
+               cy_bench_fifo ? "true" : "false", runs, hold_ms, burn_ms, p50, max);
+    }
+
+    // With inheritance nothing but the holder runs between the high thread and the lock
+    CY_TEST_CHECK(!cy_bench_fifo || !inherit || (max < ((double)(hold_ms + burn_ms) / 2.0)));
+    return EXIT_SUCCESS;
+}
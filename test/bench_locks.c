@@ -0,0 +1,394 @@
+/***********************************************************************************************//**
+ * \file bench_locks.c
+ *
+ * \brief
+ * Contention benchmark for the C library lock hooks on the POSIX host backend
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include "cy_test.h"
+#include "cy_mutex_pool.h"
+
+// Each run hammers one hook from a number of threads for a fixed time. A
+// thread repeatedly takes the lock, does some work in it, releases it and does
+// the same amount of work outside of it. The time each acquire takes is
+// sampled, and the acquisitions of each thread are counted. Every run prints
+// one JSON object per line (or a table row with --text):
+//
+//     {"benchmark": "locks", "hook": "malloc", "threads": 4, "ops": ..., "ops_per_s": ...,
+//      "acquire_ns": {"p50": ..., "p99": ..., "max": ...},
+//      "fairness": {"jain": ..., "min_share": ..., "max_share": ...},
+//      "per_thread": [{"priority": ..., "ops": ..., "p99_ns": ...}, ...]}
+//
+// jain is Jain's fairness index of the per-thread counts (1 when all threads
+// acquired the lock equally often, 1/threads when one thread took them all),
+// and min_share/max_share are the smallest and largest count relative to the
+// mean. With --priorities, odd threads run at a higher SCHED_FIFO priority than
+// even ones, which needs the privilege to do so; the priority each thread
+// actually ran at is reported.
+//
+// Options: --threads N (runs 1, 2, 4, ... N threads, default 8), --ms M (per
+// run, default 1000), --work W (loop iterations in and out of the lock,
+// default 50), --hook malloc|env|pool|compact (default all), --priorities,
+// --text, --quick (2 threads, 50 ms).
+
+#define CY_BENCH_SAMPLES    (65536U)    // Acquire times kept per thread
+#define CY_BENCH_THREADS    (64U)
+
+struct _reent;
+extern void __malloc_lock(struct _reent* reent);
+extern void __malloc_unlock(struct _reent* reent);
+extern void __env_lock(struct _reent* reent);
+extern void __env_unlock(struct _reent* reent);
+extern void cy_toolchain_init(void);
+
+typedef struct
+{
+    const char* name;
+    void        (* acquire)(void);
+    void        (* release)(void);
+} cy_bench_hook_t;
+
+typedef struct
+{
+    pthread_t thread;
+    uint32_t  index;
+    int       priority;
+    uint64_t  ops;
+    uint64_t  seen;                     // Acquires sampled or skipped
+    uint64_t  max;
+    uint64_t  random;
+    uint32_t  count;                    // Valid entries in samples
+    uint64_t  samples[CY_BENCH_SAMPLES];
+} cy_bench_thread_t;
+
+static cy_mutex_pool_semaphore_t cy_bench_pool_mutex;
+static volatile cy_compact_lock_t cy_bench_compact_lock = 0U;
+
+static const cy_bench_hook_t* cy_bench_hook;
+static uint32_t               cy_bench_work;
+static atomic_bool            cy_bench_go;
+static atomic_bool            cy_bench_stop;
+static volatile uint64_t      cy_bench_shared;  // Only changed with the lock held
+static cy_bench_thread_t      cy_bench_threads[CY_BENCH_THREADS];
+
+//--------------------------------------------------------------------------------------------------
+// Hooks
+//--------------------------------------------------------------------------------------------------
+// __malloc_lock and __env_lock are the GCC Newlib hooks. The ARM (_mutex_acquire) and IAR
+// (__iar_system_Mtxlock) hooks call cy_mutex_pool_acquire on the mutex of the lock, so "pool"
+// measures their path; "compact" is the ARM path with CY_ARMLIB_COMPACT_LOCKS.
+static void cy_bench_malloc_acquire(void)
+{
+    __malloc_lock(NULL);
+}
+
+
+static void cy_bench_malloc_release(void)
+{
+    __malloc_unlock(NULL);
+}
+
+
+static void cy_bench_env_acquire(void)
+{
+    __env_lock(NULL);
+}
+
+
+static void cy_bench_env_release(void)
+{
+    __env_unlock(NULL);
+}
+
+
+static void cy_bench_pool_acquire(void)
+{
+    cy_mutex_pool_acquire(cy_bench_pool_mutex);
+}
+
+
+static void cy_bench_pool_release(void)
+{
+    cy_mutex_pool_release(cy_bench_pool_mutex);
+}
+
+
+static void cy_bench_compact_acquire(void)
+{
+    cy_compact_lock_acquire(&cy_bench_compact_lock);
+}
+
+
+static void cy_bench_compact_release(void)
+{
+    cy_compact_lock_release(&cy_bench_compact_lock);
+}
+
+
+static const cy_bench_hook_t cy_bench_hooks[] =
+{
+    { "malloc",  cy_bench_malloc_acquire,  cy_bench_malloc_release  },
+    { "env",     cy_bench_env_acquire,     cy_bench_env_release     },
+    { "pool",    cy_bench_pool_acquire,    cy_bench_pool_release    },
+    { "compact", cy_bench_compact_acquire, cy_bench_compact_release },
+};
+
+//--------------------------------------------------------------------------------------------------
+// cy_bench_spin
+//--------------------------------------------------------------------------------------------------
+static void cy_bench_spin(uint32_t iterations)
+{
+    for (volatile uint32_t i = 0U; i < iterations; i++)
+    {
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_bench_sample
+//--------------------------------------------------------------------------------------------------
+// Reservoir sampling keeps a uniform sample of the acquire times of a long run
+static void cy_bench_sample(cy_bench_thread_t* thread, uint64_t ns)
+{
+    if (ns > thread->max)
+    {
+        thread->max = ns;
+    }
+    thread->seen++;
+    if (thread->count < CY_BENCH_SAMPLES)
+    {
+        thread->samples[thread->count] = ns;
+        thread->count++;
+    }
+    else
+    {
+        // xorshift64
+        thread->random ^= thread->random << 13U;
+        thread->random ^= thread->random >> 7U;
+        thread->random ^= thread->random << 17U;
+        uint64_t slot = thread->random % thread->seen;
+        if (slot < CY_BENCH_SAMPLES)
+        {
+            thread->samples[slot] = ns;
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_bench_worker
+//--------------------------------------------------------------------------------------------------
+static void* cy_bench_worker(void* arg)
+{
+    cy_bench_thread_t* thread = (cy_bench_thread_t*)arg;
+    while (!atomic_load(&cy_bench_go))
+    {
+        sched_yield();
+    }
+    while (!atomic_load_explicit(&cy_bench_stop, memory_order_relaxed))
+    {
+        uint64_t start = cy_test_now_ns();
+        cy_bench_hook->acquire();
+        uint64_t acquired = cy_test_now_ns();
+        cy_bench_shared++;
+        cy_bench_spin(cy_bench_work);
+        cy_bench_hook->release();
+        cy_bench_sample(thread, acquired - start);
+        thread->ops++;
+        cy_bench_spin(cy_bench_work);
+    }
+    return NULL;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_bench_start_thread
+//--------------------------------------------------------------------------------------------------
+static void cy_bench_start_thread(cy_bench_thread_t* thread, bool priorities)
+{
+    pthread_attr_t attr;
+    (void)pthread_attr_init(&attr);
+    thread->priority = 0;
+    if (priorities)
+    {
+        struct sched_param param;
+        param.sched_priority = sched_get_priority_min(SCHED_FIFO) + 1 + (int)(thread->index & 1U);
+        (void)pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        (void)pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        (void)pthread_attr_setschedparam(&attr, &param);
+        if (0 == pthread_create(&thread->thread, &attr, cy_bench_worker, thread))
+        {
+            thread->priority = param.sched_priority;
+            (void)pthread_attr_destroy(&attr);
+            return;
+        }
+        // Not permitted: run at the default priority
+        (void)pthread_attr_destroy(&attr);
+        (void)pthread_attr_init(&attr);
+    }
+    CY_TEST_CHECK(0 == pthread_create(&thread->thread, &attr, cy_bench_worker, thread));
+    (void)pthread_attr_destroy(&attr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_bench_run
+//--------------------------------------------------------------------------------------------------
+static void cy_bench_run(const cy_bench_hook_t* hook, uint32_t threads, uint32_t ms,
+                         bool priorities, bool text)
+{
+    static uint64_t all[CY_BENCH_SAMPLES * CY_BENCH_THREADS];
+    uint64_t        ops     = 0U;
+    uint64_t        max     = 0U;
+    size_t          samples = 0U;
+    double          sum     = 0.0;
+    double          squares = 0.0;
+    double          least   = 0.0;
+    double          most    = 0.0;
+
+    cy_bench_hook   = hook;
+    cy_bench_shared = 0U;
+    atomic_store(&cy_bench_go, false);
+    atomic_store(&cy_bench_stop, false);
+    for (uint32_t i = 0U; i < threads; i++)
+    {
+        cy_bench_thread_t* thread = &cy_bench_threads[i];
+        thread->index  = i;
+        thread->ops    = 0U;
+        thread->seen   = 0U;
+        thread->max    = 0U;
+        thread->count  = 0U;
+        thread->random = 0x9E3779B97F4A7C15ULL + i;
+        cy_bench_start_thread(thread, priorities);
+    }
+
+    uint64_t start = cy_test_now_ns();
+    atomic_store(&cy_bench_go, true);
+    struct timespec period = { (time_t)(ms / 1000U), (long)(ms % 1000U) * 1000000L };
+    (void)nanosleep(&period, NULL);
+    atomic_store(&cy_bench_stop, true);
+    for (uint32_t i = 0U; i < threads; i++)
+    {
+        (void)pthread_join(cy_bench_threads[i].thread, NULL);
+    }
+    double seconds = (double)(cy_test_now_ns() - start) / 1e9;
+
+    for (uint32_t i = 0U; i < threads; i++)
+    {
+        const cy_bench_thread_t* thread = &cy_bench_threads[i];
+        ops     += thread->ops;
+        sum     += (double)thread->ops;
+        squares += (double)thread->ops * (double)thread->ops;
+        max      = (thread->max > max) ? thread->max : max;
+        (void)memcpy(&all[samples], thread->samples, thread->count * sizeof(uint64_t));
+        samples += thread->count;
+    }
+    // The lock must have kept the increments of the shared counter apart
+    CY_TEST_CHECK(cy_bench_shared == ops);
+    qsort(all, samples, sizeof(uint64_t), cy_test_compare_u64);
+
+    double mean = sum / threads;
+    double jain = (squares > 0.0) ? ((sum * sum) / (threads * squares)) : 1.0;
+    for (uint32_t i = 0U; i < threads; i++)
+    {
+        double share = (mean > 0.0) ? ((double)cy_bench_threads[i].ops / mean) : 1.0;
+        least = ((0U == i) || (share < least)) ? share : least;
+        most  = ((0U == i) || (share > most)) ? share : most;
+    }
+
+    uint64_t p50 = cy_test_percentile(all, samples, 500U);
+    uint64_t p99 = cy_test_percentile(all, samples, 990U);
+    if (text)
+    {
+        printf("%-8s %3u %12.0f %8llu %8llu %10llu %6.3f %6.3f %6.3f\n", hook->name, threads,
+               (double)ops / seconds, (unsigned long long)p50, (unsigned long long)p99,
+               (unsigned long long)max, jain, least, most);
+        return;
+    }
+
+    printf("{\"benchmark\": \"locks\", \"hook\": \"%s\", \"threads\": %u, \"work\": %u, "
+           "\"seconds\": %.3f, \"ops\": %llu, \"ops_per_s\": %.0f, "
+           "\"acquire_ns\": {\"p50\": %llu, \"p99\": %llu, \"max\": %llu}, "
+           "\"fairness\": {\"jain\": %.4f, \"min_share\": %.4f, \"max_share\": %.4f}, "
+           "\"per_thread\": [", hook->name, threads, cy_bench_work, seconds,
+           (unsigned long long)ops, (double)ops / seconds, (unsigned long long)p50,
+           (unsigned long long)p99, (unsigned long long)max, jain, least, most);
+    for (uint32_t i = 0U; i < threads; i++)
+    {
+        cy_bench_thread_t* thread = &cy_bench_threads[i];
+        qsort(thread->samples, thread->count, sizeof(uint64_t), cy_test_compare_u64);
+        printf("%s{\"priority\": %d, \"ops\": %llu, \"p99_ns\": %llu}", (0U == i) ? "" : ", ",
+               thread->priority, (unsigned long long)thread->ops,
+               (unsigned long long)cy_test_percentile(thread->samples, thread->count, 990U));
+    }
+    printf("]}\n");
+    (void)fflush(stdout);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// main
+//--------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    bool        quick      = cy_test_option(argc, argv, "--quick");
+    bool        text       = cy_test_option(argc, argv, "--text");
+    bool        priorities = cy_test_option(argc, argv, "--priorities");
+    long        threads    = cy_test_value(argc, argv, "--threads", quick ? 2 : 8);
+    long        ms         = cy_test_value(argc, argv, "--ms", quick ? 50 : 1000);
+    const char* only       = NULL;
+    for (int i = 1; i < (argc - 1); i++)
+    {
+        if (0 == strcmp(argv[i], "--hook"))
+        {
+            only = argv[i + 1];
+        }
+    }
+    CY_TEST_CHECK((threads >= 1) && (threads <= (long)CY_BENCH_THREADS) && (ms > 0));
+    cy_bench_work = (uint32_t)cy_test_value(argc, argv, "--work", 50);
+
+    cy_mutex_pool_setup();
+    cy_toolchain_init();
+    cy_bench_pool_mutex = cy_mutex_pool_create(CY_MUTEX_POOL_ROLE_SYSTEM);
+    cy_mutex_pool_posix_kernel_start();
+
+    if (text)
+    {
+        printf("%-8s %3s %12s %8s %8s %10s %6s %6s %6s\n", "hook", "thr", "ops/s", "p50 ns",
+               "p99 ns", "max ns", "jain", "min", "max");
+    }
+    for (size_t h = 0U; h < (sizeof(cy_bench_hooks) / sizeof(cy_bench_hooks[0])); h++)
+    {
+        if ((NULL == only) || (0 == strcmp(only, cy_bench_hooks[h].name)))
+        {
+            for (long n = 1; n <= threads; n = (n < threads) && ((n * 2) > threads) ? threads :
+                                                (n * 2))
+            {
+                cy_bench_run(&cy_bench_hooks[h], (uint32_t)n, (uint32_t)ms, priorities, text);
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
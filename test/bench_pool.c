@@ -0,0 +1,201 @@
+/***********************************************************************************************//**
+ * \file bench_pool.c
+ *
+ * \brief
+ * Host benchmark of mutex pool create and destroy as the pool grows
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#include <pthread.h>
+#include "cy_test.h"
+#include "cy_mutex_pool.h"
+#include "cy_mutex_pool_cfg.h"
+
+// Built once per pool size (CY_STATIC_MUTEX_MAX). Each run creates and
+// destroys one mutex --pairs times and prints one JSON object per line (or a
+// table row with --text):
+//
+//     {"benchmark": "pool", "pool_size": 128, "slots": "bitmap", "fill": "full",
+//      "ns_per_pair": ...}
+//
+// slots "bitmap" is cy_mutex_pool_create and cy_mutex_pool_destroy. slots
+// "scan" is the same work with the slot search the backends used before the
+// free-slot bitmap: create scans the handles for a free one and destroy scans
+// them for the handle, both under the pool lock. With fill "empty" the mutex
+// takes the first slot; with fill "full" every other slot is taken, so the
+// scans walk the whole pool. The bitmap should cost the same at every pool
+// size and fill, and the scans should grow with the pool size when it is full.
+//
+// Options: --pairs P (default 1000000), --text, --quick (10000 pairs).
+
+typedef struct
+{
+    const char*               name;
+    cy_mutex_pool_semaphore_t (* create)(void);
+    void                      (* destroy)(cy_mutex_pool_semaphore_t m);
+} cy_bench_slots_t;
+
+static pthread_mutex_t           cy_bench_scan_storage[CY_STATIC_MUTEX_MAX];
+static cy_mutex_pool_semaphore_t cy_bench_scan_handle[CY_STATIC_MUTEX_MAX];
+static pthread_mutex_t           cy_bench_scan_lock = PTHREAD_MUTEX_INITIALIZER;
+static cy_mutex_pool_semaphore_t cy_bench_fill[CY_STATIC_MUTEX_MAX];
+
+//--------------------------------------------------------------------------------------------------
+// cy_bench_bitmap_create
+//--------------------------------------------------------------------------------------------------
+static cy_mutex_pool_semaphore_t cy_bench_bitmap_create(void)
+{
+    return cy_mutex_pool_create(CY_MUTEX_POOL_ROLE_SYSTEM);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_bench_scan_create
+//--------------------------------------------------------------------------------------------------
+static cy_mutex_pool_semaphore_t cy_bench_scan_create(void)
+{
+    cy_mutex_pool_semaphore_t handle = NULL;
+    int32_t                   found  = -1;
+    pthread_mutexattr_t       attr;
+
+    (void)pthread_mutex_lock(&cy_bench_scan_lock);
+    for (int32_t i = 0; i < (int32_t)(CY_STATIC_MUTEX_MAX); i++)
+    {
+        if (NULL == cy_bench_scan_handle[i])
+        {
+            found                       = i;
+            cy_bench_scan_handle[found] = (cy_mutex_pool_semaphore_t)1;
+            break;
+        }
+    }
+    (void)pthread_mutex_unlock(&cy_bench_scan_lock);
+
+    if (found >= 0)
+    {
+        handle = &cy_bench_scan_storage[found];
+        (void)pthread_mutexattr_init(&attr);
+        (void)pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+        (void)pthread_mutex_init(handle, &attr);
+        (void)pthread_mutexattr_destroy(&attr);
+        cy_bench_scan_handle[found] = handle;
+    }
+    return handle;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_bench_scan_destroy
+//--------------------------------------------------------------------------------------------------
+static void cy_bench_scan_destroy(cy_mutex_pool_semaphore_t m)
+{
+    (void)pthread_mutex_destroy(m);
+    (void)pthread_mutex_lock(&cy_bench_scan_lock);
+    for (int32_t i = 0; i < (int32_t)(CY_STATIC_MUTEX_MAX); i++)
+    {
+        if (cy_bench_scan_handle[i] == m)
+        {
+            cy_bench_scan_handle[i] = NULL;
+            break;
+        }
+    }
+    (void)pthread_mutex_unlock(&cy_bench_scan_lock);
+}
+
+
+static const cy_bench_slots_t cy_bench_slots[] =
+{
+    { "bitmap", cy_bench_bitmap_create, cy_mutex_pool_destroy },
+    { "scan",   cy_bench_scan_create,   cy_bench_scan_destroy },
+};
+
+//--------------------------------------------------------------------------------------------------
+// cy_bench_run
+//--------------------------------------------------------------------------------------------------
+// Returns the nanoseconds per create and destroy pair
+static double cy_bench_run(const cy_bench_slots_t* slots, bool full, long pairs)
+{
+    uint32_t filled = 0U;
+    if (full)
+    {
+        // Leave only the last slot free
+        for (; filled < ((uint32_t)(CY_STATIC_MUTEX_MAX) - 1U); filled++)
+        {
+            cy_bench_fill[filled] = slots->create();
+            CY_TEST_CHECK(NULL != cy_bench_fill[filled]);
+        }
+    }
+
+    uint64_t start = cy_test_now_ns();
+    for (long i = 0; i < pairs; i++)
+    {
+        cy_mutex_pool_semaphore_t m = slots->create();
+        CY_TEST_CHECK(NULL != m);
+        slots->destroy(m);
+    }
+    uint64_t ns = cy_test_now_ns() - start;
+
+    while (filled > 0U)
+    {
+        filled--;
+        slots->destroy(cy_bench_fill[filled]);
+    }
+    return (double)ns / (double)pairs;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// main
+//--------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    bool quick = cy_test_option(argc, argv, "--quick");
+    bool text  = cy_test_option(argc, argv, "--text");
+    long pairs = cy_test_value(argc, argv, "--pairs", quick ? 10000 : 1000000);
+    CY_TEST_CHECK(pairs > 0);
+
+    // The C library locks are not created, so the whole pool is available
+    cy_mutex_pool_setup();
+
+    if (text)
+    {
+        printf("%9s %-7s %-6s %12s\n", "pool_size", "slots", "fill", "ns/pair");
+    }
+    for (size_t s = 0U; s < (sizeof(cy_bench_slots) / sizeof(cy_bench_slots[0])); s++)
+    {
+        for (uint32_t full = 0U; full < 2U; full++)
+        {
+            const char* fill = (0U != full) ? "full" : "empty";
+            double      ns   = cy_bench_run(&cy_bench_slots[s], 0U != full, pairs);
+            if (text)
+            {
+                printf("%9u %-7s %-6s %12.1f\n", (unsigned)(CY_STATIC_MUTEX_MAX),
+                       cy_bench_slots[s].name, fill, ns);
+            }
+            else
+            {
+                printf("{\"benchmark\": \"pool\", \"pool_size\": %u, \"slots\": \"%s\", "
+                       "\"fill\": \"%s\", \"ns_per_pair\": %.1f}\n",
+                       (unsigned)(CY_STATIC_MUTEX_MAX), cy_bench_slots[s].name, fill, ns);
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,274 @@
+/***********************************************************************************************//**
+ * \file bench_time.c
+ *
+ * \brief
+ * Benchmark of time() and the clocks against a stand-in RTC on the POSIX host backend
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "cy_test.h"
+#include "cy_test_rtc.h"
+#include "cy_time.h"
+#include "cy_mutex_pool.h"
+
+// Threads call one clock in a loop for a fixed time. For each run one JSON
+// object is printed per line (or a table row with --text):
+//
+//     {"benchmark": "time", "clock": "time", "threads": 2, "ns_per_call": ...,
+//      "calls_per_s": ..., "rtc_reads_per_million": ..., "backward": 0, "max_error_s": 0}
+//
+// ns_per_call is the CPU time per call of the slowest thread, which does not
+// include the time other threads ran on the same CPU. rtc_reads_per_million
+// counts reads of the stand-in RTC, which busy-waits --rtc-ns nanoseconds per
+// read. backward counts results smaller than the previous one of the same
+// thread, and max_error_s is the largest difference between time() and the
+// stand-in RTC, sampled every 1024 calls.
+//
+// Clocks: time (time()), realtime (mtb_clib_support_realtime_us), monotonic
+// (mtb_clib_support_monotonic_us) and rtc_locked, which reads the RTC under
+// cy_timer_mutex and converts it on every call for comparison. time() reads
+// the RTC on every call unless the benchmark is built with CY_TIME_CACHE
+// (bench_time_cache).
+//
+// Options: --threads N (runs 1, 2, 4, ... N threads, default 4), --ms M (per
+// run, default 500), --rtc-ns D (default 2000), --text, --quick.
+
+#define CY_BENCH_THREADS    (64U)
+
+extern cy_mutex_pool_semaphore_t cy_timer_mutex;
+extern void cy_toolchain_init(void);
+
+typedef enum
+{
+    CY_BENCH_TIME,
+    CY_BENCH_REALTIME,
+    CY_BENCH_MONOTONIC,
+    CY_BENCH_RTC_LOCKED,
+    CY_BENCH_CLOCKS
+} cy_bench_clock_t;
+
+static const char* const cy_bench_clock_names[CY_BENCH_CLOCKS] =
+{
+    "time", "realtime", "monotonic", "rtc_locked"
+};
+
+typedef struct
+{
+    pthread_t thread;
+    uint64_t  calls;
+    uint64_t  cpu_ns;
+    uint64_t  backward;
+    int64_t   max_error;
+} cy_bench_thread_t;
+
+static cy_bench_clock_t  cy_bench_clock;
+static atomic_bool       cy_bench_stop;
+static pthread_barrier_t cy_bench_barrier;
+static cy_bench_thread_t cy_bench_threads[CY_BENCH_THREADS];
+
+//--------------------------------------------------------------------------------------------------
+// cy_bench_cpu_ns
+//--------------------------------------------------------------------------------------------------
+static uint64_t cy_bench_cpu_ns(void)
+{
+    struct timespec now;
+    (void)clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return ((uint64_t)now.tv_sec * 1000000000U) + (uint64_t)now.tv_nsec;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_bench_read
+//--------------------------------------------------------------------------------------------------
+static int64_t cy_bench_read(void)
+{
+    int64_t value = 0;
+    switch (cy_bench_clock)
+    {
+        case CY_BENCH_TIME:
+            value = (int64_t)time(NULL);
+            break;
+
+        case CY_BENCH_REALTIME:
+            CY_TEST_CHECK(mtb_clib_support_realtime_us(&value));
+            break;
+
+        case CY_BENCH_MONOTONIC:
+            value = (int64_t)mtb_clib_support_monotonic_us();
+            break;
+
+        default:
+        {
+            struct tm rtc_time;
+            cy_mutex_pool_acquire(cy_timer_mutex);
+            (void)mtb_hal_rtc_read(&cy_test_rtc, &rtc_time);
+            value = (int64_t)timegm(&rtc_time);
+            cy_mutex_pool_release(cy_timer_mutex);
+            break;
+        }
+    }
+    return value;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_bench_worker
+//--------------------------------------------------------------------------------------------------
+static void* cy_bench_worker(void* arg)
+{
+    cy_bench_thread_t* thread   = (cy_bench_thread_t*)arg;
+    int64_t            previous = INT64_MIN;
+    (void)pthread_barrier_wait(&cy_bench_barrier);
+    uint64_t cpu = cy_bench_cpu_ns();
+    while (!atomic_load_explicit(&cy_bench_stop, memory_order_relaxed))
+    {
+        int64_t value = cy_bench_read();
+        if (value < previous)
+        {
+            thread->backward++;
+        }
+        previous = value;
+        thread->calls++;
+        if ((CY_BENCH_TIME == cy_bench_clock) && (0U == (thread->calls & 1023U)))
+        {
+            int64_t error = value - (int64_t)cy_test_rtc_now();
+            error = (error < 0) ? -error : error;
+            thread->max_error = (error > thread->max_error) ? error : thread->max_error;
+        }
+    }
+    thread->cpu_ns = cy_bench_cpu_ns() - cpu;
+    return NULL;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_bench_run
+//--------------------------------------------------------------------------------------------------
+static void cy_bench_run(cy_bench_clock_t clock, uint32_t threads, uint32_t ms, bool text)
+{
+    uint64_t calls    = 0U;
+    uint64_t back     = 0U;
+    int64_t  error    = 0;
+    double   per_call = 0.0;
+
+    cy_bench_clock = clock;
+    atomic_store(&cy_bench_stop, false);
+    CY_TEST_CHECK(0 == pthread_barrier_init(&cy_bench_barrier, NULL, threads + 1U));
+    for (uint32_t i = 0U; i < threads; i++)
+    {
+        (void)memset(&cy_bench_threads[i], 0, sizeof(cy_bench_threads[i]));
+        CY_TEST_CHECK(0 == pthread_create(&cy_bench_threads[i].thread, NULL, cy_bench_worker,
+                                          &cy_bench_threads[i]));
+    }
+    uintptr_t reads = cy_test_rtc_reads;
+    uint64_t  start = cy_test_now_ns();
+    (void)pthread_barrier_wait(&cy_bench_barrier);
+    struct timespec period = { (time_t)(ms / 1000U), (long)(ms % 1000U) * 1000000L };
+    (void)nanosleep(&period, NULL);
+    atomic_store(&cy_bench_stop, true);
+    for (uint32_t i = 0U; i < threads; i++)
+    {
+        (void)pthread_join(cy_bench_threads[i].thread, NULL);
+    }
+    double seconds = (double)(cy_test_now_ns() - start) / 1e9;
+    reads = cy_test_rtc_reads - reads;
+    (void)pthread_barrier_destroy(&cy_bench_barrier);
+
+    for (uint32_t i = 0U; i < threads; i++)
+    {
+        const cy_bench_thread_t* thread = &cy_bench_threads[i];
+        double                   ns     = (double)thread->cpu_ns / (double)thread->calls;
+        calls   += thread->calls;
+        back    += thread->backward;
+        error    = (thread->max_error > error) ? thread->max_error : error;
+        per_call = (ns > per_call) ? ns : per_call;
+    }
+    double per_m = ((double)reads * 1e6) / (double)calls;
+    if (text)
+    {
+        printf("%-11s %3u %10.1f %12.0f %12.1f %8llu %6lld\n", cy_bench_clock_names[clock],
+               threads, per_call, (double)calls / seconds, per_m, (unsigned long long)back,
+               (long long)error);
+    }
+    else
+    {
+        printf("{\"benchmark\": \"time\", \"clock\": \"%s\", \"threads\": %u, "
+               "\"ns_per_call\": %.1f, \"calls_per_s\": %.0f, \"rtc_reads_per_million\": %.1f, "
+               "\"backward\": %llu, \"max_error_s\": %lld}\n", cy_bench_clock_names[clock],
+               threads, per_call, (double)calls / seconds, per_m, (unsigned long long)back,
+               (long long)error);
+    }
+    (void)fflush(stdout);
+    // Clocks must never run backwards, and time() must follow the RTC
+    CY_TEST_CHECK(0U == back);
+    CY_TEST_CHECK(error <= 1);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// main
+//--------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    bool quick   = cy_test_option(argc, argv, "--quick");
+    bool text    = cy_test_option(argc, argv, "--text");
+    long threads = cy_test_value(argc, argv, "--threads", quick ? 2 : 4);
+    long ms      = cy_test_value(argc, argv, "--ms", quick ? 50 : 500);
+    CY_TEST_CHECK((threads >= 1) && (threads <= (long)CY_BENCH_THREADS) && (ms > 0));
+    cy_test_rtc_delay_ns = (uint32_t)cy_test_value(argc, argv, "--rtc-ns", 2000);
+
+    cy_mutex_pool_setup();
+    cy_toolchain_init();
+    cy_mutex_pool_posix_kernel_start();
+    mtb_clib_support_init(&cy_test_rtc);
+
+    if (text)
+    {
+        printf("%-11s %3s %10s %12s %12s %8s %6s\n", "clock", "thr", "ns/call", "calls/s",
+               "rtc/M", "back", "err s");
+    }
+    for (uint32_t c = 0U; c < (uint32_t)CY_BENCH_CLOCKS; c++)
+    {
+        for (long n = 1; n <= threads;
+             n = ((n < threads) && ((n * 2) > threads)) ? threads : (n * 2))
+        {
+            cy_bench_run((cy_bench_clock_t)c, (uint32_t)n, (uint32_t)ms, text);
+        }
+    }
+
+    // A new time written to the RTC is taken over on resync
+    time_t    target = cy_test_rtc_now() + 3600;
+    struct tm written;
+    (void)gmtime_r(&target, &written);
+    (void)mtb_hal_rtc_write(&cy_test_rtc, &written);
+    mtb_clib_support_time_resync();
+    CY_TEST_CHECK((time(NULL) - cy_test_rtc_now()) <= 1);
+    CY_TEST_CHECK((cy_test_rtc_now() - time(NULL)) <= 1);
+
+    // The logging timestamp follows the realtime clock without reading the RTC
+    uintptr_t reads = cy_test_rtc_reads;
+    int64_t   stamp = mtb_clib_support_timestamp_us() / 1000000;
+    CY_TEST_CHECK(reads == cy_test_rtc_reads);
+    CY_TEST_CHECK(((stamp - cy_test_rtc_now()) <= 1) && ((cy_test_rtc_now() - stamp) <= 1));
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,116 @@
+/***********************************************************************************************//**
+ * \file cy_test.h
+ *
+ * \brief
+ * Helpers shared by the host tests and benchmarks
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Stops the test with the location of the first check that fails
+#define CY_TEST_CHECK(condition)                                                   \
+    do                                                                             \
+    {                                                                              \
+        if (!(condition))                                                          \
+        {                                                                          \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,       \
+                    #condition);                                                   \
+            exit(EXIT_FAILURE);                                                    \
+        }                                                                          \
+    } while (false)
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_now_ns
+//--------------------------------------------------------------------------------------------------
+static inline uint64_t cy_test_now_ns(void)
+{
+    struct timespec now;
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000000U) + (uint64_t)now.tv_nsec;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_option
+//--------------------------------------------------------------------------------------------------
+// Returns whether the flag name (such as "--quick") was given
+static inline bool cy_test_option(int argc, char** argv, const char* name)
+{
+    bool found = false;
+    for (int i = 1; (i < argc) && !found; i++)
+    {
+        found = (0 == strcmp(argv[i], name));
+    }
+    return found;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_value
+//--------------------------------------------------------------------------------------------------
+// Returns the value given for name as "name value", or fallback
+static inline long cy_test_value(int argc, char** argv, const char* name, long fallback)
+{
+    long value = fallback;
+    for (int i = 1; i < (argc - 1); i++)
+    {
+        if (0 == strcmp(argv[i], name))
+        {
+            value = strtol(argv[i + 1], NULL, 0);
+        }
+    }
+    return value;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_compare_u64
+//--------------------------------------------------------------------------------------------------
+static inline int cy_test_compare_u64(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_percentile
+//--------------------------------------------------------------------------------------------------
+// Returns the value below which per_mille thousandths of the sorted samples fall
+static inline uint64_t cy_test_percentile(const uint64_t* sorted, size_t count, uint32_t per_mille)
+{
+    uint64_t value = 0U;
+    if (0U != count)
+    {
+        size_t index = (size_t)(((uint64_t)count * per_mille) / 1000U);
+        value = sorted[(index < count) ? index : (count - 1U)];
+    }
+    return value;
+}
@@ -0,0 +1,38 @@
+/***********************************************************************************************//**
+ * \file cy_test_heap.c
+ *
+ * \brief
+ * Host stand-in for the heap that the linker script reserves on a target
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+// _sbrk takes the heap from __HeapBase to __HeapLimit, which the linker script
+// defines on a target. The host executables reserve 1 MiB for it.
+__asm__ (
+    "    .bss\n"
+    "    .balign 16\n"
+    "    .globl __HeapBase\n"
+    "__HeapBase:\n"
+    "    .space 0x100000\n"
+    "    .globl __HeapLimit\n"
+    "__HeapLimit:\n"
+    "    .text\n"
+    );
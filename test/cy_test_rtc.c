@@ -0,0 +1,81 @@
+/***********************************************************************************************//**
+ * \file cy_test_rtc.c
+ *
+ * \brief
+ * Stand-in RTC for the host tests and benchmarks of time()
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#include "cy_test.h"
+#include "cy_test_rtc.h"
+#include "cy_clib_support_atomic.h"
+
+mtb_hal_rtc_t      cy_test_rtc;
+volatile uintptr_t cy_test_rtc_reads    = 0U;
+volatile time_t    cy_test_rtc_offset   = 0;
+uint32_t           cy_test_rtc_delay_ns = 0U;
+const struct tm*   cy_test_rtc_fixed    = NULL;
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_rtc_now
+//--------------------------------------------------------------------------------------------------
+time_t cy_test_rtc_now(void)
+{
+    struct timespec now;
+    (void)clock_gettime(CLOCK_REALTIME, &now);
+    return now.tv_sec + cy_test_rtc_offset;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// mtb_hal_rtc_read
+//--------------------------------------------------------------------------------------------------
+cy_rslt_t mtb_hal_rtc_read(mtb_hal_rtc_t* obj, struct tm* time)
+{
+    (void)obj;
+    (void)cy_atomic_add(&cy_test_rtc_reads, 1U);
+    if (NULL != cy_test_rtc_fixed)
+    {
+        *time = *cy_test_rtc_fixed;
+    }
+    else
+    {
+        uint64_t until   = cy_test_now_ns() + cy_test_rtc_delay_ns;
+        time_t   seconds = cy_test_rtc_now();
+        while (cy_test_now_ns() < until)
+        {
+        }
+        (void)gmtime_r(&seconds, time);
+    }
+    return CY_RSLT_SUCCESS;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// mtb_hal_rtc_write
+//--------------------------------------------------------------------------------------------------
+cy_rslt_t mtb_hal_rtc_write(mtb_hal_rtc_t* obj, const struct tm* time)
+{
+    (void)obj;
+    struct tm copy = *time;
+    cy_test_rtc_offset += timegm(&copy) - cy_test_rtc_now();
+    return CY_RSLT_SUCCESS;
+}
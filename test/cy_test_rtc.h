@@ -0,0 +1,45 @@
+/***********************************************************************************************//**
+ * \file cy_test_rtc.h
+ *
+ * \brief
+ * Stand-in RTC for the host tests and benchmarks of time()
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+#include "mtb_hal.h"
+
+// The stand-in RTC runs on the host realtime clock plus cy_test_rtc_offset
+// seconds. Each read busy-waits cy_test_rtc_delay_ns, standing in for the
+// register access and BCD conversion of a real RTC, and is counted. If
+// cy_test_rtc_fixed is set, reads return that calendar time instead.
+
+extern mtb_hal_rtc_t      cy_test_rtc;
+extern volatile uintptr_t cy_test_rtc_reads;
+extern volatile time_t    cy_test_rtc_offset;
+extern uint32_t           cy_test_rtc_delay_ns;
+extern const struct tm*   cy_test_rtc_fixed;
+
+/** Seconds since the epoch the stand-in RTC reads now */
+time_t cy_test_rtc_now(void);
@@ -0,0 +1,34 @@
+/***********************************************************************************************//**
+ * \file cy_utils.h
+ *
+ * \brief
+ * Host stand-in for the parts of the PDL utilities header that the library uses
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <assert.h>
+
+#define CY_MISRA_DEVIATE_BLOCK_START(id, count, reason)
+#define CY_MISRA_BLOCK_END(id)
+
+#define CY_ASSERT(condition)    assert(condition)
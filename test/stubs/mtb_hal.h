@@ -0,0 +1,48 @@
+/***********************************************************************************************//**
+ * \file mtb_hal.h
+ *
+ * \brief
+ * Host stand-in for the parts of the HAL that the library uses (the RTC)
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include "cy_utils.h"
+
+// The RTC functions are provided by test/cy_test_rtc.c
+
+#define MTB_HAL_API_VERSION             (3)
+#define MTB_HAL_DRIVER_AVAILABLE_RTC    (1)
+
+typedef uint32_t cy_rslt_t;
+#define CY_RSLT_SUCCESS                 ((cy_rslt_t)0U)
+
+typedef struct
+{
+    int unused;
+} mtb_hal_rtc_t;
+
+cy_rslt_t mtb_hal_rtc_read(mtb_hal_rtc_t* obj, struct tm* time);
+cy_rslt_t mtb_hal_rtc_write(mtb_hal_rtc_t* obj, const struct tm* time);
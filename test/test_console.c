@@ -0,0 +1,266 @@
+/***********************************************************************************************//**
+ * \file test_console.c
+ *
+ * \brief
+ * Host test of the line buffers of the buffered console on the POSIX host backend
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include "cy_test.h"
+#include "cy_console.h"
+#include "cy_mutex_pool.h"
+
+// Built with CY_CONSOLE and a CY_CONSOLE_LINE_TIMEOUT of 200 ms. A thread
+// drains the console into a capture buffer while the checks run:
+//
+// - A prompt written a character at a time, without a newline, reaches the
+//   sink once it has not grown for the timeout, and not long before.
+// - Threads that exit with a partial line do not keep their line buffers:
+//   their output reaches the sink, and a new thread gets a buffer again.
+// - Lines written a character at a time by several threads at once do not
+//   interleave.
+
+#define CY_TEST_CAPTURE_SIZE    (65536U)
+#define CY_TEST_WRITERS         (4U)
+#define CY_TEST_LINES           (200U)
+
+extern void cy_toolchain_init(void);
+
+static pthread_mutex_t cy_test_capture_lock = PTHREAD_MUTEX_INITIALIZER;
+static char            cy_test_capture[CY_TEST_CAPTURE_SIZE];
+static size_t          cy_test_captured;
+static atomic_bool     cy_test_stop;
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_sink
+//--------------------------------------------------------------------------------------------------
+static void cy_test_sink(void* context, const uint8_t* data, size_t size)
+{
+    (void)context;
+    (void)pthread_mutex_lock(&cy_test_capture_lock);
+    CY_TEST_CHECK((cy_test_captured + size) < CY_TEST_CAPTURE_SIZE);
+    (void)memcpy(&cy_test_capture[cy_test_captured], data, size);
+    cy_test_captured                  += size;
+    cy_test_capture[cy_test_captured] = '\0';
+    (void)pthread_mutex_unlock(&cy_test_capture_lock);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_contains
+//--------------------------------------------------------------------------------------------------
+static bool cy_test_contains(const char* text)
+{
+    (void)pthread_mutex_lock(&cy_test_capture_lock);
+    bool found = (NULL != strstr(cy_test_capture, text));
+    (void)pthread_mutex_unlock(&cy_test_capture_lock);
+    return found;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_wait_for
+//--------------------------------------------------------------------------------------------------
+// Returns the milliseconds until text was captured, checking that it is within limit_ms
+static uint64_t cy_test_wait_for(const char* text, uint64_t limit_ms)
+{
+    uint64_t start = cy_test_now_ns();
+    while (!cy_test_contains(text))
+    {
+        CY_TEST_CHECK((cy_test_now_ns() - start) < (limit_ms * 1000000U));
+        (void)usleep(1000U);
+    }
+    return (cy_test_now_ns() - start) / 1000000U;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_reset
+//--------------------------------------------------------------------------------------------------
+static void cy_test_reset(void)
+{
+    (void)pthread_mutex_lock(&cy_test_capture_lock);
+    cy_test_captured   = 0U;
+    cy_test_capture[0] = '\0';
+    (void)pthread_mutex_unlock(&cy_test_capture_lock);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_put
+//--------------------------------------------------------------------------------------------------
+// Writes text a character at a time, as unbuffered stdio does
+static void cy_test_put(const char* text)
+{
+    for (; '\0' != *text; text++)
+    {
+        (void)cy_console_write(text, 1U);
+        (void)sched_yield();
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_drain
+//--------------------------------------------------------------------------------------------------
+static void* cy_test_drain(void* arg)
+{
+    (void)arg;
+    while (!atomic_load(&cy_test_stop))
+    {
+        (void)cy_console_drain(true);
+    }
+    return NULL;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_partial
+//--------------------------------------------------------------------------------------------------
+// Writes a partial line and exits
+static void* cy_test_partial(void* arg)
+{
+    cy_test_put((const char*)arg);
+    return NULL;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_writer
+//--------------------------------------------------------------------------------------------------
+static void* cy_test_writer(void* arg)
+{
+    char line[16];
+    (void)memset(line, 'a' + (int)(uintptr_t)arg, 12U);
+    line[12] = '\n';
+    line[13] = '\0';
+    for (uint32_t i = 0U; i < CY_TEST_LINES; i++)
+    {
+        cy_test_put(line);
+    }
+    return NULL;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_prompt
+//--------------------------------------------------------------------------------------------------
+static void* cy_test_prompt(void* arg)
+{
+    (void)arg;
+    cy_test_put("login: ");
+    // Stays alive with the prompt in its line buffer while it is checked
+    (void)usleep(500000U);
+    return NULL;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// main
+//--------------------------------------------------------------------------------------------------
+int main(void)
+{
+    pthread_t drain;
+    pthread_t threads[CY_TEST_WRITERS * 2U];
+
+    cy_mutex_pool_setup();
+    cy_toolchain_init();
+    cy_mutex_pool_posix_kernel_start();
+    cy_console_set_sink(cy_test_sink, NULL);
+    CY_TEST_CHECK(0 == pthread_create(&drain, NULL, cy_test_drain, NULL));
+
+    // A prompt reaches the sink after the timeout, although its task is still running
+    CY_TEST_CHECK(0 == pthread_create(&threads[0], NULL, cy_test_prompt, NULL));
+    uint64_t prompt_ms = cy_test_wait_for("login: ", 900U);
+    CY_TEST_CHECK((prompt_ms >= (CY_CONSOLE_LINE_TIMEOUT / 2U)) &&
+                  (prompt_ms <= (CY_CONSOLE_LINE_TIMEOUT * 2U)));
+    (void)pthread_join(threads[0], NULL);
+
+    // Twice as many threads as line buffers exit with partial lines, in two rounds
+    cy_test_reset();
+    static const char* const partial[CY_TEST_WRITERS * 2U] =
+    {
+        "p0", "p1", "p2", "p3", "q0", "q1", "q2", "q3"
+    };
+    for (uint32_t round = 0U; round < 2U; round++)
+    {
+        for (uint32_t i = 0U; i < CY_TEST_WRITERS; i++)
+        {
+            uint32_t index = (round * CY_TEST_WRITERS) + i;
+            CY_TEST_CHECK(0 == pthread_create(&threads[index], NULL, cy_test_partial,
+                                              (void*)partial[index]));
+        }
+        for (uint32_t i = 0U; i < CY_TEST_WRITERS; i++)
+        {
+            uint32_t index = (round * CY_TEST_WRITERS) + i;
+            (void)pthread_join(threads[index], NULL);
+            (void)cy_test_wait_for(partial[index], 900U);
+        }
+    }
+    // All buffers are free again, so a new partial line is held until the timeout
+    CY_TEST_CHECK(0 == pthread_create(&threads[0], NULL, cy_test_partial, (void*)"held"));
+    (void)pthread_join(threads[0], NULL);
+    (void)usleep(20000U);
+    CY_TEST_CHECK(!cy_test_contains("held"));
+    (void)cy_test_wait_for("held", 900U);
+
+    // Lines written a character at a time by several threads do not interleave
+    cy_test_reset();
+    for (uint32_t i = 0U; i < CY_TEST_WRITERS; i++)
+    {
+        CY_TEST_CHECK(0 == pthread_create(&threads[i], NULL, cy_test_writer, (void*)(uintptr_t)i));
+    }
+    for (uint32_t i = 0U; i < CY_TEST_WRITERS; i++)
+    {
+        (void)pthread_join(threads[i], NULL);
+    }
+    uint64_t start = cy_test_now_ns();
+    (void)pthread_mutex_lock(&cy_test_capture_lock);
+    while (cy_test_captured < (CY_TEST_WRITERS * CY_TEST_LINES * 13U))
+    {
+        (void)pthread_mutex_unlock(&cy_test_capture_lock);
+        CY_TEST_CHECK((cy_test_now_ns() - start) < 1000000000U);
+        (void)usleep(1000U);
+        (void)pthread_mutex_lock(&cy_test_capture_lock);
+    }
+    CY_TEST_CHECK((CY_TEST_WRITERS * CY_TEST_LINES * 13U) == cy_test_captured);
+    for (size_t i = 0U; i < cy_test_captured; i += 13U)
+    {
+        CY_TEST_CHECK(0 == memcmp(&cy_test_capture[i], &cy_test_capture[i + 1U], 11U));
+        CY_TEST_CHECK('\n' == cy_test_capture[i + 12U]);
+    }
+    (void)pthread_mutex_unlock(&cy_test_capture_lock);
+
+    atomic_store(&cy_test_stop, true);
+    (void)cy_console_write("\n", 1U);
+    (void)pthread_join(drain, NULL);
+
+    cy_console_stats_t stats;
+    cy_console_get_stats(&stats);
+    CY_TEST_CHECK(0U == stats.dropped);
+    printf("{\"test\": \"console\", \"prompt_ms\": %llu, \"written\": %u, \"drained\": %u}\n",
+           (unsigned long long)prompt_ms, stats.written, stats.drained);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,436 @@
+/***********************************************************************************************//**
+ * \file test_heap_region.c
+ *
+ * \brief
+ * Host test of the heap regions behind _sbrk and __rt_heap_extend
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#include <errno.h>
+#include "cy_test.h"
+#include "cy_clib_heap.h"
+
+// Built three times:
+//
+// - Without a model allocator, the test checks that _sbrk only moves the break
+//   of the linker heap and never switches regions, and that cy_clib_heap_extend
+//   (__rt_heap_extend) crosses into further regions.
+// - With CY_TEST_NEWLIB_NANO or CY_TEST_NEWLIB_FULL, the test links a model of
+//   the newlib allocator: it defines the free list symbol the port looks for
+//   and _free_r, lays out chunks the way nano-mallocr.c or mallocr.c does, and
+//   grows through _sbrk the way they do (nano extends its last free chunk in
+//   place, the full allocator extends its top chunk). Both assume that every
+//   _sbrk continues the previous one, which the model checks. The test then
+//   allocates until the linker heap and a region added with
+//   cy_clib_heap_add_region are used up and checks that the blocks are where
+//   they belong and do not overlap.
+//
+// The models follow the chunk layout and the _sbrk use of newlib 4; they are
+// not the newlib sources.
+
+struct _reent;
+extern void* _sbrk(int32_t incr);
+extern uint8_t __HeapBase, __HeapLimit;
+
+#define CY_TEST_REGION_SIZE     (64U * 1024U)
+#define CY_TEST_BLOCK_SIZE      (1000U)
+#define CY_TEST_BLOCKS_MAX      (4096U)
+
+static uint8_t cy_test_region[CY_TEST_REGION_SIZE + 16U] __attribute__((aligned(16)));
+
+#if defined(CY_TEST_NEWLIB_NANO) || defined(CY_TEST_NEWLIB_FULL)
+
+// Free chunks of both models, sorted by address. The size is where mallocr.c keeps it.
+typedef struct cy_model_free
+{
+    size_t                prev_size;
+    size_t                size;     // Of the whole chunk
+    struct cy_model_free* next;
+} cy_model_free_t;
+
+static cy_model_free_t* cy_model_free_list = NULL;
+static uint8_t*         cy_model_brk_end   = NULL;  // End of the memory _sbrk returned so far
+
+//--------------------------------------------------------------------------------------------------
+// cy_model_sbrk
+//--------------------------------------------------------------------------------------------------
+// Both allocators take the memory from _sbrk as continuing what they have
+static uint8_t* cy_model_sbrk(size_t size)
+{
+    uint8_t* block = (uint8_t*)_sbrk((int32_t)size);
+    if ((void*)-1 == (void*)block)
+    {
+        CY_TEST_CHECK(ENOMEM == errno);
+        return NULL;
+    }
+    CY_TEST_CHECK((NULL == cy_model_brk_end) || (block == cy_model_brk_end));
+    CY_TEST_CHECK((block >= &__HeapBase) && ((block + size) <= &__HeapLimit));
+    cy_model_brk_end = block + size;
+    return block;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_model_insert
+//--------------------------------------------------------------------------------------------------
+// Inserts a free chunk by address and merges it with its neighbours, as nano's free does
+static void cy_model_insert(uint8_t* chunk, size_t size, bool merge)
+{
+    cy_model_free_t** link = &cy_model_free_list;
+    cy_model_free_t*  prev = NULL;
+    while ((NULL != *link) && ((uint8_t*)*link < chunk))
+    {
+        prev = *link;
+        link = &(*link)->next;
+    }
+    // Overlapping chunks mean the heap is corrupt
+    CY_TEST_CHECK((NULL == prev) || (((uint8_t*)prev + prev->size) <= chunk));
+    CY_TEST_CHECK((NULL == *link) || ((chunk + size) <= (uint8_t*)*link));
+
+    cy_model_free_t* free_chunk = (cy_model_free_t*)chunk;
+    free_chunk->size = size;
+    free_chunk->next = *link;
+    *link            = free_chunk;
+    if (merge && (NULL != free_chunk->next) &&
+        ((chunk + size) == (uint8_t*)free_chunk->next))
+    {
+        free_chunk->size += free_chunk->next->size;
+        free_chunk->next  = free_chunk->next->next;
+    }
+    if (merge && (NULL != prev) && (((uint8_t*)prev + prev->size) == chunk))
+    {
+        prev->size += free_chunk->size;
+        prev->next  = free_chunk->next;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_model_take
+//--------------------------------------------------------------------------------------------------
+// First fit; returns the chunk, split to size if the rest is large enough
+static uint8_t* cy_model_take(size_t size)
+{
+    for (cy_model_free_t** link = &cy_model_free_list; NULL != *link; link = &(*link)->next)
+    {
+        cy_model_free_t* chunk = *link;
+        if (chunk->size >= size)
+        {
+            if ((chunk->size - size) >= sizeof(cy_model_free_t) * 2U)
+            {
+                // Keep the front free and hand out the tail, as nano does
+                chunk->size -= size;
+                return (uint8_t*)chunk + chunk->size;
+            }
+            *link = chunk->next;
+            return (uint8_t*)chunk;
+        }
+    }
+    return NULL;
+}
+
+
+#endif // defined(CY_TEST_NEWLIB_NANO) || defined(CY_TEST_NEWLIB_FULL)
+
+#if defined(CY_TEST_NEWLIB_NANO)
+// nano-mallocr.c: a chunk is { long size; ... } and the memory handed out starts after the size
+uint8_t* __malloc_free_list = NULL;
+
+#define CY_NANO_OFFSET      (sizeof(long))
+
+//--------------------------------------------------------------------------------------------------
+// _free_r
+//--------------------------------------------------------------------------------------------------
+void _free_r(struct _reent* reent, void* ptr)
+{
+    (void)reent;
+    uint8_t* chunk = (uint8_t*)ptr - CY_NANO_OFFSET;
+    long     size  = *(long*)chunk;
+    CY_TEST_CHECK((size > 0) && (0U == ((size_t)size % 8U)));
+    cy_model_insert(chunk, (size_t)size, true);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_model_malloc
+//--------------------------------------------------------------------------------------------------
+static void* cy_model_malloc(size_t size)
+{
+    size_t   alloc = (size + CY_NANO_OFFSET + 7U) & ~(size_t)7U;
+    uint8_t* chunk = cy_model_take(alloc);
+    if (NULL == chunk)
+    {
+        // Grow the last free chunk in place if it ends at the break
+        cy_model_free_t* last = cy_model_free_list;
+        while ((NULL != last) && (NULL != last->next))
+        {
+            last = last->next;
+        }
+        if ((NULL != last) && (((uint8_t*)last + last->size) == (uint8_t*)_sbrk(0)) &&
+            (NULL != cy_model_sbrk(alloc - last->size)))
+        {
+            last->size = alloc;
+            chunk      = cy_model_take(alloc);
+        }
+        else
+        {
+            chunk = cy_model_sbrk(alloc);
+        }
+    }
+    if (NULL == chunk)
+    {
+        return NULL;
+    }
+    *(long*)chunk = (long)alloc;
+    return chunk + CY_NANO_OFFSET;
+}
+
+
+#elif defined(CY_TEST_NEWLIB_FULL)
+// mallocr.c: a chunk is { size_t prev_size; size_t size; ... } with PREV_INUSE in bit 0 of the
+// size and the memory handed out after both. The top chunk is carved from the end of _sbrk.
+uint8_t __malloc_av_[16];
+
+#define CY_FULL_WORD        (sizeof(size_t))
+#define CY_FULL_PREV_INUSE  (1U)
+
+static uint8_t* cy_model_top      = NULL;
+static size_t   cy_model_top_size = 0U;
+
+//--------------------------------------------------------------------------------------------------
+// cy_model_size_at
+//--------------------------------------------------------------------------------------------------
+static size_t* cy_model_size_at(uint8_t* chunk)
+{
+    return (size_t*)&chunk[CY_FULL_WORD];
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// _free_r
+//--------------------------------------------------------------------------------------------------
+void _free_r(struct _reent* reent, void* ptr)
+{
+    (void)reent;
+    uint8_t* chunk = (uint8_t*)ptr - (2U * CY_FULL_WORD);
+    size_t   head  = *cy_model_size_at(chunk);
+    size_t   size  = head & ~(size_t)CY_FULL_PREV_INUSE;
+    CY_TEST_CHECK((0U != (head & CY_FULL_PREV_INUSE)) && (size >= (4U * CY_FULL_WORD)) &&
+                  (0U == (size % 8U)) && (0U == ((uintptr_t)ptr % 8U)));
+    // free looks at the chunk after this one and the in-use bit after that to decide whether
+    // to merge; unless this chunk borders the top, both must be readable chunk headers
+    uint8_t* next = chunk + size;
+    if (next != cy_model_top)
+    {
+        size_t next_size = *cy_model_size_at(next) & ~(size_t)CY_FULL_PREV_INUSE;
+        CY_TEST_CHECK(next_size >= CY_FULL_WORD);
+        // A fence post must be followed by a header that marks it in use, or free would
+        // merge the chunk with what follows the region
+        if (next_size == CY_FULL_WORD)
+        {
+            CY_TEST_CHECK(0U != (*cy_model_size_at(next + next_size) & CY_FULL_PREV_INUSE));
+        }
+    }
+    cy_model_insert(chunk, size, false);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_model_malloc
+//--------------------------------------------------------------------------------------------------
+static void* cy_model_malloc(size_t size)
+{
+    size_t   alloc = (size + CY_FULL_WORD + 7U) & ~(size_t)7U;
+    uint8_t* chunk;
+    alloc = (alloc < (4U * CY_FULL_WORD)) ? (4U * CY_FULL_WORD) : alloc;
+    chunk = cy_model_take(alloc);
+    if (NULL == chunk)
+    {
+        if (cy_model_top_size < alloc)
+        {
+            // malloc_extend_top: new memory must continue the top chunk
+            uint8_t* more = cy_model_sbrk(alloc - cy_model_top_size);
+            if (NULL == more)
+            {
+                return NULL;
+            }
+            if (NULL == cy_model_top)
+            {
+                cy_model_top = more;
+            }
+            CY_TEST_CHECK(more == (cy_model_top + cy_model_top_size));
+            cy_model_top_size = alloc;
+        }
+        chunk              = cy_model_top;
+        cy_model_top      += alloc;
+        cy_model_top_size -= alloc;
+    }
+    *cy_model_size_at(chunk) = alloc | CY_FULL_PREV_INUSE;
+    return chunk + (2U * CY_FULL_WORD);
+}
+
+
+#endif // if defined(CY_TEST_NEWLIB_NANO)
+
+#if defined(CY_TEST_NEWLIB_NANO) || defined(CY_TEST_NEWLIB_FULL)
+//--------------------------------------------------------------------------------------------------
+// cy_test_compare_ptr
+//--------------------------------------------------------------------------------------------------
+static int cy_test_compare_ptr(const void* a, const void* b)
+{
+    uintptr_t x = (uintptr_t)*(uint8_t* const*)a;
+    uintptr_t y = (uintptr_t)*(uint8_t* const*)b;
+    return (x > y) - (x < y);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_allocator
+//--------------------------------------------------------------------------------------------------
+// Allocates until both the linker heap and the added region are used up
+static void cy_test_allocator(void)
+{
+    static uint8_t*             blocks[CY_TEST_BLOCKS_MAX];
+    uint32_t                    count      = 0U;
+    uint32_t                    in_heap    = 0U;
+    uint32_t                    in_region  = 0U;
+    uint8_t*                    region     = &cy_test_region[3];  // Deliberately misaligned
+    cy_clib_heap_region_stats_t stats[2];
+
+    // A little of the linker heap is in use before the region is added
+    blocks[count++] = cy_model_malloc(CY_TEST_BLOCK_SIZE);
+    CY_TEST_CHECK(NULL != blocks[0]);
+    CY_TEST_CHECK(cy_clib_heap_add_region(region, CY_TEST_REGION_SIZE));
+    CY_TEST_CHECK(2U == cy_clib_heap_get_region_stats(stats, 2U));
+    CY_TEST_CHECK((stats[1].base == region) && (stats[1].used == CY_TEST_REGION_SIZE));
+
+    while (count < CY_TEST_BLOCKS_MAX)
+    {
+        uint8_t* block = cy_model_malloc(CY_TEST_BLOCK_SIZE);
+        if (NULL == block)
+        {
+            break;
+        }
+        blocks[count++] = block;
+    }
+    CY_TEST_CHECK(count < CY_TEST_BLOCKS_MAX);
+    for (uint32_t i = 0U; i < count; i++)
+    {
+        (void)memset(blocks[i], (int)(i & 0xFFU), CY_TEST_BLOCK_SIZE);
+    }
+
+    qsort(blocks, count, sizeof(blocks[0]), cy_test_compare_ptr);
+    for (uint32_t i = 0U; i < count; i++)
+    {
+        uint8_t* block = blocks[i];
+        if ((block >= &__HeapBase) && ((block + CY_TEST_BLOCK_SIZE) <= &__HeapLimit))
+        {
+            in_heap++;
+        }
+        else
+        {
+            CY_TEST_CHECK((block >= region) &&
+                          ((block + CY_TEST_BLOCK_SIZE) <= (region + CY_TEST_REGION_SIZE)));
+            in_region++;
+        }
+        CY_TEST_CHECK((0U == i) || ((blocks[i - 1U] + CY_TEST_BLOCK_SIZE) <= block));
+    }
+    // Both must have been used nearly completely
+    size_t heap_size = (size_t)(&__HeapLimit - &__HeapBase);
+    CY_TEST_CHECK((in_heap * (CY_TEST_BLOCK_SIZE + 16U)) > (heap_size - 2048U));
+    CY_TEST_CHECK((in_region * (CY_TEST_BLOCK_SIZE + 16U)) > (CY_TEST_REGION_SIZE - 2048U));
+
+    // Everything freed goes back into one chunk per area
+    for (uint32_t i = 0U; i < count; i++)
+    {
+        _free_r(NULL, blocks[i]);
+    }
+    printf("%u blocks in the linker heap, %u in the added region\n", in_heap, in_region);
+}
+
+
+#else // if defined(CY_TEST_NEWLIB_NANO) || defined(CY_TEST_NEWLIB_FULL)
+static uint8_t cy_test_region2[CY_TEST_REGION_SIZE] __attribute__((aligned(16)));
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_regions
+//--------------------------------------------------------------------------------------------------
+static void cy_test_regions(void)
+{
+    size_t                      heap_size = (size_t)(&__HeapLimit - &__HeapBase);
+    cy_clib_heap_region_stats_t stats[3];
+
+    // Without a newlib allocator to give them to, added regions stay with the table
+    CY_TEST_CHECK(cy_clib_heap_add_region(cy_test_region, CY_TEST_REGION_SIZE));
+    CY_TEST_CHECK(cy_clib_heap_add_region(cy_test_region2, CY_TEST_REGION_SIZE));
+    CY_TEST_CHECK(!cy_clib_heap_add_region(NULL, CY_TEST_REGION_SIZE));
+
+    // _sbrk moves the break of the linker heap contiguously, in both directions
+    uint8_t* base = (uint8_t*)_sbrk(0);
+    CY_TEST_CHECK(base == &__HeapBase);
+    CY_TEST_CHECK((uint8_t*)_sbrk((int32_t)(heap_size - 64U)) == base);
+    CY_TEST_CHECK((uint8_t*)_sbrk(-64) == (base + heap_size - 64U));
+    CY_TEST_CHECK((uint8_t*)_sbrk(64) == (base + heap_size - 128U));
+    CY_TEST_CHECK((uint8_t*)_sbrk(0) == (base + heap_size - 64U));
+
+    // and fails once it is full, although the added regions have room
+    errno = 0;
+    CY_TEST_CHECK((void*)-1 == _sbrk(128));
+    CY_TEST_CHECK(ENOMEM == errno);
+    CY_TEST_CHECK((uint8_t*)_sbrk(0) == (base + heap_size - 64U));
+    CY_TEST_CHECK(3U == cy_clib_heap_get_region_stats(stats, 3U));
+    CY_TEST_CHECK((0U == stats[1].used) && (0U == stats[2].used));
+
+    // cy_clib_heap_extend fills the rest of the linker heap, then moves on region by region
+    CY_TEST_CHECK((uint8_t*)cy_clib_heap_extend(64U) == (base + heap_size - 64U));
+    CY_TEST_CHECK((uint8_t*)cy_clib_heap_extend(4096U) == cy_test_region);
+    CY_TEST_CHECK((uint8_t*)cy_clib_heap_extend(4096U) == &cy_test_region[4096]);
+    CY_TEST_CHECK((uint8_t*)cy_clib_heap_extend(CY_TEST_REGION_SIZE - 4096U) == cy_test_region2);
+    // Space left at the end of a region serves later, smaller requests
+    CY_TEST_CHECK((uint8_t*)cy_clib_heap_extend(8192U) == &cy_test_region[8192]);
+    CY_TEST_CHECK(NULL == cy_clib_heap_extend(CY_TEST_REGION_SIZE));
+
+    CY_TEST_CHECK(3U == cy_clib_heap_get_region_stats(stats, 3U));
+    CY_TEST_CHECK((stats[0].used == heap_size) && (stats[0].high_water == heap_size));
+    CY_TEST_CHECK((stats[1].base == cy_test_region) && (stats[1].used == 16384U));
+    CY_TEST_CHECK((stats[2].used == (CY_TEST_REGION_SIZE - 4096U)));
+
+    // _sbrk still only answers for the linker heap
+    CY_TEST_CHECK((void*)-1 == _sbrk(16));
+    CY_TEST_CHECK((uint8_t*)_sbrk(-64) == (base + heap_size));
+    CY_TEST_CHECK((uint8_t*)_sbrk(0) == (base + heap_size - 64U));
+}
+
+
+#endif // if defined(CY_TEST_NEWLIB_NANO) || defined(CY_TEST_NEWLIB_FULL)
+
+//--------------------------------------------------------------------------------------------------
+// main
+//--------------------------------------------------------------------------------------------------
+int main(void)
+{
+    #if defined(CY_TEST_NEWLIB_NANO) || defined(CY_TEST_NEWLIB_FULL)
+    cy_test_allocator();
+    #else
+    cy_test_regions();
+    #endif
+    return EXIT_SUCCESS;
+}
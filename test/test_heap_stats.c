@@ -0,0 +1,179 @@
+/***********************************************************************************************//**
+ * \file test_heap_stats.c
+ *
+ * \brief
+ * Host test of the heap counters kept by the Newlib allocator front end
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#include <malloc.h>
+#include "cy_test.h"
+#include "cy_clib_heap.h"
+#include "cy_mutex_pool.h"
+
+// Built with CY_CLIB_HEAP_STATS alone and together with the task cache and the
+// block pools. On the host the front end sits in front of glibc, and
+// __libc_malloc stands in for the allocations the C library makes with
+// _malloc_r (strdup, stdio buffers) that the application releases with free.
+// The largest free block bound is checked to rise with frees and fall with
+// allocations, together with the fragmentation index derived from it.
+
+extern void* __libc_malloc(size_t size);
+extern void  cy_toolchain_init(void);
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_in_use
+//--------------------------------------------------------------------------------------------------
+static size_t cy_test_in_use(void)
+{
+    cy_clib_heap_stats_t stats;
+    cy_clib_heap_get_stats(&stats);
+    return stats.in_use;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_counts
+//--------------------------------------------------------------------------------------------------
+static void cy_test_counts(void)
+{
+    cy_clib_heap_stats_t before;
+    cy_clib_heap_stats_t after;
+
+    // Blocks the C library allocated itself are neither counted in nor out
+    cy_clib_heap_get_stats(&before);
+    for (uint32_t i = 0U; i < 100U; i++)
+    {
+        char* copy = __libc_malloc(200U);
+        CY_TEST_CHECK(NULL != copy);
+        free(copy);
+    }
+    cy_clib_heap_get_stats(&after);
+    CY_TEST_CHECK(after.in_use == before.in_use);
+    CY_TEST_CHECK(after.frees == before.frees);
+
+    // Blocks allocated through the front end are counted in and out by their usable size
+    size_t base  = cy_test_in_use();
+    char*  block = malloc(200U);
+    CY_TEST_CHECK((NULL != block) && (malloc_usable_size(block) >= 200U));
+    size_t usable = malloc_usable_size(block);
+    CY_TEST_CHECK(cy_test_in_use() == (base + usable));
+    (void)memset(block, 0xFF, 200U);    // The tag lies beyond the requested size
+    free(block);
+    CY_TEST_CHECK(cy_test_in_use() == base);
+
+    // realloc moves the count to the new block, keeps it on failure and drops it for size 0
+    block = calloc(10U, 10U);
+    CY_TEST_CHECK(NULL != block);
+    block = realloc(block, 5000U);
+    CY_TEST_CHECK(NULL != block);
+    CY_TEST_CHECK(cy_test_in_use() == (base + malloc_usable_size(block)));
+    volatile size_t huge = SIZE_MAX - 2U;
+    CY_TEST_CHECK(NULL == realloc(block, huge));
+    CY_TEST_CHECK(cy_test_in_use() == (base + malloc_usable_size(block)));
+    CY_TEST_CHECK(NULL == realloc(block, 0U));
+    CY_TEST_CHECK(cy_test_in_use() == base);
+
+    // A block the C library allocated becomes counted once realloc replaces it
+    block = __libc_malloc(100U);
+    CY_TEST_CHECK(NULL != block);
+    block = realloc(block, 300U);
+    CY_TEST_CHECK(cy_test_in_use() == (base + malloc_usable_size(block)));
+    free(block);
+    CY_TEST_CHECK(cy_test_in_use() == base);
+
+    // Small blocks, which may come from the pools or the task cache
+    static void* small[64];
+    for (uint32_t i = 0U; i < 64U; i++)
+    {
+        small[i] = malloc(8U + (i % 60U));
+        CY_TEST_CHECK(NULL != small[i]);
+        (void)memset(small[i], 0xFF, 8U + (i % 60U));
+    }
+    for (uint32_t i = 0U; i < 64U; i++)
+    {
+        free(small[i]);
+    }
+    CY_TEST_CHECK(cy_test_in_use() == base);
+    cy_clib_heap_get_stats(&after);
+    CY_TEST_CHECK((after.allocations - before.allocations) == (after.frees - before.frees));
+    CY_TEST_CHECK(0U == (after.failures - before.failures - 1U));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_largest_free
+//--------------------------------------------------------------------------------------------------
+// glibc does not take its memory from the regions, so a region is added and claimed in full to
+// give the snapshot a heap size without unclaimed space
+static void cy_test_largest_free(void)
+{
+    static uint8_t       region[256U * 1024U];
+    cy_clib_heap_stats_t stats;
+
+    CY_TEST_CHECK(cy_clib_heap_add_region(region, sizeof(region)));
+    CY_TEST_CHECK(region == cy_clib_heap_extend(sizeof(region)));
+
+    // A freed block leaves a free block at least its size behind
+    char* block = malloc(100U * 1024U);
+    CY_TEST_CHECK(NULL != block);
+    size_t usable = malloc_usable_size(block);
+    free(block);
+    cy_clib_heap_get_stats(&stats);
+    CY_TEST_CHECK(stats.largest_free >= usable);
+    CY_TEST_CHECK(stats.largest_free <= stats.free);
+    CY_TEST_CHECK(stats.fragmentation ==
+                  (uint32_t)(1000U - (((uint64_t)stats.largest_free * 1000U) / stats.free)));
+    size_t bound = stats.largest_free;
+
+    // An allocation lowers the bound by its size, as it may come from the largest free block
+    block = malloc(100U * 1024U);
+    CY_TEST_CHECK(NULL != block);
+    cy_clib_heap_get_stats(&stats);
+    CY_TEST_CHECK(stats.largest_free == (bound - malloc_usable_size(block)));
+    CY_TEST_CHECK(stats.fragmentation > 900U);
+
+    // realloc to a smaller size may shrink in place, which only lowers the bound further
+    block = realloc(block, 64U * 1024U);
+    CY_TEST_CHECK(NULL != block);
+    free(block);
+    cy_clib_heap_get_stats(&stats);
+    CY_TEST_CHECK(stats.largest_free >= (64U * 1024U));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// main
+//--------------------------------------------------------------------------------------------------
+int main(void)
+{
+    cy_mutex_pool_setup();
+    cy_toolchain_init();
+    cy_test_counts();
+    // Again with the kernel running, which enables the task cache
+    cy_mutex_pool_posix_kernel_start();
+    cy_test_counts();
+    cy_test_largest_free();
+    #if defined(CY_CLIB_HEAP_CACHE)
+    cy_clib_heap_cache_flush();
+    #endif
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,217 @@
+/***********************************************************************************************//**
+ * \file test_lockdep.c
+ *
+ * \brief
+ * Host test of the lock-order checker of the mutex pool (CY_MUTEX_POOL_LOCKDEP)
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+// For pthread_setname_np
+#define _GNU_SOURCE
+#include <pthread.h>
+#include "cy_test.h"
+#include "cy_mutex_pool.h"
+
+// Built with CY_MUTEX_POOL_LOCKDEP. Each scenario takes pool mutexes from
+// named threads, one thread after the other, so that no order it checks can
+// actually deadlock, and compares the calls to cy_mutex_pool_lockdep_report
+// with the expected ones:
+//
+// - A direct inversion (malloc before file, then file before malloc) is
+//   reported once, naming both threads, and not again when repeated.
+// - A cycle over three mutexes is reported with the slot in between.
+// - Orders taken with cy_mutex_pool_try_acquire are not reported.
+// - A mutex destroyed and created again in the same slot starts without
+//   orders.
+
+#define CY_TEST_REPORTS     (8U)
+#define CY_TEST_LOCKS       (4U)
+
+// Pool handles point into the static storage in slot order, and cy_toolchain_init takes the first
+// three slots (malloc, env and timer) before the test creates its first mutex, first_lock
+#define CY_TEST_SLOT(m)     (3U + (uint32_t)((m) - first_lock))
+
+typedef struct
+{
+    const char*               name;
+    cy_mutex_pool_semaphore_t locks[CY_TEST_LOCKS];     // Taken in this order, up to a NULL
+    bool                      try_last;                 // The last one with a try-acquire
+} cy_test_order_t;
+
+extern void cy_toolchain_init(void);
+
+static cy_mutex_pool_lockdep_report_t cy_test_reports[CY_TEST_REPORTS];
+static uint32_t                       cy_test_report_count;
+
+//--------------------------------------------------------------------------------------------------
+// cy_mutex_pool_lockdep_report
+//--------------------------------------------------------------------------------------------------
+void cy_mutex_pool_lockdep_report(const cy_mutex_pool_lockdep_report_t* report)
+{
+    CY_TEST_CHECK(cy_test_report_count < CY_TEST_REPORTS);
+    cy_test_reports[cy_test_report_count] = *report;
+    cy_test_report_count++;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_take
+//--------------------------------------------------------------------------------------------------
+static void* cy_test_take(void* arg)
+{
+    const cy_test_order_t* order = (const cy_test_order_t*)arg;
+    uint32_t               count = 0U;
+
+    (void)pthread_setname_np(pthread_self(), order->name);
+    while ((count < CY_TEST_LOCKS) && (NULL != order->locks[count]))
+    {
+        bool last = ((count + 1U) == CY_TEST_LOCKS) || (NULL == order->locks[count + 1U]);
+        if (last && order->try_last)
+        {
+            CY_TEST_CHECK(cy_mutex_pool_try_acquire(order->locks[count]));
+        }
+        else
+        {
+            cy_mutex_pool_acquire(order->locks[count]);
+        }
+        count++;
+    }
+    while (count > 0U)
+    {
+        count--;
+        cy_mutex_pool_release(order->locks[count]);
+    }
+    return NULL;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_run
+//--------------------------------------------------------------------------------------------------
+// Takes the mutexes of order in a thread of its own and returns the number of new reports
+static uint32_t cy_test_run(const cy_test_order_t* order)
+{
+    pthread_t thread;
+    uint32_t  before = cy_test_report_count;
+    CY_TEST_CHECK(0 == pthread_create(&thread, NULL, cy_test_take, (void*)order));
+    (void)pthread_join(thread, NULL);
+    return cy_test_report_count - before;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// main
+//--------------------------------------------------------------------------------------------------
+int main(void)
+{
+    cy_mutex_pool_setup();
+    cy_toolchain_init();
+    cy_mutex_pool_posix_kernel_start();
+
+    cy_mutex_pool_semaphore_t malloc_lock = cy_mutex_pool_create(CY_MUTEX_POOL_ROLE_MALLOC);
+    cy_mutex_pool_semaphore_t first_lock  = malloc_lock;
+    cy_mutex_pool_semaphore_t file_lock   = cy_mutex_pool_create(CY_MUTEX_POOL_ROLE_FILE);
+    cy_mutex_pool_semaphore_t a           = cy_mutex_pool_create(CY_MUTEX_POOL_ROLE_SYSTEM);
+    cy_mutex_pool_semaphore_t b           = cy_mutex_pool_create(CY_MUTEX_POOL_ROLE_SYSTEM);
+    cy_mutex_pool_semaphore_t c           = cy_mutex_pool_create(CY_MUTEX_POOL_ROLE_SYSTEM);
+    CY_TEST_CHECK((NULL != malloc_lock) && (NULL != file_lock) && (NULL != a) && (NULL != b) &&
+                  (NULL != c));
+
+    // Direct inversion, reported once
+    static cy_test_order_t malloc_file = { "malloc_file", { NULL }, false };
+    static cy_test_order_t file_malloc = { "file_malloc", { NULL }, false };
+    malloc_file.locks[0] = malloc_lock;
+    malloc_file.locks[1] = file_lock;
+    file_malloc.locks[0] = file_lock;
+    file_malloc.locks[1] = malloc_lock;
+    CY_TEST_CHECK(0U == cy_test_run(&malloc_file));
+    CY_TEST_CHECK(1U == cy_test_run(&file_malloc));
+    const cy_mutex_pool_lockdep_report_t* report = &cy_test_reports[0];
+    CY_TEST_CHECK(CY_TEST_SLOT(file_lock) == report->held_slot);
+    CY_TEST_CHECK(CY_MUTEX_POOL_ROLE_FILE == report->held_role);
+    CY_TEST_CHECK(CY_TEST_SLOT(malloc_lock) == report->acquiring_slot);
+    CY_TEST_CHECK(CY_MUTEX_POOL_ROLE_MALLOC == report->acquiring_role);
+    CY_TEST_CHECK(report->acquiring_slot == report->via_slot);
+    CY_TEST_CHECK(0 == strcmp("file_malloc", report->task));
+    CY_TEST_CHECK(0 == strcmp("malloc_file", report->other_task));
+    CY_TEST_CHECK(0U == cy_test_run(&file_malloc));
+    CY_TEST_CHECK(0U == cy_test_run(&malloc_file));
+
+    // Cycle over three mutexes: a -> b and b -> c, then c -> a
+    static cy_test_order_t a_b = { "a_b", { NULL }, false };
+    static cy_test_order_t b_c = { "b_c", { NULL }, false };
+    static cy_test_order_t c_a = { "c_a", { NULL }, false };
+    a_b.locks[0] = a;
+    a_b.locks[1] = b;
+    b_c.locks[0] = b;
+    b_c.locks[1] = c;
+    c_a.locks[0] = c;
+    c_a.locks[1] = a;
+    CY_TEST_CHECK(0U == cy_test_run(&a_b));
+    CY_TEST_CHECK(0U == cy_test_run(&b_c));
+    CY_TEST_CHECK(1U == cy_test_run(&c_a));
+    report = &cy_test_reports[1];
+    CY_TEST_CHECK(CY_TEST_SLOT(c) == report->held_slot);
+    CY_TEST_CHECK(CY_TEST_SLOT(a) == report->acquiring_slot);
+    CY_TEST_CHECK(CY_TEST_SLOT(b) == report->via_slot);
+    CY_TEST_CHECK(0 == strcmp("c_a", report->task));
+    CY_TEST_CHECK(0 == strcmp("b_c", report->other_task));
+
+    // Try-acquires cannot deadlock and add no orders, so the blocking order after them is fine
+    cy_mutex_pool_semaphore_t d = cy_mutex_pool_create(CY_MUTEX_POOL_ROLE_SYSTEM);
+    cy_mutex_pool_semaphore_t e = cy_mutex_pool_create(CY_MUTEX_POOL_ROLE_SYSTEM);
+    static cy_test_order_t d_try_e = { "d_try_e", { NULL }, true };
+    static cy_test_order_t e_try_d = { "e_try_d", { NULL }, true };
+    static cy_test_order_t e_d     = { "e_d", { NULL }, false };
+    d_try_e.locks[0] = d;
+    d_try_e.locks[1] = e;
+    e_try_d.locks[0] = e;
+    e_try_d.locks[1] = d;
+    e_d.locks[0]     = e;
+    e_d.locks[1]     = d;
+    CY_TEST_CHECK(0U == cy_test_run(&d_try_e));
+    CY_TEST_CHECK(0U == cy_test_run(&e_try_d));
+    CY_TEST_CHECK(0U == cy_test_run(&e_d));
+
+    // A destroyed mutex takes its orders with it, so the slot starts clean when it is reused
+    static cy_test_order_t a_c = { "a_c", { NULL }, false };
+    static cy_test_order_t c_b = { "c_b", { NULL }, false };
+    a_c.locks[0] = a;
+    a_c.locks[1] = c;
+    cy_mutex_pool_destroy(c);
+    cy_mutex_pool_semaphore_t reused = cy_mutex_pool_create(CY_MUTEX_POOL_ROLE_SYSTEM);
+    CY_TEST_CHECK(c == reused);
+    CY_TEST_CHECK(0U == cy_test_run(&a_c));
+    // b -> c was destroyed as well, so c -> b closes no cycle
+    c_b.locks[0] = reused;
+    c_b.locks[1] = b;
+    CY_TEST_CHECK(0U == cy_test_run(&c_b));
+
+    // Recursive acquires of a held mutex are no new order
+    static cy_test_order_t a_a = { "a_a", { NULL }, false };
+    a_a.locks[0] = a;
+    a_a.locks[1] = a;
+    CY_TEST_CHECK(0U == cy_test_run(&a_a));
+
+    CY_TEST_CHECK(2U == cy_test_report_count);
+    printf("{\"test\": \"lockdep\", \"reports\": %u}\n", cy_test_report_count);
+    return EXIT_SUCCESS;
+}
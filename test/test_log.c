@@ -0,0 +1,336 @@
+/***********************************************************************************************//**
+ * \file test_log.c
+ *
+ * \brief
+ * Host test of the binary log through tools/cy_log_decode.py, and benchmark against snprintf
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#include <stdarg.h>
+#include "cy_test.h"
+#include "cy_log.h"
+
+// Built with CY_LOG_ENABLED, and linked without PIE so that the addresses of
+// the format strings are those in the ELF file. Every message is recorded with
+// CY_LOG and formatted with snprintf as well. The log is drained through
+// cy_log_drain into a file, which is decoded with
+// --decoder <python> <cy_log_decode.py> <this executable>; every decoded line
+// must match the snprintf text, in order and with a plausible timestamp. The
+// messages cover every kind of argument, the length modifiers, flags, widths
+// and precisions the decoder handles, strings cut at CY_LOG_STRING_MAX and the
+// report of dropped records.
+//
+// Then CY_LOG and snprintf of the same message are timed, with three int
+// arguments and with one double, and the time per call is printed as one JSON
+// object per line (or a table row with --text):
+//
+//     {"benchmark": "log", "message": "3 ints", "calls": ..., "cy_log_ns": ...,
+//      "snprintf_ns": ...}
+//
+// The ring buffer is drained between batches of calls, outside of the timed
+// part, so CY_LOG is timed without dropping records.
+//
+// Options: --calls N (default 1000000), --text, --quick (20000 calls).
+
+#define CY_TEST_MESSAGES    (64U)
+#define CY_TEST_TEXT        (128U)
+#define CY_TEST_BATCH       (16U)
+
+static char     cy_test_expected[CY_TEST_MESSAGES][CY_TEST_TEXT];
+static uint32_t cy_test_count;
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_expect
+//--------------------------------------------------------------------------------------------------
+// Adds the line the decoder must print for the next record
+static void cy_test_expect(const char* format, ...)
+{
+    va_list args;
+    CY_TEST_CHECK(cy_test_count < CY_TEST_MESSAGES);
+    va_start(args, format);
+    (void)vsnprintf(cy_test_expected[cy_test_count], CY_TEST_TEXT, format, args);
+    va_end(args);
+    cy_test_count++;
+}
+
+
+// Records a message and expects the text snprintf makes of it
+#define CY_TEST_LOG(...)                \
+    do {                                \
+        CY_LOG(__VA_ARGS__);            \
+        cy_test_expect(__VA_ARGS__);    \
+    } while (false)
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_file_sink
+//--------------------------------------------------------------------------------------------------
+static void cy_test_file_sink(void* context, const uint8_t* data, size_t size)
+{
+    CY_TEST_CHECK(size == fwrite(data, 1U, size, (FILE*)context));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_null_sink
+//--------------------------------------------------------------------------------------------------
+static void cy_test_null_sink(void* context, const uint8_t* data, size_t size)
+{
+    (void)context;
+    (void)data;
+    (void)size;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_record
+//--------------------------------------------------------------------------------------------------
+static void cy_test_record(void)
+{
+    static const char long_string[] = "0123456789abcdefghijklmnopqrstuvwxyzABCDEF";
+    static int        object;
+    const char*       name           = "pool";
+    char              mutable_name[] = "heap";
+    long long         big            = -1234567890123LL;
+    unsigned long     address        = 0xDEADBEEFUL;
+    double            ratio          = 2.0 / 3.0;
+    float             small          = 0.125f;
+    short             negative       = -2;
+    unsigned char     byte           = 200U;
+    bool              flag           = true;
+
+    CY_TEST_LOG("no arguments");
+    CY_TEST_LOG("int %d, negative %d, unsigned %u, hex %x, HEX %X, octal %o", 42, -42, 4000000000U,
+                0xBEEFU, 0xBEEFU, 8U);
+    CY_TEST_LOG("int extremes %d %d %u", INT32_MIN, INT32_MAX, UINT32_MAX);
+    CY_TEST_LOG("long long %lld, unsigned %llu, long %lx", big, 18446744073709551615ULL, address);
+    CY_TEST_LOG("short %hd, char %hhd, unsigned char %hhu, bool %d", negative, 300, byte, flag);
+    CY_TEST_LOG("char '%c', percent %%, string '%s', char* '%s'", 'x', name, mutable_name);
+    CY_TEST_LOG("double %f, %.3f, %10.4f|, %-10.2f|, %e, %g", ratio, ratio, ratio, ratio, 12345.678,
+                0.0001);
+    CY_TEST_LOG("float %f, %+.2f, %08.3f", small, small, -small);
+    CY_TEST_LOG("widths %5d|%-5d|%05d|%+d|% d|%#x|%#o", 7, 7, 7, 7, 7, 255U, 8U);
+    CY_TEST_LOG("star width %*d|, precision %.*f|, string %-8s|%8s|", 6, 99, 2, ratio, name, name);
+    CY_TEST_LOG("pointer %p", (void*)&object);
+    CY_TEST_LOG("eight %d %d %d %d %d %d %d %d", 1, 2, 3, 4, 5, 6, 7, 8);
+
+    // Strings are cut at CY_LOG_STRING_MAX characters
+    CY_LOG("long '%s'", long_string);
+    cy_test_expect("long '%.*s'", (int)CY_LOG_STRING_MAX, long_string);
+    CY_LOG("empty '%s'", "");
+    cy_test_expect("empty ''");
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_drop
+//--------------------------------------------------------------------------------------------------
+// Fills the ring buffer and expects the records that fit, then the number dropped
+static void cy_test_drop(void)
+{
+    cy_log_stats_t before;
+    cy_log_stats_t after;
+    uint32_t       recorded = 0U;
+
+    cy_log_get_stats(&before);
+    for (uint32_t i = 0U; i < 100U; i++)
+    {
+        CY_LOG("fill %u", i);
+        cy_log_get_stats(&after);
+        if (after.recorded != (before.recorded + recorded))
+        {
+            cy_test_expect("fill %u", i);
+            recorded++;
+        }
+    }
+    cy_log_get_stats(&after);
+    CY_TEST_CHECK((after.recorded - before.recorded) == recorded);
+    CY_TEST_CHECK((after.dropped - before.dropped) == (100U - recorded));
+    CY_TEST_CHECK((recorded > 0U) && (recorded < 100U) && (after.high_water <= CY_LOG_RING_SIZE));
+
+    // The drain reports the dropped records before the ones that were kept
+    CY_TEST_CHECK(cy_test_count > recorded);
+    (void)memmove(cy_test_expected[cy_test_count - recorded + 1U],
+                  cy_test_expected[cy_test_count - recorded], recorded * CY_TEST_TEXT);
+    (void)snprintf(cy_test_expected[cy_test_count - recorded], CY_TEST_TEXT,
+                   "<%u records dropped>", 100U - recorded);
+    cy_test_count++;
+    CY_TEST_CHECK(cy_test_count <= CY_TEST_MESSAGES);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_decode
+//--------------------------------------------------------------------------------------------------
+// Runs the decoder on the log and compares its lines with the expected ones
+static void cy_test_decode(const char* python, const char* decoder, const char* elf,
+                           const char* log, int64_t start_us)
+{
+    static char command[2048];
+    static char line[CY_TEST_TEXT + 32U];
+    uint32_t    index    = 0U;
+    long long   previous = 0;
+
+    int length = snprintf(command, sizeof(command), "'%s' '%s' --raw-time '%s' '%s'", python,
+                          decoder, elf, log);
+    CY_TEST_CHECK((length > 0) && ((size_t)length < sizeof(command)));
+    FILE* output = popen(command, "r");
+    CY_TEST_CHECK(NULL != output);
+    while (NULL != fgets(line, sizeof(line), output))
+    {
+        char*     message = NULL;
+        long long stamp   = strtoll(line, &message, 10);
+        CY_TEST_CHECK((' ' == *message) && (index < cy_test_count));
+        message++;
+        message[strcspn(message, "\n")] = '\0';
+        if (0 != strcmp(cy_test_expected[index], message))
+        {
+            fprintf(stderr, "record %u: expected \"%s\", decoded \"%s\"\n", index,
+                    cy_test_expected[index], message);
+            CY_TEST_CHECK(false);
+        }
+        // The default clock on the host is CLOCK_REALTIME in microseconds. The report of dropped
+        // records is stamped when it is drained, after the records that follow it.
+        CY_TEST_CHECK((stamp >= start_us) && (stamp < (start_us + 60000000LL)));
+        if ('<' != message[0])
+        {
+            CY_TEST_CHECK(stamp >= previous);
+            previous = stamp;
+        }
+        index++;
+    }
+    CY_TEST_CHECK(0 == pclose(output));
+    CY_TEST_CHECK(cy_test_count == index);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_bench
+//--------------------------------------------------------------------------------------------------
+static void cy_test_bench(bool doubles, long calls, bool text)
+{
+    static char       buffer[CY_TEST_TEXT];
+    volatile uint32_t sink    = 0U;
+    uint64_t          log_ns  = 0U;
+    uint64_t          libc_ns = 0U;
+    long              done    = 0;
+
+    cy_log_set_sink(cy_test_null_sink, NULL);
+    while (done < calls)
+    {
+        uint64_t start = cy_test_now_ns();
+        for (uint32_t i = 0U; i < CY_TEST_BATCH; i++)
+        {
+            int    value = (int)(done + (long)i);
+            double ratio = (double)value / 7.0;
+            if (doubles)
+            {
+                CY_LOG("ratio %f", ratio);
+            }
+            else
+            {
+                CY_LOG("sample %d of %d at %d", value, 3, -value);
+            }
+        }
+        log_ns += cy_test_now_ns() - start;
+
+        start = cy_test_now_ns();
+        for (uint32_t i = 0U; i < CY_TEST_BATCH; i++)
+        {
+            int    value = (int)(done + (long)i);
+            double ratio = (double)value / 7.0;
+            if (doubles)
+            {
+                sink += (uint32_t)snprintf(buffer, sizeof(buffer), "ratio %f", ratio);
+            }
+            else
+            {
+                sink += (uint32_t)snprintf(buffer, sizeof(buffer), "sample %d of %d at %d", value,
+                                           3, -value);
+            }
+        }
+        libc_ns += cy_test_now_ns() - start;
+
+        CY_TEST_CHECK(CY_TEST_BATCH == cy_log_drain());
+        done += (long)CY_TEST_BATCH;
+    }
+    (void)sink;
+
+    const char* message = doubles ? "double" : "3 ints";
+    double      log     = (double)log_ns / (double)done;
+    double      libc    = (double)libc_ns / (double)done;
+    if (text)
+    {
+        printf("%-8s %10ld %10.1f %12.1f\n", message, done, log, libc);
+    }
+    else
+    {
+        printf("{\"benchmark\": \"log\", \"message\": \"%s\", \"calls\": %ld, "
+               "\"cy_log_ns\": %.1f, \"snprintf_ns\": %.1f}\n", message, done, log, libc);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// main
+//--------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    static char log[1024];
+    bool        quick   = cy_test_option(argc, argv, "--quick");
+    bool        text    = cy_test_option(argc, argv, "--text");
+    long        calls   = cy_test_value(argc, argv, "--calls", quick ? 20000 : 1000000);
+    const char* python  = NULL;
+    const char* decoder = NULL;
+    for (int i = 1; i < (argc - 2); i++)
+    {
+        if (0 == strcmp(argv[i], "--decoder"))
+        {
+            python  = argv[i + 1];
+            decoder = argv[i + 2];
+        }
+    }
+    CY_TEST_CHECK(calls > 0);
+
+    if (NULL != decoder)
+    {
+        int64_t start_us = (int64_t)time(NULL) * 1000000;
+        (void)snprintf(log, sizeof(log), "%s.bin", argv[0]);
+        FILE* file = fopen(log, "wb");
+        CY_TEST_CHECK(NULL != file);
+        cy_log_set_sink(cy_test_file_sink, file);
+        cy_test_record();
+        CY_TEST_CHECK(cy_test_count == cy_log_drain());
+        cy_test_drop();
+        CY_TEST_CHECK(0U != cy_log_drain());
+        CY_TEST_CHECK(0U == cy_log_drain());
+        CY_TEST_CHECK(0 == fclose(file));
+        cy_log_set_sink(NULL, NULL);
+        cy_test_decode(python, decoder, argv[0], log, start_us);
+    }
+
+    if (text)
+    {
+        printf("%-8s %10s %10s %12s\n", "message", "calls", "CY_LOG ns", "snprintf ns");
+    }
+    cy_test_bench(false, calls, text);
+    cy_test_bench(true, calls, text);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,241 @@
+/***********************************************************************************************//**
+ * \file test_romfs.c
+ *
+ * \brief
+ * Host test of the ROM file system against an image built by tools/cy_romfs_image.py
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#include <limits.h>
+#include <cmsis_compiler.h>
+#include "cy_test.h"
+#include "cy_romfs_port.h"
+
+// Built with CY_ROMFS and the image CMake generates with the tool from the
+// files written by CMakeLists.txt: hello.txt, "Hello, ROM file system!\n";
+// empty, an empty file; and table/squares.txt, the squares of 0 to 99, one
+// per line, aligned to 16 bytes. Checks mounting, cy_romfs_map, reads and
+// seeks (including offsets that would overflow), the descriptor limit with the
+// EMFILE and ENOENT split of the Newlib _open, and the end-of-file encoding of
+// the ARM _sys_read.
+
+#define CY_TEST_HELLO       "Hello, ROM file system!\n"
+
+extern const uint8_t cy_test_romfs_image[];
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_squares
+//--------------------------------------------------------------------------------------------------
+// Writes the expected contents of table/squares.txt and returns their length
+static size_t cy_test_squares(char* buffer, size_t size)
+{
+    size_t length = 0U;
+    for (uint32_t i = 0U; i < 100U; i++)
+    {
+        length += (size_t)snprintf(&buffer[length], size - length, "%u\n", i * i);
+    }
+    return length;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_mount
+//--------------------------------------------------------------------------------------------------
+static void cy_test_mount(void)
+{
+    static uint8_t copy[64 + 4] __ALIGNED(16);
+
+    // Not an image, or not at the alignment of the image
+    (void)memcpy(copy, cy_test_romfs_image, 64U);
+    copy[0] ^= 0xFFU;
+    CY_TEST_CHECK(!cy_romfs_mount(copy));
+    (void)memcpy(&copy[4], cy_test_romfs_image, 64U);
+    CY_TEST_CHECK(!cy_romfs_mount(&copy[4]));
+
+    // Nothing is found while no image is mounted
+    CY_TEST_CHECK(cy_romfs_mount(NULL));
+    CY_TEST_CHECK(-1 == cy_romfs_open("hello.txt"));
+    CY_TEST_CHECK(ENOENT == cy_romfs_open_error("hello.txt"));
+    CY_TEST_CHECK(cy_romfs_mount(cy_test_romfs_image));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_map
+//--------------------------------------------------------------------------------------------------
+static void cy_test_map(void)
+{
+    static char expected[512];
+    size_t      length = cy_test_squares(expected, sizeof(expected));
+    const void* data;
+    size_t      size;
+
+    CY_TEST_CHECK(cy_romfs_map("hello.txt", &data, &size));
+    CY_TEST_CHECK((strlen(CY_TEST_HELLO) == size) && (0 == memcmp(CY_TEST_HELLO, data, size)));
+    CY_TEST_CHECK(0U == ((uintptr_t)data & 15U));
+    CY_TEST_CHECK(cy_romfs_map("//table/squares.txt", &data, &size));
+    CY_TEST_CHECK((length == size) && (0 == memcmp(expected, data, size)));
+    CY_TEST_CHECK(0U == ((uintptr_t)data & 15U));
+    CY_TEST_CHECK(cy_romfs_map("empty", &data, &size) && (0U == size));
+
+    // Directories and partial paths are not files
+    CY_TEST_CHECK(!cy_romfs_map("table", &data, &size));
+    CY_TEST_CHECK(!cy_romfs_map("hello", &data, &size));
+    CY_TEST_CHECK(!cy_romfs_map("zzz", &data, &size));
+    CY_TEST_CHECK(!cy_romfs_map(NULL, &data, &size));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_read_seek
+//--------------------------------------------------------------------------------------------------
+static void cy_test_read_seek(void)
+{
+    static char expected[512];
+    static char buffer[512];
+    size_t      length = cy_test_squares(expected, sizeof(expected));
+    long        end    = (long)length;
+
+    int fd = cy_romfs_open("/table/squares.txt");
+    CY_TEST_CHECK(fd >= CY_ROMFS_FD_BASE);
+    CY_TEST_CHECK(cy_romfs_is_open(fd) && (end == cy_romfs_size(fd)));
+
+    // Reads in pieces that do not divide the file, then 0 at the end
+    size_t done = 0U;
+    long   result;
+    while ((result = cy_romfs_read(fd, &buffer[done], 7U)) > 0)
+    {
+        done += (size_t)result;
+    }
+    CY_TEST_CHECK((0 == result) && (length == done) && (0 == memcmp(expected, buffer, length)));
+
+    CY_TEST_CHECK(10 == cy_romfs_seek(fd, 10, SEEK_SET));
+    CY_TEST_CHECK(15 == cy_romfs_seek(fd, 5, SEEK_CUR));
+    CY_TEST_CHECK(5 == cy_romfs_seek(fd, -10, SEEK_CUR));
+    CY_TEST_CHECK((end - 3) == cy_romfs_seek(fd, -3, SEEK_END));
+    CY_TEST_CHECK(3 == cy_romfs_read(fd, buffer, sizeof(buffer)));
+    CY_TEST_CHECK(0 == memcmp(&expected[length - 3U], buffer, 3U));
+
+    // Past the end is allowed and reads nothing; before the start is not, and leaves the position
+    CY_TEST_CHECK((end + 100) == cy_romfs_seek(fd, 100, SEEK_END));
+    CY_TEST_CHECK(0 == cy_romfs_read(fd, buffer, sizeof(buffer)));
+    CY_TEST_CHECK(20 == cy_romfs_seek(fd, 20, SEEK_SET));
+    CY_TEST_CHECK(-1 == cy_romfs_seek(fd, -21, SEEK_CUR));
+    CY_TEST_CHECK(-1 == cy_romfs_seek(fd, -1, SEEK_SET));
+    CY_TEST_CHECK(-1 == cy_romfs_seek(fd, -(end + 1), SEEK_END));
+    CY_TEST_CHECK(-1 == cy_romfs_seek(fd, 0, 12345));
+    CY_TEST_CHECK(20 == cy_romfs_seek(fd, 0, SEEK_CUR));
+
+    // Offsets whose negation or sum with the base overflows a long
+    CY_TEST_CHECK(-1 == cy_romfs_seek(fd, LONG_MIN, SEEK_SET));
+    CY_TEST_CHECK(-1 == cy_romfs_seek(fd, LONG_MIN, SEEK_CUR));
+    CY_TEST_CHECK(-1 == cy_romfs_seek(fd, LONG_MIN, SEEK_END));
+    CY_TEST_CHECK(-1 == cy_romfs_seek(fd, LONG_MAX, SEEK_END));
+    CY_TEST_CHECK(-1 == cy_romfs_seek(fd, LONG_MAX - 10, SEEK_CUR));
+    CY_TEST_CHECK(20 == cy_romfs_seek(fd, 0, SEEK_CUR));
+    CY_TEST_CHECK(LONG_MAX == cy_romfs_seek(fd, LONG_MAX, SEEK_SET));
+    CY_TEST_CHECK(0 == cy_romfs_read(fd, buffer, sizeof(buffer)));
+
+    CY_TEST_CHECK(0 == cy_romfs_close(fd));
+    CY_TEST_CHECK(!cy_romfs_is_open(fd));
+    CY_TEST_CHECK(-1 == cy_romfs_close(fd));
+    CY_TEST_CHECK(-1 == cy_romfs_read(fd, buffer, sizeof(buffer)));
+    CY_TEST_CHECK(-1 == cy_romfs_seek(fd, 0, SEEK_SET));
+    CY_TEST_CHECK(-1 == cy_romfs_size(fd));
+    CY_TEST_CHECK(!cy_romfs_is_open(0) && !cy_romfs_is_open(CY_ROMFS_FD_BASE + 1000));
+
+    // An empty file is at its end at once
+    fd = cy_romfs_open("empty");
+    CY_TEST_CHECK((fd >= 0) && (0 == cy_romfs_size(fd)));
+    CY_TEST_CHECK(0 == cy_romfs_read(fd, buffer, sizeof(buffer)));
+    CY_TEST_CHECK(0 == cy_romfs_close(fd));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_limit
+//--------------------------------------------------------------------------------------------------
+static void cy_test_limit(void)
+{
+    int fds[CY_ROMFS_MAX_OPEN];
+    for (uint32_t i = 0U; i < CY_ROMFS_MAX_OPEN; i++)
+    {
+        fds[i] = cy_romfs_open("hello.txt");
+        CY_TEST_CHECK(((CY_ROMFS_FD_BASE + (int)i) == fds[i]));
+    }
+
+    // An existing file fails with EMFILE while all descriptors are taken, a missing one with ENOENT
+    CY_TEST_CHECK(-1 == cy_romfs_open("hello.txt"));
+    CY_TEST_CHECK(EMFILE == cy_romfs_open_error("hello.txt"));
+    CY_TEST_CHECK(-1 == cy_romfs_open("missing.txt"));
+    CY_TEST_CHECK(ENOENT == cy_romfs_open_error("missing.txt"));
+
+    // A closed descriptor is taken again, from its start
+    char buffer[8];
+    CY_TEST_CHECK(5 == cy_romfs_read(fds[2], buffer, 5U));
+    CY_TEST_CHECK(0 == cy_romfs_close(fds[2]));
+    CY_TEST_CHECK(fds[2] == cy_romfs_open("hello.txt"));
+    CY_TEST_CHECK((5 == cy_romfs_read(fds[2], buffer, 5U)) && (0 == memcmp("Hello", buffer, 5U)));
+    for (uint32_t i = 0U; i < CY_ROMFS_MAX_OPEN; i++)
+    {
+        CY_TEST_CHECK(0 == cy_romfs_close(fds[i]));
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_sys_read
+//--------------------------------------------------------------------------------------------------
+// The ARM C library expects the bytes not read, with the top bit set only if none were read
+// because the end of the file was reached
+static void cy_test_sys_read(void)
+{
+    unsigned char buffer[64];
+    unsigned      size = (unsigned)strlen(CY_TEST_HELLO);
+
+    int fd = cy_romfs_open("hello.txt");
+    CY_TEST_CHECK(fd >= 0);
+    CY_TEST_CHECK(0 == cy_romfs_sys_read_result(cy_romfs_read(fd, buffer, 10U), 10U));
+    CY_TEST_CHECK((int)(sizeof(buffer) - (size - 10U)) ==
+                  cy_romfs_sys_read_result(cy_romfs_read(fd, buffer, sizeof(buffer)),
+                                           sizeof(buffer)));
+    CY_TEST_CHECK((int)(0x80000000U | sizeof(buffer)) ==
+                  cy_romfs_sys_read_result(cy_romfs_read(fd, buffer, sizeof(buffer)),
+                                           sizeof(buffer)));
+    // A read of nothing is not the end of the file
+    CY_TEST_CHECK(0 == cy_romfs_sys_read_result(cy_romfs_read(fd, buffer, 0U), 0U));
+    CY_TEST_CHECK(0 == cy_romfs_close(fd));
+    CY_TEST_CHECK(-1 == cy_romfs_sys_read_result(cy_romfs_read(fd, buffer, 10U), 10U));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// main
+//--------------------------------------------------------------------------------------------------
+int main(void)
+{
+    cy_test_mount();
+    cy_test_map();
+    cy_test_read_seek();
+    cy_test_limit();
+    cy_test_sys_read();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,221 @@
+/***********************************************************************************************//**
+ * \file test_time_civil.c
+ *
+ * \brief
+ * Host test of the RTC calendar conversion of time() against mktime
+ *
+ ***************************************************************************************************
+ * \copyright
+ * Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **************************************************************************************************/
+
+#include "cy_test.h"
+#include "cy_test_rtc.h"
+#include "cy_time.h"
+#include "cy_mutex_pool.h"
+
+// Built with the default conversion and with CY_TIME_RTC_LOCALTIME. The kernel
+// is not started, so every time() call reads the stand-in RTC, which returns
+// the calendar time in cy_test_rtc_fixed. The result is compared with mktime
+// under TZ=UTC0 for three times of every day from 1601 to 2400 and for fields
+// outside of their normal ranges, which mktime normalizes. Afterwards one JSON
+// line reports the time per time() call (RTC read and conversion) and per
+// mktime call over the same dates.
+
+extern void cy_toolchain_init(void);
+
+static const int cy_test_times[][3] =
+{
+    { 0, 0, 0 }, { 12, 34, 56 }, { 23, 59, 59 }
+};
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_days_in_month
+//--------------------------------------------------------------------------------------------------
+static int cy_test_days_in_month(int year, int month)
+{
+    static const int days[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    bool             leap     = ((0 == (year % 4)) && (0 != (year % 100))) || (0 == (year % 400));
+    return days[month] + (((1 == month) && leap) ? 1 : 0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_compare
+//--------------------------------------------------------------------------------------------------
+static void cy_test_compare(const struct tm* rtc_time)
+{
+    struct tm copy     = *rtc_time;
+    time_t    expected = mktime(&copy);
+    cy_test_rtc_fixed = rtc_time;
+    time_t actual = time(NULL);
+    if (actual != expected)
+    {
+        fprintf(stderr, "%d-%02d-%02d %02d:%02d:%02d: time %lld, mktime %lld\n",
+                rtc_time->tm_year + 1900, rtc_time->tm_mon + 1, rtc_time->tm_mday,
+                rtc_time->tm_hour, rtc_time->tm_min, rtc_time->tm_sec, (long long)actual,
+                (long long)expected);
+    }
+    CY_TEST_CHECK(actual == expected);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_civil
+//--------------------------------------------------------------------------------------------------
+static void cy_test_civil(void)
+{
+    struct tm rtc_time = { 0 };
+    time_t    previous = 0;
+    uint32_t  days     = 0U;
+
+    for (int year = 1601; year <= 2400; year++)
+    {
+        for (int month = 0; month < 12; month++)
+        {
+            for (int day = 1; day <= cy_test_days_in_month(year, month); day++)
+            {
+                rtc_time.tm_year = year - 1900;
+                rtc_time.tm_mon  = month;
+                rtc_time.tm_mday = day;
+                for (uint32_t i = 0U; i < (sizeof(cy_test_times) / sizeof(cy_test_times[0])); i++)
+                {
+                    rtc_time.tm_hour = cy_test_times[i][0];
+                    rtc_time.tm_min  = cy_test_times[i][1];
+                    rtc_time.tm_sec  = cy_test_times[i][2];
+                    cy_test_compare(&rtc_time);
+                }
+                // Consecutive days are 86400 seconds apart
+                rtc_time.tm_hour = 0;
+                rtc_time.tm_min  = 0;
+                rtc_time.tm_sec  = 0;
+                cy_test_rtc_fixed = &rtc_time;
+                time_t midnight = time(NULL);
+                CY_TEST_CHECK((0U == days) || ((midnight - previous) == 86400));
+                previous = midnight;
+                days++;
+            }
+        }
+    }
+    CY_TEST_CHECK(292194U == days);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_out_of_range
+//--------------------------------------------------------------------------------------------------
+static void cy_test_out_of_range(void)
+{
+    struct tm rtc_time = { 0 };
+
+    for (int month = -30; month <= 30; month++)
+    {
+        for (int day = -2; day <= 33; day += 5)
+        {
+            rtc_time.tm_year = 2024 - 1900;
+            rtc_time.tm_mon  = month;
+            rtc_time.tm_mday = day;
+            rtc_time.tm_hour = 24;
+            rtc_time.tm_min  = -1;
+            rtc_time.tm_sec  = 60;
+            cy_test_compare(&rtc_time);
+            rtc_time.tm_hour = -1;
+            rtc_time.tm_min  = 61;
+            rtc_time.tm_sec  = -61;
+            cy_test_compare(&rtc_time);
+        }
+    }
+    // Around the epoch and 2038
+    rtc_time.tm_year = 70;
+    rtc_time.tm_mon  = 0;
+    rtc_time.tm_mday = 1;
+    rtc_time.tm_hour = 0;
+    rtc_time.tm_min  = 0;
+    rtc_time.tm_sec  = -1;
+    cy_test_compare(&rtc_time);
+    rtc_time.tm_year = 138;
+    rtc_time.tm_mday = 19;
+    rtc_time.tm_hour = 3;
+    rtc_time.tm_min  = 14;
+    rtc_time.tm_sec  = 8;
+    cy_test_compare(&rtc_time);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// cy_test_throughput
+//--------------------------------------------------------------------------------------------------
+static void cy_test_throughput(uint32_t count)
+{
+    struct tm    rtc_time = { 0 };
+    volatile int sink     = 0;
+
+    cy_test_rtc_fixed = &rtc_time;
+    uint64_t start = cy_test_now_ns();
+    for (uint32_t i = 0U; i < count; i++)
+    {
+        rtc_time.tm_year = 70 + (int)(i % 400U);
+        rtc_time.tm_mday = 1 + (int)(i % 28U);
+        sink            += (int)time(NULL);
+    }
+    uint64_t time_ns = cy_test_now_ns() - start;
+
+    start = cy_test_now_ns();
+    for (uint32_t i = 0U; i < count; i++)
+    {
+        struct tm copy = rtc_time;
+        copy.tm_year = 70 + (int)(i % 400U);
+        copy.tm_mday = 1 + (int)(i % 28U);
+        sink        += (int)mktime(&copy);
+    }
+    uint64_t mktime_ns = cy_test_now_ns() - start;
+    (void)sink;
+
+    #if defined(CY_TIME_RTC_LOCALTIME)
+    const char* conversion = "mktime";
+    #else
+    const char* conversion = "days_from_civil";
+    #endif
+    printf("{\"benchmark\": \"time_civil\", \"conversion\": \"%s\", \"calls\": %u, "
+           "\"time_ns_per_call\": %.1f, \"mktime_ns_per_call\": %.1f}\n", conversion, count,
+           (double)time_ns / (double)count, (double)mktime_ns / (double)count);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// main
+//--------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    bool quick = cy_test_option(argc, argv, "--quick");
+    long calls = cy_test_value(argc, argv, "--calls", quick ? 100000 : 2000000);
+    CY_TEST_CHECK(calls > 0);
+    CY_TEST_CHECK(0 == setenv("TZ", "UTC0", 1));
+    tzset();
+
+    struct tm start = { .tm_year = 100, .tm_mday = 1 };
+    cy_test_rtc_fixed = &start;
+    cy_mutex_pool_setup();
+    cy_toolchain_init();
+    mtb_clib_support_init(&cy_test_rtc);
+
+    cy_test_civil();
+    cy_test_out_of_range();
+    cy_test_throughput((uint32_t)calls);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,248 @@
+#!/usr/bin/env python3
+#
+# Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+# an affiliate of Cypress Semiconductor Corporation
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Formats binary log records written by CY_LOG (see source/cy_log.c).
+
+The format strings are read from the .cy_log_fmt section of the ELF file of the
+application. The log is read from a file, or from standard input if none is
+given, so that it can be piped from a serial port:
+
+    cy_log_decode.py app.elf log.bin
+    cy_log_decode.py --location app.elf < /dev/ttyACM0
+"""
+
+import argparse
+import datetime
+import re
+import struct
+import sys
+
+SECTION = ".cy_log_fmt"
+
+ARG_WORD = 0
+ARG_INT64 = 1
+ARG_DOUBLE = 2
+ARG_STRING = 3
+
+CONVERSION = re.compile(r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d+))?"
+                        r"(hh|h|ll|l|j|z|t|L)?([diouxXeEfFgGcsp%])")
+
+
+class Image:
+    """Format strings of an ELF file, by address."""
+
+    def __init__(self, path):
+        with open(path, "rb") as file:
+            data = file.read()
+        if data[:4] != b"\x7fELF":
+            raise ValueError(f"{path} is not an ELF file")
+        self.is_64 = data[4] == 2
+        self.endian = "<" if data[5] == 1 else ">"
+        self.pointer = "Q" if self.is_64 else "I"
+        if self.is_64:
+            shoff, = struct.unpack_from(self.endian + "Q", data, 0x28)
+            shentsize, shnum, shstrndx = struct.unpack_from(self.endian + "HHH", data, 0x3A)
+            header = self.endian + "IIQQQQIIQQ"
+        else:
+            shoff, = struct.unpack_from(self.endian + "I", data, 0x20)
+            shentsize, shnum, shstrndx = struct.unpack_from(self.endian + "HHH", data, 0x2E)
+            header = self.endian + "IIIIIIIIII"
+        sections = [struct.unpack_from(header, data, shoff + (i * shentsize))
+                    for i in range(shnum)]
+        names = sections[shstrndx]
+        self.base = None
+        self.contents = b""
+        for section in sections:
+            start = names[4] + section[0]
+            name = data[start:data.index(b"\0", start)].decode()
+            if name == SECTION:
+                self.base = section[3]
+                self.contents = data[section[4]:section[4] + section[5]]
+        if self.base is None:
+            raise ValueError(f"{path} has no {SECTION} section")
+
+    def string(self, address):
+        """Returns the format string and source location at address."""
+        offset = address - self.base
+        if not 0 <= offset < len(self.contents):
+            return None, None
+        end = self.contents.index(b"\0", offset)
+        location_end = self.contents.index(b"\0", end + 1)
+        return (self.contents[offset:end].decode(errors="replace"),
+                self.contents[end + 1:location_end].decode(errors="replace"))
+
+
+def frames(stream):
+    """Yields the COBS-decoded records of a stream, skipping corrupt ones."""
+    pending = bytearray()
+    while True:
+        chunk = stream.read(4096)
+        if not chunk:
+            break
+        pending += chunk
+        while True:
+            end = pending.find(b"\0")
+            if end < 0:
+                break
+            frame = bytes(pending[:end])
+            del pending[:end + 1]
+            record = cobs_decode(frame)
+            if record is not None:
+                yield record
+
+
+def cobs_decode(frame):
+    record = bytearray()
+    index = 0
+    while index < len(frame):
+        code = frame[index]
+        if (code == 0) or (index + code > len(frame)):
+            return None
+        record += frame[index + 1:index + code]
+        index += code
+        if (code != 0xFF) and (index < len(frame)):
+            record.append(0)
+    return bytes(record)
+
+
+def parse(image, record):
+    """Returns the format address, timestamp and arguments of a record."""
+    e = image.endian
+    address, timestamp, kinds = struct.unpack_from(e + image.pointer + "qI", record)
+    offset = struct.calcsize(e + image.pointer + "qI")
+    args = []
+    for i in range(kinds & 0xF):
+        kind = (kinds >> (4 + (2 * i))) & 0x3
+        if kind == ARG_WORD:
+            args.append((kind, struct.unpack_from(e + "I", record, offset)[0]))
+            offset += 4
+        elif kind == ARG_INT64:
+            args.append((kind, struct.unpack_from(e + "Q", record, offset)[0]))
+            offset += 8
+        elif kind == ARG_DOUBLE:
+            args.append((kind, struct.unpack_from(e + "d", record, offset)[0]))
+            offset += 8
+        else:
+            size = record[offset]
+            args.append((kind, record[offset + 1:offset + 1 + size].decode(errors="replace")))
+            offset += 1 + size
+    return address, timestamp, args
+
+
+def convert(kind, value, conversion, length):
+    """Returns an argument as the Python value for a conversion."""
+    if kind == ARG_STRING or kind == ARG_DOUBLE:
+        return value
+    bits = 32 if kind == ARG_WORD else 64
+    if length in ("hh", "h"):
+        bits = 8 if length == "hh" else 16
+        value &= (1 << bits) - 1
+    if conversion in "di" and (value >> (bits - 1)) & 1:
+        value -= 1 << bits
+    if conversion in "eEfFgG":
+        return float(value)
+    return value
+
+
+def format_message(text, args):
+    """Formats a C printf format string with the recorded arguments."""
+    pending = list(args)
+    out = []
+    position = 0
+
+    def take():
+        return pending.pop(0) if pending else (ARG_WORD, 0)
+
+    for match in CONVERSION.finditer(text):
+        out.append(text[position:match.start()])
+        position = match.end()
+        flags, width, precision, length, conversion = match.groups()
+        if conversion == "%":
+            out.append("%")
+            continue
+        if width == "*":
+            width = str(convert(*take(), "d", None))
+        if precision == "*":
+            precision = str(convert(*take(), "d", None))
+        spec = "%" + flags + (width or "") + (("." + precision) if precision is not None else "")
+        kind, value = take()
+        value = convert(kind, value, conversion, length)
+        if (conversion == "o") and ("#" in flags):
+            # C marks octal with a leading zero, which Python writes as "0o"
+            digits = len("%o" % value) + (1 if value else 0)
+            precision = str(max(int(precision or 0), digits))
+            spec = "%" + flags.replace("#", "") + (width or "") + "." + precision
+            out.append((spec + "o") % value)
+        elif conversion == "p":
+            out.append((spec + "s") % hex(value))
+        elif conversion == "u":
+            out.append((spec + "d") % value)
+        elif conversion == "c":
+            out.append((spec + "s") % chr(value & 0xFF))
+        elif conversion == "s":
+            out.append((spec + "s") % value)
+        else:
+            try:
+                out.append((spec + conversion) % value)
+            except TypeError:
+                out.append((spec + "s") % value)
+    out.append(text[position:])
+    return "".join(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf", help="ELF file of the application")
+    parser.add_argument("log", nargs="?", help="binary log, standard input if not given")
+    parser.add_argument("--location", action="store_true", help="show the source location")
+    parser.add_argument("--raw-time", action="store_true",
+                        help="show timestamps as microseconds instead of UTC")
+    options = parser.parse_args()
+
+    image = Image(options.elf)
+    stream = open(options.log, "rb") if options.log else sys.stdin.buffer
+    for record in frames(stream):
+        try:
+            address, timestamp, args = parse(image, record)
+        except (struct.error, IndexError):
+            print("<corrupt record>")
+            continue
+        if options.raw_time:
+            stamp = f"{timestamp:>16}"
+        else:
+            stamp = (datetime.datetime.fromtimestamp(0, datetime.timezone.utc) +
+                     datetime.timedelta(microseconds=timestamp)).strftime("%Y-%m-%d %H:%M:%S.%f")
+        if address == 0:
+            message = f"<{args[0][1] if args else 0} records dropped>"
+            location = None
+        else:
+            text, location = image.string(address)
+            if text is None:
+                message = f"<unknown format 0x{address:x}> {[value for _, value in args]}"
+            else:
+                message = format_message(text, args)
+        if options.location and location:
+            print(f"{stamp} {message}  ({location})")
+        else:
+            print(f"{stamp} {message}")
+        sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+#
+# Copyright 2018-2022 Cypress Semiconductor Corporation (an Infineon company) or
+# an affiliate of Cypress Semiconductor Corporation
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Builds a ROM file system image (see source/cy_romfs.c) from a directory.
+
+The image is written as a C source file defining a const array, which is
+linked into flash and passed to cy_romfs_mount, or with --binary as a raw image
+to be programmed at an address of the application's choosing:
+
+    cy_romfs_image.py assets cy_romfs_image.c
+    cy_romfs_image.py --align 32 --name assets_image assets assets_image.c
+    cy_romfs_image.py --binary assets assets.bin
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+MAGIC = 0x46525943  # "CYRF"
+VERSION = 1
+HEADER = struct.Struct("<IHHII")
+ENTRY = struct.Struct("<III")
+
+
+def collect(root):
+    """Returns the (path, contents) of the files under root, sorted as strcmp compares paths."""
+    files = []
+    for directory, subdirectories, names in os.walk(root):
+        subdirectories.sort()
+        for name in names:
+            full = os.path.join(directory, name)
+            path = os.path.relpath(full, root).replace(os.sep, "/").encode()
+            if b"\0" in path:
+                raise ValueError(f"invalid file name {full!r}")
+            with open(full, "rb") as file:
+                files.append((path, file.read()))
+    files.sort(key=lambda item: item[0])
+    return files
+
+
+def build(files, alignment):
+    """Returns the image of files, whose contents are aligned to alignment bytes."""
+    def pad(image):
+        image += bytes(-len(image) % alignment)
+
+    image = bytearray(HEADER.size + (ENTRY.size * len(files)))
+    path_offsets = []
+    for path, _ in files:
+        path_offsets.append(len(image))
+        image += path + b"\0"
+    entries = []
+    for (path, contents), path_offset in zip(files, path_offsets):
+        pad(image)
+        entries.append((path_offset, len(image), len(contents)))
+        image += contents
+    pad(image)
+    HEADER.pack_into(image, 0, MAGIC, VERSION, alignment, len(files), len(image))
+    for index, entry in enumerate(entries):
+        ENTRY.pack_into(image, HEADER.size + (index * ENTRY.size), *entry)
+    return bytes(image)
+
+
+def write_c(image, files, name, alignment, output):
+    output.write("// Generated by cy_romfs_image.py; do not edit.\n")
+    output.write("// Mount with cy_romfs_mount(%s). Files:\n" % name)
+    for path, contents in files:
+        output.write("//     %s (%d bytes)\n" % (path.decode(errors="replace"), len(contents)))
+    output.write("\n#include <stdint.h>\n#include <cmsis_compiler.h>\n\n")
+    output.write("const uint8_t %s[%d] __ALIGNED(%d) =\n{\n" % (name, len(image), alignment))
+    for start in range(0, len(image), 16):
+        row = ", ".join("0x%02X" % byte for byte in image[start:start + 16])
+        output.write("    %s,\n" % row)
+    output.write("};\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("directory", help="directory holding the files of the image")
+    parser.add_argument("output", help="C source file, or image with --binary")
+    parser.add_argument("--binary", action="store_true", help="write the raw image")
+    parser.add_argument("--name", default="cy_romfs_image",
+                        help="name of the array in the C source file (default cy_romfs_image)")
+    parser.add_argument("--align", type=int, default=8,
+                        help="alignment of the contents of each file in bytes, a power of "
+                             "two from 4 to 32768 (default 8)")
+    options = parser.parse_args()
+
+    if (options.align < 4) or (options.align > 32768) or (options.align & (options.align - 1)):
+        parser.error("--align must be a power of two from 4 to 32768")
+    files = collect(options.directory)
+    image = build(files, options.align)
+    if options.binary:
+        with open(options.output, "wb") as output:
+            output.write(image)
+    else:
+        with open(options.output, "w") as output:
+            write_c(image, files, options.name, options.align, output)
+    print("%s: %d files, %d bytes" % (options.output, len(files), len(image)), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()